@@ -0,0 +1,316 @@
+// CPU pose evaluation of many animated characters: every instance samples two clips, cross-fades them and builds
+// its skinning matrices. Compares a plain glm evaluator over the imported keys with PoseEvaluator over the
+// compressed clips on one thread and on the thread pool, and reports what AnimationCompressor saved.
+//   CanaryBenchmark animation [instances] [frames] [model]
+// Without a model a procedural 64 bone skeleton with two clips is used, so the benchmark needs no assets.
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "Benchmark.h"
+#include "Engine/Animation/AnimationCompressor.h"
+#include "Engine/Animation/PoseEvaluator.h"
+#include "Engine/Core/ThreadPool.h"
+#include "Engine/Mesh/Model.h"
+
+namespace
+{
+	const float FrameTime = 1.0f / 60.0f;
+
+	// Spine of eight bones with a chain of seven hanging off every spine bone
+	void BuildProceduralSkeleton(SkeletonData& OutSkeleton)
+	{
+		const int SpineLength = 8;
+		const int ChainLength = 7;
+
+		auto AddBone = [&OutSkeleton](int32_t Parent, const glm::vec3& Offset)
+		{
+			BoneTransform Bind;
+			Bind.Translation = glm::vec4(Offset, 0.0f);
+			OutSkeleton.BoneNames.push_back("Bone" + std::to_string(OutSkeleton.GetBoneCount()));
+			OutSkeleton.Parents.push_back(Parent);
+			OutSkeleton.BindPose.push_back(Bind);
+			return static_cast<int32_t>(OutSkeleton.GetBoneCount() - 1);
+		};
+
+		int32_t Spine = -1;
+		for (int SpineBone = 0; SpineBone < SpineLength; SpineBone++)
+		{
+			Spine = AddBone(Spine, glm::vec3(0.0f, SpineBone == 0 ? 0.0f : 0.1f, 0.0f));
+			int32_t Link = Spine;
+			for (int ChainBone = 0; ChainBone < ChainLength; ChainBone++)
+			{
+				Link = AddBone(Link, glm::vec3(0.08f, 0.0f, 0.0f));
+			}
+		}
+
+		// inverse of the model space bind pose, so the bind pose skins to identity
+		std::vector<glm::mat4> ModelSpace(OutSkeleton.GetBoneCount());
+		for (size_t Bone = 0; Bone < OutSkeleton.GetBoneCount(); Bone++)
+		{
+			const glm::mat4 Local = glm::translate(glm::mat4(1.0f), glm::vec3(OutSkeleton.BindPose[Bone].Translation));
+			ModelSpace[Bone] = OutSkeleton.Parents[Bone] >= 0 ? ModelSpace[OutSkeleton.Parents[Bone]] * Local : Local;
+			OutSkeleton.InverseBindMatrices.push_back(glm::inverse(ModelSpace[Bone]));
+		}
+	}
+
+	// Appends Count keys sampled from Value(Time) evenly over the clip
+	template <typename ValueFunc>
+	AnimationKeyRange AddKeys(AnimationClipData& Clip, uint32_t Count, ValueFunc Value)
+	{
+		AnimationKeyRange Range;
+		Range.First = static_cast<uint32_t>(Clip.Times.size());
+		Range.Count = Count;
+		for (uint32_t Key = 0; Key < Count; Key++)
+		{
+			const float Time = Clip.Duration * Key / (Count - 1);
+			Clip.Times.push_back(Time);
+			Clip.Values.push_back(Value(Time));
+		}
+		return Range;
+	}
+
+	// Every bone swings around its own axis and the root also moves. Like a typical export every channel is baked
+	// at 30 keys per second, including the translations and scales that never change.
+	AnimationClipData BuildProceduralClip(const SkeletonData& Skeleton, const std::string& Name, float Duration, float Frequency)
+	{
+		const uint32_t KeyCount = static_cast<uint32_t>(Duration * 30.0f) + 1;
+
+		AnimationClipData Clip;
+		Clip.Name = Name;
+		Clip.Duration = Duration;
+		for (uint32_t Bone = 0; Bone < Skeleton.GetBoneCount(); Bone++)
+		{
+			const glm::vec3 Axis = glm::normalize(glm::vec3(std::sin(Bone * 1.3f), std::cos(Bone * 0.7f), 0.5f));
+			const glm::vec4 Offset = Skeleton.BindPose[Bone].Translation;
+
+			AnimationTrackData Track;
+			Track.Bone = Bone;
+			Track.Translation = AddKeys(Clip, KeyCount, [&](float Time)
+			{
+				return Bone == 0 ? glm::vec4(0.0f, 0.05f * std::sin(6.2831853f * 2.0f * Frequency * Time), Time, 0.0f) : Offset;
+			});
+			Track.Rotation = AddKeys(Clip, KeyCount, [&](float Time)
+			{
+				const glm::quat Rotation = glm::angleAxis(0.6f * std::sin(6.2831853f * Frequency * Time + Bone), Axis);
+				return glm::vec4(Rotation.x, Rotation.y, Rotation.z, Rotation.w);
+			});
+			Track.Scale = AddKeys(Clip, KeyCount, [](float)
+			{
+				return glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+			});
+			Clip.Tracks.push_back(Track);
+		}
+		return Clip;
+	}
+
+	// Straightforward glm version of PoseEvaluator::Evaluate, the baseline for the SIMD path
+	namespace Reference
+	{
+		glm::vec4 SampleVector(const AnimationClipData& Clip, const AnimationKeyRange& Range, float Time)
+		{
+			const float* Times = Clip.Times.data() + Range.First;
+			const uint32_t Next = static_cast<uint32_t>(std::upper_bound(Times, Times + Range.Count, Time) - Times);
+			if (Next == 0 || Next == Range.Count)
+			{
+				return Clip.Values[Range.First + (Next == 0 ? 0 : Range.Count - 1)];
+			}
+			const float Fraction = (Time - Times[Next - 1]) / (Times[Next] - Times[Next - 1]);
+			return glm::mix(Clip.Values[Range.First + Next - 1], Clip.Values[Range.First + Next], Fraction);
+		}
+
+		glm::quat SampleRotation(const AnimationClipData& Clip, const AnimationKeyRange& Range, float Time)
+		{
+			const float* Times = Clip.Times.data() + Range.First;
+			const uint32_t Next = static_cast<uint32_t>(std::upper_bound(Times, Times + Range.Count, Time) - Times);
+			const uint32_t First = Range.First + (Next == 0 ? 0 : Next - 1);
+			const uint32_t Second = Range.First + std::min(Next, Range.Count - 1);
+			const float Fraction = First == Second ? 0.0f : (Time - Clip.Times[First]) / (Clip.Times[Second] - Clip.Times[First]);
+
+			const glm::vec4& A = Clip.Values[First];
+			const glm::vec4& B = Clip.Values[Second];
+			return glm::slerp(glm::quat(A.w, A.x, A.y, A.z), glm::quat(B.w, B.x, B.y, B.z), Fraction);
+		}
+
+		void SampleClip(const SkeletonData& Skeleton, const AnimationClipData& Clip, float Time, std::vector<BoneTransform>& OutPose)
+		{
+			OutPose = Skeleton.BindPose;
+			for (const AnimationTrackData& Track : Clip.Tracks)
+			{
+				if (Track.Translation.Count > 0)
+				{
+					OutPose[Track.Bone].Translation = SampleVector(Clip, Track.Translation, Time);
+				}
+				if (Track.Rotation.Count > 0)
+				{
+					OutPose[Track.Bone].Rotation = SampleRotation(Clip, Track.Rotation, Time);
+				}
+				if (Track.Scale.Count > 0)
+				{
+					OutPose[Track.Bone].Scale = SampleVector(Clip, Track.Scale, Time);
+				}
+			}
+		}
+
+		// Samples the imported keys the instance's compressed clips were made from
+		void Evaluate(const AnimationSetData& Animation, AnimationInstance& Instance, PoseScratch& Scratch)
+		{
+			const SkeletonData& Skeleton = Animation.Skeleton;
+
+			SampleClip(Skeleton, Animation.Clips[Instance.Clip], Instance.Time, Scratch.Pose);
+			SampleClip(Skeleton, Animation.Clips[Instance.BlendClip], Instance.BlendTime, Scratch.BlendPose);
+
+			Scratch.ModelSpace.resize(Skeleton.GetBoneCount());
+			Instance.SkinningMatrices.resize(Skeleton.GetBoneCount());
+			for (size_t Bone = 0; Bone < Skeleton.GetBoneCount(); Bone++)
+			{
+				const BoneTransform& A = Scratch.Pose[Bone];
+				const BoneTransform& B = Scratch.BlendPose[Bone];
+				const glm::quat Rotation = glm::slerp(A.Rotation, B.Rotation, Instance.BlendWeight);
+				const glm::vec3 Translation = glm::mix(glm::vec3(A.Translation), glm::vec3(B.Translation), Instance.BlendWeight);
+				const glm::vec3 Scale = glm::mix(glm::vec3(A.Scale), glm::vec3(B.Scale), Instance.BlendWeight);
+
+				const glm::mat4 Local = glm::translate(glm::mat4(1.0f), Translation) * glm::mat4_cast(Rotation) * glm::scale(glm::mat4(1.0f), Scale);
+				const int32_t Parent = Skeleton.Parents[Bone];
+				Scratch.ModelSpace[Bone] = Parent >= 0 ? Scratch.ModelSpace[Parent] * Local : Local;
+				Instance.SkinningMatrices[Bone] = Scratch.ModelSpace[Bone] * Skeleton.InverseBindMatrices[Bone];
+			}
+		}
+	}
+
+	std::vector<AnimationInstance> CreateInstances(const AnimationSet& Animation, int Count)
+	{
+		std::vector<AnimationInstance> Instances(Count);
+		for (int Index = 0; Index < Count; Index++)
+		{
+			AnimationInstance& Instance = Instances[Index];
+			Instance.Animation = &Animation;
+			Instance.Clip = 0;
+			Instance.BlendClip = static_cast<int>(Animation.Clips.size() > 1 ? 1 : 0);
+			Instance.Time = Animation.Clips[0].Duration * (Index % 97) / 97.0f;
+			Instance.BlendTime = Animation.Clips[Instance.BlendClip].Duration * (Index % 89) / 89.0f;
+			Instance.BlendWeight = (Index % 11) / 10.0f;
+			Instance.Speed = 0.75f + (Index % 5) * 0.125f;
+		}
+		return Instances;
+	}
+
+	float MaxDifference(const std::vector<AnimationInstance>& A, const std::vector<AnimationInstance>& B)
+	{
+		float Difference = 0.0f;
+		for (size_t Index = 0; Index < A.size(); Index++)
+		{
+			for (size_t Bone = 0; Bone < A[Index].SkinningMatrices.size(); Bone++)
+			{
+				for (int Column = 0; Column < 4; Column++)
+				{
+					const glm::vec4 Delta = glm::abs(A[Index].SkinningMatrices[Bone][Column] - B[Index].SkinningMatrices[Bone][Column]);
+					Difference = std::max(Difference, std::max(std::max(Delta.x, Delta.y), std::max(Delta.z, Delta.w)));
+				}
+			}
+		}
+		return Difference;
+	}
+
+	int RunAnimationBenchmark(const std::vector<std::string>& Args)
+	{
+		const int InstanceCount = std::max(1, GetIntArg(Args, 0, 1000));
+		const int Frames = std::max(1, GetIntArg(Args, 1, 100));
+
+		AnimationSetData Imported;
+		if (Args.size() > 2)
+		{
+			std::vector<MeshData> Meshes;
+			if (!Model::ImportMeshData(Args[2], Meshes, EModelImporter::Assimp, nullptr, &Imported) || Imported.Clips.empty())
+			{
+				std::cout << "No skeleton or clips in " << Args[2] << std::endl;
+				return 1;
+			}
+		}
+		else
+		{
+			BuildProceduralSkeleton(Imported.Skeleton);
+			Imported.Clips.push_back(BuildProceduralClip(Imported.Skeleton, "Walk", 1.0f, 1.0f));
+			Imported.Clips.push_back(BuildProceduralClip(Imported.Skeleton, "Run", 0.7f, 1.5f));
+		}
+
+		AnimationSet Animation;
+		AnimationCompressionStats CompressionStats;
+		const BenchmarkTimings CompressTimings = MeasureRuns(1, [&]()
+		{
+			CompressionStats = AnimationCompressor::Compress(Imported, Animation);
+		});
+
+		std::cout << "Animation: " << InstanceCount << " instances, " << Animation.Skeleton.GetBoneCount() << " bones, " << Animation.Clips.size()
+			<< " clips, " << Frames << " frames, " << ThreadPool::Get().GetThreadCount() + 1 << " threads" << std::endl;
+		AnimationCompressor::PrintStats("clips", CompressionStats);
+		PrintTimings("compression", CompressTimings);
+		if (CompressionStats.ClipsOverTolerance > 0)
+		{
+			std::cout << "ERROR::BENCHMARK::Compressed clips are over the tolerance" << std::endl;
+			return 1;
+		}
+
+		std::vector<AnimationInstance> ReferenceInstances = CreateInstances(Animation, InstanceCount);
+		std::vector<AnimationInstance> SingleInstances = ReferenceInstances;
+		std::vector<AnimationInstance> ParallelInstances = ReferenceInstances;
+
+		PoseScratch Scratch;
+		const BenchmarkTimings ReferenceTimings = MeasureRuns(Frames, [&]()
+		{
+			for (AnimationInstance& Instance : ReferenceInstances)
+			{
+				PoseEvaluator::Advance(Instance, FrameTime);
+				Reference::Evaluate(Imported, Instance, Scratch);
+			}
+		});
+		const BenchmarkTimings SingleTimings = MeasureRuns(Frames, [&]()
+		{
+			for (AnimationInstance& Instance : SingleInstances)
+			{
+				PoseEvaluator::Advance(Instance, FrameTime);
+				PoseEvaluator::Evaluate(Instance, Scratch);
+			}
+		});
+		const BenchmarkTimings ParallelTimings = MeasureRuns(Frames, [&]()
+		{
+			PoseEvaluator::EvaluateInstances(ParallelInstances, FrameTime);
+		});
+
+		// clip sampling alone, imported keys against compressed ones decoded on the fly
+		std::vector<BoneTransform> Pose(Animation.Skeleton.GetBoneCount());
+		auto SampleAll = [&](auto& Clips)
+		{
+			for (int Index = 0; Index < InstanceCount; Index++)
+			{
+				const auto& Clip = Clips[Index % Clips.size()];
+				PoseEvaluator::SampleClip(Animation.Skeleton, Clip, Clip.Duration * (Index % 97) / 97.0f, Pose.data());
+			}
+		};
+		const BenchmarkTimings RawSampleTimings = MeasureRuns(Frames, [&]() { SampleAll(Imported.Clips); });
+		const BenchmarkTimings CompressedSampleTimings = MeasureRuns(Frames, [&]() { SampleAll(Animation.Clips); });
+
+		PrintTimings("sample imported keys", RawSampleTimings);
+		PrintTimings("sample compressed keys", CompressedSampleTimings);
+		PrintTimings("glm reference", ReferenceTimings);
+		PrintTimings("SIMD, one thread", SingleTimings);
+		PrintTimings("SIMD, thread pool", ParallelTimings);
+
+		const double Matrices = double(InstanceCount) * Animation.Skeleton.GetBoneCount();
+		std::cout << "SIMD speedup (min): " << ReferenceTimings.MinMs / SingleTimings.MinMs << "x, thread pool speedup (min): "
+			<< SingleTimings.MinMs / ParallelTimings.MinMs << "x" << std::endl;
+		std::cout << "per instance: " << ParallelTimings.AverageMs * 1000.0 / InstanceCount << " us, "
+			<< Matrices / (ParallelTimings.AverageMs / 1000.0) / 1e6 << " M skinning matrices/s" << std::endl;
+
+		// nlerp against slerp and compressed keys against imported ones, so only close
+		std::cout << "max difference to reference: " << MaxDifference(ReferenceInstances, ParallelInstances) << std::endl;
+		return 0;
+	}
+
+	BenchmarkRegistration Registration("animation", "sample, blend and skin 1,000 animated instances on the CPU", &RunAnimationBenchmark);
+}
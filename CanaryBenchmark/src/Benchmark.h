@@ -0,0 +1,39 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Minimal harness shared by the benchmarks. Each benchmark lives in its own file and registers itself with a
+// static BenchmarkRegistration, BenchmarkMain picks the one named on the command line.
+
+typedef int (*BenchmarkFunction)(const std::vector<std::string>& Args);
+
+struct BenchmarkEntry
+{
+	const char* Name;
+	const char* Description;
+	BenchmarkFunction Run;
+};
+
+std::vector<BenchmarkEntry>& GetBenchmarks();
+
+struct BenchmarkRegistration
+{
+	BenchmarkRegistration(const char* Name, const char* Description, BenchmarkFunction Run);
+};
+
+struct BenchmarkTimings
+{
+	double MinMs = 0.0;
+	double AverageMs = 0.0;
+	double MaxMs = 0.0;
+};
+
+// Runs Func the given number of times and returns the wall clock timings
+BenchmarkTimings MeasureRuns(int Iterations, const std::function<void()>& Func);
+
+void PrintTimings(const std::string& Label, const BenchmarkTimings& Timings);
+
+// Returns Args[Index] converted to an int, or Default if it was not passed
+int GetIntArg(const std::vector<std::string>& Args, size_t Index, int Default);
@@ -0,0 +1,84 @@
+// CanaryBenchmark runs the engine's CPU side benchmarks. Run it from the CanaryEngine directory so the default
+// asset paths resolve.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+#include "Benchmark.h"
+
+std::vector<BenchmarkEntry>& GetBenchmarks()
+{
+	static std::vector<BenchmarkEntry> Benchmarks;
+	return Benchmarks;
+}
+
+BenchmarkRegistration::BenchmarkRegistration(const char* Name, const char* Description, BenchmarkFunction Run)
+{
+	GetBenchmarks().push_back({ Name, Description, Run });
+}
+
+BenchmarkTimings MeasureRuns(int Iterations, const std::function<void()>& Func)
+{
+	BenchmarkTimings Timings;
+	Timings.MinMs = 1e30;
+
+	double TotalMs = 0.0;
+	for (int i = 0; i < Iterations; i++)
+	{
+		const auto Start = std::chrono::high_resolution_clock::now();
+		Func();
+		const auto End = std::chrono::high_resolution_clock::now();
+
+		const double Ms = std::chrono::duration<double, std::milli>(End - Start).count();
+		Timings.MinMs = std::min(Timings.MinMs, Ms);
+		Timings.MaxMs = std::max(Timings.MaxMs, Ms);
+		TotalMs += Ms;
+	}
+
+	Timings.AverageMs = Iterations > 0 ? TotalMs / Iterations : 0.0;
+	return Timings;
+}
+
+void PrintTimings(const std::string& Label, const BenchmarkTimings& Timings)
+{
+	std::cout << std::left << std::setw(28) << Label << std::right << std::fixed << std::setprecision(2)
+		<< " min " << std::setw(9) << Timings.MinMs << " ms"
+		<< "  avg " << std::setw(9) << Timings.AverageMs << " ms"
+		<< "  max " << std::setw(9) << Timings.MaxMs << " ms" << std::endl;
+}
+
+int GetIntArg(const std::vector<std::string>& Args, size_t Index, int Default)
+{
+	return Index < Args.size() ? std::atoi(Args[Index].c_str()) : Default;
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<BenchmarkEntry>& Benchmarks = GetBenchmarks();
+	std::sort(Benchmarks.begin(), Benchmarks.end(), [](const BenchmarkEntry& A, const BenchmarkEntry& B) { return std::strcmp(A.Name, B.Name) < 0; });
+
+	if (argc < 2)
+	{
+		std::cout << "Usage: CanaryBenchmark <benchmark> [args...]" << std::endl;
+		for (const BenchmarkEntry& Entry : Benchmarks)
+		{
+			std::cout << "  " << std::left << std::setw(12) << Entry.Name << Entry.Description << std::endl;
+		}
+		return 1;
+	}
+
+	for (const BenchmarkEntry& Entry : Benchmarks)
+	{
+		if (std::strcmp(Entry.Name, argv[1]) == 0)
+		{
+			return Entry.Run(std::vector<std::string>(argv + 2, argv + argc));
+		}
+	}
+
+	std::cout << "Unknown benchmark " << argv[1] << std::endl;
+	return 1;
+}
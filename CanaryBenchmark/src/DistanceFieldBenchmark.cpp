@@ -0,0 +1,113 @@
+// Distance field generation speed: DistanceFieldBuilder::Build on a generated torus, reported as voxels per second.
+// The torus has an exact distance function, so the result is also checked against it: the largest error in voxels
+// (bounded below by how far the tessellation is from the true surface) and the voxels whose sign is wrong.
+//   CanaryBenchmark sdf [resolution] [iterations] [segments]
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "Benchmark.h"
+#include "Engine/Core/ThreadPool.h"
+#include "Engine/Mesh/DistanceField.h"
+
+namespace
+{
+	const float MajorRadius = 1.0f;
+	const float MinorRadius = 0.35f;
+
+	// Segments around the ring and half as many around the tube, two triangles per quad
+	MeshData MakeTorus(int Segments)
+	{
+		const float TwoPi = 6.28318530718f;
+		const int Rings = Segments;
+		const int Sides = std::max(Segments / 2, 3);
+
+		MeshData Torus;
+		for (int Ring = 0; Ring < Rings; Ring++)
+		{
+			const float U = TwoPi * Ring / Rings;
+			for (int Side = 0; Side < Sides; Side++)
+			{
+				const float V = TwoPi * Side / Sides;
+				const glm::vec3 Normal(std::cos(U) * std::cos(V), std::sin(V), std::sin(U) * std::cos(V));
+
+				Vertex Point;
+				Point.Position = glm::vec3(std::cos(U), 0.0f, std::sin(U)) * MajorRadius + Normal * MinorRadius;
+				Point.Normal = Normal;
+				Point.TexCoords = glm::vec2(float(Ring) / Rings, float(Side) / Sides);
+				Torus.Vertices.push_back(Point);
+			}
+		}
+
+		for (int Ring = 0; Ring < Rings; Ring++)
+		{
+			for (int Side = 0; Side < Sides; Side++)
+			{
+				const unsigned int A = Ring * Sides + Side;
+				const unsigned int B = ((Ring + 1) % Rings) * Sides + Side;
+				const unsigned int C = ((Ring + 1) % Rings) * Sides + (Side + 1) % Sides;
+				const unsigned int D = Ring * Sides + (Side + 1) % Sides;
+				Torus.Indices.insert(Torus.Indices.end(), { A, B, C, A, C, D });
+			}
+		}
+		return Torus;
+	}
+
+	float GetTorusDistance(const glm::vec3& Position)
+	{
+		const glm::vec2 Ring(glm::length(glm::vec2(Position.x, Position.z)) - MajorRadius, Position.y);
+		return glm::length(Ring) - MinorRadius;
+	}
+
+	int RunDistanceFieldBenchmark(const std::vector<std::string>& Args)
+	{
+		DistanceFieldSettings Settings;
+		Settings.Resolution = static_cast<unsigned int>(GetIntArg(Args, 0, 64));
+		const int Iterations = GetIntArg(Args, 1, 5);
+		const int Segments = GetIntArg(Args, 2, 256);
+
+		const std::vector<MeshData> Meshes(1, MakeTorus(Segments));
+		std::cout << "Distance field: torus of " << Meshes[0].Indices.size() / 3 << " triangles, resolution " << Settings.Resolution << ", "
+			<< ThreadPool::Get().GetThreadCount() + 1 << " threads, " << Iterations << " iterations" << std::endl;
+
+		DistanceFieldData Field;
+		const BenchmarkTimings Timings = MeasureRuns(Iterations, [&]()
+		{
+			DistanceFieldBuilder::Build(Meshes, Field, Settings);
+		});
+		if (Field.IsEmpty())
+		{
+			std::cout << "ERROR::BENCHMARK::No distance field was built" << std::endl;
+			return 1;
+		}
+
+		float MaxError = 0.0f;
+		size_t WrongSigns = 0;
+		for (int Z = 0; Z < Field.Resolution.z; Z++)
+		{
+			for (int Y = 0; Y < Field.Resolution.y; Y++)
+			{
+				for (int X = 0; X < Field.Resolution.x; X++)
+				{
+					const glm::vec3 Center = Field.BoundsMin + (glm::vec3(X, Y, Z) + 0.5f) * Field.VoxelSize;
+					const float Expected = GetTorusDistance(Center);
+					const float Actual = Field.GetDistance(X, Y, Z);
+					MaxError = std::max(MaxError, std::abs(Actual - Expected));
+					WrongSigns += (Actual < 0.0f) != (Expected < 0.0f) && std::abs(Expected) > Field.VoxelSize * 0.1f ? 1 : 0;
+				}
+			}
+		}
+
+		const size_t VoxelCount = Field.Distances.size();
+		std::cout << "volume: " << Field.Resolution.x << "x" << Field.Resolution.y << "x" << Field.Resolution.z << " (" << VoxelCount
+			<< " voxels, " << VoxelCount * sizeof(int16_t) / 1024 << " KiB)" << std::endl;
+		PrintTimings("build", Timings);
+		std::cout << "voxels/s (min): " << VoxelCount / (Timings.MinMs / 1000.0) << std::endl;
+		std::cout << "max error: " << MaxError / Field.VoxelSize << " voxels, wrong signs: " << WrongSigns << std::endl;
+		return 0;
+	}
+
+	BenchmarkRegistration Registration("sdf", "signed distance field generation speed in voxels per second", &RunDistanceFieldBenchmark);
+}
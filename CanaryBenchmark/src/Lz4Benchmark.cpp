@@ -0,0 +1,160 @@
+// LZ4 block codec: checks Lz4::Decompress against blocks produced by the reference implementation (liblz4 1.9,
+// LZ4_compress_default) and round trips them through Lz4::Compress, then measures both directions on generated text
+// in MB/s. Fails if any block does not decode to its input.
+//   CanaryBenchmark lz4 [megabytes] [iterations]
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "Engine/Core/Lz4.h"
+
+namespace
+{
+	struct ReferenceBlock
+	{
+		const char* Name;
+		std::string Input;
+		std::vector<uint8_t> Compressed;
+	};
+
+	std::string Repeat(const std::string& Value, int Count)
+	{
+		std::string Result;
+		for (int i = 0; i < Count; i++)
+		{
+			Result += Value;
+		}
+		return Result;
+	}
+
+	std::string Sequence(int Count)
+	{
+		std::string Result;
+		for (int i = 0; i < Count; i++)
+		{
+			Result += static_cast<char>(i);
+		}
+		return Result;
+	}
+
+	std::vector<ReferenceBlock> GetReferenceBlocks()
+	{
+		return {
+			{ "empty", std::string(), { 0x00 } },
+			{ "literals only", "Hello, LZ4!", { 0xB0, 0x48, 0x65, 0x6C, 0x6C, 0x6F, 0x2C, 0x20, 0x4C, 0x5A, 0x34, 0x21 } },
+			{ "repeated sentence", Repeat("The quick brown fox jumps over the lazy dog. ", 3), {
+				0xFF, 0x1E, 0x54, 0x68, 0x65, 0x20, 0x71, 0x75, 0x69, 0x63, 0x6B, 0x20, 0x62, 0x72, 0x6F, 0x77, 0x6E, 0x20,
+				0x66, 0x6F, 0x78, 0x20, 0x6A, 0x75, 0x6D, 0x70, 0x73, 0x20, 0x6F, 0x76, 0x65, 0x72, 0x20, 0x74, 0x68, 0x65,
+				0x20, 0x6C, 0x61, 0x7A, 0x79, 0x20, 0x64, 0x6F, 0x67, 0x2E, 0x20, 0x2D, 0x00, 0x42, 0x50, 0x64, 0x6F, 0x67,
+				0x2E, 0x20 } },
+			{ "overlapping match", std::string(300, 'a'), { 0x1F, 0x61, 0x01, 0x00, 0xFF, 0x14, 0x50, 0x61, 0x61, 0x61, 0x61, 0x61 } },
+			{ "long literal run", Sequence(40) + Sequence(40), {
+				0xFF, 0x19, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+				0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21,
+				0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x00, 0x10, 0x50, 0x23, 0x24, 0x25, 0x26, 0x27 } },
+		};
+	}
+
+	bool RoundTrip(const uint8_t* Data, size_t Size, std::vector<uint8_t>& Compressed, std::vector<uint8_t>& Decompressed)
+	{
+		Compressed.resize(Lz4::CompressBound(Size));
+		const size_t CompressedSize = Lz4::Compress(Data, Size, Compressed.data(), Compressed.size());
+		Compressed.resize(CompressedSize);
+		Decompressed.assign(Size, 0);
+		return CompressedSize > 0 && Lz4::Decompress(Compressed.data(), CompressedSize, Decompressed.data(), Size)
+			&& (Size == 0 || std::memcmp(Decompressed.data(), Data, Size) == 0);
+	}
+
+	bool CheckReferenceBlocks()
+	{
+		bool bPassed = true;
+		std::vector<uint8_t> Compressed, Decompressed;
+		for (const ReferenceBlock& Block : GetReferenceBlocks())
+		{
+			const uint8_t* Input = reinterpret_cast<const uint8_t*>(Block.Input.data());
+			std::vector<uint8_t> Output(Block.Input.size());
+			const bool bDecoded = Lz4::Decompress(Block.Compressed.data(), Block.Compressed.size(), Output.data(), Output.size())
+				&& (Output.empty() || std::memcmp(Output.data(), Input, Output.size()) == 0);
+
+			// a block that is one byte short or expands to the wrong size has to be rejected
+			const bool bTruncatedRejected = Block.Compressed.size() < 2
+				|| !Lz4::Decompress(Block.Compressed.data(), Block.Compressed.size() - 1, Output.data(), Output.size());
+			const bool bRoundTrip = RoundTrip(Input, Block.Input.size(), Compressed, Decompressed);
+
+			std::cout << Block.Name << ": reference " << (bDecoded ? "ok" : "FAILED") << ", truncated " << (bTruncatedRejected ? "rejected" : "ACCEPTED")
+				<< ", round trip " << (bRoundTrip ? "ok" : "FAILED") << " (" << Block.Input.size() << " -> " << Compressed.size() << " bytes)" << std::endl;
+			bPassed &= bDecoded && bTruncatedRejected && bRoundTrip;
+		}
+		return bPassed;
+	}
+
+	// Words from a small vocabulary with numbers mixed in, compresses about as well as source text and OBJ files
+	std::vector<uint8_t> MakeText(size_t Size)
+	{
+		static const char* const Words[] = { "vertex", "normal", "texture", "material", "mesh", "0.5", "1.0", "-0.25", "f", "v", "vn", "vt", "usemtl", "\n" };
+		const size_t WordCount = sizeof(Words) / sizeof(Words[0]);
+
+		std::vector<uint8_t> Text;
+		Text.reserve(Size + 16);
+		uint32_t State = 12345;
+		while (Text.size() < Size)
+		{
+			State = State * 1664525u + 1013904223u;
+			const char* Word = Words[(State >> 16) % WordCount];
+			Text.insert(Text.end(), Word, Word + std::strlen(Word));
+			Text.push_back(' ');
+			if ((State & 0xFF) < 16)
+			{
+				const std::string Number = std::to_string(State % 100000);
+				Text.insert(Text.end(), Number.begin(), Number.end());
+			}
+		}
+		Text.resize(Size);
+		return Text;
+	}
+
+	int RunLz4Benchmark(const std::vector<std::string>& Args)
+	{
+		const size_t Megabytes = static_cast<size_t>(GetIntArg(Args, 0, 16));
+		const int Iterations = GetIntArg(Args, 1, 5);
+
+		if (!CheckReferenceBlocks())
+		{
+			std::cout << "ERROR::BENCHMARK::LZ4 blocks did not decode to their input" << std::endl;
+			return 1;
+		}
+
+		const std::vector<uint8_t> Source = MakeText(Megabytes * 1024 * 1024);
+		std::vector<uint8_t> Compressed(Lz4::CompressBound(Source.size()));
+		size_t CompressedSize = 0;
+		const BenchmarkTimings CompressTimings = MeasureRuns(Iterations, [&]()
+		{
+			CompressedSize = Lz4::Compress(Source.data(), Source.size(), Compressed.data(), Compressed.size());
+		});
+
+		std::vector<uint8_t> Decompressed(Source.size());
+		bool bDecoded = false;
+		const BenchmarkTimings DecompressTimings = MeasureRuns(Iterations, [&]()
+		{
+			bDecoded = Lz4::Decompress(Compressed.data(), CompressedSize, Decompressed.data(), Decompressed.size());
+		});
+		if (CompressedSize == 0 || !bDecoded || Decompressed != Source)
+		{
+			std::cout << "ERROR::BENCHMARK::Generated text did not round trip" << std::endl;
+			return 1;
+		}
+
+		const double SourceMb = Source.size() / (1024.0 * 1024.0);
+		std::cout << "text: " << Source.size() << " -> " << CompressedSize << " bytes (ratio " << double(Source.size()) / CompressedSize << ")" << std::endl;
+		PrintTimings("compress", CompressTimings);
+		PrintTimings("decompress", DecompressTimings);
+		std::cout << "compress MB/s (min): " << SourceMb / (CompressTimings.MinMs / 1000.0) << std::endl;
+		std::cout << "decompress MB/s (min): " << SourceMb / (DecompressTimings.MinMs / 1000.0) << std::endl;
+		return 0;
+	}
+
+	BenchmarkRegistration Registration("lz4", "LZ4 reference blocks and round trip, then compression and decompression speed", &RunLz4Benchmark);
+}
@@ -0,0 +1,81 @@
+// Compares the native OBJ reader with the assimp import (aiProcess_Triangulate | aiProcess_FlipUVs), then prints
+// what MeshOptimizer makes of the imported meshes
+//   CanaryBenchmark obj [model.obj] [iterations]
+
+#include <iostream>
+
+#include "Benchmark.h"
+#include "Engine/Core/ThreadPool.h"
+#include "Engine/Mesh/MeshOptimizer.h"
+#include "Engine/Mesh/Model.h"
+
+namespace
+{
+	struct ImportStats
+	{
+		size_t Meshes = 0;
+		size_t Vertices = 0;
+		size_t Triangles = 0;
+	};
+
+	ImportStats GetStats(const std::vector<MeshData>& Meshes)
+	{
+		ImportStats Stats;
+		Stats.Meshes = Meshes.size();
+		for (const MeshData& Data : Meshes)
+		{
+			Stats.Vertices += Data.Vertices.size();
+			Stats.Triangles += Data.Indices.size() / 3;
+		}
+		return Stats;
+	}
+
+	bool BenchmarkImporter(const std::string& Label, const std::string& FilePath, EModelImporter Importer, int Iterations, BenchmarkTimings& OutTimings)
+	{
+		std::vector<MeshData> Meshes;
+		if (!Model::ImportMeshData(FilePath, Meshes, Importer))
+		{
+			std::cout << Label << " failed to import " << FilePath << std::endl;
+			return false;
+		}
+
+		const ImportStats Stats = GetStats(Meshes);
+		std::cout << Label << ": " << Stats.Meshes << " meshes, " << Stats.Vertices << " vertices, " << Stats.Triangles << " triangles" << std::endl;
+
+		OutTimings = MeasureRuns(Iterations, [&]()
+		{
+			std::vector<MeshData> Result;
+			Model::ImportMeshData(FilePath, Result, Importer);
+		});
+		return true;
+	}
+
+	int RunObjImportBenchmark(const std::vector<std::string>& Args)
+	{
+		const std::string FilePath = Args.size() > 0 ? Args[0] : "resources/Objects/Backpack/backpack.obj";
+		const int Iterations = GetIntArg(Args, 1, 5);
+
+		std::cout << "OBJ import: " << FilePath << ", " << Iterations << " iterations, " << ThreadPool::Get().GetThreadCount() + 1 << " threads" << std::endl;
+
+		BenchmarkTimings AssimpTimings, NativeTimings;
+		if (!BenchmarkImporter("assimp", FilePath, EModelImporter::Assimp, Iterations, AssimpTimings) ||
+			!BenchmarkImporter("native", FilePath, EModelImporter::NativeObj, Iterations, NativeTimings))
+		{
+			return 1;
+		}
+
+		PrintTimings("assimp", AssimpTimings);
+		PrintTimings("native", NativeTimings);
+		std::cout << "speedup (min): " << AssimpTimings.MinMs / NativeTimings.MinMs << "x" << std::endl;
+
+		// the cooker and runtime imports optimize right after importing
+		std::vector<MeshData> Meshes;
+		if (Model::ImportMeshData(FilePath, Meshes))
+		{
+			MeshOptimizer::PrintStats(FilePath, MeshOptimizer::OptimizeMeshes(Meshes));
+		}
+		return 0;
+	}
+
+	BenchmarkRegistration Registration("obj", "native OBJ/MTL reader vs assimp import", &RunObjImportBenchmark);
+}
@@ -0,0 +1,111 @@
+// Load time of a large scene: parsing the text format with SceneImporter against opening the cooked version with
+// CookedSceneFile and touching every object the way Scene::Load does. The scene is generated, a grid of objects
+// spread over a few models with one light per thousand objects, and written to the temporary directory.
+//   CanaryBenchmark scene [objects] [iterations]
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "Benchmark.h"
+#include "Engine/Scene/CookedScene.h"
+#include "Engine/Scene/SceneImporter.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	const int ModelCount = 16;
+	const int ObjectsPerLight = 1000;
+
+	// Every object has a position, rotation and scale so the importer does its full work per line
+	bool WriteTextScene(const std::string& FilePath, int Objects)
+	{
+		std::ofstream File(FilePath);
+		if (!File)
+		{
+			std::cout << "ERROR::BENCHMARK::Could not write " << FilePath << std::endl;
+			return false;
+		}
+
+		File << "# generated by CanaryBenchmark scene\n";
+		for (int Model = 0; Model < ModelCount; Model++)
+		{
+			File << "model m" << Model << " resources/Objects/Generated/model" << Model << ".obj\n";
+		}
+
+		const int Side = 1 + static_cast<int>(std::sqrt(static_cast<double>(Objects)));
+		for (int Object = 0; Object < Objects; Object++)
+		{
+			const float X = static_cast<float>(Object % Side) * 4.0f;
+			const float Z = static_cast<float>(Object / Side) * 4.0f;
+			File << "object m" << Object % ModelCount
+				<< " position " << X << " 0 " << Z
+				<< " rotation 0 " << (Object * 37) % 360 << " 0"
+				<< " scale " << 0.5f + static_cast<float>(Object % 5) * 0.25f << "\n";
+
+			if (Object % ObjectsPerLight == 0)
+			{
+				File << "light point position " << X << " 3 " << Z << " color 1 0.9 0.8 intensity 10 radius 40\n";
+			}
+		}
+		return static_cast<bool>(File);
+	}
+
+	int RunSceneLoadBenchmark(const std::vector<std::string>& Args)
+	{
+		const int Objects = GetIntArg(Args, 0, 100000);
+		const int Iterations = GetIntArg(Args, 1, 5);
+
+		std::error_code Error;
+		const std::string TextPath = (fs::temp_directory_path(Error) / "CanaryBenchmark.scene").string();
+		const std::string CookedPath = CookedScene::GetCookedPath(TextPath);
+
+		std::cout << "Scene load: " << Objects << " objects, " << ModelCount << " models, " << Iterations << " iterations" << std::endl;
+
+		SceneData Scene;
+		if (!WriteTextScene(TextPath, Objects) || !SceneImporter::Import(TextPath, Scene) || !CookedScene::Write(CookedPath, Scene))
+		{
+			return 1;
+		}
+		std::cout << "text: " << fs::file_size(TextPath, Error) / 1024 << " KiB, cooked: " << fs::file_size(CookedPath, Error) / 1024 << " KiB" << std::endl;
+
+		const BenchmarkTimings TextTimings = MeasureRuns(Iterations, [&]()
+		{
+			SceneData Imported;
+			SceneImporter::Import(TextPath, Imported);
+		});
+
+		// what Scene::Load does with a cooked file before the models are loaded: map it and walk the objects once
+		float Checksum = 0.0f;
+		const BenchmarkTimings CookedTimings = MeasureRuns(Iterations, [&]()
+		{
+			CookedSceneFile File;
+			if (!File.Open(CookedPath))
+			{
+				return;
+			}
+			const glm::mat4* Transforms = File.GetTransforms();
+			const uint32_t* ObjectModels = File.GetObjectModels();
+			for (uint32_t Object = 0; Object < File.GetObjectCount(); Object++)
+			{
+				Checksum += Transforms[Object][3].x + static_cast<float>(ObjectModels[Object]);
+			}
+			File.Close();
+		});
+
+		PrintTimings("text", TextTimings);
+		PrintTimings("cooked", CookedTimings);
+		std::cout << "objects/s (min): text " << Objects / (TextTimings.MinMs / 1000.0)
+			<< ", cooked " << Objects / (CookedTimings.MinMs / 1000.0) << std::endl;
+		std::cout << "speedup (min): " << TextTimings.MinMs / CookedTimings.MinMs << "x (checksum " << Checksum << ")" << std::endl;
+
+		fs::remove(TextPath, Error);
+		fs::remove(CookedPath, Error);
+		return 0;
+	}
+
+	BenchmarkRegistration Registration("scene", "load time of a cooked scene vs importing its text", &RunSceneLoadBenchmark);
+}
@@ -0,0 +1,976 @@
+#include "AssetCooker.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#include "Engine/Animation/AnimationCompressor.h"
+#include "Engine/Core/Hash.h"
+#include "Engine/Core/Paths.h"
+#include "Engine/Core/ThreadPool.h"
+#include "Engine/Mesh/CookedMesh.h"
+#include "Engine/Mesh/MeshletBuilder.h"
+#include "Engine/Mesh/MeshOptimizer.h"
+#include "Engine/Mesh/MeshSimplifier.h"
+#include "Engine/Mesh/Model.h"
+#include "Engine/Scene/CookedScene.h"
+#include "Engine/Scene/SceneImporter.h"
+#include "Engine/Texture/CookedVirtualTexture.h"
+#include "Engine/Texture/TextureCooker.h"
+#include "Engine/Texture/VirtualTextureCooker.h"
+#include "Engine/Texture/VirtualTextureSystem.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	bool HasExtension(const std::string& FilePath, const char* const* Extensions, size_t ExtensionCount)
+	{
+		const std::string::size_type Dot = FilePath.find_last_of('.');
+		if (Dot == std::string::npos)
+		{
+			return false;
+		}
+
+		std::string Extension = FilePath.substr(Dot);
+		for (char& Character : Extension)
+		{
+			Character = static_cast<char>(std::tolower(static_cast<unsigned char>(Character)));
+		}
+		for (size_t i = 0; i < ExtensionCount; i++)
+		{
+			if (Extension == Extensions[i])
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Duplicates come from the same source being added twice, the first spelling wins
+	void RemoveDuplicates(std::vector<std::pair<std::string, std::string>>& Sources)
+	{
+		std::stable_sort(Sources.begin(), Sources.end(), [](const std::pair<std::string, std::string>& A, const std::pair<std::string, std::string>& B)
+		{
+			return A.first < B.first;
+		});
+		Sources.erase(std::unique(Sources.begin(), Sources.end(), [](const std::pair<std::string, std::string>& A, const std::pair<std::string, std::string>& B)
+		{
+			return A.first == B.first;
+		}), Sources.end());
+	}
+
+	// Directory prefix dependency paths are stored relative to, including the trailing slash
+	std::string GetModelDirectory(const std::string& SourcePath)
+	{
+		return SourcePath.substr(0, SourcePath.find_last_of('/') + 1);
+	}
+
+	// Dependencies are recorded relative to the model so the key, and with it the cache entry, does not depend on
+	// where the model lives. False for a file outside the model's directory.
+	bool MakeRelative(const std::string& ModelDirectory, const std::string& Dependency, std::string& OutRelative)
+	{
+		if (Dependency.compare(0, ModelDirectory.size(), ModelDirectory) != 0)
+		{
+			OutRelative = Paths::Normalise(Dependency);
+			return false;
+		}
+		OutRelative = Paths::Normalise(Dependency.substr(ModelDirectory.size()));
+		return true;
+	}
+
+	AtlasPacker::PackOptions GetAtlasOptions(const CookSettings& Settings)
+	{
+		AtlasPacker::PackOptions Options;
+		Options.bHighQuality = Settings.bHighQualityTextures;
+		return Options;
+	}
+
+	// Only normal maps are compressed differently at the moment, when models disagree the normal map wins so the
+	// choice does not depend on the order models were cooked in
+	std::string ChooseTextureType(const std::set<std::string>& Types)
+	{
+		if (Types.empty())
+		{
+			return "texture_diffuse";
+		}
+		return Types.count("texture_normal") ? "texture_normal" : *Types.begin();
+	}
+}
+
+AssetCooker::AssetCooker(const CookSettings& InSettings, const std::string& InManifestPath)
+	: Settings(InSettings)
+	, ManifestPath(InManifestPath)
+	, Cache(InSettings.CacheDirectory)
+{
+}
+
+bool AssetCooker::AddDirectory(const std::string& Directory)
+{
+	std::error_code Error;
+	for (fs::recursive_directory_iterator It(Directory, Error), End; !Error && It != End; It.increment(Error))
+	{
+		if (!It->is_regular_file())
+		{
+			continue;
+		}
+
+		const std::string Path = It->path().generic_string();
+		if (IsModel(Path))
+		{
+			Models.emplace_back(Paths::Normalise(Path), Path);
+		}
+		else if (IsImage(Path))
+		{
+			Images.emplace_back(Paths::Normalise(Path), Path);
+		}
+		else if (IsScene(Path))
+		{
+			Scenes.emplace_back(Paths::Normalise(Path), Path);
+		}
+	}
+
+	if (Error)
+	{
+		std::cout << "ERROR::COOKER::Could not walk " << Directory << ": " << Error.message() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool AssetCooker::AddFile(const std::string& FilePath)
+{
+	if (IsModel(FilePath))
+	{
+		Models.emplace_back(Paths::Normalise(FilePath), FilePath);
+		return true;
+	}
+	if (IsImage(FilePath))
+	{
+		Images.emplace_back(Paths::Normalise(FilePath), FilePath);
+		return true;
+	}
+	if (IsScene(FilePath))
+	{
+		Scenes.emplace_back(Paths::Normalise(FilePath), FilePath);
+		return true;
+	}
+
+	std::cout << "ERROR::COOKER::Don't know how to cook " << FilePath << std::endl;
+	return false;
+}
+
+bool AssetCooker::Cook()
+{
+	Previous.Load(ManifestPath);
+
+	// assets outside this run keep their records, a run over a single file must not make everything else dirty
+	Current = CookManifest();
+	Current.Assets = Previous.Assets;
+
+	RemoveDuplicates(Models);
+	RemoveDuplicates(Images);
+	RemoveDuplicates(Scenes);
+
+	ThreadPool& Pool = ThreadPool::Get();
+	size_t Counts[static_cast<size_t>(ECookResult::Busy)] = {};
+
+	// models first, their materials decide which textures are needed and what they are used as
+	std::vector<CookManifest::AssetRecord> ModelRecords(Models.size());
+	std::vector<ECookResult> ModelResults(Models.size());
+	auto BuildModelAt = [&](size_t i)
+	{
+		const std::string& SourcePath = Models[i].second;
+
+		auto Found = Previous.Assets.find(Models[i].first);
+		if (!Settings.bForce && Found != Previous.Assets.end() && Found->second.Kind == "mesh"
+			&& fs::exists(CookedMesh::GetCookedPath(SourcePath)) && GetModelKey(SourcePath, Found->second.Dependencies) == Found->second.Key)
+		{
+			ModelRecords[i] = Found->second;
+			return ECookResult::UpToDate;
+		}
+		return BuildModel(SourcePath, ModelRecords[i]);
+	};
+	Pool.ParallelFor(Models.size(), [&](size_t i)
+	{
+		ModelResults[i] = BuildModelAt(i);
+	});
+	WaitForClaimed(ModelResults, BuildModelAt);
+
+	// every image found is cooked, images only reached through a material are added here
+	std::map<std::string, std::pair<std::string, std::set<std::string>>> Textures;
+	for (const std::pair<std::string, std::string>& Image : Images)
+	{
+		Textures[Image.first].first = Image.second;
+	}
+	for (size_t i = 0; i < Models.size(); i++)
+	{
+		Counts[static_cast<size_t>(ModelResults[i])]++;
+		if (ModelResults[i] == ECookResult::Failed)
+		{
+			Current.Assets.erase(Models[i].first);
+			continue;
+		}
+		Current.Assets[Models[i].first] = ModelRecords[i];
+
+		// texture paths are relative to the model, the same way Model::LoadMaterialTextures resolves them
+		const std::string& SourcePath = Models[i].second;
+		const std::string Directory = SourcePath.substr(0, SourcePath.find_last_of('/'));
+		for (const MaterialTextureRef& Ref : ModelRecords[i].TextureRefs)
+		{
+			const std::string TexturePath = Directory + '/' + Ref.Path;
+			std::pair<std::string, std::set<std::string>>& Texture = Textures[Paths::Normalise(TexturePath)];
+			if (Texture.first.empty())
+			{
+				Texture.first = TexturePath;
+			}
+			Texture.second.insert(Ref.Type);
+		}
+	}
+
+	std::vector<std::pair<std::string, std::string>> TextureJobs; // normalised path, original path
+	std::vector<std::string> TextureTypes;
+	for (const auto& Texture : Textures)
+	{
+		TextureJobs.emplace_back(Texture.first, Texture.second.first);
+		TextureTypes.push_back(ChooseTextureType(Texture.second.second));
+	}
+
+	std::vector<CookManifest::AssetRecord> TextureRecords(TextureJobs.size());
+	std::vector<ECookResult> TextureResults(TextureJobs.size());
+	auto BuildTextureAt = [&](size_t i)
+	{
+		const std::string& SourcePath = TextureJobs[i].second;
+
+		CookManifest::AssetRecord& Record = TextureRecords[i];
+		Record.Kind = "texture";
+		Record.Key = GetTextureKey(SourcePath, TextureTypes[i]);
+		Record.Dependencies.assign(1, SourcePath);
+
+		auto Found = Previous.Assets.find(TextureJobs[i].first);
+		if (!Settings.bForce && Found != Previous.Assets.end() && Found->second.Kind == "texture" && Found->second.Key == Record.Key
+			&& fs::exists(CookedTexture::GetCookedPath(SourcePath)))
+		{
+			return ECookResult::UpToDate;
+		}
+		return BuildTexture(SourcePath, TextureTypes[i], Record.Key);
+	};
+	Pool.ParallelFor(TextureJobs.size(), [&](size_t i)
+	{
+		TextureResults[i] = BuildTextureAt(i);
+	});
+	WaitForClaimed(TextureResults, BuildTextureAt);
+
+	for (size_t i = 0; i < TextureJobs.size(); i++)
+	{
+		Counts[static_cast<size_t>(TextureResults[i])]++;
+		if (TextureResults[i] != ECookResult::Failed)
+		{
+			Current.Assets[TextureJobs[i].first] = TextureRecords[i];
+		}
+		else
+		{
+			Current.Assets.erase(TextureJobs[i].first);
+		}
+	}
+
+	if (Settings.bVirtualTextures)
+	{
+		// only material slots the engine samples virtually, anything else keeps loading the .ctex
+		std::vector<size_t> VirtualJobs;
+		for (size_t i = 0; i < TextureJobs.size(); i++)
+		{
+			const std::set<std::string>& Types = Textures[TextureJobs[i].first].second;
+			const bool bVirtualSlot = std::any_of(Types.begin(), Types.end(), [](const std::string& Type)
+			{
+				return VirtualTextureSystem::IsVirtualSlot(Type);
+			});
+			if (TextureResults[i] != ECookResult::Failed && bVirtualSlot && VirtualTextureCooker::IsCandidate(TextureJobs[i].second))
+			{
+				VirtualJobs.push_back(i);
+				continue;
+			}
+
+			// the engine would keep streaming pages of a texture that is no longer meant to be virtual
+			const std::string VirtualPath = CookedVirtualTexture::GetCookedPath(TextureJobs[i].second);
+			auto Stale = Current.Assets.find(Paths::Normalise(VirtualPath));
+			if (Stale != Current.Assets.end() && Stale->second.Kind == "vtexture")
+			{
+				std::error_code Ignored;
+				fs::remove(VirtualPath, Ignored);
+				Current.Assets.erase(Stale);
+			}
+		}
+
+		std::vector<CookManifest::AssetRecord> VirtualRecords(VirtualJobs.size());
+		std::vector<ECookResult> VirtualResults(VirtualJobs.size());
+		auto BuildVirtualTextureAt = [&](size_t i)
+		{
+			const std::string& SourcePath = TextureJobs[VirtualJobs[i]].second;
+			const std::string CookedPath = CookedVirtualTexture::GetCookedPath(SourcePath);
+
+			CookManifest::AssetRecord& Record = VirtualRecords[i];
+			Record.Kind = "vtexture";
+			Record.Key = GetVirtualTextureKey(SourcePath);
+			Record.Dependencies.assign(1, SourcePath);
+
+			auto Found = Previous.Assets.find(Paths::Normalise(CookedPath));
+			if (!Settings.bForce && Found != Previous.Assets.end() && Found->second.Kind == "vtexture" && Found->second.Key == Record.Key
+				&& fs::exists(CookedPath))
+			{
+				return ECookResult::UpToDate;
+			}
+			return BuildVirtualTexture(SourcePath, Record.Key);
+		};
+		Pool.ParallelFor(VirtualJobs.size(), [&](size_t i)
+		{
+			VirtualResults[i] = BuildVirtualTextureAt(i);
+		});
+		WaitForClaimed(VirtualResults, BuildVirtualTextureAt);
+
+		// keyed by the .cvt, the source's own key already holds its texture record
+		for (size_t i = 0; i < VirtualJobs.size(); i++)
+		{
+			Counts[static_cast<size_t>(VirtualResults[i])]++;
+			const std::string VirtualKey = Paths::Normalise(CookedVirtualTexture::GetCookedPath(TextureJobs[VirtualJobs[i]].second));
+			if (VirtualResults[i] != ECookResult::Failed)
+			{
+				Current.Assets[VirtualKey] = VirtualRecords[i];
+			}
+			else
+			{
+				Current.Assets.erase(VirtualKey);
+			}
+		}
+	}
+
+	if (!Settings.AtlasPath.empty())
+	{
+		// only textures a material uses can be remapped into the atlas, loose images keep their own .ctex
+		std::vector<AtlasPacker::SourceTexture> Candidates;
+		for (size_t i = 0; i < TextureJobs.size(); i++)
+		{
+			if (TextureResults[i] != ECookResult::Failed && !Textures[TextureJobs[i].first].second.empty()
+				&& AtlasPacker::IsCandidate(TextureJobs[i].second, GetAtlasOptions(Settings)))
+			{
+				AtlasPacker::SourceTexture Candidate;
+				Candidate.Path = TextureJobs[i].second;
+				Candidate.TextureType = TextureTypes[i];
+				Candidates.push_back(Candidate);
+			}
+		}
+
+		const ECookResult AtlasResult = CookAtlas(Candidates);
+		if (!Candidates.empty())
+		{
+			Counts[static_cast<size_t>(AtlasResult)]++;
+		}
+	}
+
+	// scenes are small and quick to cook, so they skip the cache and the thread pool
+	for (const std::pair<std::string, std::string>& SceneSource : Scenes)
+	{
+		const std::string& SourcePath = SceneSource.second;
+
+		CookManifest::AssetRecord Record;
+		Record.Kind = "scene";
+		Record.Key = GetSceneKey(SourcePath);
+		Record.Dependencies.push_back(SourcePath);
+
+		auto Found = Previous.Assets.find(SceneSource.first);
+		ECookResult Result = ECookResult::UpToDate;
+		if (Settings.bForce || Found == Previous.Assets.end() || Found->second.Kind != "scene" || Found->second.Key != Record.Key
+			|| !fs::exists(CookedScene::GetCookedPath(SourcePath)))
+		{
+			Result = CookScene(SourcePath) ? ECookResult::Cooked : ECookResult::Failed;
+		}
+
+		Counts[static_cast<size_t>(Result)]++;
+		if (Result != ECookResult::Failed)
+		{
+			Current.Assets[SceneSource.first] = Record;
+		}
+		else
+		{
+			Current.Assets.erase(SceneSource.first);
+		}
+	}
+
+	// failed assets are left out of the manifest so the next run tries them again, as are deleted sources
+	for (auto It = Current.Assets.begin(); It != Current.Assets.end();)
+	{
+		It = fs::exists(It->first) ? std::next(It) : Current.Assets.erase(It);
+	}
+	for (const auto& File : Previous.Files)
+	{
+		if (!Current.Files.count(File.first) && fs::exists(File.first))
+		{
+			Current.Files.insert(File);
+		}
+	}
+
+	const bool bSaved = Current.Save(ManifestPath);
+
+	std::cout << "Cooked " << Counts[static_cast<size_t>(ECookResult::Cooked)] << " assets, "
+		<< "fetched " << Counts[static_cast<size_t>(ECookResult::Fetched)] << " from the cache, "
+		<< Counts[static_cast<size_t>(ECookResult::UpToDate)] << " up to date, "
+		<< Counts[static_cast<size_t>(ECookResult::Failed)] << " failed" << std::endl;
+	return bSaved && Counts[static_cast<size_t>(ECookResult::Failed)] == 0;
+}
+
+bool AssetCooker::IsModel(const std::string& FilePath)
+{
+	static const char* const Extensions[] = { ".obj", ".fbx", ".gltf", ".glb", ".dae", ".3ds", ".blend" };
+	return HasExtension(FilePath, Extensions, sizeof(Extensions) / sizeof(Extensions[0]));
+}
+
+bool AssetCooker::IsImage(const std::string& FilePath)
+{
+	static const char* const Extensions[] = { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".psd", ".hdr" };
+	return HasExtension(FilePath, Extensions, sizeof(Extensions) / sizeof(Extensions[0]));
+}
+
+bool AssetCooker::IsScene(const std::string& FilePath)
+{
+	static const char* const Extensions[] = { ".scene" };
+	return HasExtension(FilePath, Extensions, sizeof(Extensions) / sizeof(Extensions[0]));
+}
+
+uint64_t AssetCooker::HashFile(const std::string& FilePath)
+{
+	const std::string Normalised = Paths::Normalise(FilePath);
+
+	std::error_code Error;
+	CookManifest::FileRecord Record;
+	Record.Size = fs::file_size(FilePath, Error);
+	if (Error)
+	{
+		return 0;
+	}
+	Record.ModifiedTime = static_cast<int64_t>(fs::last_write_time(FilePath, Error).time_since_epoch().count());
+
+	{
+		std::lock_guard<std::mutex> Lock(FilesMutex);
+		auto Found = Current.Files.find(Normalised);
+		if (Found != Current.Files.end())
+		{
+			return Found->second.Hash;
+		}
+	}
+
+	auto Found = Previous.Files.find(Normalised);
+	if (Found != Previous.Files.end() && Found->second.Size == Record.Size && Found->second.ModifiedTime == Record.ModifiedTime)
+	{
+		Record.Hash = Found->second.Hash;
+	}
+	else if (!Hash::File(FilePath, Record.Hash))
+	{
+		return 0;
+	}
+
+	std::lock_guard<std::mutex> Lock(FilesMutex);
+	Current.Files[Normalised] = Record;
+	return Record.Hash;
+}
+
+uint64_t AssetCooker::GetModelKey(const std::string& SourcePath, const std::vector<std::string>& Dependencies)
+{
+	const std::string ModelDirectory = GetModelDirectory(SourcePath);
+	uint64_t Key = Hash::Combine(CookerVersion, CookedMesh::Version);
+	Key = Hash::Combine(Key, static_cast<uint64_t>(Settings.VertexFormat));
+	Key = Hash::Combine(Key, Settings.DistanceField.Resolution);
+	Key = Hash::Combine(Key, Settings.DistanceField.Padding);
+	for (const std::string& Dependency : Dependencies)
+	{
+		// a dependency that has gone missing hashes to 0 and still changes the key
+		std::string Relative;
+		MakeRelative(ModelDirectory, Dependency, Relative);
+		Key = Hash::Combine(Key, Hash::String(Relative));
+		Key = Hash::Combine(Key, HashFile(Dependency));
+	}
+	return Key;
+}
+
+uint64_t AssetCooker::GetRecipeKey(const std::string& SourcePath)
+{
+	// the importer is picked by extension, what the model references is decided by its own contents
+	const std::string::size_type Dot = SourcePath.find_last_of('.');
+	uint64_t Key = Hash::Combine(CookerVersion, CookedMesh::Version);
+	Key = Hash::Combine(Key, Hash::String(Dot == std::string::npos ? "" : Paths::ToArchivePath(SourcePath.substr(Dot)), 1));
+	return Hash::Combine(Key, HashFile(SourcePath));
+}
+
+uint64_t AssetCooker::GetTextureKey(const std::string& FilePath, const std::string& TextureType)
+{
+	uint64_t Key = Hash::Combine(CookerVersion, CookedTexture::Version);
+	Key = Hash::Combine(Key, Settings.bHighQualityTextures ? 1 : 0);
+	Key = Hash::Combine(Key, Hash::String(TextureType));
+	return Hash::Combine(Key, HashFile(FilePath));
+}
+
+uint64_t AssetCooker::GetAtlasKey(const std::vector<AtlasPacker::SourceTexture>& Sources)
+{
+	const AtlasPacker::PackOptions Options = GetAtlasOptions(Settings);
+	uint64_t Key = Hash::Combine(CookerVersion, CookedAtlas::Version);
+	Key = Hash::Combine(Key, Options.bHighQuality ? 1 : 0);
+	Key = Hash::Combine(Key, Hash::Combine(Options.MaxPageSize, Options.MaxEntrySize));
+	for (const AtlasPacker::SourceTexture& Source : Sources)
+	{
+		// entries are looked up by path, so the paths are part of the output too
+		Key = Hash::Combine(Key, Hash::String(Paths::ToArchivePath(Source.Path)));
+		Key = Hash::Combine(Key, Hash::String(Source.TextureType));
+		Key = Hash::Combine(Key, HashFile(Source.Path));
+	}
+	return Key;
+}
+
+uint64_t AssetCooker::GetVirtualTextureKey(const std::string& FilePath)
+{
+	uint64_t Key = Hash::Combine(CookerVersion, CookedVirtualTexture::Version);
+	return Hash::Combine(Key, HashFile(FilePath));
+}
+
+uint64_t AssetCooker::GetSceneKey(const std::string& FilePath)
+{
+	uint64_t Key = Hash::Combine(CookerVersion, CookedScene::Version);
+	return Hash::Combine(Key, HashFile(FilePath));
+}
+
+AssetCooker::ECookResult AssetCooker::BuildModel(const std::string& SourcePath, CookManifest::AssetRecord& OutRecord)
+{
+	// claimed by recipe key, the full key is not known until the model has been imported once
+	const uint64_t RecipeKey = GetRecipeKey(SourcePath);
+	if (FetchModel(SourcePath, RecipeKey, OutRecord))
+	{
+		return ECookResult::Fetched;
+	}
+	if (!Cache.TryClaim(RecipeKey))
+	{
+		return ECookResult::Busy;
+	}
+
+	// another process may have published the model between the lookup and the claim
+	ECookResult Result = ECookResult::Fetched;
+	if (!FetchModel(SourcePath, RecipeKey, OutRecord))
+	{
+		Result = CookModel(SourcePath, OutRecord) ? ECookResult::Cooked : ECookResult::Failed;
+	}
+
+	if (Result == ECookResult::Cooked && Cache.IsEnabled())
+	{
+		// a model reaching outside its directory cannot be shared, the relative recipe would not describe it
+		const std::string ModelDirectory = GetModelDirectory(SourcePath);
+		std::string Recipe;
+		bool bShareable = true;
+		for (const std::string& Dependency : OutRecord.Dependencies)
+		{
+			std::string Relative;
+			bShareable &= MakeRelative(ModelDirectory, Dependency, Relative);
+			Recipe += Relative + '\n';
+		}
+
+		// the recipe goes last, whoever can read it will find the cooked mesh too
+		if (bShareable && Cache.Store(OutRecord.Key, ".cmesh", CookedMesh::GetCookedPath(SourcePath)))
+		{
+			Cache.WriteText(RecipeKey, ".deps", Recipe);
+		}
+	}
+
+	Cache.ReleaseClaim(RecipeKey);
+	return Result;
+}
+
+bool AssetCooker::FetchModel(const std::string& SourcePath, uint64_t RecipeKey, CookManifest::AssetRecord& OutRecord)
+{
+	std::string Recipe;
+	if (Settings.bForce || !Cache.ReadText(RecipeKey, ".deps", Recipe))
+	{
+		return false;
+	}
+
+	CookManifest::AssetRecord Record;
+	Record.Kind = "mesh";
+	std::istringstream Lines(Recipe);
+	for (std::string Line; std::getline(Lines, Line);)
+	{
+		Record.Dependencies.push_back(GetModelDirectory(SourcePath) + Line);
+	}
+	Record.Key = GetModelKey(SourcePath, Record.Dependencies);
+
+	const std::string CookedPath = CookedMesh::GetCookedPath(SourcePath);
+	if (!Cache.Fetch(Record.Key, ".cmesh", CookedPath))
+	{
+		return false;
+	}
+
+	// the materials' texture refs are part of the cooked mesh
+	CookedMeshFile File;
+	if (!File.Open(CookedPath))
+	{
+		return false;
+	}
+	std::set<std::pair<std::string, std::string>> TextureRefs;
+	for (uint32_t MeshIndex = 0; MeshIndex < File.GetMeshCount(); MeshIndex++)
+	{
+		const CookedMesh::MeshRecord& Mesh = File.GetMesh(MeshIndex);
+		for (uint32_t RefIndex = Mesh.FirstTextureRef; RefIndex < Mesh.FirstTextureRef + Mesh.TextureRefCount; RefIndex++)
+		{
+			MaterialTextureRef Ref;
+			Ref.Type = File.GetString(File.GetTextureRef(RefIndex).TypeOffset);
+			Ref.Path = File.GetString(File.GetTextureRef(RefIndex).PathOffset);
+			if (TextureRefs.insert(std::make_pair(Ref.Type, Ref.Path)).second)
+			{
+				Record.TextureRefs.push_back(Ref);
+			}
+		}
+	}
+
+	OutRecord = Record;
+	Log("Fetched " + SourcePath + " -> " + CookedPath + " from the cook cache");
+	return true;
+}
+
+AssetCooker::ECookResult AssetCooker::BuildTexture(const std::string& SourcePath, const std::string& TextureType, uint64_t Key)
+{
+	const std::string CookedPath = CookedTexture::GetCookedPath(SourcePath);
+	const bool bUseCache = !Settings.bForce;
+	if (bUseCache && Cache.Fetch(Key, ".ctex", CookedPath))
+	{
+		Log("Fetched " + SourcePath + " -> " + CookedPath + " from the cook cache");
+		return ECookResult::Fetched;
+	}
+	if (!Cache.TryClaim(Key))
+	{
+		return ECookResult::Busy;
+	}
+
+	ECookResult Result = ECookResult::Fetched;
+	if (!bUseCache || !Cache.Fetch(Key, ".ctex", CookedPath))
+	{
+		Result = CookTexture(SourcePath, TextureType) ? ECookResult::Cooked : ECookResult::Failed;
+	}
+	if (Result == ECookResult::Cooked)
+	{
+		Cache.Store(Key, ".ctex", CookedPath);
+	}
+
+	Cache.ReleaseClaim(Key);
+	return Result;
+}
+
+AssetCooker::ECookResult AssetCooker::BuildAtlas(const std::vector<AtlasPacker::SourceTexture>& Sources, uint64_t Key)
+{
+	const bool bUseCache = !Settings.bForce;
+	if (bUseCache && Cache.Fetch(Key, ".catlas", Settings.AtlasPath))
+	{
+		Log("Fetched " + Settings.AtlasPath + " from the cook cache");
+		return ECookResult::Fetched;
+	}
+	if (!Cache.TryClaim(Key))
+	{
+		return ECookResult::Busy;
+	}
+
+	ECookResult Result = ECookResult::Fetched;
+	if (!bUseCache || !Cache.Fetch(Key, ".catlas", Settings.AtlasPath))
+	{
+		std::error_code Ignored;
+		fs::remove(Settings.AtlasPath, Ignored);
+
+		Result = AtlasPacker::Pack(Sources, Settings.AtlasPath, GetAtlasOptions(Settings)) ? ECookResult::Cooked : ECookResult::Failed;
+		if (Result == ECookResult::Cooked)
+		{
+			Log("Packed " + std::to_string(Sources.size()) + " textures -> " + Settings.AtlasPath);
+		}
+		else
+		{
+			fs::remove(Settings.AtlasPath, Ignored);
+			Log("ERROR::ASSETCOOKER::Failed to pack " + Settings.AtlasPath);
+		}
+	}
+	if (Result == ECookResult::Cooked)
+	{
+		Cache.Store(Key, ".catlas", Settings.AtlasPath);
+	}
+
+	Cache.ReleaseClaim(Key);
+	return Result;
+}
+
+AssetCooker::ECookResult AssetCooker::BuildVirtualTexture(const std::string& SourcePath, uint64_t Key)
+{
+	const std::string CookedPath = CookedVirtualTexture::GetCookedPath(SourcePath);
+	const bool bUseCache = !Settings.bForce;
+	if (bUseCache && Cache.Fetch(Key, ".cvt", CookedPath))
+	{
+		Log("Fetched " + SourcePath + " -> " + CookedPath + " from the cook cache");
+		return ECookResult::Fetched;
+	}
+	if (!Cache.TryClaim(Key))
+	{
+		return ECookResult::Busy;
+	}
+
+	ECookResult Result = ECookResult::Fetched;
+	if (!bUseCache || !Cache.Fetch(Key, ".cvt", CookedPath))
+	{
+		Result = CookVirtualTexture(SourcePath) ? ECookResult::Cooked : ECookResult::Failed;
+	}
+	if (Result == ECookResult::Cooked)
+	{
+		Cache.Store(Key, ".cvt", CookedPath);
+	}
+
+	Cache.ReleaseClaim(Key);
+	return Result;
+}
+
+void AssetCooker::WaitForClaimed(std::vector<ECookResult>& Results, const std::function<ECookResult(size_t)>& Build)
+{
+	bool bLogged = false;
+	for (;;)
+	{
+		std::vector<size_t> Claimed;
+		for (size_t i = 0; i < Results.size(); i++)
+		{
+			if (Results[i] == ECookResult::Busy)
+			{
+				Claimed.push_back(i);
+			}
+		}
+		if (Claimed.empty())
+		{
+			return;
+		}
+
+		if (!bLogged)
+		{
+			Log("Waiting for " + std::to_string(Claimed.size()) + " assets another cooker is working on");
+			bLogged = true;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(ClaimPollMilliseconds));
+
+		// each one is either in the cache by now, still claimed, or was given up and is cooked here
+		ThreadPool::Get().ParallelFor(Claimed.size(), [&](size_t i)
+		{
+			Results[Claimed[i]] = Build(Claimed[i]);
+		});
+	}
+}
+
+bool AssetCooker::CookModel(const std::string& SourcePath, CookManifest::AssetRecord& OutRecord)
+{
+	std::vector<MeshData> Meshes;
+	std::vector<std::string> Dependencies;
+	AnimationSetData ImportedAnimation;
+	if (!Model::ImportMeshData(SourcePath, Meshes, EModelImporter::Auto, &Dependencies, &ImportedAnimation))
+	{
+		Log("ERROR::COOKER::Failed to import " + SourcePath);
+		return false;
+	}
+
+	const MeshOptimizerStats Stats = MeshOptimizer::OptimizeMeshes(Meshes);
+	MeshSimplifier::BuildLodChains(Meshes);
+	MeshletBuilder::BuildAllMeshlets(Meshes);
+
+	AnimationSet Animation;
+	const AnimationCompressionStats AnimationStats = AnimationCompressor::Compress(ImportedAnimation, Animation);
+	if (AnimationStats.ClipsOverTolerance > 0)
+	{
+		Log("ERROR::COOKER::" + std::to_string(AnimationStats.ClipsOverTolerance) + " clips of " + SourcePath
+			+ " are over the animation tolerance with every key kept");
+		return false;
+	}
+
+	// a skinned model's bind pose says little about where its surface is while it plays
+	DistanceFieldData DistanceField;
+	const bool bSkinned = std::any_of(Meshes.begin(), Meshes.end(), [](const MeshData& Data) { return !Data.Skin.empty(); });
+	if (Settings.DistanceField.Resolution > 0 && !bSkinned)
+	{
+		DistanceFieldBuilder::Build(Meshes, DistanceField, Settings.DistanceField);
+	}
+
+	size_t VertexCount = 0, IndexCount = 0, LodCount = 0, MeshletCount = 0;
+	for (const MeshData& Data : Meshes)
+	{
+		VertexCount += Data.Vertices.size();
+		IndexCount += Data.Indices.size();
+		LodCount += Data.Lods.size();
+		MeshletCount += Data.Meshlets.size();
+	}
+
+	// the old file may be hardlinked to a cache entry, writing into it would change the entry
+	const std::string CookedPath = CookedMesh::GetCookedPath(SourcePath);
+	std::error_code Ignored;
+	fs::remove(CookedPath, Ignored);
+	if (!CookedMesh::Write(CookedPath, Meshes, Settings.VertexFormat, &Animation, &DistanceField))
+	{
+		Log("ERROR::COOKER::Failed to write " + CookedPath);
+		return false;
+	}
+
+	// assimp opens some files more than once
+	OutRecord = CookManifest::AssetRecord();
+	OutRecord.Kind = "mesh";
+	for (const std::string& Dependency : Dependencies)
+	{
+		if (std::find(OutRecord.Dependencies.begin(), OutRecord.Dependencies.end(), Dependency) == OutRecord.Dependencies.end())
+		{
+			OutRecord.Dependencies.push_back(Dependency);
+		}
+	}
+	OutRecord.Key = GetModelKey(SourcePath, OutRecord.Dependencies);
+
+	std::set<std::pair<std::string, std::string>> TextureRefs;
+	for (const MeshData& Data : Meshes)
+	{
+		for (const MaterialTextureRef& Ref : Data.TextureRefs)
+		{
+			if (TextureRefs.insert(std::make_pair(Ref.Type, Ref.Path)).second)
+			{
+				OutRecord.TextureRefs.push_back(Ref);
+			}
+		}
+	}
+
+	std::ostringstream Message;
+	Message << "Cooked " << SourcePath << " -> " << CookedPath << " (" << Meshes.size() << " meshes, " << VertexCount << " vertices, "
+		<< IndexCount << " indices, " << LodCount << " LODs, " << MeshletCount << " meshlets";
+	if (!Animation.IsEmpty())
+	{
+		Message << ", " << Animation.Skeleton.GetBoneCount() << " bones, " << Animation.Clips.size() << " clips";
+	}
+	if (!DistanceField.IsEmpty())
+	{
+		Message << ", " << DistanceField.Resolution.x << "x" << DistanceField.Resolution.y << "x" << DistanceField.Resolution.z << " distance field";
+	}
+	Message << ")";
+	{
+		std::lock_guard<std::mutex> Lock(LogMutex);
+		MeshOptimizer::PrintStats(SourcePath, Stats);
+		if (!Animation.IsEmpty())
+		{
+			AnimationCompressor::PrintStats(SourcePath, AnimationStats);
+		}
+	}
+	Log(Message.str());
+	return true;
+}
+
+bool AssetCooker::CookTexture(const std::string& SourcePath, const std::string& TextureType)
+{
+	TextureCooker::CookOptions Options;
+	Options.TextureType = TextureType;
+	Options.bHighQuality = Settings.bHighQualityTextures;
+
+	const std::string CookedPath = CookedTexture::GetCookedPath(SourcePath);
+	std::error_code Ignored;
+	fs::remove(CookedPath, Ignored);
+	if (!TextureCooker::Cook(SourcePath, CookedPath, Options))
+	{
+		Log("ERROR::COOKER::Failed to cook " + SourcePath);
+		return false;
+	}
+
+	Log("Cooked " + SourcePath + " -> " + CookedPath + " (" + TextureType + ")");
+	return true;
+}
+
+bool AssetCooker::CookScene(const std::string& SourcePath)
+{
+	SceneData Scene;
+	if (!SceneImporter::Import(SourcePath, Scene))
+	{
+		Log("ERROR::COOKER::Failed to import " + SourcePath);
+		return false;
+	}
+
+	const std::string CookedPath = CookedScene::GetCookedPath(SourcePath);
+	if (!CookedScene::Write(CookedPath, Scene))
+	{
+		std::error_code Ignored;
+		fs::remove(CookedPath, Ignored);
+		Log("ERROR::COOKER::Failed to write " + CookedPath);
+		return false;
+	}
+
+	std::ostringstream Message;
+	Message << "Cooked " << SourcePath << " -> " << CookedPath << " (" << Scene.Transforms.size() << " objects, "
+		<< Scene.Models.size() << " models, " << Scene.Lights.size() << " lights)";
+	Log(Message.str());
+	return true;
+}
+
+bool AssetCooker::CookVirtualTexture(const std::string& SourcePath)
+{
+	const std::string CookedPath = CookedVirtualTexture::GetCookedPath(SourcePath);
+	std::error_code Ignored;
+	fs::remove(CookedPath, Ignored);
+	if (!VirtualTextureCooker::Cook(SourcePath, CookedPath))
+	{
+		fs::remove(CookedPath, Ignored);
+		Log("ERROR::COOKER::Failed to cook virtual texture " + SourcePath);
+		return false;
+	}
+
+	Log("Cooked " + SourcePath + " -> " + CookedPath + " (virtual texture)");
+	return true;
+}
+
+AssetCooker::ECookResult AssetCooker::CookAtlas(const std::vector<AtlasPacker::SourceTexture>& Candidates)
+{
+	const std::string AtlasKey = Paths::Normalise(Settings.AtlasPath);
+	if (Candidates.empty())
+	{
+		// the engine would otherwise keep remapping materials into an atlas nothing is packed into anymore
+		std::error_code Ignored;
+		fs::remove(Settings.AtlasPath, Ignored);
+		Current.Assets.erase(AtlasKey);
+		return ECookResult::UpToDate;
+	}
+
+	CookManifest::AssetRecord Record;
+	Record.Kind = "atlas";
+	Record.Key = GetAtlasKey(Candidates);
+	for (const AtlasPacker::SourceTexture& Candidate : Candidates)
+	{
+		Record.Dependencies.push_back(Candidate.Path);
+	}
+
+	auto Found = Previous.Assets.find(AtlasKey);
+	if (!Settings.bForce && Found != Previous.Assets.end() && Found->second.Kind == "atlas" && Found->second.Key == Record.Key
+		&& fs::exists(Settings.AtlasPath))
+	{
+		Current.Assets[AtlasKey] = Record;
+		return ECookResult::UpToDate;
+	}
+
+	std::vector<ECookResult> Results(1, BuildAtlas(Candidates, Record.Key));
+	WaitForClaimed(Results, [&](size_t)
+	{
+		return BuildAtlas(Candidates, Record.Key);
+	});
+
+	if (Results[0] == ECookResult::Failed)
+	{
+		Current.Assets.erase(AtlasKey);
+	}
+	else
+	{
+		Current.Assets[AtlasKey] = Record;
+	}
+	return Results[0];
+}
+
+void AssetCooker::Log(const std::string& Message)
+{
+	std::lock_guard<std::mutex> Lock(LogMutex);
+	std::cout << Message << std::endl;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "CookCache.h"
+#include "CookManifest.h"
+#include "Engine/Texture/AtlasPacker.h"
+#include "Engine/Texture/CookedAtlas.h"
+#include "Engine/Mesh/DistanceField.h"
+#include "Engine/Mesh/VertexFormat.h"
+
+struct CookSettings
+{
+	EVertexFormat VertexFormat = EVertexFormat::Packed;
+	bool bHighQualityTextures = false;
+
+	// Cook every asset even if the manifest says it is up to date or the cache has it
+	bool bForce = false;
+
+	// Shared CookCache directory, empty to cook without one
+	std::string CacheDirectory;
+
+	// Where the material textures small enough to share an atlas are packed, empty to leave them out
+	std::string AtlasPath = CookedAtlas::DefaultPath;
+
+	// Also cut material textures of at least VirtualTextureCooker::MinSize into virtual texture pages (.cvt)
+	bool bVirtualTextures = false;
+
+	// Signed distance field cooked into every static model, a resolution of 0 leaves them out
+	DistanceFieldSettings DistanceField;
+};
+
+// Incremental cooker. Every asset is identified by a key hashing the contents of all files it was built from
+// together with the settings and format versions that affect its output, an asset whose key matches the one in the
+// manifest and whose cooked file still exists is skipped.
+// The dependency graph comes out of the importers: a model depends on every file Model::ImportMeshData read (the
+// model, its material libraries, ...) and each texture its materials reference depends on the image and on the
+// type the models use it as. Models are cooked first, all of them in parallel, then the textures they reference.
+// With a cache directory, dirty assets are fetched from the CookCache when another run already cooked the same
+// inputs, and what is cooked here is published to it. A model's dependencies are only known after importing it, so
+// the cache also keeps a recipe per model source listing them, keyed by the model file's contents alone.
+// With virtual textures on, large diffuse textures are then cut into pages for VirtualTextureSystem.
+// Text scenes are cooked on their own, they only name their models and depend on nothing but their own file.
+// Last, the material textures small enough for AtlasPacker are packed into one atlas keyed by all of them. Both sit
+// on top of the texture's own .ctex, which stays for anything loading the texture outside a material.
+class AssetCooker
+{
+public:
+	// Bump when a change to the cooking code changes its output so every asset is cooked again
+	static const uint32_t CookerVersion = 3;
+
+	// How often to look again at assets another process has claimed
+	static constexpr int ClaimPollMilliseconds = 100;
+
+	AssetCooker(const CookSettings& InSettings, const std::string& InManifestPath);
+
+	// Adds every model, image and scene under the directory
+	bool AddDirectory(const std::string& Directory);
+
+	// Adds a single model, image or scene
+	bool AddFile(const std::string& FilePath);
+
+	// Cooks every dirty asset and rewrites the manifest, returns false if any asset failed to cook
+	bool Cook();
+
+	static bool IsModel(const std::string& FilePath);
+	static bool IsImage(const std::string& FilePath);
+	static bool IsScene(const std::string& FilePath);
+
+private:
+	enum class ECookResult
+	{
+		UpToDate,
+		Cooked,
+		Fetched,
+		Failed,
+		Busy // claimed by another process, try again later
+	};
+
+	// Content hash of the file, 0 if it does not exist. Reuses the manifest's hash when the size and modification
+	// time have not changed. Thread safe.
+	uint64_t HashFile(const std::string& FilePath);
+
+	uint64_t GetModelKey(const std::string& SourcePath, const std::vector<std::string>& Dependencies);
+	uint64_t GetTextureKey(const std::string& FilePath, const std::string& TextureType);
+	uint64_t GetAtlasKey(const std::vector<AtlasPacker::SourceTexture>& Sources);
+	uint64_t GetVirtualTextureKey(const std::string& FilePath);
+	uint64_t GetSceneKey(const std::string& FilePath);
+
+	// Key of the model's dependency list in the cache, covers the model file's contents and its extension
+	uint64_t GetRecipeKey(const std::string& SourcePath);
+
+	// Fetch from the cache, or claim, cook and publish
+	ECookResult BuildModel(const std::string& SourcePath, CookManifest::AssetRecord& OutRecord);
+	ECookResult BuildTexture(const std::string& SourcePath, const std::string& TextureType, uint64_t Key);
+	ECookResult BuildAtlas(const std::vector<AtlasPacker::SourceTexture>& Sources, uint64_t Key);
+	ECookResult BuildVirtualTexture(const std::string& SourcePath, uint64_t Key);
+	bool FetchModel(const std::string& SourcePath, uint64_t RecipeKey, CookManifest::AssetRecord& OutRecord);
+
+	// Retries every Busy asset until it has been fetched or cooked
+	void WaitForClaimed(std::vector<ECookResult>& Results, const std::function<ECookResult(size_t)>& Build);
+
+	bool CookModel(const std::string& SourcePath, CookManifest::AssetRecord& OutRecord);
+	bool CookTexture(const std::string& SourcePath, const std::string& TextureType);
+	bool CookVirtualTexture(const std::string& SourcePath);
+	bool CookScene(const std::string& SourcePath);
+
+	// Packs the atlas from the material textures, removes a stale one when none of them fits
+	ECookResult CookAtlas(const std::vector<AtlasPacker::SourceTexture>& Candidates);
+
+	// Worker threads print whole messages so lines from different assets do not interleave
+	void Log(const std::string& Message);
+
+	CookSettings Settings;
+	std::string ManifestPath;
+	CookCache Cache;
+
+	// Sources by normalised path, the original spelling is kept for opening and naming cooked files
+	std::vector<std::pair<std::string, std::string>> Models;
+	std::vector<std::pair<std::string, std::string>> Images;
+	std::vector<std::pair<std::string, std::string>> Scenes;
+
+	CookManifest Previous;
+	CookManifest Current;
+	std::mutex FilesMutex;
+	std::mutex LogMutex;
+};
@@ -0,0 +1,213 @@
+#include "ClaimTest.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "CookCache.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	const int KeyCount = 64;
+
+	// Short enough for the test to wait out, claims are refreshed four times as often
+	const int StaleClaimSeconds = 2;
+
+	// Every StaleEvery-th key starts with a dead claim, every SlowEvery-th one cooks for longer than a claim stays fresh
+	const int StaleEvery = 4;
+	const int SlowEvery = 8;
+	const int SlowCookMilliseconds = StaleClaimSeconds * 1500;
+	const int CookMilliseconds = 5;
+
+	// The keys have to be spread like asset keys, the cache fans entries out by their first byte
+	uint64_t GetKey(int Index)
+	{
+		return 0x9E3779B97F4A7C15ull * static_cast<uint64_t>(Index + 1);
+	}
+
+	std::string GetMarkerPath(const std::string& TestDirectory, const char* Kind, int Index)
+	{
+		return (fs::path(TestDirectory) / Kind / std::to_string(Index)).string();
+	}
+
+	bool CreateExclusive(const std::string& Path)
+	{
+		std::FILE* File = std::fopen(Path.c_str(), "wx");
+		if (File)
+		{
+			std::fclose(File);
+		}
+		return File != nullptr;
+	}
+
+	std::string GetCacheDirectory(const std::string& TestDirectory)
+	{
+		return (fs::path(TestDirectory) / "cache").string();
+	}
+
+	// Claims left behind by a process that died, old enough to be stale
+	bool AddDeadClaims(const std::string& TestDirectory)
+	{
+		const fs::path Claims = fs::path(GetCacheDirectory(TestDirectory)) / "v1" / "claims";
+		for (int i = 0; i < KeyCount; i += StaleEvery)
+		{
+			char Name[17];
+			std::snprintf(Name, sizeof(Name), "%016llx", static_cast<unsigned long long>(GetKey(i)));
+			const std::string ClaimPath = (Claims / Name).string();
+			if (!CreateExclusive(ClaimPath))
+			{
+				return false;
+			}
+
+			std::error_code Error;
+			fs::last_write_time(ClaimPath, fs::file_time_type::clock::now() - std::chrono::seconds(StaleClaimSeconds * 2), Error);
+			if (Error)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+int ClaimTest::Run(const std::string& ExecutablePath, const std::string& Directory, int Processes)
+{
+	const std::string TestDirectory = (fs::path(Directory) / ("claim-test-" + std::to_string(std::random_device()()))).string();
+	std::error_code Error;
+	fs::create_directories(fs::path(TestDirectory) / "cooking", Error);
+	fs::create_directories(fs::path(TestDirectory) / "cooked", Error);
+	if (Error)
+	{
+		std::cout << "ERROR::CLAIMTEST::Could not create " << TestDirectory << ": " << Error.message() << std::endl;
+		return 1;
+	}
+
+	bool bPassed = true;
+	{
+		// creates the cache layout the dead claims go into
+		CookCache Cache(GetCacheDirectory(TestDirectory));
+		bPassed = Cache.IsEnabled() && AddDeadClaims(TestDirectory);
+	}
+	if (!bPassed)
+	{
+		std::cout << "ERROR::CLAIMTEST::Could not set up " << TestDirectory << std::endl;
+		fs::remove_all(TestDirectory, Error);
+		return 1;
+	}
+
+	std::cout << "Claim test: " << Processes << " processes, " << KeyCount << " keys in " << TestDirectory << std::endl;
+	const auto Start = std::chrono::steady_clock::now();
+	std::vector<int> ExitCodes(Processes, 0);
+	std::vector<std::thread> Workers;
+	for (int i = 0; i < Processes; i++)
+	{
+		Workers.emplace_back([&, i]()
+		{
+			std::string Command = "\"" + ExecutablePath + "\" --claim-worker \"" + TestDirectory + "\" " + std::to_string(i);
+#ifdef _WIN32
+			// cmd /c strips the first and last quote of a command holding more than two, the outer pair keeps ours
+			Command = "\"" + Command + "\"";
+#endif
+			ExitCodes[i] = std::system(Command.c_str());
+		});
+	}
+	for (std::thread& Worker : Workers)
+	{
+		Worker.join();
+	}
+
+	for (int i = 0; i < Processes; i++)
+	{
+		if (ExitCodes[i] != 0)
+		{
+			std::cout << "ERROR::CLAIMTEST::Worker " << i << " failed" << std::endl;
+			bPassed = false;
+		}
+	}
+	for (int i = 0; i < KeyCount; i++)
+	{
+		if (!fs::exists(GetMarkerPath(TestDirectory, "cooked", i), Error))
+		{
+			std::cout << "ERROR::CLAIMTEST::Key " << i << " was never cooked" << std::endl;
+			bPassed = false;
+		}
+	}
+	if (!fs::is_empty(fs::path(GetCacheDirectory(TestDirectory)) / "v1" / "claims", Error))
+	{
+		std::cout << "ERROR::CLAIMTEST::Claims were left behind" << std::endl;
+		bPassed = false;
+	}
+
+	const double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	std::cout << "Claim test " << (bPassed ? "passed" : "FAILED") << " in " << Seconds << " s" << std::endl;
+	fs::remove_all(TestDirectory, Error);
+	return bPassed ? 0 : 1;
+}
+
+int ClaimTest::RunWorker(const std::string& TestDirectory, int WorkerIndex)
+{
+	CookCache Cache(GetCacheDirectory(TestDirectory), StaleClaimSeconds);
+	if (!Cache.IsEnabled())
+	{
+		return 1;
+	}
+
+	// each worker starts somewhere else so they meet on every kind of key
+	std::vector<int> Pending;
+	for (int i = 0; i < KeyCount; i++)
+	{
+		Pending.push_back((i + WorkerIndex * 7) % KeyCount);
+	}
+
+	bool bPassed = true;
+	while (!Pending.empty())
+	{
+		std::vector<int> Busy;
+		for (const int Index : Pending)
+		{
+			// the same order AssetCooker follows: look, claim, look again, cook
+			const std::string CookedPath = GetMarkerPath(TestDirectory, "cooked", Index);
+			std::error_code Error;
+			if (fs::exists(CookedPath, Error))
+			{
+				continue;
+			}
+			if (!Cache.TryClaim(GetKey(Index)))
+			{
+				Busy.push_back(Index);
+				continue;
+			}
+			if (fs::exists(CookedPath, Error))
+			{
+				Cache.ReleaseClaim(GetKey(Index));
+				continue;
+			}
+
+			// fails if another process is cooking the key right now
+			const std::string CookingPath = GetMarkerPath(TestDirectory, "cooking", Index);
+			if (!CreateExclusive(CookingPath))
+			{
+				std::cout << "ERROR::CLAIMTEST::Worker " << WorkerIndex << " cooks key " << Index << " together with another process" << std::endl;
+				bPassed = false;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(Index % SlowEvery == 1 ? SlowCookMilliseconds : CookMilliseconds));
+			fs::remove(CookingPath, Error);
+			CreateExclusive(CookedPath);
+			Cache.ReleaseClaim(GetKey(Index));
+		}
+
+		Pending.swap(Busy);
+		if (!Pending.empty())
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		}
+	}
+	return bPassed ? 0 : 1;
+}
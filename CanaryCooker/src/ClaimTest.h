@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+
+// Checks CookCache claims across processes: starts several copies of the cooker on one cache directory, each
+// claiming and "cooking" the same keys, and fails if two of them ever cook a key at the same time. Some keys start out
+// with claims left by a process that died, which have to be taken over, and some take longer to cook than a claim
+// stays fresh, which the refresh has to keep.
+namespace ClaimTest
+{
+	// Runs the test in a new directory under Directory and removes it afterwards. ExecutablePath is the cooker
+	// itself, for starting the workers. Returns the exit code.
+	int Run(const std::string& ExecutablePath, const std::string& Directory, int Processes);
+
+	// One of the processes Run starts
+	int RunWorker(const std::string& TestDirectory, int WorkerIndex);
+}
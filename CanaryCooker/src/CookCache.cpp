@@ -0,0 +1,358 @@
+#include "CookCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	// Version of the directory layout, not of the cooked formats (those are part of every key)
+	const char* const LayoutVersion = "v1";
+
+	// Links if possible so a hit costs no copying, the cache may be on a different volume or a file system
+	// without hardlinks
+	bool LinkOrCopy(const std::string& From, const std::string& To)
+	{
+		std::error_code Error;
+		fs::remove(To, Error);
+		fs::create_hard_link(From, To, Error);
+		if (!Error)
+		{
+			return true;
+		}
+		return fs::copy_file(From, To, fs::copy_options::overwrite_existing, Error) && !Error;
+	}
+
+	std::string ToHex(uint64_t Value)
+	{
+		char Text[17];
+		std::snprintf(Text, sizeof(Text), "%016llx", static_cast<unsigned long long>(Value));
+		return Text;
+	}
+
+	// Unique across threads, processes and machines sharing the directory
+	std::string MakeUniqueName()
+	{
+		static std::atomic<uint64_t> Counter(0);
+		static const uint64_t ProcessId = (static_cast<uint64_t>(std::random_device()()) << 32) ^ std::random_device()();
+		return ToHex(ProcessId) + "-" + std::to_string(Counter++);
+	}
+
+	// Opening with "x" fails if the file exists, which is atomic on local disks, NFS 3 and later and SMB shares,
+	// exactly one process creates the claim
+	bool CreateClaim(const std::string& ClaimPath, const std::string& Token)
+	{
+		std::FILE* File = std::fopen(ClaimPath.c_str(), "wx");
+		if (!File)
+		{
+			return false;
+		}
+		std::fwrite(Token.data(), 1, Token.size(), File);
+		std::fclose(File);
+		return true;
+	}
+
+	// False if there is no claim, a claim that is still being written reads as an empty token
+	bool ReadClaim(const std::string& ClaimPath, std::string& OutToken)
+	{
+		std::ifstream In(ClaimPath, std::ios::binary);
+		if (!In)
+		{
+			return false;
+		}
+		std::ostringstream Token;
+		Token << In.rdbuf();
+		OutToken = Token.str();
+		return true;
+	}
+}
+
+CookCache::CookCache(const std::string& InDirectory, int InStaleClaimSeconds)
+	: Directory(InDirectory)
+	, StaleClaimSeconds(InStaleClaimSeconds)
+{
+	if (Directory.empty())
+	{
+		return;
+	}
+
+	std::error_code Error;
+	fs::create_directories(fs::path(Directory) / LayoutVersion / "tmp", Error);
+	fs::create_directories(fs::path(Directory) / LayoutVersion / "claims", Error);
+	if (Error)
+	{
+		std::cout << "ERROR::COOKCACHE::Could not create " << Directory << ": " << Error.message() << ", cooking without a cache" << std::endl;
+		Directory.clear();
+		return;
+	}
+
+	RefreshThread = std::thread(&CookCache::RefreshClaims, this);
+}
+
+CookCache::~CookCache()
+{
+	if (RefreshThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> Lock(ClaimsMutex);
+			bStopping = true;
+		}
+		StopRequested.notify_all();
+		RefreshThread.join();
+	}
+}
+
+bool CookCache::Fetch(uint64_t Key, const char* Extension, const std::string& DestinationPath) const
+{
+	if (!IsEnabled())
+	{
+		return false;
+	}
+
+	const std::string EntryPath = GetEntryPath(Key, Extension);
+	std::error_code Error;
+	if (!fs::is_regular_file(EntryPath, Error))
+	{
+		return false;
+	}
+
+	// linked next to the destination first, so an interrupted fetch never leaves half a file behind
+	const std::string TempPath = DestinationPath + ".fetch";
+	if (!LinkOrCopy(EntryPath, TempPath))
+	{
+		fs::remove(TempPath, Error);
+		return false;
+	}
+
+	fs::rename(TempPath, DestinationPath, Error);
+	if (Error)
+	{
+		std::cout << "ERROR::COOKCACHE::Could not move " << TempPath << " to " << DestinationPath << ": " << Error.message() << std::endl;
+		fs::remove(TempPath, Error);
+		return false;
+	}
+
+	// the engine only trusts a cooked file that is newer than its source, a link keeps the entry's original time
+	fs::last_write_time(DestinationPath, fs::file_time_type::clock::now(), Error);
+	return true;
+}
+
+bool CookCache::Store(uint64_t Key, const char* Extension, const std::string& SourcePath) const
+{
+	if (!IsEnabled())
+	{
+		return false;
+	}
+
+	const std::string TempPath = GetTempPath();
+	if (!LinkOrCopy(SourcePath, TempPath))
+	{
+		std::cout << "ERROR::COOKCACHE::Could not copy " << SourcePath << " into " << Directory << std::endl;
+		return false;
+	}
+	return Publish(TempPath, GetEntryPath(Key, Extension));
+}
+
+bool CookCache::ReadText(uint64_t Key, const char* Extension, std::string& OutText) const
+{
+	if (!IsEnabled())
+	{
+		return false;
+	}
+
+	std::ifstream In(GetEntryPath(Key, Extension));
+	if (!In)
+	{
+		return false;
+	}
+
+	std::ostringstream Text;
+	Text << In.rdbuf();
+	OutText = Text.str();
+	return true;
+}
+
+bool CookCache::WriteText(uint64_t Key, const char* Extension, const std::string& Text) const
+{
+	if (!IsEnabled())
+	{
+		return false;
+	}
+
+	const std::string TempPath = GetTempPath();
+	{
+		std::ofstream Out(TempPath, std::ios::trunc);
+		if (!(Out << Text) || !Out.flush())
+		{
+			std::error_code Error;
+			fs::remove(TempPath, Error);
+			return false;
+		}
+	}
+	return Publish(TempPath, GetEntryPath(Key, Extension));
+}
+
+bool CookCache::TryClaim(uint64_t Key)
+{
+	if (!IsEnabled())
+	{
+		return true;
+	}
+
+	const std::string ClaimPath = GetClaimPath(Key);
+	const std::string Token = MakeUniqueName();
+	if (!CreateClaim(ClaimPath, Token) && !TakeOverStaleClaim(ClaimPath, Token))
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> Lock(ClaimsMutex);
+	HeldClaims[Key] = Token;
+	return true;
+}
+
+void CookCache::ReleaseClaim(uint64_t Key)
+{
+	if (!IsEnabled())
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> Lock(ClaimsMutex);
+	const auto Held = HeldClaims.find(Key);
+	if (Held == HeldClaims.end())
+	{
+		return;
+	}
+
+	// a claim that was taken over belongs to its new owner
+	const std::string ClaimPath = GetClaimPath(Key);
+	std::string Token;
+	if (ReadClaim(ClaimPath, Token) && Token == Held->second)
+	{
+		std::error_code Error;
+		fs::remove(ClaimPath, Error);
+	}
+	HeldClaims.erase(Held);
+}
+
+bool CookCache::IsClaimed(uint64_t Key) const
+{
+	if (!IsEnabled())
+	{
+		return false;
+	}
+
+	const std::string ClaimPath = GetClaimPath(Key);
+	std::error_code Error;
+	return fs::exists(ClaimPath, Error) && !IsStale(ClaimPath);
+}
+
+bool CookCache::IsStale(const std::string& ClaimPath) const
+{
+	std::error_code Error;
+	const fs::file_time_type ClaimTime = fs::last_write_time(ClaimPath, Error);
+	return !Error && fs::file_time_type::clock::now() - ClaimTime > std::chrono::seconds(StaleClaimSeconds);
+}
+
+bool CookCache::TakeOverStaleClaim(const std::string& ClaimPath, const std::string& Token) const
+{
+	std::string StaleToken;
+	if (!ReadClaim(ClaimPath, StaleToken))
+	{
+		// released since the claim was tried
+		return CreateClaim(ClaimPath, Token);
+	}
+	if (!IsStale(ClaimPath))
+	{
+		return false;
+	}
+
+	// Deleting the claim could delete the one a faster process has just put in its place. A rename moves whatever
+	// claim is there at that moment and moves it once, so of all processes breaking the claim only one gets it.
+	const std::string MovedPath = GetTempPath();
+	std::error_code Error;
+	fs::rename(ClaimPath, MovedPath, Error);
+	if (Error)
+	{
+		return false;
+	}
+
+	std::string MovedToken;
+	const bool bMovedStale = ReadClaim(MovedPath, MovedToken) && MovedToken == StaleToken && IsStale(MovedPath);
+	fs::remove(MovedPath, Error);
+	if (!bMovedStale)
+	{
+		// another process took the claim over between the check and the rename, hand it back. Should a third
+		// process claim the key in between, both cook it, which costs time but publishes the same entry.
+		CreateClaim(ClaimPath, MovedToken);
+		return false;
+	}
+
+	std::cout << "Taking over stale cook cache claim " << ClaimPath << std::endl;
+	return CreateClaim(ClaimPath, Token);
+}
+
+void CookCache::RefreshClaims()
+{
+	const std::chrono::milliseconds Interval(std::max(StaleClaimSeconds * 1000 / 4, 1));
+	std::unique_lock<std::mutex> Lock(ClaimsMutex);
+	while (!StopRequested.wait_for(Lock, Interval, [this]() { return bStopping; }))
+	{
+		for (auto Held = HeldClaims.begin(); Held != HeldClaims.end();)
+		{
+			const std::string ClaimPath = GetClaimPath(Held->first);
+			std::string Token;
+			std::error_code Error;
+			if (ReadClaim(ClaimPath, Token) && Token == Held->second)
+			{
+				fs::last_write_time(ClaimPath, fs::file_time_type::clock::now(), Error);
+				++Held;
+				continue;
+			}
+
+			// reported once, ReleaseClaim leaves the new owner's claim alone
+			std::cout << "ERROR::COOKCACHE::Lost the claim " << ClaimPath << ", another process may cook the same asset" << std::endl;
+			Held = HeldClaims.erase(Held);
+		}
+	}
+}
+
+std::string CookCache::GetEntryPath(uint64_t Key, const char* Extension) const
+{
+	// fanned out over 256 directories so none of them grows too large
+	const std::string Name = ToHex(Key);
+	return (fs::path(Directory) / LayoutVersion / Name.substr(0, 2) / (Name + Extension)).string();
+}
+
+std::string CookCache::GetClaimPath(uint64_t Key) const
+{
+	return (fs::path(Directory) / LayoutVersion / "claims" / ToHex(Key)).string();
+}
+
+std::string CookCache::GetTempPath() const
+{
+	return (fs::path(Directory) / LayoutVersion / "tmp" / MakeUniqueName()).string();
+}
+
+bool CookCache::Publish(const std::string& TempPath, const std::string& EntryPath) const
+{
+	std::error_code Error;
+	fs::create_directories(fs::path(EntryPath).parent_path(), Error);
+	fs::rename(TempPath, EntryPath, Error);
+	if (Error)
+	{
+		std::cout << "ERROR::COOKCACHE::Could not publish " << EntryPath << ": " << Error.message() << std::endl;
+		fs::remove(TempPath, Error);
+		return false;
+	}
+	return true;
+}
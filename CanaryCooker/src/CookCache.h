@@ -0,0 +1,77 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// Content addressed store of cooked files shared between cooker runs, processes and machines (the directory can
+// live on a network mount). Entries are named by the asset key, which already covers the source contents, the
+// settings and the cooker version, so an entry never has to be invalidated.
+// Nothing in the directory is ever written in place: files are written under a unique temporary name and renamed
+// into place, so readers only ever see complete entries. A process about to cook an asset first claims its key by
+// creating a claim file exclusively, which either succeeds or fails atomically, so two processes never cook the same
+// asset. The file holds a token naming the claim's owner. A background thread touches the claims this cache holds
+// every quarter of StaleClaimSeconds, a claim left untouched for longer belongs to a process that died and is taken
+// over: it is renamed away, which only one of the processes breaking it can do, and replaced by a new claim.
+class CookCache
+{
+public:
+	// Claims not refreshed for this long are assumed to belong to a process that died and are taken over
+	static constexpr int DefaultStaleClaimSeconds = 600;
+
+	// An empty directory disables the cache, every lookup misses
+	explicit CookCache(const std::string& InDirectory, int InStaleClaimSeconds = DefaultStaleClaimSeconds);
+	~CookCache();
+
+	CookCache(const CookCache&) = delete;
+	CookCache& operator=(const CookCache&) = delete;
+
+	bool IsEnabled() const { return !Directory.empty(); }
+	const std::string& GetDirectory() const { return Directory; }
+
+	// Hardlinks the entry to DestinationPath, copying it when the cache is on another volume. False on a miss.
+	bool Fetch(uint64_t Key, const char* Extension, const std::string& DestinationPath) const;
+
+	// Publishes a local file as the entry for Key
+	bool Store(uint64_t Key, const char* Extension, const std::string& SourcePath) const;
+
+	bool ReadText(uint64_t Key, const char* Extension, std::string& OutText) const;
+	bool WriteText(uint64_t Key, const char* Extension, const std::string& Text) const;
+
+	// True if this cache now owns the key and keeps its claim fresh until ReleaseClaim, false if another process is
+	// working on it. Thread safe.
+	bool TryClaim(uint64_t Key);
+	void ReleaseClaim(uint64_t Key);
+
+	// Whether a live claim is held on the key, by anyone
+	bool IsClaimed(uint64_t Key) const;
+
+private:
+	std::string GetEntryPath(uint64_t Key, const char* Extension) const;
+	std::string GetClaimPath(uint64_t Key) const;
+	std::string GetTempPath() const;
+
+	// Moves a finished temporary file into place, an existing entry is identical and may be replaced
+	bool Publish(const std::string& TempPath, const std::string& EntryPath) const;
+
+	bool IsStale(const std::string& ClaimPath) const;
+
+	// Replaces the claim at ClaimPath with one holding Token if it is stale
+	bool TakeOverStaleClaim(const std::string& ClaimPath, const std::string& Token) const;
+
+	// Body of RefreshThread, touches every held claim until the cache is destroyed
+	void RefreshClaims();
+
+	std::string Directory;
+	int StaleClaimSeconds;
+
+	// Token of every claim this cache holds, by key
+	std::unordered_map<uint64_t, std::string> HeldClaims;
+	bool bStopping = false;
+	std::mutex ClaimsMutex;
+	std::condition_variable StopRequested;
+	std::thread RefreshThread;
+};
@@ -0,0 +1,162 @@
+#include "CookManifest.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+	const char* const Header = "CanaryCookManifest";
+
+	// Paths may contain spaces so they are always the last field on a line
+	std::string ReadPath(std::istringstream& Line)
+	{
+		std::string Path;
+		std::getline(Line >> std::ws, Path);
+		return Path;
+	}
+
+	template <typename T>
+	std::vector<const typename T::value_type*> SortedByPath(const T& Map)
+	{
+		std::vector<const typename T::value_type*> Sorted;
+		Sorted.reserve(Map.size());
+		for (const typename T::value_type& Pair : Map)
+		{
+			Sorted.push_back(&Pair);
+		}
+		std::sort(Sorted.begin(), Sorted.end(), [](const typename T::value_type* A, const typename T::value_type* B)
+		{
+			return A->first < B->first;
+		});
+		return Sorted;
+	}
+}
+
+bool CookManifest::Load(const std::string& FilePath)
+{
+	Files.clear();
+	Assets.clear();
+
+	std::ifstream In(FilePath);
+	if (!In)
+	{
+		return true;
+	}
+
+	std::string Text;
+	std::string FileHeader;
+	uint32_t FileVersion = 0;
+	std::getline(In, Text);
+	std::istringstream(Text) >> FileHeader >> FileVersion;
+	if (FileHeader != Header || FileVersion != Version)
+	{
+		std::cout << "Discarding outdated cook manifest " << FilePath << std::endl;
+		return false;
+	}
+
+	AssetRecord* Current = nullptr;
+	while (std::getline(In, Text))
+	{
+		std::istringstream Line(Text);
+		std::string Tag;
+		Line >> Tag;
+
+		if (Tag == "file")
+		{
+			FileRecord Record;
+			Line >> std::hex >> Record.Hash >> std::dec >> Record.Size >> Record.ModifiedTime;
+			const std::string Path = ReadPath(Line);
+			if (Line.fail() || Path.empty())
+			{
+				break;
+			}
+			Files[Path] = Record;
+		}
+		else if (Tag == "asset")
+		{
+			AssetRecord Record;
+			Line >> Record.Kind >> std::hex >> Record.Key;
+			const std::string Path = ReadPath(Line);
+			if (Line.fail() || Path.empty())
+			{
+				break;
+			}
+			Current = &(Assets[Path] = Record);
+		}
+		else if (Tag == "dep" && Current)
+		{
+			Current->Dependencies.push_back(ReadPath(Line));
+		}
+		else if (Tag == "ref" && Current)
+		{
+			MaterialTextureRef Ref;
+			Line >> Ref.Type;
+			Ref.Path = ReadPath(Line);
+			Current->TextureRefs.push_back(Ref);
+		}
+		else if (!Tag.empty())
+		{
+			break;
+		}
+	}
+
+	if (!In.eof())
+	{
+		std::cout << "ERROR::COOKMANIFEST::Malformed line in " << FilePath << ": " << Text << std::endl;
+		Files.clear();
+		Assets.clear();
+		return false;
+	}
+	return true;
+}
+
+bool CookManifest::Save(const std::string& FilePath) const
+{
+	const std::string TempPath = FilePath + ".tmp";
+	{
+		std::ofstream Out(TempPath, std::ios::trunc);
+		if (!Out)
+		{
+			std::cout << "ERROR::COOKMANIFEST::Could not open " << TempPath << " for writing" << std::endl;
+			return false;
+		}
+
+		// sorted so the file only changes where the assets did
+		Out << Header << ' ' << Version << '\n';
+		for (const auto* File : SortedByPath(Files))
+		{
+			Out << "file " << std::hex << File->second.Hash << std::dec << ' ' << File->second.Size << ' '
+				<< File->second.ModifiedTime << ' ' << File->first << '\n';
+		}
+		for (const auto* Asset : SortedByPath(Assets))
+		{
+			Out << "asset " << Asset->second.Kind << ' ' << std::hex << Asset->second.Key << std::dec << ' ' << Asset->first << '\n';
+			for (const std::string& Dependency : Asset->second.Dependencies)
+			{
+				Out << "dep " << Dependency << '\n';
+			}
+			for (const MaterialTextureRef& Ref : Asset->second.TextureRefs)
+			{
+				Out << "ref " << Ref.Type << ' ' << Ref.Path << '\n';
+			}
+		}
+
+		if (!Out.flush())
+		{
+			std::cout << "ERROR::COOKMANIFEST::Failed to write " << TempPath << std::endl;
+			return false;
+		}
+	}
+
+	std::error_code Error;
+	std::filesystem::rename(TempPath, FilePath, Error);
+	if (Error)
+	{
+		std::cout << "ERROR::COOKMANIFEST::Could not replace " << FilePath << ": " << Error.message() << std::endl;
+		return false;
+	}
+	return true;
+}
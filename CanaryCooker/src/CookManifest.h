@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Engine/Mesh/Mesh.h"
+
+// What the cooker remembers between runs, stored as a line based text file so it can be inspected and diffed.
+// Files caches content hashes so unchanged sources (same size and modification time) are not read again, Assets
+// holds the key every asset was last cooked with together with the dependency graph discovered while cooking it.
+class CookManifest
+{
+public:
+	static const uint32_t Version = 1;
+
+	struct FileRecord
+	{
+		uint64_t Hash = 0;
+		uint64_t Size = 0;
+		int64_t ModifiedTime = 0;
+	};
+
+	struct AssetRecord
+	{
+		std::string Kind;                          // "mesh" or "texture"
+		uint64_t Key = 0;                          // hash of every input, see AssetCooker
+		std::vector<std::string> Dependencies;     // files the importer read or missed (model, material libraries, ...)
+		std::vector<MaterialTextureRef> TextureRefs; // textures a model's materials use, relative to the model
+	};
+
+	// A missing manifest is not an error, everything is simply dirty. An unreadable or outdated one is discarded.
+	bool Load(const std::string& FilePath);
+
+	// Written to a temporary file first and renamed over the old manifest, an interrupted run keeps the old one
+	bool Save(const std::string& FilePath) const;
+
+	// Keyed by normalised path
+	std::unordered_map<std::string, FileRecord> Files;
+	std::unordered_map<std::string, AssetRecord> Assets;
+};
@@ -0,0 +1,177 @@
+// CanaryCooker converts source assets into the formats the engine loads at runtime without going
+// through the importers. Run it from the CanaryEngine directory so relative asset paths resolve the same
+// way they do in the engine.
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "AssetCooker.h"
+#include "ClaimTest.h"
+#include "Engine/Core/PakArchive.h"
+#include "Engine/Texture/VirtualTextureCooker.h"
+
+namespace
+{
+	const char* const DefaultManifestPath = "CanaryCooker.manifest";
+
+	// Lets build agents point every cooker at a shared cache without changing their command lines
+	const char* const CacheEnvironmentVariable = "CANARY_COOK_CACHE";
+
+	void PrintUsage()
+	{
+		std::cout << "Usage: CanaryCooker [options] [<directory|model|image|scene> ...]" << std::endl;
+		std::cout << "  Cooks every model, image and scene under the directories (resources by default) and any files given," << std::endl;
+		std::cout << "  skipping assets whose sources, dependencies and settings have not changed since the last run." << std::endl;
+		std::cout << "  Models are written to <model>.cmesh, images and the textures materials reference to <image>.ctex" << std::endl;
+		std::cout << "  Text scenes are written to <scene>.cscene for the engine to map in place" << std::endl;
+		std::cout << "  --float-vertices     store full precision vertices instead of the packed format" << std::endl;
+		std::cout << "  --bc7                compress colour textures as BC7 instead of BC1/BC3" << std::endl;
+		std::cout << "  --force              cook everything, even assets that are up to date" << std::endl;
+		std::cout << "  --no-atlas           do not pack small material textures into " << CookedAtlas::DefaultPath << std::endl;
+		std::cout << "  --virtual-textures   also cut diffuse textures of " << VirtualTextureCooker::MinSize << " texels or more into streamed pages (<image>.cvt)" << std::endl;
+		std::cout << "  --distance-field <n> voxels along the longest axis of the distance field of static models, 0 for none ("
+			<< DistanceFieldSettings().Resolution << ")" << std::endl;
+		std::cout << "  --manifest <file>    where hashes and dependencies are kept between runs (" << DefaultManifestPath << ")" << std::endl;
+		std::cout << "  --cache <directory>  share cooked files through a content addressed cache, e.g. on a network mount" << std::endl;
+		std::cout << "                       (defaults to $" << CacheEnvironmentVariable << ", no cache if unset)" << std::endl;
+		std::cout << "Usage: CanaryCooker --pak <output.pak> <directory> [<directory> ...]" << std::endl;
+		std::cout << "  Packs every file under the directories into one archive, paths stay relative to the" << std::endl;
+		std::cout << "  working directory (e.g. --pak Canary.pak resources shaders)" << std::endl;
+		std::cout << "Usage: CanaryCooker --claim-test <directory> [processes]" << std::endl;
+		std::cout << "  Checks that cooker processes sharing a cache in the directory (e.g. a network mount) never cook" << std::endl;
+		std::cout << "  the same asset at once, and that claims left by a process that died are taken over" << std::endl;
+	}
+
+	bool PackDirectories(const std::string& PakPath, const std::vector<std::string>& Directories)
+	{
+		namespace fs = std::filesystem;
+
+		// the archive may be written inside one of the directories being packed
+		std::error_code Ignored;
+		const fs::path PakFullPath = fs::weakly_canonical(PakPath, Ignored);
+
+		std::vector<PakArchive::SourceFile> Files;
+		for (const std::string& Directory : Directories)
+		{
+			std::error_code Error;
+			for (fs::recursive_directory_iterator It(Directory, Error), End; !Error && It != End; It.increment(Error))
+			{
+				if (!It->is_regular_file() || fs::weakly_canonical(It->path(), Ignored) == PakFullPath)
+				{
+					continue;
+				}
+
+				const std::string Path = It->path().generic_string();
+				Files.push_back({ Path, Path });
+			}
+
+			if (Error)
+			{
+				std::cout << "ERROR::COOKER::Could not walk " << Directory << ": " << Error.message() << std::endl;
+				return false;
+			}
+		}
+
+		if (!PakArchive::Write(PakPath, Files))
+		{
+			return false;
+		}
+
+		std::cout << "Packed " << Files.size() << " files into " << PakPath << std::endl;
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc >= 2 && std::string(argv[1]) == "--pak")
+	{
+		if (argc < 4)
+		{
+			PrintUsage();
+			return 1;
+		}
+		return PackDirectories(argv[2], std::vector<std::string>(argv + 3, argv + argc)) ? 0 : 1;
+	}
+	if (argc >= 3 && std::string(argv[1]) == "--claim-test")
+	{
+		return ClaimTest::Run(argv[0], argv[2], argc >= 4 ? std::max(std::atoi(argv[3]), 2) : 4);
+	}
+	if (argc >= 4 && std::string(argv[1]) == "--claim-worker")
+	{
+		return ClaimTest::RunWorker(argv[2], std::atoi(argv[3]));
+	}
+
+	CookSettings Settings;
+	if (const char* CacheDirectory = std::getenv(CacheEnvironmentVariable))
+	{
+		Settings.CacheDirectory = CacheDirectory;
+	}
+
+	std::string ManifestPath = DefaultManifestPath;
+	std::vector<std::string> Sources;
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string Argument = argv[i];
+		if (Argument == "--float-vertices")
+		{
+			Settings.VertexFormat = EVertexFormat::Float;
+		}
+		else if (Argument == "--bc7")
+		{
+			Settings.bHighQualityTextures = true;
+		}
+		else if (Argument == "--force")
+		{
+			Settings.bForce = true;
+		}
+		else if (Argument == "--no-atlas")
+		{
+			Settings.AtlasPath.clear();
+		}
+		else if (Argument == "--virtual-textures")
+		{
+			Settings.bVirtualTextures = true;
+		}
+		else if (Argument == "--distance-field" && i + 1 < argc)
+		{
+			Settings.DistanceField.Resolution = static_cast<unsigned int>(std::max(std::atoi(argv[++i]), 0));
+		}
+		else if (Argument == "--manifest" && i + 1 < argc)
+		{
+			ManifestPath = argv[++i];
+		}
+		else if (Argument == "--cache" && i + 1 < argc)
+		{
+			Settings.CacheDirectory = argv[++i];
+		}
+		else if (Argument == "--help" || Argument.compare(0, 2, "--") == 0)
+		{
+			PrintUsage();
+			return 1;
+		}
+		else
+		{
+			Sources.push_back(Argument);
+		}
+	}
+
+	if (Sources.empty())
+	{
+		Sources.push_back("resources");
+	}
+
+	AssetCooker Cooker(Settings, ManifestPath);
+	bool bSuccess = true;
+	for (const std::string& Source : Sources)
+	{
+		bSuccess &= std::filesystem::is_directory(Source) ? Cooker.AddDirectory(Source) : Cooker.AddFile(Source);
+	}
+
+	bSuccess &= Cooker.Cook();
+	return bSuccess ? 0 : 1;
+}
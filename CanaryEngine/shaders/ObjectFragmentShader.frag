@@ -10,6 +10,20 @@ uniform vec3 ViewPos;  // Position of the viewer/camera
 uniform sampler2D texture_diffuse1;
 uniform sampler2D texture_specular1;
 
+// Small textures packed into the material atlas (see TextureAtlas.h). A layer below 0 means the mesh has a texture
+// of its own in texture_diffuse1.
+uniform sampler2DArray texture_diffuse_atlas;
+uniform vec4 texture_diffuse_atlas_rect; // offset.xy, size.zw
+uniform float texture_diffuse_atlas_layer;
+
+// Virtual textures (see VirtualTextureSystem.h). Pages of every virtual texture share the vt_physical cache, the
+// indirection texture has a texel per page and level pointing at the finest resident page covering it. The z of the
+// info is 0 when the mesh's diffuse texture is not virtual.
+uniform sampler2D vt_physical;
+uniform vec4 vt_physical_info;         // page size, border, page size with border, cache size in texels
+uniform sampler2D texture_diffuse_vt_indirection;
+uniform vec4 texture_diffuse_vt_info;  // pages along level 0, level count, texture index + 1
+
 struct Light {
     vec3 LightPosition; // 12 bytes
     vec3 LightColor;    // 12 bytes
@@ -23,6 +37,53 @@ struct Light {
 uniform int numLights;
 uniform Light lights[100];
 
+vec4 SampleAtlas(sampler2DArray Atlas, vec4 Rect, float Layer, vec2 UV)
+{
+    // repeat inside the rect the way GL_REPEAT would, the gradients come from the unwrapped coordinates so the mip
+    // level does not jump where fract wraps around
+    vec2 AtlasUV = Rect.xy + fract(UV) * Rect.zw;
+    return textureGrad(Atlas, vec3(AtlasUV, Layer), dFdx(UV) * Rect.zw, dFdy(UV) * Rect.zw);
+}
+
+// Must match VirtualTextureFeedback.frag so the pages sampled are the pages requested
+float VirtualLevel(vec4 Info, vec2 UV)
+{
+    vec2 Texels = UV * Info.x * vt_physical_info.x;
+    float Footprint = max(length(dFdx(Texels)), length(dFdy(Texels)));
+    return clamp(floor(log2(max(Footprint, 1e-8))), 0.0, Info.y - 1.0);
+}
+
+vec4 SampleVirtual(sampler2D Indirection, vec4 Info, vec2 UV)
+{
+    int Level = int(VirtualLevel(Info, UV));
+    int Pages = max(1, int(Info.x) >> Level);
+    vec2 WrappedUV = fract(UV);
+    vec4 Entry = texelFetch(Indirection, min(ivec2(WrappedUV * float(Pages)), ivec2(Pages - 1)), Level) * 255.0;
+    if (Entry.a < 0.5)
+    {
+        return vec4(1.0);
+    }
+
+    // the entry may point at a coarser page than the level asked for, find the position inside that page
+    float ResidentPages = float(max(1, int(Info.x) >> int(Entry.b + 0.5)));
+    vec2 InPage = fract(WrappedUV * ResidentPages);
+    vec2 Texel = floor(Entry.rg + 0.5) * vt_physical_info.z + vt_physical_info.y + InPage * vt_physical_info.x;
+    return textureLod(vt_physical, Texel / vt_physical_info.w, 0.0);
+}
+
+vec4 SampleDiffuse(vec2 UV)
+{
+    if (texture_diffuse_vt_info.z > 0.0)
+    {
+        return SampleVirtual(texture_diffuse_vt_indirection, texture_diffuse_vt_info, UV);
+    }
+    if (texture_diffuse_atlas_layer >= 0.0)
+    {
+        return SampleAtlas(texture_diffuse_atlas, texture_diffuse_atlas_rect, texture_diffuse_atlas_layer, UV);
+    }
+    return texture(texture_diffuse1, UV);
+}
+
 vec3 calculateLight(Light light, vec3 normal, vec3 fragPos, vec3 viewDir)
 {
     vec3 ambient, diffuse, specular;
@@ -79,7 +140,7 @@ void main()
     }
 
     // Sample the texture color
-    vec4 textureColor = texture(texture_diffuse1, TexCoords);
+    vec4 textureColor = SampleDiffuse(TexCoords);
     if (numLights == 1)
     {
         FragColor = vec4(1.0, 1.0, 1.0, 1.0);
@@ -11,15 +11,38 @@ uniform mat4 ModelMatrix;
 uniform mat4 ViewMatrix;
 uniform mat4 ProjectionMatrix;
 
+// Packed vertices (see VertexFormat.h): aPos is the position normalised to [0, 1] inside the mesh bounds and
+// aNormal.xy holds an octahedral encoded normal. Half float texture coordinates need no decoding.
+uniform bool bPackedVertices;
+uniform vec3 PositionOffset;
+uniform vec3 PositionScale;
+
+vec3 DecodeOctahedral(vec2 Encoded)
+{
+    vec3 N = vec3(Encoded, 1.0 - abs(Encoded.x) - abs(Encoded.y));
+    float Fold = max(-N.z, 0.0);
+    N.x += N.x >= 0.0 ? -Fold : Fold;
+    N.y += N.y >= 0.0 ? -Fold : Fold;
+    return normalize(N);
+}
+
 void main()
 {
+    vec3 Position = aPos;
+    vec3 VertexNormal = aNormal;
+    if (bPackedVertices)
+    {
+        Position = PositionOffset + aPos * PositionScale;
+        VertexNormal = DecodeOctahedral(aNormal.xy);
+    }
+
     // Transform vertex position into world space
-    FragPos = vec3(ModelMatrix * vec4(aPos, 1.0));
+    FragPos = vec3(ModelMatrix * vec4(Position, 1.0));
 
     // Transform the normal to world space
-    Normal = mat3(transpose(inverse(ModelMatrix))) * aNormal;
+    Normal = mat3(transpose(inverse(ModelMatrix))) * VertexNormal;
 
     TexCoords = aTexCoords;
 
-    gl_Position = ProjectionMatrix * ViewMatrix * ModelMatrix * vec4(aPos, 1.0);
-}
\ No newline at end of file
+    gl_Position = ProjectionMatrix * ViewMatrix * ModelMatrix * vec4(Position, 1.0);
+}
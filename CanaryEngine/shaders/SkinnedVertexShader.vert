@@ -0,0 +1,112 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in uvec4 aBoneIndices;
+layout (location = 4) in vec4 aBoneWeights;
+
+// Skinned variant of ObjectVertexShader.vert, drawn with the same fragment shaders. Bone indices and weights come
+// from the mesh's skin stream (see VertexSkin in Mesh.h), meshes without one have no weights and are not skinned
+// (see Mesh::SetRigidSkinAttributes). Bone matrices are stored as the top three rows of the affine skinning matrix,
+// three RGBA32F texels per bone.
+
+out vec3 FragPos;  // Position in world space
+out vec3 Normal;   // Normal in world space
+out vec2 TexCoords;
+
+uniform mat4 ModelMatrix;
+uniform mat4 ViewMatrix;
+uniform mat4 ProjectionMatrix;
+
+// Packed vertices (see VertexFormat.h): aPos is the position normalised to [0, 1] inside the mesh bounds and
+// aNormal.xy holds an octahedral encoded normal. Half float texture coordinates need no decoding.
+uniform bool bPackedVertices;
+uniform vec3 PositionOffset;
+uniform vec3 PositionScale;
+
+// Palette mode (see SkinningPalette.h): the bones of every character posed this frame, this draw's start at
+// BonePaletteOffset. The transform is ModelMatrix.
+uniform samplerBuffer BonePalette;
+uniform int BonePaletteOffset;
+
+// Baked mode (see AnimatedCrowd.h): instanced crowds. InstanceData has four texels per instance, the top three rows
+// of its transform then the two frames of AnimationTexture around its time and the fraction between them.
+// AnimationTexture has one row per frame.
+uniform bool bBakedAnimation;
+uniform samplerBuffer InstanceData;
+uniform int InstanceOffset;
+uniform sampler2D AnimationTexture;
+
+vec3 DecodeOctahedral(vec2 Encoded)
+{
+    vec3 N = vec3(Encoded, 1.0 - abs(Encoded.x) - abs(Encoded.y));
+    float Fold = max(-N.z, 0.0);
+    N.x += N.x >= 0.0 ? -Fold : Fold;
+    N.y += N.y >= 0.0 ? -Fold : Fold;
+    return normalize(N);
+}
+
+mat4 RowsToMatrix(vec4 Row0, vec4 Row1, vec4 Row2)
+{
+    return transpose(mat4(Row0, Row1, Row2, vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
+void main()
+{
+    vec3 Position = aPos;
+    vec3 VertexNormal = aNormal;
+    if (bPackedVertices)
+    {
+        Position = PositionOffset + aPos * PositionScale;
+        VertexNormal = DecodeOctahedral(aNormal.xy);
+    }
+
+    // Weights sum to one, so blending the rows of the bone matrices blends the matrices
+    vec4 Row0 = vec4(0.0);
+    vec4 Row1 = vec4(0.0);
+    vec4 Row2 = vec4(0.0);
+    mat4 WorldMatrix = ModelMatrix;
+    if (bBakedAnimation)
+    {
+        int Instance = (InstanceOffset + gl_InstanceID) * 4;
+        WorldMatrix = RowsToMatrix(texelFetch(InstanceData, Instance), texelFetch(InstanceData, Instance + 1), texelFetch(InstanceData, Instance + 2));
+
+        vec4 Frames = texelFetch(InstanceData, Instance + 3);
+        int FirstFrame = int(Frames.x);
+        int SecondFrame = int(Frames.y);
+        for (int i = 0; i < 4; i++)
+        {
+            if (aBoneWeights[i] > 0.0)
+            {
+                int Column = int(aBoneIndices[i]) * 3;
+                Row0 += aBoneWeights[i] * mix(texelFetch(AnimationTexture, ivec2(Column, FirstFrame), 0), texelFetch(AnimationTexture, ivec2(Column, SecondFrame), 0), Frames.z);
+                Row1 += aBoneWeights[i] * mix(texelFetch(AnimationTexture, ivec2(Column + 1, FirstFrame), 0), texelFetch(AnimationTexture, ivec2(Column + 1, SecondFrame), 0), Frames.z);
+                Row2 += aBoneWeights[i] * mix(texelFetch(AnimationTexture, ivec2(Column + 2, FirstFrame), 0), texelFetch(AnimationTexture, ivec2(Column + 2, SecondFrame), 0), Frames.z);
+            }
+        }
+    }
+    else
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            if (aBoneWeights[i] > 0.0)
+            {
+                int Texel = (BonePaletteOffset + int(aBoneIndices[i])) * 3;
+                Row0 += aBoneWeights[i] * texelFetch(BonePalette, Texel);
+                Row1 += aBoneWeights[i] * texelFetch(BonePalette, Texel + 1);
+                Row2 += aBoneWeights[i] * texelFetch(BonePalette, Texel + 2);
+            }
+        }
+    }
+    mat4 SkinMatrix = dot(aBoneWeights, vec4(1.0)) > 0.0 ? RowsToMatrix(Row0, Row1, Row2) : mat4(1.0);
+
+    // Transform vertex position into world space
+    FragPos = vec3(WorldMatrix * SkinMatrix * vec4(Position, 1.0));
+
+    // Transform the normal to world space, bones are assumed to scale uniformly
+    Normal = mat3(transpose(inverse(WorldMatrix))) * (mat3(SkinMatrix) * VertexNormal);
+
+    TexCoords = aTexCoords;
+
+    gl_Position = ProjectionMatrix * ViewMatrix * vec4(FragPos, 1.0);
+}
@@ -0,0 +1,37 @@
+#version 330 core
+
+// Feedback pass of virtual texturing (see VirtualTextureSystem.h), drawn with ObjectVertexShader.vert at a fraction
+// of the screen resolution. Every pixel writes the page its diffuse texture wants: page x, page y, level and the
+// texture index + 1, or all zero when the surface is not virtual.
+out uvec4 FeedbackPage;
+
+in vec2 TexCoords;
+
+uniform vec4 vt_physical_info;         // page size, border, page size with border, cache size in texels
+uniform vec4 texture_diffuse_vt_info;  // pages along level 0, level count, texture index + 1
+
+// log2 of the resolution divisor, negative so the levels match the full resolution pass
+uniform float FeedbackLodBias;
+
+// Must match VirtualLevel in ObjectFragmentShader.frag
+float VirtualLevel(vec4 Info, vec2 UV)
+{
+    vec2 Texels = UV * Info.x * vt_physical_info.x;
+    float Footprint = max(length(dFdx(Texels)), length(dFdy(Texels)));
+    return clamp(floor(log2(max(Footprint, 1e-8)) + FeedbackLodBias), 0.0, Info.y - 1.0);
+}
+
+void main()
+{
+    vec4 Info = texture_diffuse_vt_info;
+    if (Info.z <= 0.0)
+    {
+        FeedbackPage = uvec4(0u);
+        return;
+    }
+
+    int Level = int(VirtualLevel(Info, TexCoords));
+    int Pages = max(1, int(Info.x) >> Level);
+    ivec2 Page = min(ivec2(fract(TexCoords) * float(Pages)), ivec2(Pages - 1));
+    FeedbackPage = uvec4(uvec2(Page), uint(Level), uint(Info.z + 0.5));
+}
@@ -0,0 +1,82 @@
+#include "AnimationBaker.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "PoseEvaluator.h"
+#include "Engine/Core/ThreadPool.h"
+
+int BakedAnimation::FindClip(const std::string& Name) const
+{
+	for (size_t Clip = 0; Clip < Clips.size(); Clip++)
+	{
+		if (Clips[Clip].Name == Name)
+		{
+			return static_cast<int>(Clip);
+		}
+	}
+	return -1;
+}
+
+void AnimationBaker::Bake(const AnimationSet& Animation, float FrameRate, BakedAnimation& OutBaked)
+{
+	const SkeletonData& Skeleton = Animation.Skeleton;
+
+	OutBaked.FrameRate = FrameRate;
+	OutBaked.BoneCount = static_cast<uint32_t>(Skeleton.GetBoneCount());
+	OutBaked.FrameCount = 0;
+	OutBaked.Clips.clear();
+
+	// frame -> clip, so the frames of all clips can be split into jobs evenly
+	std::vector<uint32_t> FrameClips;
+	for (const AnimationClip& Clip : Animation.Clips)
+	{
+		BakedClip Baked;
+		Baked.Name = Clip.Name;
+		Baked.Duration = Clip.Duration;
+		Baked.FirstFrame = OutBaked.FrameCount;
+		Baked.FrameCount = static_cast<uint32_t>(std::ceil(Clip.Duration * FrameRate)) + 1;
+		Baked.FrameCount = std::max<uint32_t>(Baked.FrameCount, 2);
+
+		FrameClips.insert(FrameClips.end(), Baked.FrameCount, static_cast<uint32_t>(OutBaked.Clips.size()));
+		OutBaked.FrameCount += Baked.FrameCount;
+		OutBaked.Clips.push_back(Baked);
+	}
+
+	const size_t RowTexels = size_t(OutBaked.BoneCount) * TexelsPerBone;
+	OutBaked.Texels.assign(RowTexels * OutBaked.FrameCount, glm::vec4(0.0f));
+
+	const size_t JobCount = (OutBaked.FrameCount + FramesPerJob - 1) / FramesPerJob;
+	ThreadPool::Get().ParallelFor(JobCount, [&](size_t Job)
+	{
+		std::vector<BoneTransform> Pose(Skeleton.GetBoneCount());
+		std::vector<glm::mat4> ModelSpace(Skeleton.GetBoneCount());
+		std::vector<glm::mat4> Skinning(Skeleton.GetBoneCount());
+
+		const uint32_t End = std::min<uint32_t>(OutBaked.FrameCount, static_cast<uint32_t>((Job + 1) * FramesPerJob));
+		for (uint32_t Frame = static_cast<uint32_t>(Job * FramesPerJob); Frame < End; Frame++)
+		{
+			const BakedClip& Baked = OutBaked.Clips[FrameClips[Frame]];
+			const float Time = Baked.Duration * float(Frame - Baked.FirstFrame) / float(Baked.FrameCount - 1);
+
+			PoseEvaluator::SampleClip(Skeleton, Animation.Clips[FrameClips[Frame]], Time, Pose.data());
+			PoseEvaluator::BuildSkinningMatrices(Skeleton, Pose.data(), ModelSpace.data(), Skinning.data());
+
+			glm::vec4* Row = OutBaked.Texels.data() + Frame * RowTexels;
+			for (uint32_t Bone = 0; Bone < OutBaked.BoneCount; Bone++)
+			{
+				StoreBoneRows(Skinning[Bone], Row + Bone * TexelsPerBone);
+			}
+		}
+	});
+}
+
+void AnimationBaker::FindFrames(const BakedClip& Clip, float Time, uint32_t& OutFirst, uint32_t& OutSecond, float& OutFraction)
+{
+	const float Position = Clip.Duration > 0.0f ? glm::clamp(Time / Clip.Duration, 0.0f, 1.0f) * float(Clip.FrameCount - 1) : 0.0f;
+	const uint32_t Frame = std::min(static_cast<uint32_t>(Position), Clip.FrameCount - 1);
+
+	OutFirst = Clip.FirstFrame + Frame;
+	OutSecond = Clip.FirstFrame + std::min(Frame + 1, Clip.FrameCount - 1);
+	OutFraction = Position - float(Frame);
+}
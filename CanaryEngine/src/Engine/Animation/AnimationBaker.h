@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "AnimationData.h"
+
+// Clips sampled at a fixed rate into skinning matrices, the data of an animation texture (see AnimatedCrowd.h).
+// Each frame is a row of BoneCount * TexelsPerBone texels, every clip a run of consecutive rows, so the GPU can pose
+// an instance from its clip, time and nothing else.
+struct BakedClip
+{
+	std::string Name;
+	float Duration = 0.0f;
+	uint32_t FirstFrame = 0;
+	uint32_t FrameCount = 0; // the first frame is at time 0 and the last at Duration
+};
+
+struct BakedAnimation
+{
+	float FrameRate = 0.0f;
+	uint32_t BoneCount = 0;
+	uint32_t FrameCount = 0; // of all clips
+
+	std::vector<BakedClip> Clips;
+	std::vector<glm::vec4> Texels;
+
+	// -1 if there is no clip of that name
+	int FindClip(const std::string& Name) const;
+
+	size_t GetMemoryBytes() const { return Texels.size() * sizeof(glm::vec4); }
+};
+
+namespace AnimationBaker
+{
+	const float DefaultFrameRate = 30.0f;
+
+	// Skinning matrices are affine, so a bone is stored as the top three rows of its matrix
+	const uint32_t TexelsPerBone = 3;
+
+	// Frames baked by one thread pool job
+	const uint32_t FramesPerJob = 8;
+
+	inline void StoreBoneRows(const glm::mat4& Matrix, glm::vec4* OutRows)
+	{
+		for (int Row = 0; Row < 3; Row++)
+		{
+			OutRows[Row] = glm::vec4(Matrix[0][Row], Matrix[1][Row], Matrix[2][Row], Matrix[3][Row]);
+		}
+	}
+
+	// Samples every clip of the set FrameRate times a second (at least twice per clip) on the thread pool
+	void Bake(const AnimationSet& Animation, float FrameRate, BakedAnimation& OutBaked);
+
+	// Frames either side of Time and how far it is from the first towards the second, Time is clamped to the clip
+	void FindFrames(const BakedClip& Clip, float Time, uint32_t& OutFirst, uint32_t& OutSecond, float& OutFraction);
+}
@@ -0,0 +1,436 @@
+#include "AnimationCompressor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "PoseEvaluator.h"
+#include "Engine/Core/ThreadPool.h"
+
+namespace
+{
+	enum class ChannelType
+	{
+		Translation,
+		Rotation,
+		Scale
+	};
+
+	// Error allowance of one bone, derived from the bind pose
+	struct BoneTolerance
+	{
+		float LeverArm = 0.0f;
+		float Budget = 0.0f;
+	};
+
+	uint16_t EncodeFraction(float Value, float Min, float Extent)
+	{
+		if (Extent <= 0.0f)
+		{
+			return 0;
+		}
+		const float Fraction = glm::clamp((Value - Min) / Extent, 0.0f, 1.0f);
+		return static_cast<uint16_t>(Fraction * 65535.0f + 0.5f);
+	}
+
+	CompressedKey EncodeVector(const glm::vec4& Value, const glm::vec3& Min, const glm::vec3& Extent)
+	{
+		CompressedKey Key;
+		Key.Time = 0;
+		for (int Component = 0; Component < 3; Component++)
+		{
+			Key.Value[Component] = EncodeFraction(Value[Component], Min[Component], Extent[Component]);
+		}
+		return Key;
+	}
+
+	// Rotation is x, y, z, w. See CompressedKey for the layout.
+	CompressedKey EncodeRotation(const glm::vec4& Rotation)
+	{
+		const glm::vec4 Normalised = glm::normalize(Rotation);
+
+		unsigned int Largest = 0;
+		for (unsigned int Component = 1; Component < 4; Component++)
+		{
+			if (std::abs(Normalised[Component]) > std::abs(Normalised[Largest]))
+			{
+				Largest = Component;
+			}
+		}
+
+		// q and -q are the same rotation, flipping makes the implied component positive
+		const float Sign = Normalised[Largest] < 0.0f ? -1.0f : 1.0f;
+		uint64_t Bits = uint64_t(Largest) << 46;
+		for (unsigned int Component = 0, Stored = 0; Component < 4; Component++)
+		{
+			if (Component == Largest)
+			{
+				continue;
+			}
+			const float Fraction = glm::clamp((Normalised[Component] * Sign + 0.70710678f) / 1.41421356f, 0.0f, 1.0f);
+			Bits |= uint64_t(Fraction * 32767.0f + 0.5f) << (15 * Stored);
+			Stored++;
+		}
+
+		CompressedKey Key;
+		Key.Time = 0;
+		Key.Value[0] = static_cast<uint16_t>(Bits);
+		Key.Value[1] = static_cast<uint16_t>(Bits >> 16);
+		Key.Value[2] = static_cast<uint16_t>(Bits >> 32);
+		return Key;
+	}
+
+	// Distance a point LeverArm away from the bone moves between the two values
+	float MeasureError(ChannelType Type, const glm::vec4& A, const glm::vec4& B, float LeverArm)
+	{
+		if (Type == ChannelType::Translation)
+		{
+			return glm::length(glm::vec3(A) - glm::vec3(B));
+		}
+		if (Type == ChannelType::Scale)
+		{
+			return glm::length(glm::vec3(A) - glm::vec3(B)) * LeverArm;
+		}
+
+		// the chord between unit quaternions is 2 sin(angle / 4), which unlike acos of their dot product keeps its
+		// precision for the tiny angles compared here
+		const float Chord = std::min(glm::length(A - B), glm::length(A + B));
+		const float Angle = 4.0f * std::asin(std::min(Chord * 0.5f, 1.0f));
+		return Angle * LeverArm;
+	}
+
+	glm::vec4 GetBindValue(ChannelType Type, const BoneTransform& Bind)
+	{
+		switch (Type)
+		{
+		case ChannelType::Translation:
+			return Bind.Translation;
+		case ChannelType::Rotation:
+			return glm::vec4(Bind.Rotation.x, Bind.Rotation.y, Bind.Rotation.z, Bind.Rotation.w);
+		default:
+			return Bind.Scale;
+		}
+	}
+
+	// Decoded value of a channel at KeyTime, exactly as PoseEvaluator will sample it
+	glm::vec4 SampleKeys(ChannelType Type, const std::vector<CompressedKey>& Keys, float KeyTime, const glm::vec3& Min, const glm::vec3& Extent)
+	{
+		glm::vec4 Value;
+		if (Type == ChannelType::Rotation)
+		{
+			glm::quat Rotation;
+			PoseEvaluator::SampleRotationKeys(Keys.data(), static_cast<uint32_t>(Keys.size()), KeyTime, Rotation);
+			Value = glm::vec4(Rotation.x, Rotation.y, Rotation.z, Rotation.w);
+		}
+		else
+		{
+			PoseEvaluator::SampleVectorKeys(Keys.data(), static_cast<uint32_t>(Keys.size()), KeyTime, Min, Extent, Value);
+		}
+		return Value;
+	}
+
+	// Quantises and reduces one channel, appending the keys it keeps to OutClip and returning their range. The
+	// range is empty when the channel can be left to the bind pose.
+	AnimationKeyRange CompressChannel(ChannelType Type, const AnimationClipData& Clip, const AnimationKeyRange& Range,
+		const BoneTransform& Bind, float LeverArm, float Budget, AnimationClip& OutClip)
+	{
+		AnimationKeyRange Result;
+		Result.First = static_cast<uint32_t>(OutClip.Keys.size());
+		if (Range.Count == 0)
+		{
+			return Result;
+		}
+
+		const glm::vec4* Raw = Clip.Values.data() + Range.First;
+		const float* RawTimes = Clip.Times.data() + Range.First;
+		const size_t Count = Range.Count;
+
+		const glm::vec4 BindValue = GetBindValue(Type, Bind);
+		bool bIsBindPose = true;
+		for (size_t Key = 0; Key < Count && bIsBindPose; Key++)
+		{
+			bIsBindPose = MeasureError(Type, Raw[Key], BindValue, LeverArm) <= Budget;
+		}
+		if (bIsBindPose)
+		{
+			return Result;
+		}
+
+		// quantise everything up front, the reduction measures the decoded values so it accounts for the rounding
+		const glm::vec3 Min = Type == ChannelType::Scale ? OutClip.ScaleMin : OutClip.TranslationMin;
+		const glm::vec3 Extent = Type == ChannelType::Scale ? OutClip.ScaleExtent : OutClip.TranslationExtent;
+		std::vector<CompressedKey> Quantised(Count);
+		std::vector<float> KeyTimes(Count);
+		for (size_t Key = 0; Key < Count; Key++)
+		{
+			Quantised[Key] = Type == ChannelType::Rotation ? EncodeRotation(Raw[Key]) : EncodeVector(Raw[Key], Min, Extent);
+			KeyTimes[Key] = CompressedKeys::GetKeyTime(RawTimes[Key], Clip.Duration);
+			Quantised[Key].Time = static_cast<uint16_t>(KeyTimes[Key] + 0.5f);
+		}
+
+		std::vector<CompressedKey> Keys(1, Quantised[0]);
+		bool bIsConstant = true;
+		for (size_t Key = 1; Key < Count && bIsConstant; Key++)
+		{
+			bIsConstant = MeasureError(Type, Raw[Key], SampleKeys(Type, Keys, KeyTimes[Key], Min, Extent), LeverArm) <= Budget;
+		}
+
+		if (!bIsConstant)
+		{
+			// keys rounded onto the time of an earlier key could never be sampled
+			std::vector<size_t> Kept(1, 0);
+			for (size_t Key = 1; Key < Count; Key++)
+			{
+				if (Quantised[Key].Time > Quantised[Kept.back()].Time)
+				{
+					Kept.push_back(Key);
+				}
+			}
+
+			// remove keys for as long as every imported key around them stays within budget. A spline segment
+			// depends on the keys either side of it, so removing a key changes the two segments on each side and
+			// only the seven keys around it are needed to sample them.
+			std::vector<CompressedKey> Window;
+			for (bool bRemoved = true; bRemoved;)
+			{
+				bRemoved = false;
+				for (size_t Position = 1; Position + 1 < Kept.size();)
+				{
+					const size_t WindowBegin = Position >= 3 ? Position - 3 : 0;
+					const size_t WindowEnd = std::min(Position + 4, Kept.size());
+					Window.clear();
+					for (size_t Index = WindowBegin; Index < WindowEnd; Index++)
+					{
+						if (Index != Position)
+						{
+							Window.push_back(Quantised[Kept[Index]]);
+						}
+					}
+
+					bool bFits = true;
+					const size_t Last = Kept[std::min(Position + 2, Kept.size() - 1)];
+					for (size_t Key = Kept[Position >= 2 ? Position - 2 : 0] + 1; Key < Last && bFits; Key++)
+					{
+						bFits = MeasureError(Type, Raw[Key], SampleKeys(Type, Window, KeyTimes[Key], Min, Extent), LeverArm) <= Budget;
+					}
+
+					if (bFits)
+					{
+						Kept.erase(Kept.begin() + Position);
+						bRemoved = true;
+					}
+					else
+					{
+						Position++;
+					}
+				}
+			}
+
+			Keys.clear();
+			for (size_t Key : Kept)
+			{
+				Keys.push_back(Quantised[Key]);
+			}
+		}
+
+		OutClip.Keys.insert(OutClip.Keys.end(), Keys.begin(), Keys.end());
+		Result.Count = static_cast<uint32_t>(Keys.size());
+		return Result;
+	}
+
+	// Bounding range of every translation or scale key of the clip
+	void ComputeRange(const AnimationClipData& Clip, AnimationKeyRange AnimationTrackData::*Channel, glm::vec3& OutMin, glm::vec3& OutExtent)
+	{
+		bool bIsEmpty = true;
+		glm::vec3 Max(0.0f);
+		OutMin = glm::vec3(0.0f);
+		for (const AnimationTrackData& Track : Clip.Tracks)
+		{
+			const AnimationKeyRange& Range = Track.*Channel;
+			for (uint32_t Key = Range.First; Key < Range.First + Range.Count; Key++)
+			{
+				const glm::vec3 Value(Clip.Values[Key]);
+				OutMin = bIsEmpty ? Value : glm::min(OutMin, Value);
+				Max = bIsEmpty ? Value : glm::max(Max, Value);
+				bIsEmpty = false;
+			}
+		}
+		OutExtent = Max - OutMin;
+	}
+
+	void CompressClip(const SkeletonData& Skeleton, const AnimationClipData& Raw, const std::vector<BoneTolerance>& Tolerances, float BudgetScale, AnimationClip& OutClip)
+	{
+		OutClip = AnimationClip();
+		OutClip.Name = Raw.Name;
+		OutClip.Duration = Raw.Duration;
+		ComputeRange(Raw, &AnimationTrackData::Translation, OutClip.TranslationMin, OutClip.TranslationExtent);
+		ComputeRange(Raw, &AnimationTrackData::Scale, OutClip.ScaleMin, OutClip.ScaleExtent);
+
+		for (const AnimationTrackData& RawTrack : Raw.Tracks)
+		{
+			const BoneTransform& Bind = Skeleton.BindPose[RawTrack.Bone];
+			const BoneTolerance& Tolerance = Tolerances[RawTrack.Bone];
+
+			// the channels of a bone share its budget
+			const int ChannelCount = int(RawTrack.Translation.Count > 0) + int(RawTrack.Rotation.Count > 0) + int(RawTrack.Scale.Count > 0);
+			const float Budget = Tolerance.Budget * BudgetScale / float(std::max(ChannelCount, 1));
+
+			AnimationTrack Track;
+			Track.Bone = RawTrack.Bone;
+			Track.Translation = CompressChannel(ChannelType::Translation, Raw, RawTrack.Translation, Bind, Tolerance.LeverArm, Budget, OutClip);
+			Track.Rotation = CompressChannel(ChannelType::Rotation, Raw, RawTrack.Rotation, Bind, Tolerance.LeverArm, Budget, OutClip);
+			Track.Scale = CompressChannel(ChannelType::Scale, Raw, RawTrack.Scale, Bind, Tolerance.LeverArm, Budget, OutClip);
+
+			if (Track.Translation.Count > 0 || Track.Rotation.Count > 0 || Track.Scale.Count > 0)
+			{
+				OutClip.Tracks.push_back(Track);
+			}
+		}
+		OutClip.Keys.shrink_to_fit();
+	}
+
+	void ComputeTolerances(const SkeletonData& Skeleton, const AnimationCompressionSettings& Settings,
+		std::vector<BoneTolerance>& OutTolerances, std::vector<bool>& OutIsLeaf, float& OutAbsoluteTolerance)
+	{
+		const size_t BoneCount = Skeleton.GetBoneCount();
+		std::vector<glm::mat4> ModelSpace(BoneCount);
+		std::vector<glm::mat4> Skinning(BoneCount);
+		PoseEvaluator::BuildSkinningMatrices(Skeleton, Skeleton.BindPose.data(), ModelSpace.data(), Skinning.data());
+
+		glm::vec3 Min(ModelSpace[0][3]);
+		glm::vec3 Max = Min;
+		for (const glm::mat4& Bone : ModelSpace)
+		{
+			Min = glm::min(Min, glm::vec3(Bone[3]));
+			Max = glm::max(Max, glm::vec3(Bone[3]));
+		}
+		const float Diagonal = glm::length(Max - Min);
+		const float Size = Diagonal > 0.0f ? Diagonal : 1.0f;
+		OutAbsoluteTolerance = Settings.Tolerance * Size;
+
+		// lever arm of a bone is the distance to its furthest descendant
+		OutTolerances.assign(BoneCount, BoneTolerance());
+		OutIsLeaf.assign(BoneCount, true);
+		for (size_t Bone = 0; Bone < BoneCount; Bone++)
+		{
+			OutTolerances[Bone].LeverArm = Settings.MinLeverArm * Size;
+			OutTolerances[Bone].Budget = OutAbsoluteTolerance;
+			if (Skeleton.Parents[Bone] >= 0)
+			{
+				OutIsLeaf[Skeleton.Parents[Bone]] = false;
+			}
+			for (int32_t Ancestor = Skeleton.Parents[Bone]; Ancestor >= 0; Ancestor = Skeleton.Parents[Ancestor])
+			{
+				const float Distance = glm::length(glm::vec3(ModelSpace[Bone][3]) - glm::vec3(ModelSpace[Ancestor][3]));
+				OutTolerances[Ancestor].LeverArm = std::max(OutTolerances[Ancestor].LeverArm, Distance);
+			}
+		}
+	}
+
+	// Largest distance between the bone positions of the two clips at the times of the imported keys, between them
+	// the spline is a closer fit to the motion than the imported keys' straight lines. Leaf bones also compare points
+	// a lever arm along each of their axes so their own rotation counts.
+	float MeasureClipError(const SkeletonData& Skeleton, const AnimationClipData& Raw, const AnimationClip& Compressed,
+		const std::vector<BoneTolerance>& Tolerances, const std::vector<bool>& IsLeaf)
+	{
+		const size_t BoneCount = Skeleton.GetBoneCount();
+		std::vector<BoneTransform> RawPose(BoneCount), CompressedPose(BoneCount);
+		std::vector<glm::mat4> RawModel(BoneCount), CompressedModel(BoneCount), Skinning(BoneCount);
+
+		std::vector<float> Times = Raw.Times;
+		std::sort(Times.begin(), Times.end());
+		Times.erase(std::unique(Times.begin(), Times.end()), Times.end());
+
+		float MaxError = 0.0f;
+		for (float Time : Times)
+		{
+			PoseEvaluator::SampleClip(Skeleton, Raw, Time, RawPose.data());
+			PoseEvaluator::SampleClip(Skeleton, Compressed, Time, CompressedPose.data());
+			PoseEvaluator::BuildSkinningMatrices(Skeleton, RawPose.data(), RawModel.data(), Skinning.data());
+			PoseEvaluator::BuildSkinningMatrices(Skeleton, CompressedPose.data(), CompressedModel.data(), Skinning.data());
+
+			for (size_t Bone = 0; Bone < BoneCount; Bone++)
+			{
+				MaxError = std::max(MaxError, glm::length(glm::vec3(RawModel[Bone][3]) - glm::vec3(CompressedModel[Bone][3])));
+				if (!IsLeaf[Bone])
+				{
+					continue;
+				}
+				for (int Axis = 0; Axis < 3; Axis++)
+				{
+					glm::vec4 Point(0.0f, 0.0f, 0.0f, 1.0f);
+					Point[Axis] = Tolerances[Bone].LeverArm;
+					MaxError = std::max(MaxError, glm::length(glm::vec3(RawModel[Bone] * Point) - glm::vec3(CompressedModel[Bone] * Point)));
+				}
+			}
+		}
+		return MaxError;
+	}
+}
+
+AnimationCompressionStats AnimationCompressor::Compress(const AnimationSetData& Data, AnimationSet& OutAnimation, const AnimationCompressionSettings& Settings)
+{
+	AnimationCompressionStats Stats;
+	OutAnimation = AnimationSet();
+	if (Data.IsEmpty())
+	{
+		return Stats;
+	}
+
+	OutAnimation.Skeleton = Data.Skeleton;
+	OutAnimation.Clips.resize(Data.Clips.size());
+
+	std::vector<BoneTolerance> Tolerances;
+	std::vector<bool> IsLeaf;
+	ComputeTolerances(Data.Skeleton, Settings, Tolerances, IsLeaf, Stats.Tolerance);
+
+	// every bone is given the whole tolerance, errors along a chain rarely line up so this is usually within it
+	// already. Clips that end up over the tolerance are compressed again with tighter budgets.
+	std::vector<float> ClipErrors(Data.Clips.size(), 0.0f);
+	ThreadPool::Get().ParallelFor(Data.Clips.size(), [&](size_t ClipIndex)
+	{
+		const AnimationClipData& Raw = Data.Clips[ClipIndex];
+		AnimationClip& Clip = OutAnimation.Clips[ClipIndex];
+
+		// the last attempt has no budget, every key that moves at all is kept
+		float BudgetScale = 1.0f;
+		for (unsigned int Attempt = 0; Attempt <= MaxAttempts; Attempt++, BudgetScale *= 0.5f)
+		{
+			CompressClip(Data.Skeleton, Raw, Tolerances, Attempt < MaxAttempts ? BudgetScale : 0.0f, Clip);
+			ClipErrors[ClipIndex] = MeasureClipError(Data.Skeleton, Raw, Clip, Tolerances, IsLeaf);
+			if (ClipErrors[ClipIndex] <= Stats.Tolerance)
+			{
+				break;
+			}
+		}
+	});
+
+	Stats.Clips = Data.Clips.size();
+	for (size_t ClipIndex = 0; ClipIndex < Data.Clips.size(); ClipIndex++)
+	{
+		Stats.RawKeys += Data.Clips[ClipIndex].Times.size();
+		Stats.RawBytes += Data.Clips[ClipIndex].GetMemoryBytes();
+		Stats.CompressedKeys += OutAnimation.Clips[ClipIndex].Keys.size();
+		Stats.CompressedBytes += OutAnimation.Clips[ClipIndex].GetMemoryBytes();
+		Stats.MaxError = std::max(Stats.MaxError, ClipErrors[ClipIndex]);
+		Stats.ClipsOverTolerance += ClipErrors[ClipIndex] > Stats.Tolerance ? 1 : 0;
+	}
+	return Stats;
+}
+
+void AnimationCompressor::PrintStats(const std::string& Label, const AnimationCompressionStats& Stats)
+{
+	const float Ratio = Stats.CompressedBytes > 0 ? float(Stats.RawBytes) / float(Stats.CompressedBytes) : 0.0f;
+	const std::ios::fmtflags Flags = std::cout.flags();
+	const std::streamsize Precision = std::cout.precision(3);
+	std::cout << "Compressed " << Label << ": " << Stats.Clips << " clips, keys " << Stats.RawKeys << " -> " << Stats.CompressedKeys
+		<< ", " << Stats.RawBytes / 1024 << " KB -> " << Stats.CompressedBytes / 1024 << " KB (" << Ratio << "x)"
+		<< ", max error " << Stats.MaxError << " (tolerance " << Stats.Tolerance << ")";
+	if (Stats.ClipsOverTolerance > 0)
+	{
+		std::cout << ", " << Stats.ClipsOverTolerance << " clips over the tolerance";
+	}
+	std::cout << std::endl;
+	std::cout.flags(Flags);
+	std::cout.precision(Precision);
+}
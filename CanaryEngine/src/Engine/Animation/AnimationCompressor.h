@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "AnimationData.h"
+
+struct AnimationCompressionSettings
+{
+	// Largest position error allowed at the end of any bone chain, as a fraction of the skeleton's bind pose size
+	float Tolerance = 0.0005f;
+
+	// Shortest distance over which a bone's rotation and scale error is measured, as a fraction of the skeleton's
+	// size. Leaf bones have no children to measure against, so this stands in for the geometry they carry.
+	float MinLeverArm = 0.05f;
+};
+
+struct AnimationCompressionStats
+{
+	size_t Clips = 0;
+	size_t RawKeys = 0;
+	size_t CompressedKeys = 0;
+	size_t RawBytes = 0;
+	size_t CompressedBytes = 0;
+
+	// Absolute tolerance the clips were compressed to and the largest bone position error measured afterwards,
+	// both in model units
+	float Tolerance = 0.0f;
+	float MaxError = 0.0f;
+
+	// Clips still over the tolerance with every quantised key kept, the quantisation alone is too coarse for them
+	size_t ClipsOverTolerance = 0;
+};
+
+// Cook-time compression of imported clips into the runtime format of AnimationData.h. Each channel is
+//   1. dropped when it never leaves the bind pose, or collapsed to one key when it is constant
+//   2. quantised: rotations smallest three in 48 bits, translations and scales to 16 bits of the clip's range
+//   3. reduced by curve fitting: keys are removed for as long as the Catmull-Rom spline through the remaining keys
+//      stays within tolerance of every imported key
+// The tolerance is a distance at the end of the bone chains: rotation and scale errors are scaled by the distance
+// to the bone's furthest descendant. Every clip is then sampled in full and its bone positions compared with the
+// imported keys, clips over the tolerance are compressed again with tighter budgets. A clip that is still over after
+// MaxAttempts keeps every quantised key of every channel that moves, and is counted in ClipsOverTolerance if even that
+// is not enough.
+namespace AnimationCompressor
+{
+	// Times a clip is compressed, halving the budgets each time, before it falls back to keeping every key
+	const unsigned int MaxAttempts = 4;
+
+	// Compresses every clip on the thread pool, OutAnimation receives the skeleton and the compressed clips
+	AnimationCompressionStats Compress(const AnimationSetData& Data, AnimationSet& OutAnimation, const AnimationCompressionSettings& Settings = AnimationCompressionSettings());
+
+	// Prints the key counts, memory before and after and the measured error, leaves the stream's formatting as it was
+	void PrintStats(const std::string& Label, const AnimationCompressionStats& Stats);
+}
@@ -0,0 +1,45 @@
+#include "AnimationData.h"
+
+int SkeletonData::FindBone(const std::string& Name) const
+{
+	for (size_t Bone = 0; Bone < BoneNames.size(); Bone++)
+	{
+		if (BoneNames[Bone] == Name)
+		{
+			return static_cast<int>(Bone);
+		}
+	}
+	return -1;
+}
+
+size_t AnimationClipData::GetMemoryBytes() const
+{
+	return Tracks.size() * sizeof(AnimationTrackData) + Times.size() * sizeof(float) + Values.size() * sizeof(glm::vec4);
+}
+
+size_t AnimationClip::GetMemoryBytes() const
+{
+	return Tracks.size() * sizeof(AnimationTrack) + Keys.size() * sizeof(CompressedKey);
+}
+
+int AnimationSet::FindClip(const std::string& Name) const
+{
+	for (size_t Clip = 0; Clip < Clips.size(); Clip++)
+	{
+		if (Clips[Clip].Name == Name)
+		{
+			return static_cast<int>(Clip);
+		}
+	}
+	return -1;
+}
+
+size_t AnimationSet::GetMemoryBytes() const
+{
+	size_t Bytes = Skeleton.GetBoneCount() * (sizeof(int32_t) + sizeof(BoneTransform) + sizeof(glm::mat4));
+	for (const AnimationClip& Clip : Clips)
+	{
+		Bytes += Clip.GetMemoryBytes();
+	}
+	return Bytes;
+}
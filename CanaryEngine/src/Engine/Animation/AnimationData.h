@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Skeletal animation data of one model. AnimationImporter produces the skeleton and uncompressed clips
+// (AnimationSetData), AnimationCompressor turns the clips into the compressed runtime form (AnimationSet) that is
+// cooked into the model's .cmesh and sampled directly by the pose evaluator.
+// A skeleton is a flat bone array sorted so every parent comes before its children, which lets the pose evaluator
+// build model space matrices in a single forward pass. Clips store the keys of all their channels in flat arrays that
+// tracks index into, so a clip is a handful of allocations however many bones it animates.
+
+// Local transform of a bone relative to its parent. Translation and scale are padded to four floats so a whole
+// transform is three SIMD loads (see SimdMath.h), their w is unused.
+struct BoneTransform
+{
+	glm::quat Rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	glm::vec4 Translation = glm::vec4(0.0f);
+	glm::vec4 Scale = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+};
+
+struct SkeletonData
+{
+	// Vertex bone indices are 8 bit (see VertexSkin in Mesh.h)
+	static const size_t MaxBones = 256;
+
+	std::vector<std::string> BoneNames;
+	std::vector<int32_t> Parents;                 // -1 for the root, always smaller than the bone's own index
+	std::vector<BoneTransform> BindPose;          // local rest pose, used for bones a clip does not animate
+	std::vector<glm::mat4> InverseBindMatrices;   // mesh space to bone space, identity for bones no vertex uses
+
+	size_t GetBoneCount() const { return Parents.size(); }
+
+	// -1 if there is no bone of that name
+	int FindBone(const std::string& Name) const;
+};
+
+// Keys of one channel: a range of the clip's key arrays, sorted by time
+struct AnimationKeyRange
+{
+	uint32_t First = 0;
+	uint32_t Count = 0;
+};
+
+// Animated channels of one bone as imported. A channel without keys keeps the bind pose value.
+struct AnimationTrackData
+{
+	uint32_t Bone = 0;
+	AnimationKeyRange Translation;
+	AnimationKeyRange Rotation; // values are quaternions stored as x, y, z, w
+	AnimationKeyRange Scale;
+};
+
+struct AnimationClipData
+{
+	std::string Name;
+	float Duration = 0.0f; // seconds
+
+	std::vector<AnimationTrackData> Tracks; // sorted by bone
+	std::vector<float> Times;               // seconds
+	std::vector<glm::vec4> Values;
+
+	size_t GetMemoryBytes() const;
+};
+
+struct AnimationSetData
+{
+	SkeletonData Skeleton;
+	std::vector<AnimationClipData> Clips;
+
+	bool IsEmpty() const { return Skeleton.GetBoneCount() == 0; }
+};
+
+// One key of a compressed channel, 16 bits of time followed by a 48 bit value. Rotations are stored smallest three:
+// the index of the largest component in the top two bits, the other three as 15 bit fractions of [-1/sqrt2, 1/sqrt2]
+// (the largest is implied by unit length and kept positive). Translations and scales are 16 bit fractions of the
+// clip's bounding range of all translations or scales.
+struct CompressedKey
+{
+	uint16_t Time; // fraction of the clip's duration, 0 to 65535
+	uint16_t Value[3];
+};
+
+// Channels of one bone in a compressed clip, key ranges index AnimationClip::Keys. A channel without keys keeps the
+// bind pose value, one key means the channel is constant.
+struct AnimationTrack
+{
+	uint32_t Bone = 0;
+	AnimationKeyRange Translation;
+	AnimationKeyRange Rotation;
+	AnimationKeyRange Scale;
+};
+
+// Compressed clip as written by AnimationCompressor. The keys left after key reduction are interpolated with a
+// Catmull-Rom spline, so a channel needs far fewer of them than the linearly interpolated imported keys.
+struct AnimationClip
+{
+	std::string Name;
+	float Duration = 0.0f; // seconds
+
+	// Tracks are sorted by bone and their keys follow each other in the same order (translation, rotation, scale),
+	// so sampling a pose walks forward through both arrays
+	std::vector<AnimationTrack> Tracks;
+	std::vector<CompressedKey> Keys;
+
+	// Quantisation ranges shared by all translation and scale keys
+	glm::vec3 TranslationMin = glm::vec3(0.0f);
+	glm::vec3 TranslationExtent = glm::vec3(0.0f);
+	glm::vec3 ScaleMin = glm::vec3(0.0f);
+	glm::vec3 ScaleExtent = glm::vec3(0.0f);
+
+	size_t GetMemoryBytes() const;
+};
+
+struct AnimationSet
+{
+	SkeletonData Skeleton;
+	std::vector<AnimationClip> Clips;
+
+	bool IsEmpty() const { return Skeleton.GetBoneCount() == 0; }
+
+	// -1 if there is no clip of that name
+	int FindClip(const std::string& Name) const;
+
+	size_t GetMemoryBytes() const;
+};
+
+namespace CompressedKeys
+{
+	const float MaxTime = 65535.0f;
+
+	// Time relative to the clip, in the units of CompressedKey::Time
+	inline float GetKeyTime(float Time, float Duration)
+	{
+		return Duration > 0.0f ? glm::clamp(Time / Duration, 0.0f, 1.0f) * MaxTime : 0.0f;
+	}
+
+	inline glm::vec4 DecodeVector(const CompressedKey& Key, const glm::vec3& Min, const glm::vec3& Extent)
+	{
+		const glm::vec3 Fraction = glm::vec3(Key.Value[0], Key.Value[1], Key.Value[2]) * (1.0f / 65535.0f);
+		return glm::vec4(Min + Extent * Fraction, 0.0f);
+	}
+
+	// Returns x, y, z, w
+	inline glm::vec4 DecodeRotation(const CompressedKey& Key)
+	{
+		const uint64_t Bits = uint64_t(Key.Value[0]) | (uint64_t(Key.Value[1]) << 16) | (uint64_t(Key.Value[2]) << 32);
+
+		const float Scale = 1.41421356f / 32767.0f;
+		const float A = float(Bits & 0x7FFF) * Scale - 0.70710678f;
+		const float B = float((Bits >> 15) & 0x7FFF) * Scale - 0.70710678f;
+		const float C = float((Bits >> 30) & 0x7FFF) * Scale - 0.70710678f;
+		const float Largest = std::sqrt(std::max(1.0f - A * A - B * B - C * C, 0.0f));
+
+		switch (Bits >> 46)
+		{
+		case 0:
+			return glm::vec4(Largest, A, B, C);
+		case 1:
+			return glm::vec4(A, Largest, B, C);
+		case 2:
+			return glm::vec4(A, B, Largest, C);
+		default:
+			return glm::vec4(A, B, C, Largest);
+		}
+	}
+}
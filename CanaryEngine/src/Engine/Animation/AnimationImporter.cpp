@@ -0,0 +1,230 @@
+#include "AnimationImporter.h"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <glm/gtc/type_ptr.hpp>
+
+namespace
+{
+	// aiMatrix4x4 is row major
+	glm::mat4 ToMat4(const aiMatrix4x4& Matrix)
+	{
+		return glm::transpose(glm::make_mat4(&Matrix.a1));
+	}
+
+	BoneTransform ToBoneTransform(const aiMatrix4x4& Matrix)
+	{
+		aiVector3D Scaling, Position;
+		aiQuaternion Rotation;
+		Matrix.Decompose(Scaling, Rotation, Position);
+
+		BoneTransform Transform;
+		Transform.Rotation = glm::normalize(glm::quat(Rotation.w, Rotation.x, Rotation.y, Rotation.z));
+		Transform.Translation = glm::vec4(Position.x, Position.y, Position.z, 0.0f);
+		Transform.Scale = glm::vec4(Scaling.x, Scaling.y, Scaling.z, 0.0f);
+		return Transform;
+	}
+
+	void MarkWithAncestors(const aiNode* Node, std::unordered_set<const aiNode*>& OutMarked)
+	{
+		for (; Node && OutMarked.insert(Node).second; Node = Node->mParent)
+		{
+		}
+	}
+
+	void AddBones(const aiNode* Node, int32_t Parent, const std::unordered_set<const aiNode*>& Marked,
+		const std::unordered_map<std::string, aiMatrix4x4>& Offsets, SkeletonData& OutSkeleton)
+	{
+		if (!Marked.count(Node))
+		{
+			return;
+		}
+
+		const int32_t Bone = static_cast<int32_t>(OutSkeleton.GetBoneCount());
+		const std::string Name = Node->mName.C_Str();
+		const auto Offset = Offsets.find(Name);
+
+		OutSkeleton.BoneNames.push_back(Name);
+		OutSkeleton.Parents.push_back(Parent);
+		OutSkeleton.BindPose.push_back(ToBoneTransform(Node->mTransformation));
+		OutSkeleton.InverseBindMatrices.push_back(Offset != Offsets.end() ? ToMat4(Offset->second) : glm::mat4(1.0f));
+
+		for (unsigned int i = 0; i < Node->mNumChildren; i++)
+		{
+			AddBones(Node->mChildren[i], Bone, Marked, Offsets, OutSkeleton);
+		}
+	}
+
+	// Appends the keys of one channel, assimp times are in ticks
+	template <typename KeyType, typename ConvertFunc>
+	AnimationKeyRange AddKeys(const KeyType* Keys, unsigned int KeyCount, double SecondsPerTick, AnimationClipData& OutClip, ConvertFunc Convert)
+	{
+		AnimationKeyRange Range;
+		Range.First = static_cast<uint32_t>(OutClip.Times.size());
+		Range.Count = KeyCount;
+		for (unsigned int i = 0; i < KeyCount; i++)
+		{
+			OutClip.Times.push_back(static_cast<float>(std::max(Keys[i].mTime, 0.0) * SecondsPerTick));
+			OutClip.Values.push_back(Convert(Keys[i].mValue));
+		}
+		return Range;
+	}
+}
+
+bool AnimationImporter::ImportSkeleton(const aiScene* Scene, SkeletonData& OutSkeleton)
+{
+	OutSkeleton = SkeletonData();
+
+	// mesh to bone space of every bone, a bone shared by several meshes has the same bind pose in all of them
+	std::unordered_map<std::string, aiMatrix4x4> Offsets;
+	std::unordered_set<const aiNode*> Marked;
+	for (unsigned int MeshIndex = 0; MeshIndex < Scene->mNumMeshes; MeshIndex++)
+	{
+		const aiMesh* InMesh = Scene->mMeshes[MeshIndex];
+		for (unsigned int BoneIndex = 0; BoneIndex < InMesh->mNumBones; BoneIndex++)
+		{
+			const aiBone* Bone = InMesh->mBones[BoneIndex];
+			Offsets.insert(std::make_pair(std::string(Bone->mName.C_Str()), Bone->mOffsetMatrix));
+			MarkWithAncestors(Scene->mRootNode->FindNode(Bone->mName), Marked);
+		}
+	}
+
+	if (Marked.empty())
+	{
+		return false;
+	}
+	if (Marked.size() > SkeletonData::MaxBones)
+	{
+		std::cout << "ERROR::ANIMATIONIMPORTER::Skeleton has " << Marked.size() << " bones, at most " << SkeletonData::MaxBones << " are supported" << std::endl;
+		return false;
+	}
+
+	// every ancestor of a bone is marked, so the root always is and the walk reaches every marked node
+	AddBones(Scene->mRootNode, -1, Marked, Offsets, OutSkeleton);
+	return true;
+}
+
+void AnimationImporter::ImportSkin(const aiMesh* InMesh, const SkeletonData& Skeleton, std::vector<VertexSkin>& OutSkin)
+{
+	struct Influence
+	{
+		uint32_t Bone = 0;
+		float Weight = 0.0f;
+	};
+
+	// strongest influences of every vertex, sorted by weight
+	std::vector<Influence> Influences(size_t(InMesh->mNumVertices) * MaxInfluences);
+	for (unsigned int BoneIndex = 0; BoneIndex < InMesh->mNumBones; BoneIndex++)
+	{
+		const aiBone* Bone = InMesh->mBones[BoneIndex];
+		const int SkeletonBone = Skeleton.FindBone(Bone->mName.C_Str());
+		if (SkeletonBone < 0)
+		{
+			continue;
+		}
+
+		for (unsigned int WeightIndex = 0; WeightIndex < Bone->mNumWeights; WeightIndex++)
+		{
+			const aiVertexWeight& Weight = Bone->mWeights[WeightIndex];
+			if (Weight.mVertexId >= InMesh->mNumVertices || Weight.mWeight <= 0.0f)
+			{
+				continue;
+			}
+
+			Influence* Slots = &Influences[size_t(Weight.mVertexId) * MaxInfluences];
+			if (Weight.mWeight <= Slots[MaxInfluences - 1].Weight)
+			{
+				continue;
+			}
+			unsigned int Slot = MaxInfluences - 1;
+			for (; Slot > 0 && Slots[Slot - 1].Weight < Weight.mWeight; Slot--)
+			{
+				Slots[Slot] = Slots[Slot - 1];
+			}
+			Slots[Slot].Bone = static_cast<uint32_t>(SkeletonBone);
+			Slots[Slot].Weight = Weight.mWeight;
+		}
+	}
+
+	OutSkin.resize(InMesh->mNumVertices);
+	for (size_t Vertex = 0; Vertex < OutSkin.size(); Vertex++)
+	{
+		const Influence* Slots = &Influences[Vertex * MaxInfluences];
+		VertexSkin& Skin = OutSkin[Vertex];
+
+		float Total = 0.0f;
+		for (unsigned int Slot = 0; Slot < MaxInfluences; Slot++)
+		{
+			Total += Slots[Slot].Weight;
+		}
+		if (Total <= 0.0f)
+		{
+			Skin = VertexSkin{ { 0, 0, 0, 0 }, { 255, 0, 0, 0 } };
+			continue;
+		}
+
+		// renormalise the dropped weight away and hand the rounding error to the strongest influence
+		int Remaining = 255;
+		for (unsigned int Slot = 0; Slot < MaxInfluences; Slot++)
+		{
+			const int Quantised = static_cast<int>(Slots[Slot].Weight / Total * 255.0f + 0.5f);
+			Skin.Bones[Slot] = static_cast<uint8_t>(Slots[Slot].Bone);
+			Skin.Weights[Slot] = static_cast<uint8_t>(Quantised);
+			Remaining -= Quantised;
+		}
+		Skin.Weights[0] = static_cast<uint8_t>(Skin.Weights[0] + Remaining);
+	}
+}
+
+void AnimationImporter::ImportClips(const aiScene* Scene, const SkeletonData& Skeleton, std::vector<AnimationClipData>& OutClips)
+{
+	for (unsigned int AnimationIndex = 0; AnimationIndex < Scene->mNumAnimations; AnimationIndex++)
+	{
+		const aiAnimation* Animation = Scene->mAnimations[AnimationIndex];
+
+		// files that do not say default to 25 ticks per second, like assimp's own viewer
+		const double TicksPerSecond = Animation->mTicksPerSecond > 0.0 ? Animation->mTicksPerSecond : 25.0;
+		const double SecondsPerTick = 1.0 / TicksPerSecond;
+
+		AnimationClipData Clip;
+		Clip.Name = Animation->mName.length > 0 ? Animation->mName.C_Str() : "Clip" + std::to_string(AnimationIndex);
+		Clip.Duration = static_cast<float>(std::max(Animation->mDuration, 0.0) * SecondsPerTick);
+
+		for (unsigned int ChannelIndex = 0; ChannelIndex < Animation->mNumChannels; ChannelIndex++)
+		{
+			const aiNodeAnim* Channel = Animation->mChannels[ChannelIndex];
+			const int Bone = Skeleton.FindBone(Channel->mNodeName.C_Str());
+			if (Bone < 0)
+			{
+				continue;
+			}
+
+			AnimationTrackData Track;
+			Track.Bone = static_cast<uint32_t>(Bone);
+			Track.Translation = AddKeys(Channel->mPositionKeys, Channel->mNumPositionKeys, SecondsPerTick, Clip, [](const aiVector3D& Value)
+			{
+				return glm::vec4(Value.x, Value.y, Value.z, 0.0f);
+			});
+			Track.Rotation = AddKeys(Channel->mRotationKeys, Channel->mNumRotationKeys, SecondsPerTick, Clip, [](const aiQuaternion& Value)
+			{
+				const glm::quat Rotation = glm::normalize(glm::quat(Value.w, Value.x, Value.y, Value.z));
+				return glm::vec4(Rotation.x, Rotation.y, Rotation.z, Rotation.w);
+			});
+			Track.Scale = AddKeys(Channel->mScalingKeys, Channel->mNumScalingKeys, SecondsPerTick, Clip, [](const aiVector3D& Value)
+			{
+				return glm::vec4(Value.x, Value.y, Value.z, 0.0f);
+			});
+			Clip.Tracks.push_back(Track);
+		}
+
+		std::sort(Clip.Tracks.begin(), Clip.Tracks.end(), [](const AnimationTrackData& A, const AnimationTrackData& B)
+		{
+			return A.Bone < B.Bone;
+		});
+		OutClips.push_back(std::move(Clip));
+	}
+}
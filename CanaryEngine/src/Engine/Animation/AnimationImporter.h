@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+
+#include <assimp/scene.h>
+
+#include "AnimationData.h"
+#include "Engine/Mesh/Mesh.h"
+
+// Converts assimp's bones (aiMesh::mBones) and animations (aiScene::mAnimations) into the runtime format of
+// AnimationData.h. Called by Model::ImportMeshData, so it runs in the engine and in the offline cooker alike.
+// Skinning matrices built from the result take vertices from mesh space to the space of the scene's root node.
+namespace AnimationImporter
+{
+	// Vertices keep their strongest influences up to the size of VertexSkin
+	const unsigned int MaxInfluences = 4;
+
+	// Bone nodes referenced by any mesh plus all of their ancestors, in depth first order. Returns false and leaves
+	// the skeleton empty when no mesh is skinned or there are more than SkeletonData::MaxBones bones.
+	bool ImportSkeleton(const aiScene* Scene, SkeletonData& OutSkeleton);
+
+	// One VertexSkin per vertex of a mesh with bones. Vertices no bone influences are bound rigidly to the root.
+	void ImportSkin(const aiMesh* InMesh, const SkeletonData& Skeleton, std::vector<VertexSkin>& OutSkin);
+
+	// Every animation of the scene, channels of nodes outside the skeleton are dropped
+	void ImportClips(const aiScene* Scene, const SkeletonData& Skeleton, std::vector<AnimationClipData>& OutClips);
+}
@@ -0,0 +1,272 @@
+#include "PoseEvaluator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Engine/Core/SimdMath.h"
+#include "Engine/Core/ThreadPool.h"
+
+namespace
+{
+	// Finds the keys around Time, OutFraction is how far Time is from the first towards the second
+	void FindKeys(const AnimationClipData& Clip, const AnimationKeyRange& Range, float Time, uint32_t& OutFirst, uint32_t& OutSecond, float& OutFraction)
+	{
+		const float* Times = Clip.Times.data() + Range.First;
+		const uint32_t Next = static_cast<uint32_t>(std::upper_bound(Times, Times + Range.Count, Time) - Times);
+
+		if (Next == 0 || Next == Range.Count)
+		{
+			OutFirst = OutSecond = Range.First + (Next == 0 ? 0 : Range.Count - 1);
+			OutFraction = 0.0f;
+			return;
+		}
+
+		OutFirst = Range.First + Next - 1;
+		OutSecond = Range.First + Next;
+		const float Span = Times[Next] - Times[Next - 1];
+		OutFraction = Span > 0.0f ? (Time - Times[Next - 1]) / Span : 0.0f;
+	}
+
+	// Catmull-Rom segment around KeyTime in four point form: OutKeys are the keys before, at the start of, at the end
+	// of and after the segment (repeated at the ends of the channel), OutWeights their weights. Returns false when
+	// KeyTime is outside the keys and OutKeys[1] alone is the value.
+	bool FindSegment(const CompressedKey* Keys, uint32_t Count, float KeyTime, const CompressedKey* OutKeys[4], glm::vec4& OutWeights)
+	{
+		const CompressedKey* Next = std::upper_bound(Keys, Keys + Count, KeyTime, [](float Time, const CompressedKey& Key)
+		{
+			return Time < float(Key.Time);
+		});
+		if (Next == Keys || Next == Keys + Count)
+		{
+			OutKeys[1] = Next == Keys ? Keys : Keys + Count - 1;
+			return false;
+		}
+
+		OutKeys[1] = Next - 1;
+		OutKeys[2] = Next;
+		OutKeys[0] = OutKeys[1] > Keys ? OutKeys[1] - 1 : OutKeys[1];
+		OutKeys[3] = OutKeys[2] < Keys + Count - 1 ? OutKeys[2] + 1 : OutKeys[2];
+
+		// Hermite basis with the tangents as central differences, folded into one weight per key
+		const float Span = float(OutKeys[2]->Time - OutKeys[1]->Time);
+		const float T = (KeyTime - float(OutKeys[1]->Time)) / Span;
+		const float T2 = T * T;
+		const float T3 = T2 * T;
+		const float StartWeight = 2.0f * T3 - 3.0f * T2 + 1.0f;
+		const float StartTangent = (T3 - 2.0f * T2 + T) * Span / float(OutKeys[2]->Time - OutKeys[0]->Time);
+		const float EndWeight = 3.0f * T2 - 2.0f * T3;
+		const float EndTangent = (T3 - T2) * Span / float(OutKeys[3]->Time - OutKeys[1]->Time);
+
+		OutWeights = glm::vec4(-StartTangent, StartWeight - EndTangent, EndWeight + StartTangent, EndTangent);
+		return true;
+	}
+
+	void SampleVector(const AnimationClipData& Clip, const AnimationKeyRange& Range, float Time, glm::vec4& Out)
+	{
+		uint32_t First, Second;
+		float Fraction;
+		FindKeys(Clip, Range, Time, First, Second, Fraction);
+		SimdMath::Lerp(Clip.Values[First], Clip.Values[Second], Fraction, Out);
+	}
+
+	void SampleRotation(const AnimationClipData& Clip, const AnimationKeyRange& Range, float Time, glm::quat& Out)
+	{
+		uint32_t First, Second;
+		float Fraction;
+		FindKeys(Clip, Range, Time, First, Second, Fraction);
+		SimdMath::Nlerp(&Clip.Values[First].x, &Clip.Values[Second].x, Fraction, &Out.x);
+	}
+
+	float AdvanceTime(float Time, float DeltaTime, float Duration, bool bLooping)
+	{
+		Time += DeltaTime;
+		if (Duration <= 0.0f)
+		{
+			return 0.0f;
+		}
+		if (!bLooping)
+		{
+			return std::min(std::max(Time, 0.0f), Duration);
+		}
+
+		Time = std::fmod(Time, Duration);
+		return Time < 0.0f ? Time + Duration : Time;
+	}
+
+	bool IsValidClip(const AnimationSet& Animation, int Clip)
+	{
+		return Clip >= 0 && static_cast<size_t>(Clip) < Animation.Clips.size();
+	}
+}
+
+void PoseEvaluator::SampleVectorKeys(const CompressedKey* Keys, uint32_t Count, float KeyTime, const glm::vec3& Min, const glm::vec3& Extent, glm::vec4& Out)
+{
+	const CompressedKey* Segment[4];
+	glm::vec4 Weights;
+	if (!FindSegment(Keys, Count, KeyTime, Segment, Weights))
+	{
+		Out = CompressedKeys::DecodeVector(*Segment[1], Min, Extent);
+		return;
+	}
+
+	SimdMath::WeightedSum(CompressedKeys::DecodeVector(*Segment[0], Min, Extent), CompressedKeys::DecodeVector(*Segment[1], Min, Extent),
+		CompressedKeys::DecodeVector(*Segment[2], Min, Extent), CompressedKeys::DecodeVector(*Segment[3], Min, Extent), Weights, Out);
+}
+
+void PoseEvaluator::SampleRotationKeys(const CompressedKey* Keys, uint32_t Count, float KeyTime, glm::quat& Out)
+{
+	const CompressedKey* Segment[4];
+	glm::vec4 Weights;
+	if (!FindSegment(Keys, Count, KeyTime, Segment, Weights))
+	{
+		const glm::vec4 Rotation = CompressedKeys::DecodeRotation(*Segment[1]);
+		Out = glm::quat(Rotation.w, Rotation.x, Rotation.y, Rotation.z);
+		return;
+	}
+
+	SimdMath::WeightedSumRotations(CompressedKeys::DecodeRotation(*Segment[0]), CompressedKeys::DecodeRotation(*Segment[1]),
+		CompressedKeys::DecodeRotation(*Segment[2]), CompressedKeys::DecodeRotation(*Segment[3]), Weights, Out);
+}
+
+void PoseEvaluator::SampleClip(const SkeletonData& Skeleton, const AnimationClip& Clip, float Time, BoneTransform* OutPose)
+{
+	std::copy(Skeleton.BindPose.begin(), Skeleton.BindPose.end(), OutPose);
+
+	const float KeyTime = CompressedKeys::GetKeyTime(Time, Clip.Duration);
+	const CompressedKey* Keys = Clip.Keys.data();
+	for (const AnimationTrack& Track : Clip.Tracks)
+	{
+		BoneTransform& Transform = OutPose[Track.Bone];
+		if (Track.Translation.Count > 0)
+		{
+			SampleVectorKeys(Keys + Track.Translation.First, Track.Translation.Count, KeyTime, Clip.TranslationMin, Clip.TranslationExtent, Transform.Translation);
+		}
+		if (Track.Rotation.Count > 0)
+		{
+			SampleRotationKeys(Keys + Track.Rotation.First, Track.Rotation.Count, KeyTime, Transform.Rotation);
+		}
+		if (Track.Scale.Count > 0)
+		{
+			SampleVectorKeys(Keys + Track.Scale.First, Track.Scale.Count, KeyTime, Clip.ScaleMin, Clip.ScaleExtent, Transform.Scale);
+		}
+	}
+}
+
+void PoseEvaluator::SampleClip(const SkeletonData& Skeleton, const AnimationClipData& Clip, float Time, BoneTransform* OutPose)
+{
+	std::copy(Skeleton.BindPose.begin(), Skeleton.BindPose.end(), OutPose);
+
+	Time = std::min(std::max(Time, 0.0f), Clip.Duration);
+	for (const AnimationTrackData& Track : Clip.Tracks)
+	{
+		BoneTransform& Transform = OutPose[Track.Bone];
+		if (Track.Translation.Count > 0)
+		{
+			SampleVector(Clip, Track.Translation, Time, Transform.Translation);
+		}
+		if (Track.Rotation.Count > 0)
+		{
+			SampleRotation(Clip, Track.Rotation, Time, Transform.Rotation);
+		}
+		if (Track.Scale.Count > 0)
+		{
+			SampleVector(Clip, Track.Scale, Time, Transform.Scale);
+		}
+	}
+}
+
+void PoseEvaluator::BlendPoses(const BoneTransform* A, const BoneTransform* B, float Weight, size_t BoneCount, BoneTransform* OutPose)
+{
+	for (size_t Bone = 0; Bone < BoneCount; Bone++)
+	{
+		SimdMath::Nlerp(A[Bone].Rotation, B[Bone].Rotation, Weight, OutPose[Bone].Rotation);
+		SimdMath::Lerp(A[Bone].Translation, B[Bone].Translation, Weight, OutPose[Bone].Translation);
+		SimdMath::Lerp(A[Bone].Scale, B[Bone].Scale, Weight, OutPose[Bone].Scale);
+	}
+}
+
+void PoseEvaluator::BuildSkinningMatrices(const SkeletonData& Skeleton, const BoneTransform* Pose, glm::mat4* OutModelSpace, glm::mat4* OutSkinning)
+{
+	// parents come first, so their model space transform is always ready
+	for (size_t Bone = 0; Bone < Skeleton.GetBoneCount(); Bone++)
+	{
+		glm::mat4& ModelSpace = OutModelSpace[Bone];
+		SimdMath::ComposeTransform(Pose[Bone].Rotation, Pose[Bone].Translation, Pose[Bone].Scale, ModelSpace);
+
+		const int32_t Parent = Skeleton.Parents[Bone];
+		if (Parent >= 0)
+		{
+			SimdMath::MultiplyMatrices(OutModelSpace[Parent], ModelSpace, ModelSpace);
+		}
+		SimdMath::MultiplyMatrices(ModelSpace, Skeleton.InverseBindMatrices[Bone], OutSkinning[Bone]);
+	}
+}
+
+void PoseEvaluator::Advance(AnimationInstance& Instance, float DeltaTime)
+{
+	if (!Instance.Animation)
+	{
+		return;
+	}
+
+	const float Step = DeltaTime * Instance.Speed;
+	if (IsValidClip(*Instance.Animation, Instance.Clip))
+	{
+		Instance.Time = AdvanceTime(Instance.Time, Step, Instance.Animation->Clips[Instance.Clip].Duration, Instance.bLooping);
+	}
+	if (IsValidClip(*Instance.Animation, Instance.BlendClip))
+	{
+		Instance.BlendTime = AdvanceTime(Instance.BlendTime, Step, Instance.Animation->Clips[Instance.BlendClip].Duration, Instance.bLooping);
+	}
+}
+
+void PoseEvaluator::Evaluate(AnimationInstance& Instance, PoseScratch& Scratch)
+{
+	if (!Instance.Animation || Instance.Animation->IsEmpty())
+	{
+		Instance.SkinningMatrices.clear();
+		return;
+	}
+
+	const AnimationSet& Animation = *Instance.Animation;
+	const SkeletonData& Skeleton = Animation.Skeleton;
+	const size_t BoneCount = Skeleton.GetBoneCount();
+
+	Scratch.Pose.resize(BoneCount);
+	Scratch.ModelSpace.resize(BoneCount);
+	Instance.SkinningMatrices.resize(BoneCount);
+
+	if (IsValidClip(Animation, Instance.Clip))
+	{
+		SampleClip(Skeleton, Animation.Clips[Instance.Clip], Instance.Time, Scratch.Pose.data());
+	}
+	else
+	{
+		std::copy(Skeleton.BindPose.begin(), Skeleton.BindPose.end(), Scratch.Pose.begin());
+	}
+
+	if (IsValidClip(Animation, Instance.BlendClip) && Instance.BlendWeight > 0.0f)
+	{
+		Scratch.BlendPose.resize(BoneCount);
+		SampleClip(Skeleton, Animation.Clips[Instance.BlendClip], Instance.BlendTime, Scratch.BlendPose.data());
+		BlendPoses(Scratch.Pose.data(), Scratch.BlendPose.data(), std::min(Instance.BlendWeight, 1.0f), BoneCount, Scratch.Pose.data());
+	}
+
+	BuildSkinningMatrices(Skeleton, Scratch.Pose.data(), Scratch.ModelSpace.data(), Instance.SkinningMatrices.data());
+}
+
+void PoseEvaluator::EvaluateInstances(std::vector<AnimationInstance>& Instances, float DeltaTime)
+{
+	const size_t JobCount = (Instances.size() + InstancesPerJob - 1) / InstancesPerJob;
+	ThreadPool::Get().ParallelFor(JobCount, [&](size_t Job)
+	{
+		// kept by each pool thread (and the calling one) across jobs and frames, it only grows to the largest skeleton
+		static thread_local PoseScratch Scratch;
+		const size_t End = std::min(Instances.size(), (Job + 1) * InstancesPerJob);
+		for (size_t Index = Job * InstancesPerJob; Index < End; Index++)
+		{
+			Advance(Instances[Index], DeltaTime);
+			Evaluate(Instances[Index], Scratch);
+		}
+	});
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "AnimationData.h"
+
+// Playback state of one animated character. EvaluateInstances advances and evaluates any number of them on the
+// thread pool, SkinningMatrices then holds one matrix per bone taking vertices from mesh space to the current pose.
+struct AnimationInstance
+{
+	const AnimationSet* Animation = nullptr;
+
+	int Clip = 0;
+	float Time = 0.0f;
+
+	// Clip cross-faded on top of Clip by BlendWeight (0 is only Clip, 1 only BlendClip), -1 for none
+	int BlendClip = -1;
+	float BlendTime = 0.0f;
+	float BlendWeight = 0.0f;
+
+	float Speed = 1.0f;
+	bool bLooping = true;
+
+	std::vector<glm::mat4> SkinningMatrices;
+};
+
+// Per-thread working memory of Evaluate, reused between instances so evaluation does not allocate
+struct PoseScratch
+{
+	std::vector<BoneTransform> Pose;
+	std::vector<BoneTransform> BlendPose;
+	std::vector<glm::mat4> ModelSpace;
+};
+
+// CPU pose evaluation: sample clips into local bone transforms, blend them, then concatenate down the hierarchy
+// into skinning matrices. The per-bone maths goes through SimdMath.h.
+namespace PoseEvaluator
+{
+	// Instances evaluated by one thread pool job
+	const size_t InstancesPerJob = 16;
+
+	// One compressed channel at KeyTime (see CompressedKeys::GetKeyTime), a Catmull-Rom spline through its keys.
+	// Before the first and after the last key the channel holds their value.
+	void SampleVectorKeys(const CompressedKey* Keys, uint32_t Count, float KeyTime, const glm::vec3& Min, const glm::vec3& Extent, glm::vec4& Out);
+	void SampleRotationKeys(const CompressedKey* Keys, uint32_t Count, float KeyTime, glm::quat& Out);
+
+	// Local transform of every bone at Time, clamped to the clip. Bones without a track keep their bind pose.
+	// Compressed keys are decoded as they are read, so clips stay compressed in memory.
+	void SampleClip(const SkeletonData& Skeleton, const AnimationClip& Clip, float Time, BoneTransform* OutPose);
+
+	// Same for an uncompressed clip, used by the compressor to measure its error
+	void SampleClip(const SkeletonData& Skeleton, const AnimationClipData& Clip, float Time, BoneTransform* OutPose);
+
+	// OutPose = A blended towards B by Weight, OutPose may be A or B
+	void BlendPoses(const BoneTransform* A, const BoneTransform* B, float Weight, size_t BoneCount, BoneTransform* OutPose);
+
+	// OutModelSpace receives the model space transform of every bone, OutSkinning the same times its inverse bind
+	void BuildSkinningMatrices(const SkeletonData& Skeleton, const BoneTransform* Pose, glm::mat4* OutModelSpace, glm::mat4* OutSkinning);
+
+	// Moves both clip times forward, wrapping looping clips and clamping the others
+	void Advance(AnimationInstance& Instance, float DeltaTime);
+
+	// Samples and blends the instance's clips and rebuilds its skinning matrices. An instance without a valid clip
+	// gets its bind pose.
+	void Evaluate(AnimationInstance& Instance, PoseScratch& Scratch);
+
+	// Advances and evaluates every instance, InstancesPerJob at a time on the thread pool
+	void EvaluateInstances(std::vector<AnimationInstance>& Instances, float DeltaTime);
+}
@@ -7,9 +7,20 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <cmath>
 #include <iostream>
 
+#include "Engine/Asset/AssetRegistry.h"
+#include "Engine/Core/VirtualFileSystem.h"
+#include "Engine/Renderer/GLStateCache.h"
+#include "Engine/Renderer/RenderStats.h"
+#include "Engine/Renderer/SkinningPalette.h"
+#include "Engine/Scene/Scene.h"
 #include "Engine/Shader/ShaderProgram.h"
+#include "Engine/Texture/TextureAtlas.h"
+#include "Engine/Texture/TextureResidency.h"
+#include "Engine/Texture/TextureStreamer.h"
+#include "Engine/Texture/VirtualTextureSystem.h"
 #include "Engine/UI/UIManager.h"
 #include "stb/stb_image.h"
 #include "Mesh/Model.h"
@@ -20,6 +31,14 @@ void mouse_callback(GLFWwindow* InWindow, double InXpos, double InYpos);
 
 void Application::Run()
 {
+    // shipping data comes from the pak, debug builds keep reading edited loose files over it
+    if (VirtualFileSystem::Get().MountPak("Canary.pak"))
+    {
+#ifndef _DEBUG
+        VirtualFileSystem::Get().SetLooseFileOverride(false);
+#endif
+    }
+
     // glfw: initialize and configure
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -54,13 +73,32 @@ void Application::Run()
     stbi_set_flip_vertically_on_load(true);
 
     // Configure global opengl state
-    glEnable(GL_DEPTH_TEST);
+    GLStateCache::Get().SetDepthTest(true);
 
     ShaderProgram EngineShaderManager("shaders/ObjectVertexShader.vert", "shaders/ObjectFragmentShader.frag");
 
-    // load models
-    // -----------
-    Model BackpackModel("resources/Objects/Backpack/backpack.obj");
+    // writes the virtual texture pages each pixel wants, see VirtualTextureSystem.h
+    ShaderProgram FeedbackShader("shaders/ObjectVertexShader.vert", "shaders/VirtualTextureFeedback.frag");
+    FeedbackShader.Use();
+    FeedbackShader.SetFloat("FeedbackLodBias", -std::log2(float(VirtualTextureSystem::FeedbackDivisor)));
+
+    // skinned meshes, posed on the CPU into the bone palette or from baked clips for crowds
+    ShaderProgram SkinnedShader("shaders/SkinnedVertexShader.vert", "shaders/ObjectFragmentShader.frag");
+    SkinningPalette::SetupShader(SkinnedShader);
+
+    // nothing reads mesh geometry back on the CPU at runtime, so models only keep it on the GPU
+    Mesh::SetRetainCpuGeometry(false);
+
+    // small material textures packed by the cooker, has to be loaded before the models that use them
+    TextureAtlas::Get().Load(TextureAtlas::DefaultPath);
+
+    // load the scene: models, object placements and lights
+    // ----------------------------------------------------
+    Scene World;
+    if (!World.Load(Scene::DefaultPath))
+    {
+        std::cout << "ERROR::APPLICATION::Could not load " << Scene::DefaultPath << std::endl;
+    }
 
     // User Interface
     UIManager UserInterface;
@@ -69,20 +107,11 @@ void Application::Run()
 
     unsigned int lights_index = glGetUniformBlockIndex(EngineShaderManager.ID, "LightBlock");
     glUniformBlockBinding(EngineShaderManager.ID, lights_index, 2);
+    glUniformBlockBinding(SkinnedShader.ID, glGetUniformBlockIndex(SkinnedShader.ID, "LightBlock"), 2);
 
     // Lighting
     LightManager LightingManager;
-
-    Light TestLight;
-    TestLight.LightPosition = glm::vec3(5.0f, 0.0f, 5.0f);
-    TestLight.LightColor = glm::vec3(1.0f, 1.0f, 1.0f);
-    TestLight.Intensity = 15.0f;
-    TestLight.LightType = 1;
-    TestLight.LightRadius = 50000.0f;
-    TestLight.LightDirection = glm::vec3(0.0f, 0.0f, 0.0f);
-    TestLight.LightCutOff = 100.0f;
-
-    LightingManager.AddLight(TestLight);
+    World.AddLights(LightingManager);
 
     // render loop
     // -----------
@@ -92,10 +121,26 @@ void Application::Run()
         DeltaTime = currentFrame - LastFrame;
         LastFrame = currentFrame;
 
+        RenderStats::BeginFrame();
+        SkinningPalette::Get().BeginFrame();
+
+        // retarget textures from what last frame drew, then finish textures decoded since last frame within the
+        // per-frame upload budget
+        TextureResidency::Get().Update();
+        TextureStreamer::Get().Update();
+        VirtualTextureSystem::Get().Update();
+
         // input
         // -----
         ProcessInput(Window);
 
+        // sectors around the camera stream in and out, their lights with them
+        if (World.Update(DeltaTime, Camera.GetPosition()))
+        {
+            LightingManager.ClearLights();
+            World.AddLights(LightingManager);
+        }
+
         // render
         // ------
         glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
@@ -115,30 +160,39 @@ void Application::Run()
         EngineShaderManager.SetMat4("ViewMatrix", view);
         EngineShaderManager.SetVec3("ViewPos", Camera.GetPosition());
 
-        // render the loaded model
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f)); // translate it down so it's at the center of the scene
-        model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));	// it's a bit too big for our scene, so scale it down
-        EngineShaderManager.SetMat4("ModelMatrix", model);
-        BackpackModel.Draw(EngineShaderManager);
-
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(5.0f, 0.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-        EngineShaderManager.SetMat4("ModelMatrix", model);
-        BackpackModel.Draw(EngineShaderManager);
-
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(10.0f, 0.0f, 0.0f)); 
-        model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));	
-        EngineShaderManager.SetMat4("ModelMatrix", model);
-        BackpackModel.Draw(EngineShaderManager);
-
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(15.0f, 0.0f, 0.0f)); 
-        model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));	
-        EngineShaderManager.SetMat4("ModelMatrix", model);
-        BackpackModel.Draw(EngineShaderManager);
+        const RenderView View(Camera.GetPosition(), projection * view, glm::radians(45.0f), 600.0f);
+
+        // the scene is drawn by the main pass and again by the virtual texture feedback pass
+        auto DrawScene = [&](ShaderProgram& Shader)
+        {
+            World.Draw(Shader, View);
+        };
+
+        DrawScene(EngineShaderManager);
+
+        // crowds and characters are only drawn by the main pass, their virtual textures get no feedback
+        if (World.HasSkinnedObjects())
+        {
+            SkinnedShader.Use();
+            LightingManager.UpdateLights(SkinnedShader);
+            SkinnedShader.SetMat4("ProjectionMatrix", projection);
+            SkinnedShader.SetMat4("ViewMatrix", view);
+            SkinnedShader.SetVec3("ViewPos", Camera.GetPosition());
+            World.DrawSkinned(SkinnedShader, View);
+        }
+
+        // low resolution pass whose result is read back a few frames later, skipped while every readback buffer is
+        // still in flight or nothing is virtual
+        if (VirtualTextureSystem::Get().BeginFeedback())
+        {
+            FeedbackShader.Use();
+            FeedbackShader.SetMat4("ProjectionMatrix", projection);
+            FeedbackShader.SetMat4("ViewMatrix", view);
+            const RenderStats MainPass = RenderStats::Get();
+            DrawScene(FeedbackShader);
+            RenderStats::EndFeedbackPass(MainPass);
+            VirtualTextureSystem::Get().EndFeedback();
+        }
 
         GLenum err;
         while ((err = glGetError()) != GL_NO_ERROR) {
@@ -153,7 +207,13 @@ void Application::Run()
         glfwPollEvents();
     }
 
+    World.Unload();
     UserInterface.Shutdown();
+    AssetRegistry::Get().Shutdown();
+    TextureStreamer::Get().Shutdown();
+    TextureAtlas::Get().Shutdown();
+    VirtualTextureSystem::Get().Shutdown();
+    SkinningPalette::Get().Shutdown();
 
     // terminate, clearing all previously allocated GLFW resources.
     glfwTerminate();
@@ -169,12 +229,12 @@ void Application::ProcessInput(GLFWwindow* InWindow)
     {
         if (bWireframeMode)
         {
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            GLStateCache::Get().SetPolygonMode(GL_FILL);
             bWireframeMode = false;
         }
         else
         {
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+            GLStateCache::Get().SetPolygonMode(GL_LINE);
             bWireframeMode = true;
         }
     }
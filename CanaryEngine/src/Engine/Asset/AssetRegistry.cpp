@@ -0,0 +1,337 @@
+#include "AssetRegistry.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "Engine/Animation/AnimationData.h"
+#include "Engine/Core/Hash.h"
+#include "Engine/Core/Paths.h"
+#include "Engine/Texture/TextureStreamer.h"
+
+template <typename T, typename Tag>
+AssetRegistry::Slot<T>* AssetRegistry::Pool<T, Tag>::Resolve(AssetHandle<Tag> Handle)
+{
+	if (Handle.Index >= Slots.size() || Slots[Handle.Index].Generation != Handle.Generation || Slots[Handle.Index].RefCount == 0)
+	{
+		return nullptr;
+	}
+	return &Slots[Handle.Index];
+}
+
+template <typename T, typename Tag>
+const AssetRegistry::Slot<T>* AssetRegistry::Pool<T, Tag>::Resolve(AssetHandle<Tag> Handle) const
+{
+	return const_cast<Pool*>(this)->Resolve(Handle);
+}
+
+template <typename T, typename Tag>
+AssetHandle<Tag> AssetRegistry::Pool<T, Tag>::Add(T&& Asset)
+{
+	uint32_t Index;
+	if (!FreeSlots.empty())
+	{
+		Index = FreeSlots.back();
+		FreeSlots.pop_back();
+	}
+	else
+	{
+		Index = static_cast<uint32_t>(Slots.size());
+		Slots.emplace_back();
+	}
+
+	Slot<T>& NewSlot = Slots[Index];
+	NewSlot.Asset = std::move(Asset);
+	NewSlot.RefCount = 1;
+
+	for (uint64_t PathHash : NewSlot.Asset.PathHashes)
+	{
+		ByPath[PathHash] = Index;
+	}
+	if (NewSlot.Asset.ContentKey != 0)
+	{
+		ByContent[NewSlot.Asset.ContentKey] = Index;
+	}
+
+	AssetHandle<Tag> Handle;
+	Handle.Index = Index;
+	Handle.Generation = NewSlot.Generation;
+	return Handle;
+}
+
+template <typename T, typename Tag>
+void AssetRegistry::Pool<T, Tag>::Remove(uint32_t Index)
+{
+	Slot<T>& OldSlot = Slots[Index];
+	for (uint64_t PathHash : OldSlot.Asset.PathHashes)
+	{
+		ByPath.erase(PathHash);
+	}
+	if (OldSlot.Asset.ContentKey != 0)
+	{
+		ByContent.erase(OldSlot.Asset.ContentKey);
+	}
+
+	OldSlot.Asset = T();
+	OldSlot.RefCount = 0;
+	OldSlot.Generation = OldSlot.Generation + 1 == 0 ? 1 : OldSlot.Generation + 1;
+	FreeSlots.push_back(Index);
+}
+
+template <typename T, typename Tag>
+AssetHandle<Tag> AssetRegistry::Pool<T, Tag>::Find(uint64_t PathHash, const std::string& FilePath, uint64_t KnownContentHash, uint64_t ContentScope, uint64_t& OutContentKey)
+{
+	AssetHandle<Tag> Handle;
+	OutContentKey = 0;
+
+	auto FoundPath = ByPath.find(PathHash);
+	if (FoundPath != ByPath.end())
+	{
+		Handle.Index = FoundPath->second;
+		Handle.Generation = Slots[Handle.Index].Generation;
+		return Handle;
+	}
+
+	// same bytes under another name, e.g. a texture copied next to every model that uses it. Hashing reads the
+	// whole file, so it happens once per path however often the asset is freed and loaded again.
+	uint64_t& ContentHash = ContentHashes[PathHash];
+	if (KnownContentHash != 0)
+	{
+		ContentHash = KnownContentHash;
+	}
+	else if (ContentHash == 0 && !Hash::File(FilePath, ContentHash))
+	{
+		ContentHashes.erase(PathHash);
+		return Handle;
+	}
+
+	OutContentKey = ContentScope != 0 ? Hash::Combine(ContentHash, ContentScope) : ContentHash;
+	auto FoundContent = ByContent.find(OutContentKey);
+	if (FoundContent != ByContent.end())
+	{
+		Handle.Index = FoundContent->second;
+		Handle.Generation = Slots[Handle.Index].Generation;
+		Slots[Handle.Index].Asset.PathHashes.push_back(PathHash);
+		ByPath[PathHash] = Handle.Index;
+	}
+	return Handle;
+}
+
+AssetRegistry& AssetRegistry::Get()
+{
+	static AssetRegistry Registry;
+	return Registry;
+}
+
+TextureHandle AssetRegistry::AcquireTexture(const std::string& FilePath, const std::string& TextureType, uint64_t InContentHash)
+{
+	const std::string Normalised = Paths::Normalise(FilePath);
+	const uint64_t PathHash = Hash::String(Normalised);
+
+	uint64_t ContentKey;
+	TextureHandle Handle = Textures.Find(PathHash, FilePath, InContentHash, 0, ContentKey);
+	if (Handle.IsValid())
+	{
+		Textures.Slots[Handle.Index].RefCount++;
+		return Handle;
+	}
+
+	TextureAsset Asset;
+	Asset.Path = Normalised;
+	Asset.PathHashes.push_back(PathHash);
+	Asset.ContentKey = ContentKey;
+	Asset.TextureID = TextureStreamer::Get().Request(FilePath, TextureType);
+	return Textures.Add(std::move(Asset));
+}
+
+void AssetRegistry::AddRef(TextureHandle Handle)
+{
+	if (Slot<TextureAsset>* Found = Textures.Resolve(Handle))
+	{
+		Found->RefCount++;
+	}
+}
+
+void AssetRegistry::Release(TextureHandle Handle)
+{
+	Slot<TextureAsset>* Found = Textures.Resolve(Handle);
+	if (bShutdown || !Found)
+	{
+		return;
+	}
+
+	if (--Found->RefCount == 0)
+	{
+		FreeTexture(Handle.Index);
+	}
+}
+
+unsigned int AssetRegistry::GetTextureID(TextureHandle Handle) const
+{
+	const Slot<TextureAsset>* Found = Textures.Resolve(Handle);
+	return Found ? Found->Asset.TextureID : 0;
+}
+
+MeshHandle AssetRegistry::AcquireMeshes(const std::string& FilePath, const MeshLoader& Loader, uint64_t InContentHash)
+{
+	const std::string Normalised = Paths::Normalise(FilePath);
+	const uint64_t PathHash = Hash::String(Normalised);
+
+	// texture paths are resolved against the model's directory, identical files elsewhere need their own meshes
+	const uint64_t DirectoryHash = Hash::String(Normalised.substr(0, Normalised.find_last_of('/') + 1));
+	uint64_t ContentKey;
+	MeshHandle Handle = MeshPool.Find(PathHash, FilePath, InContentHash, DirectoryHash, ContentKey);
+	if (Handle.IsValid())
+	{
+		MeshPool.Slots[Handle.Index].RefCount++;
+		return Handle;
+	}
+
+	MeshAsset Asset;
+	AnimationSet Animation;
+	if (!Loader(Asset.Meshes, Asset.Textures, Animation))
+	{
+		// the meshes delete their buffers as the asset goes out of scope
+		for (TextureHandle Texture : Asset.Textures)
+		{
+			Release(Texture);
+		}
+		std::cout << "ERROR::ASSETREGISTRY::Failed to load " << FilePath << std::endl;
+		return MeshHandle();
+	}
+
+	if (!Animation.IsEmpty())
+	{
+		Asset.Animation = std::make_shared<const AnimationSet>(std::move(Animation));
+	}
+	Asset.Path = Normalised;
+	Asset.PathHashes.push_back(PathHash);
+	Asset.ContentKey = ContentKey;
+	return MeshPool.Add(std::move(Asset));
+}
+
+void AssetRegistry::AddRef(MeshHandle Handle)
+{
+	if (Slot<MeshAsset>* Found = MeshPool.Resolve(Handle))
+	{
+		Found->RefCount++;
+	}
+}
+
+void AssetRegistry::Release(MeshHandle Handle)
+{
+	Slot<MeshAsset>* Found = MeshPool.Resolve(Handle);
+	if (bShutdown || !Found)
+	{
+		return;
+	}
+
+	if (--Found->RefCount == 0)
+	{
+		FreeMeshes(Handle.Index);
+	}
+}
+
+bool AssetRegistry::HasMeshes(const std::string& FilePath) const
+{
+	return MeshPool.ByPath.count(Hash::String(Paths::Normalise(FilePath))) != 0;
+}
+
+std::vector<Mesh>* AssetRegistry::GetMeshes(MeshHandle Handle)
+{
+	Slot<MeshAsset>* Found = MeshPool.Resolve(Handle);
+	return Found ? &Found->Asset.Meshes : nullptr;
+}
+
+const AnimationSet* AssetRegistry::GetAnimation(MeshHandle Handle) const
+{
+	const Slot<MeshAsset>* Found = MeshPool.Resolve(Handle);
+	return Found ? Found->Asset.Animation.get() : nullptr;
+}
+
+void AssetRegistry::GatherResidentAssets(std::vector<AssetMemoryInfo>& OutAssets) const
+{
+	OutAssets.clear();
+
+	for (const Slot<MeshAsset>& MeshSlot : MeshPool.Slots)
+	{
+		if (MeshSlot.RefCount == 0)
+		{
+			continue;
+		}
+
+		AssetMemoryInfo Info;
+		Info.Path = MeshSlot.Asset.Path;
+		Info.Kind = "Mesh";
+		Info.RefCount = MeshSlot.RefCount;
+		for (const Mesh& LoadedMesh : MeshSlot.Asset.Meshes)
+		{
+			Info.GpuBytes += LoadedMesh.GetGpuBytes();
+			Info.CpuBytes += LoadedMesh.GetCpuBytes();
+		}
+		if (MeshSlot.Asset.Animation)
+		{
+			Info.CpuBytes += MeshSlot.Asset.Animation->GetMemoryBytes();
+		}
+		OutAssets.push_back(Info);
+	}
+
+	for (const Slot<TextureAsset>& TextureSlot : Textures.Slots)
+	{
+		if (TextureSlot.RefCount == 0)
+		{
+			continue;
+		}
+
+		AssetMemoryInfo Info;
+		Info.Path = TextureSlot.Asset.Path;
+		Info.Kind = "Texture";
+		Info.RefCount = TextureSlot.RefCount;
+		Info.GpuBytes = TextureStreamer::Get().GetResidentBytes(TextureSlot.Asset.TextureID);
+		OutAssets.push_back(Info);
+	}
+
+	std::sort(OutAssets.begin(), OutAssets.end(), [](const AssetMemoryInfo& A, const AssetMemoryInfo& B)
+	{
+		return A.GpuBytes + A.CpuBytes > B.GpuBytes + B.CpuBytes;
+	});
+}
+
+void AssetRegistry::Shutdown()
+{
+	for (uint32_t Index = 0; Index < MeshPool.Slots.size(); Index++)
+	{
+		if (MeshPool.Slots[Index].RefCount > 0)
+		{
+			FreeMeshes(Index);
+		}
+	}
+	for (uint32_t Index = 0; Index < Textures.Slots.size(); Index++)
+	{
+		if (Textures.Slots[Index].RefCount > 0)
+		{
+			FreeTexture(Index);
+		}
+	}
+
+	bShutdown = true;
+}
+
+void AssetRegistry::FreeTexture(uint32_t Index)
+{
+	TextureStreamer::Get().Release(Textures.Slots[Index].Asset.TextureID);
+	Textures.Remove(Index);
+}
+
+void AssetRegistry::FreeMeshes(uint32_t Index)
+{
+	MeshAsset& Asset = MeshPool.Slots[Index].Asset;
+
+	// removing the asset destroys the meshes and with them their buffers. Textures may be shared with other models,
+	// they go when their own count drops to zero
+	const std::vector<TextureHandle> MeshTextures = std::move(Asset.Textures);
+	MeshPool.Remove(Index);
+	for (TextureHandle Texture : MeshTextures)
+	{
+		Release(Texture);
+	}
+}
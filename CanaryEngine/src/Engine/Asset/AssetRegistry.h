@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Engine/Mesh/Mesh.h"
+
+struct AnimationSet;
+
+// Generational handle into one of the registry's pools. A handle whose asset has been freed no longer resolves,
+// even if the slot has been reused since.
+template <typename Tag>
+struct AssetHandle
+{
+	uint32_t Index = 0;
+	uint32_t Generation = 0; // 0 is never a live generation
+
+	bool IsValid() const { return Generation != 0; }
+};
+
+struct TextureAssetTag;
+struct MeshAssetTag;
+using TextureHandle = AssetHandle<TextureAssetTag>;
+using MeshHandle = AssetHandle<MeshAssetTag>;
+
+// One row of the debug window's resident memory view
+struct AssetMemoryInfo
+{
+	std::string Path;
+	const char* Kind = "";
+	unsigned int RefCount = 0;
+	size_t GpuBytes = 0;
+	size_t CpuBytes = 0;
+};
+
+// Engine-wide cache of loaded textures and model meshes. Assets are looked up by a hash of their normalised path
+// (Paths::Normalise) and, when that misses, by a hash of the file's contents, so the same file reached through
+// different paths or a texture copied next to another model is only loaded once. Models resolve their textures
+// relative to their own directory, so their meshes are only shared by content within one directory. Each path's
+// file is hashed once and the result kept, later misses on the same path do not read it again. Every Acquire must be
+// paired with a Release, assets are freed as soon as their reference count reaches zero. GL thread only.
+class AssetRegistry
+{
+public:
+	// Loads a model's meshes on a cache miss, textures it acquires are released together with the meshes. Skinned
+	// models also fill in their skeleton and clips.
+	using MeshLoader = std::function<bool(std::vector<Mesh>& OutMeshes, std::vector<TextureHandle>& OutTextures, AnimationSet& OutAnimation)>;
+
+	static AssetRegistry& Get();
+
+	// Returns the texture for the file, starting to stream it in if it is not resident yet. Like AcquireMeshes, a
+	// content hash computed ahead of time saves reading the file on the GL thread when the path misses.
+	TextureHandle AcquireTexture(const std::string& FilePath, const std::string& TextureType, uint64_t InContentHash = 0);
+	void AddRef(TextureHandle Handle);
+	void Release(TextureHandle Handle);
+
+	// GL texture name, or 0 for a stale handle
+	unsigned int GetTextureID(TextureHandle Handle) const;
+
+	// Returns the meshes loaded from the file, calling Loader to create them on a miss. The handle is invalid if the
+	// loader fails. A content hash computed ahead of time (Hash::File, e.g. on a loading thread) saves reading the
+	// file on the GL thread when the path misses.
+	MeshHandle AcquireMeshes(const std::string& FilePath, const MeshLoader& Loader, uint64_t InContentHash = 0);
+	void AddRef(MeshHandle Handle);
+	void Release(MeshHandle Handle);
+
+	// True if meshes have been loaded through this path and are still resident, acquiring them again loads nothing
+	bool HasMeshes(const std::string& FilePath) const;
+
+	// Null for a stale handle
+	std::vector<Mesh>* GetMeshes(MeshHandle Handle);
+
+	// Null for a stale handle or a model without a skeleton. The animation never moves, so the pointer stays valid
+	// for as long as the handle holds its reference.
+	const AnimationSet* GetAnimation(MeshHandle Handle) const;
+
+	void GatherResidentAssets(std::vector<AssetMemoryInfo>& OutAssets) const;
+
+	// Frees everything still resident while the GL context is current, later releases are ignored
+	void Shutdown();
+
+private:
+	struct TextureAsset
+	{
+		std::string Path;
+		std::vector<uint64_t> PathHashes; // every path the asset was requested through
+		uint64_t ContentKey = 0;          // content hash, 0 if the file could not be read
+		unsigned int TextureID = 0;
+	};
+
+	struct MeshAsset
+	{
+		std::string Path;
+		std::vector<uint64_t> PathHashes;
+		uint64_t ContentKey = 0;          // content hash combined with the directory hash
+		std::vector<Mesh> Meshes;
+		std::vector<TextureHandle> Textures;
+		std::shared_ptr<const AnimationSet> Animation; // null for static models
+	};
+
+	template <typename T>
+	struct Slot
+	{
+		T Asset;
+		uint32_t Generation = 1;
+		uint32_t RefCount = 0;
+	};
+
+	// Slot storage with a free list, freeing a slot bumps its generation so old handles stop resolving
+	template <typename T, typename Tag>
+	struct Pool
+	{
+		std::vector<Slot<T>> Slots;
+		std::vector<uint32_t> FreeSlots;
+		std::unordered_map<uint64_t, uint32_t> ByPath;
+		std::unordered_map<uint64_t, uint32_t> ByContent;
+		std::unordered_map<uint64_t, uint64_t> ContentHashes; // by path hash, outlives the assets
+
+		Slot<T>* Resolve(AssetHandle<Tag> Handle);
+		const Slot<T>* Resolve(AssetHandle<Tag> Handle) const;
+
+		AssetHandle<Tag> Add(T&& Asset);
+		void Remove(uint32_t Index);
+
+		// Path lookup first, then content. A content hit is remembered under the new path too. The content key is
+		// the file's hash combined with ContentScope (unless that is 0), 0 when the file cannot be read. The file is
+		// only hashed when neither KnownContentHash nor an earlier lookup of the path provides its hash.
+		AssetHandle<Tag> Find(uint64_t PathHash, const std::string& FilePath, uint64_t KnownContentHash, uint64_t ContentScope, uint64_t& OutContentKey);
+	};
+
+	void FreeTexture(uint32_t Index);
+	void FreeMeshes(uint32_t Index);
+
+	Pool<TextureAsset, TextureAssetTag> Textures;
+	Pool<MeshAsset, MeshAssetTag> MeshPool;
+
+	bool bShutdown = false;
+};
@@ -0,0 +1,20 @@
+#include "CookedFile.h"
+
+#include "VirtualFileSystem.h"
+
+bool CookedFile::IsUpToDate(const std::string& CookedPath, const std::string& SourcePath)
+{
+	// goes through the file system so cooked files inside a pak are checked against the source time recorded at pack time
+	const VirtualFileSystem& FileSystem = VirtualFileSystem::Get();
+
+	int64_t CookedTime, SourceTime;
+	if (!FileSystem.GetModifiedTime(CookedPath, CookedTime))
+	{
+		return false;
+	}
+	if (!FileSystem.GetModifiedTime(SourcePath, SourceTime))
+	{
+		return true;
+	}
+	return CookedTime >= SourceTime;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Helpers shared by the cooked asset formats (.cmesh, .ctex)
+namespace CookedFile
+{
+	inline uint64_t AlignUp(uint64_t Value, uint64_t Alignment)
+	{
+		return (Value + Alignment - 1) & ~(Alignment - 1);
+	}
+
+	// True if the cooked file exists and is not older than its source (a missing source counts as up to date)
+	bool IsUpToDate(const std::string& CookedPath, const std::string& SourcePath);
+}
@@ -0,0 +1,62 @@
+#include "Hash.h"
+
+#include <cstring>
+
+#include "VirtualFileSystem.h"
+
+namespace
+{
+	const uint64_t Prime1 = 0x9E3779B185EBCA87ull;
+	const uint64_t Prime2 = 0xC2B2AE3D27D4EB4Full;
+	const uint64_t Prime3 = 0x165667B19E3779F9ull;
+
+	inline uint64_t RotateLeft(uint64_t Value, int Bits)
+	{
+		return (Value << Bits) | (Value >> (64 - Bits));
+	}
+
+	inline uint64_t Mix(uint64_t Hash, uint64_t Word)
+	{
+		Hash ^= RotateLeft(Word * Prime2, 31) * Prime1;
+		return RotateLeft(Hash, 27) * Prime1 + Prime3;
+	}
+}
+
+uint64_t Hash::Bytes(const void* Data, size_t Size, uint64_t Seed)
+{
+	const unsigned char* Bytes = static_cast<const unsigned char*>(Data);
+	uint64_t Hash = Seed + Prime3 + uint64_t(Size) * Prime1;
+
+	size_t Offset = 0;
+	for (; Offset + 8 <= Size; Offset += 8)
+	{
+		uint64_t Word;
+		std::memcpy(&Word, Bytes + Offset, 8);
+		Hash = Mix(Hash, Word);
+	}
+
+	// remaining 0-7 bytes
+	uint64_t Tail = 0;
+	std::memcpy(&Tail, Bytes + Offset, Size - Offset);
+	Hash = Mix(Hash, Tail);
+
+	// final avalanche so nearby inputs spread over all bits
+	Hash ^= Hash >> 33;
+	Hash *= Prime2;
+	Hash ^= Hash >> 29;
+	Hash *= Prime3;
+	Hash ^= Hash >> 32;
+	return Hash;
+}
+
+bool Hash::File(const std::string& FilePath, uint64_t& OutHash)
+{
+	VirtualFile Mapping;
+	if (!Mapping.Open(FilePath))
+	{
+		return false;
+	}
+
+	OutHash = Bytes(Mapping.GetData(), Mapping.GetSize());
+	return true;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 64 bit non-cryptographic hashing used to identify assets by path and by content
+namespace Hash
+{
+	// Processes 8 bytes per step, fast enough to hash whole source files while loading them
+	uint64_t Bytes(const void* Data, size_t Size, uint64_t Seed = 0);
+
+	inline uint64_t String(const std::string& Value, uint64_t Seed = 0)
+	{
+		return Bytes(Value.data(), Value.size(), Seed);
+	}
+
+	// Hashes the contents of a file read through the VirtualFileSystem, returns false if it cannot be read
+	bool File(const std::string& FilePath, uint64_t& OutHash);
+
+	inline uint64_t Combine(uint64_t A, uint64_t B)
+	{
+		return A ^ (B + 0x9E3779B97F4A7C15ull + (A << 6) + (A >> 2));
+	}
+}
@@ -0,0 +1,242 @@
+#include "Lz4.h"
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	const size_t MinMatch = 4;
+	const size_t LastLiterals = 5;  // the format requires the block to end in at least 5 literals
+	const size_t MatchStartLimit = 12; // and the last match to start at least 12 bytes before the end
+	const size_t MaxOffset = 65535;
+	const unsigned int HashBits = 16;
+
+	inline uint32_t Read32(const uint8_t* Pointer)
+	{
+		uint32_t Value;
+		std::memcpy(&Value, Pointer, 4);
+		return Value;
+	}
+
+	inline uint32_t HashSequence(uint32_t Sequence)
+	{
+		return (Sequence * 2654435761u) >> (32 - HashBits);
+	}
+
+	// Writes the remainder of a length that did not fit in the token's 4 bits
+	inline bool WriteLength(size_t Length, uint8_t*& Out, const uint8_t* OutEnd)
+	{
+		for (; Length >= 255; Length -= 255)
+		{
+			if (Out >= OutEnd)
+			{
+				return false;
+			}
+			*Out++ = 255;
+		}
+		if (Out >= OutEnd)
+		{
+			return false;
+		}
+		*Out++ = static_cast<uint8_t>(Length);
+		return true;
+	}
+
+	inline bool ReadLength(size_t& Length, const uint8_t*& In, const uint8_t* InEnd)
+	{
+		uint8_t Byte;
+		do
+		{
+			if (In >= InEnd)
+			{
+				return false;
+			}
+			Byte = *In++;
+			Length += Byte;
+		} while (Byte == 255);
+		return true;
+	}
+
+	bool WriteSequence(const uint8_t* Literals, size_t LiteralCount, size_t Offset, size_t MatchLength, uint8_t*& Out, const uint8_t* OutEnd)
+	{
+		if (Out >= OutEnd)
+		{
+			return false;
+		}
+
+		uint8_t* Token = Out++;
+		*Token = static_cast<uint8_t>((LiteralCount >= 15 ? 15 : LiteralCount) << 4);
+		if (LiteralCount >= 15 && !WriteLength(LiteralCount - 15, Out, OutEnd))
+		{
+			return false;
+		}
+
+		if (size_t(OutEnd - Out) < LiteralCount)
+		{
+			return false;
+		}
+		if (LiteralCount > 0)
+		{
+			std::memcpy(Out, Literals, LiteralCount);
+			Out += LiteralCount;
+		}
+
+		// the final sequence only carries literals
+		if (MatchLength == 0)
+		{
+			return true;
+		}
+
+		if (OutEnd - Out < 2)
+		{
+			return false;
+		}
+		*Out++ = static_cast<uint8_t>(Offset & 0xFF);
+		*Out++ = static_cast<uint8_t>(Offset >> 8);
+
+		const size_t MatchCode = MatchLength - MinMatch;
+		*Token |= static_cast<uint8_t>(MatchCode >= 15 ? 15 : MatchCode);
+		return MatchCode < 15 || WriteLength(MatchCode - 15, Out, OutEnd);
+	}
+}
+
+size_t Lz4::CompressBound(size_t SourceSize)
+{
+	return SourceSize + SourceSize / 255 + 16;
+}
+
+size_t Lz4::Compress(const uint8_t* Source, size_t SourceSize, uint8_t* Dest, size_t DestCapacity)
+{
+	uint8_t* Out = Dest;
+	const uint8_t* OutEnd = Dest + DestCapacity;
+
+	size_t Anchor = 0;
+	if (SourceSize > MatchStartLimit)
+	{
+		// positions of the last sequence seen with each hash
+		std::vector<uint32_t> Table(size_t(1) << HashBits, 0);
+
+		const size_t MatchEndLimit = SourceSize - LastLiterals;
+		size_t Position = 0;
+		while (Position + MatchStartLimit <= SourceSize)
+		{
+			const uint32_t Sequence = Read32(Source + Position);
+			const uint32_t Hash = HashSequence(Sequence);
+			size_t Candidate = Table[Hash];
+			Table[Hash] = static_cast<uint32_t>(Position);
+
+			if (Candidate >= Position || Position - Candidate > MaxOffset || Read32(Source + Candidate) != Sequence)
+			{
+				// skip faster through data that does not compress
+				Position += 1 + ((Position - Anchor) >> 6);
+				continue;
+			}
+
+			// grow the match backwards into the pending literals, then forwards
+			while (Position > Anchor && Candidate > 0 && Source[Position - 1] == Source[Candidate - 1])
+			{
+				Position--;
+				Candidate--;
+			}
+
+			size_t MatchLength = MinMatch;
+			while (Position + MatchLength < MatchEndLimit && Source[Candidate + MatchLength] == Source[Position + MatchLength])
+			{
+				MatchLength++;
+			}
+
+			if (!WriteSequence(Source + Anchor, Position - Anchor, Position - Candidate, MatchLength, Out, OutEnd))
+			{
+				return 0;
+			}
+
+			Position += MatchLength;
+			Anchor = Position;
+
+			// remember a position inside the match so runs keep finding each other
+			if (Position + MatchStartLimit <= SourceSize)
+			{
+				Table[HashSequence(Read32(Source + Position - 2))] = static_cast<uint32_t>(Position - 2);
+			}
+		}
+	}
+
+	if (!WriteSequence(Source + Anchor, SourceSize - Anchor, 0, 0, Out, OutEnd))
+	{
+		return 0;
+	}
+	return static_cast<size_t>(Out - Dest);
+}
+
+bool Lz4::Decompress(const uint8_t* Source, size_t SourceSize, uint8_t* Dest, size_t DestSize)
+{
+	const uint8_t* In = Source;
+	const uint8_t* InEnd = Source + SourceSize;
+	uint8_t* Out = Dest;
+	uint8_t* OutEnd = Dest + DestSize;
+
+	while (In < InEnd)
+	{
+		const uint8_t Token = *In++;
+
+		size_t LiteralCount = Token >> 4;
+		if (LiteralCount == 15 && !ReadLength(LiteralCount, In, InEnd))
+		{
+			return false;
+		}
+		if (size_t(InEnd - In) < LiteralCount || size_t(OutEnd - Out) < LiteralCount)
+		{
+			return false;
+		}
+		if (LiteralCount > 0)
+		{
+			std::memcpy(Out, In, LiteralCount);
+			In += LiteralCount;
+			Out += LiteralCount;
+		}
+
+		if (In == InEnd)
+		{
+			break;
+		}
+
+		if (InEnd - In < 2)
+		{
+			return false;
+		}
+		const size_t Offset = size_t(In[0]) | (size_t(In[1]) << 8);
+		In += 2;
+		if (Offset == 0 || Offset > size_t(Out - Dest))
+		{
+			return false;
+		}
+
+		size_t MatchLength = Token & 15;
+		if (MatchLength == 15 && !ReadLength(MatchLength, In, InEnd))
+		{
+			return false;
+		}
+		MatchLength += MinMatch;
+		if (size_t(OutEnd - Out) < MatchLength)
+		{
+			return false;
+		}
+
+		// matches may overlap their own output (runs), which needs a forward byte copy
+		const uint8_t* Match = Out - Offset;
+		if (Offset >= MatchLength)
+		{
+			std::memcpy(Out, Match, MatchLength);
+			Out += MatchLength;
+		}
+		else
+		{
+			for (size_t i = 0; i < MatchLength; i++)
+			{
+				*Out++ = *Match++;
+			}
+		}
+	}
+
+	return Out == OutEnd;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Compressor and decompressor for the LZ4 block format (no frame header or checksums), compatible with the reference
+// implementation. Compression is a greedy single-probe hash search, decompression is plain bounds-checked copying.
+namespace Lz4
+{
+	// Worst case compressed size of an input of the given size
+	size_t CompressBound(size_t SourceSize);
+
+	// Returns the compressed size, or 0 if the output did not fit in DestCapacity
+	size_t Compress(const uint8_t* Source, size_t SourceSize, uint8_t* Dest, size_t DestCapacity);
+
+	// Decompresses a whole block, returns false on malformed input or if it does not expand to exactly DestSize bytes
+	bool Decompress(const uint8_t* Source, size_t SourceSize, uint8_t* Dest, size_t DestSize);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only view of a whole file mapped into the address space. The pointer returned by GetData() stays valid
+// until the file is closed, so callers can hand ranges of it straight to the GPU without copying them first.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Maps the file at the given path, returns false if it could not be opened or is empty
+	bool Open(const std::string& FilePath);
+	void Close();
+
+	bool IsOpen() const { return Data != nullptr; }
+
+	const unsigned char* GetData() const { return Data; }
+	size_t GetSize() const { return Size; }
+
+private:
+	const unsigned char* Data = nullptr;
+	size_t Size = 0;
+
+#ifdef _WIN32
+	void* FileHandle = nullptr;
+	void* MappingHandle = nullptr;
+#else
+	int FileDescriptor = -1;
+#endif
+};
@@ -0,0 +1,258 @@
+#include "PakArchive.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <sys/stat.h>
+
+#include "CookedFile.h"
+#include "Hash.h"
+#include "Lz4.h"
+#include "Paths.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	// Files are compressed in batches so only a batch worth of data is held in memory at once
+	const size_t WriteBatchSize = 64;
+
+	struct PackedEntry
+	{
+		std::vector<uint8_t> Data;
+		PakArchive::ECompression Compression = PakArchive::ECompression::None;
+		uint64_t Size = 0;
+		int64_t ModifiedTime = 0;
+		bool bFailed = false;
+	};
+
+	void PackFile(const std::string& DiskPath, bool bCompress, PackedEntry& OutEntry)
+	{
+		struct stat FileStat;
+		if (stat(DiskPath.c_str(), &FileStat) != 0)
+		{
+			OutEntry.bFailed = true;
+			return;
+		}
+		OutEntry.ModifiedTime = static_cast<int64_t>(FileStat.st_mtime);
+		OutEntry.Size = static_cast<uint64_t>(FileStat.st_size);
+		if (OutEntry.Size == 0)
+		{
+			return;
+		}
+
+		MappedFile Source;
+		if (!Source.Open(DiskPath))
+		{
+			OutEntry.bFailed = true;
+			return;
+		}
+
+		if (bCompress)
+		{
+			OutEntry.Data.resize(Lz4::CompressBound(Source.GetSize()));
+			const size_t CompressedSize = Lz4::Compress(Source.GetData(), Source.GetSize(), OutEntry.Data.data(), OutEntry.Data.size());
+			if (CompressedSize > 0 && CompressedSize <= Source.GetSize() - Source.GetSize() / 8)
+			{
+				OutEntry.Data.resize(CompressedSize);
+				OutEntry.Compression = PakArchive::ECompression::Lz4;
+				return;
+			}
+		}
+
+		OutEntry.Data.assign(Source.GetData(), Source.GetData() + Source.GetSize());
+		OutEntry.Compression = PakArchive::ECompression::None;
+	}
+}
+
+uint64_t PakArchive::HashPath(const std::string& ArchivePath)
+{
+	return Hash::String(ArchivePath);
+}
+
+bool PakArchive::Write(const std::string& PakPath, const std::vector<SourceFile>& Files, bool bCompress)
+{
+	std::ofstream Out(PakPath, std::ios::binary | std::ios::trunc);
+	if (!Out)
+	{
+		std::cout << "ERROR::PAKARCHIVE::Could not open " << PakPath << " for writing" << std::endl;
+		return false;
+	}
+
+	FileHeader Header = {};
+	Header.Magic = Magic;
+	Header.Version = Version;
+	Header.EntryCount = static_cast<uint32_t>(Files.size());
+	Out.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+
+	static const char Padding[DataAlignment] = {};
+	uint64_t Offset = sizeof(Header);
+
+	std::vector<EntryRecord> Directory(Files.size());
+	std::string StringTable;
+	std::vector<PackedEntry> Batch;
+
+	for (size_t BatchStart = 0; BatchStart < Files.size(); BatchStart += WriteBatchSize)
+	{
+		const size_t BatchCount = std::min(WriteBatchSize, Files.size() - BatchStart);
+		Batch.assign(BatchCount, PackedEntry());
+		ThreadPool::Get().ParallelFor(BatchCount, [&](size_t i)
+		{
+			PackFile(Files[BatchStart + i].DiskPath, bCompress, Batch[i]);
+		});
+
+		for (size_t i = 0; i < BatchCount; i++)
+		{
+			const SourceFile& Source = Files[BatchStart + i];
+			const PackedEntry& Packed = Batch[i];
+			if (Packed.bFailed)
+			{
+				std::cout << "ERROR::PAKARCHIVE::Failed to read " << Source.DiskPath << std::endl;
+				return false;
+			}
+
+			const uint64_t AlignedOffset = CookedFile::AlignUp(Offset, DataAlignment);
+			Out.write(Padding, static_cast<std::streamsize>(AlignedOffset - Offset));
+			Out.write(reinterpret_cast<const char*>(Packed.Data.data()), static_cast<std::streamsize>(Packed.Data.size()));
+			Offset = AlignedOffset + Packed.Data.size();
+
+			const std::string ArchivePath = Paths::ToArchivePath(Source.ArchivePath);
+			EntryRecord& Entry = Directory[BatchStart + i];
+			Entry.PathHash = HashPath(ArchivePath);
+			Entry.Offset = AlignedOffset;
+			Entry.StoredSize = Packed.Data.size();
+			Entry.Size = Packed.Size;
+			Entry.ModifiedTime = Packed.ModifiedTime;
+			Entry.PathOffset = static_cast<uint32_t>(StringTable.size());
+			Entry.Compression = static_cast<uint32_t>(Packed.Compression);
+
+			StringTable += ArchivePath;
+			StringTable += '\0';
+		}
+	}
+
+	// equal hashes end up next to each other, Find walks that run comparing paths
+	std::sort(Directory.begin(), Directory.end(), [](const EntryRecord& A, const EntryRecord& B)
+	{
+		return A.PathHash < B.PathHash;
+	});
+
+	const uint64_t DirectoryOffset = CookedFile::AlignUp(Offset, DataAlignment);
+	Out.write(Padding, static_cast<std::streamsize>(DirectoryOffset - Offset));
+	Out.write(reinterpret_cast<const char*>(Directory.data()), static_cast<std::streamsize>(Directory.size() * sizeof(EntryRecord)));
+	Out.write(StringTable.data(), static_cast<std::streamsize>(StringTable.size()));
+
+	Header.DirectoryOffset = DirectoryOffset;
+	Header.StringsOffset = DirectoryOffset + Directory.size() * sizeof(EntryRecord);
+	Header.StringsSize = StringTable.size();
+	Out.seekp(0);
+	Out.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+
+	return Out.good();
+}
+
+bool PakFile::Open(const std::string& PakPath)
+{
+	Close();
+
+	if (!File.Open(PakPath))
+	{
+		return false;
+	}
+
+	if (File.GetSize() < sizeof(PakArchive::FileHeader))
+	{
+		std::cout << "ERROR::PAKARCHIVE::File is truncated: " << PakPath << std::endl;
+		Close();
+		return false;
+	}
+
+	Header = reinterpret_cast<const PakArchive::FileHeader*>(File.GetData());
+	if (Header->Magic != PakArchive::Magic || Header->Version != PakArchive::Version)
+	{
+		std::cout << "ERROR::PAKARCHIVE::Unsupported archive version: " << PakPath << std::endl;
+		Close();
+		return false;
+	}
+
+	const uint64_t DirectoryEnd = Header->DirectoryOffset + uint64_t(Header->EntryCount) * sizeof(PakArchive::EntryRecord);
+	if (DirectoryEnd > File.GetSize() || Header->StringsOffset < DirectoryEnd || Header->StringsOffset + Header->StringsSize > File.GetSize()
+		|| (Header->StringsSize > 0 && File.GetData()[Header->StringsOffset + Header->StringsSize - 1] != '\0'))
+	{
+		std::cout << "ERROR::PAKARCHIVE::Directory is out of bounds in " << PakPath << std::endl;
+		Close();
+		return false;
+	}
+
+	Entries = reinterpret_cast<const PakArchive::EntryRecord*>(File.GetData() + Header->DirectoryOffset);
+	Strings = reinterpret_cast<const char*>(File.GetData() + Header->StringsOffset);
+	for (uint32_t i = 0; i < Header->EntryCount; i++)
+	{
+		if (Entries[i].Offset + Entries[i].StoredSize > File.GetSize() || Entries[i].PathOffset >= Header->StringsSize)
+		{
+			std::cout << "ERROR::PAKARCHIVE::Entry " << i << " is out of bounds in " << PakPath << std::endl;
+			Close();
+			return false;
+		}
+	}
+
+	Path = PakPath;
+	return true;
+}
+
+void PakFile::Close()
+{
+	File.Close();
+	Path.clear();
+
+	Header = nullptr;
+	Entries = nullptr;
+	Strings = nullptr;
+}
+
+const PakArchive::EntryRecord* PakFile::Find(const std::string& FilePath) const
+{
+	if (!Header)
+	{
+		return nullptr;
+	}
+
+	const std::string ArchivePath = Paths::ToArchivePath(FilePath);
+	const uint64_t PathHash = PakArchive::HashPath(ArchivePath);
+
+	const PakArchive::EntryRecord* End = Entries + Header->EntryCount;
+	const PakArchive::EntryRecord* Entry = std::lower_bound(Entries, End, PathHash, [](const PakArchive::EntryRecord& Record, uint64_t Hash)
+	{
+		return Record.PathHash < Hash;
+	});
+
+	for (; Entry != End && Entry->PathHash == PathHash; ++Entry)
+	{
+		if (ArchivePath == GetEntryPath(*Entry))
+		{
+			return Entry;
+		}
+	}
+	return nullptr;
+}
+
+bool PakFile::Read(const PakArchive::EntryRecord& Entry, const uint8_t*& OutData, std::vector<uint8_t>& Scratch) const
+{
+	const uint8_t* Stored = File.GetData() + Entry.Offset;
+	if (Entry.Compression == static_cast<uint32_t>(PakArchive::ECompression::None))
+	{
+		OutData = Stored;
+		return true;
+	}
+
+	Scratch.resize(static_cast<size_t>(Entry.Size));
+	if (!Lz4::Decompress(Stored, static_cast<size_t>(Entry.StoredSize), Scratch.data(), Scratch.size()))
+	{
+		std::cout << "ERROR::PAKARCHIVE::Corrupt entry " << GetEntryPath(Entry) << " in " << Path << std::endl;
+		return false;
+	}
+
+	OutData = Scratch.data();
+	return true;
+}
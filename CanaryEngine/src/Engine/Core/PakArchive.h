@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+// Pak archives (.pak) bundle many files into one so shipping builds open a single file instead of thousands.
+// Layout: FileHeader, entry data (each entry starting on a 16 byte boundary, LZ4 compressed when that pays off),
+// then the directory sorted by path hash and the path strings. Paths are stored as Paths::ToArchivePath keys.
+namespace PakArchive
+{
+	const uint32_t Magic = 0x4B415043; // "CPAK"
+	const uint32_t Version = 1;
+	const uint32_t DataAlignment = 16;
+
+	enum class ECompression : uint32_t
+	{
+		None = 0,
+		Lz4 = 1
+	};
+
+	struct FileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t EntryCount;
+		uint32_t Reserved;
+		uint64_t DirectoryOffset;
+		uint64_t StringsOffset;
+		uint64_t StringsSize;
+	};
+
+	struct EntryRecord
+	{
+		uint64_t PathHash;
+		uint64_t Offset;
+		uint64_t StoredSize;   // size in the archive
+		uint64_t Size;         // size once decompressed
+		int64_t ModifiedTime;  // of the source file when it was packed, used for cooked file staleness checks
+		uint32_t PathOffset;   // into the string table
+		uint32_t Compression;  // ECompression
+	};
+
+	struct SourceFile
+	{
+		std::string ArchivePath; // path the engine will ask for, e.g. "shaders/ObjectVertexShader.vert"
+		std::string DiskPath;
+	};
+
+	uint64_t HashPath(const std::string& ArchivePath);
+
+	// Entries only stay compressed when that saves at least an eighth of their size, everything else is stored so
+	// it can be read straight from the mapping. Files are compressed on the thread pool.
+	bool Write(const std::string& PakPath, const std::vector<SourceFile>& Files, bool bCompress = true);
+}
+
+// Memory mapped pak archive. Lookups binary search the directory, stored entries are served straight from the mapping.
+class PakFile
+{
+public:
+	bool Open(const std::string& PakPath);
+	void Close();
+
+	// Accepts any spelling of the path, it is converted to the archive key first
+	const PakArchive::EntryRecord* Find(const std::string& FilePath) const;
+
+	// Points OutData at the entry's bytes, decompressing into Scratch when the entry is compressed
+	bool Read(const PakArchive::EntryRecord& Entry, const uint8_t*& OutData, std::vector<uint8_t>& Scratch) const;
+
+	uint32_t GetEntryCount() const { return Header ? Header->EntryCount : 0; }
+	const PakArchive::EntryRecord& GetEntry(uint32_t Index) const { return Entries[Index]; }
+	const char* GetEntryPath(const PakArchive::EntryRecord& Entry) const { return Strings + Entry.PathOffset; }
+
+	const std::string& GetPath() const { return Path; }
+
+private:
+	MappedFile File;
+	std::string Path;
+
+	const PakArchive::FileHeader* Header = nullptr;
+	const PakArchive::EntryRecord* Entries = nullptr;
+	const char* Strings = nullptr;
+};
@@ -0,0 +1,64 @@
+#include "Paths.h"
+
+#include <cctype>
+#include <vector>
+
+std::string Paths::Normalise(const std::string& FilePath)
+{
+	std::vector<std::string> Parts;
+	std::string Part;
+	const bool bAbsolute = !FilePath.empty() && (FilePath[0] == '/' || FilePath[0] == '\\');
+
+	for (size_t i = 0; i <= FilePath.size(); i++)
+	{
+		const char Character = i < FilePath.size() ? FilePath[i] : '/';
+		if (Character != '/' && Character != '\\')
+		{
+#ifdef _WIN32
+			Part += static_cast<char>(std::tolower(static_cast<unsigned char>(Character)));
+#else
+			Part += Character;
+#endif
+			continue;
+		}
+
+		if (Part == "..")
+		{
+			// a leading ".." has nothing to cancel and has to stay
+			if (!Parts.empty() && Parts.back() != "..")
+			{
+				Parts.pop_back();
+			}
+			else if (!bAbsolute)
+			{
+				Parts.push_back(Part);
+			}
+		}
+		else if (!Part.empty() && Part != ".")
+		{
+			Parts.push_back(Part);
+		}
+		Part.clear();
+	}
+
+	std::string Normalised = bAbsolute ? "/" : "";
+	for (size_t i = 0; i < Parts.size(); i++)
+	{
+		if (i > 0)
+		{
+			Normalised += '/';
+		}
+		Normalised += Parts[i];
+	}
+	return Normalised;
+}
+
+std::string Paths::ToArchivePath(const std::string& FilePath)
+{
+	std::string ArchivePath = Normalise(FilePath);
+	for (char& Character : ArchivePath)
+	{
+		Character = static_cast<char>(std::tolower(static_cast<unsigned char>(Character)));
+	}
+	return ArchivePath;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+namespace Paths
+{
+	// Forward slashes, no "." or ".." components, lower case on Windows where paths are case insensitive
+	std::string Normalise(const std::string& FilePath);
+
+	// Normalised and always lower case, the key files are stored under in a pak archive so lookups behave the same
+	// whichever platform built it
+	std::string ToArchivePath(const std::string& FilePath);
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cmath>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// SSE versions of the few matrix and quaternion operations that dominate pose evaluation. Every function works on
+// glm types in place (column major matrices, quaternions stored x, y, z, w) and falls back to plain glm where SSE is
+// not available. Loads are unaligned so callers do not need to over-align their arrays.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CANARY_SIMD_SSE 1
+#include <emmintrin.h>
+
+// Lanes X, Y, Z, W of the result pick these lanes of V
+#define CANARY_SIMD_PERMUTE(V, X, Y, Z, W) _mm_shuffle_ps((V), (V), _MM_SHUFFLE((W), (Z), (Y), (X)))
+// Lanes X and Y come from A, lanes Z and W from B
+#define CANARY_SIMD_SHUFFLE(A, B, X, Y, Z, W) _mm_shuffle_ps((A), (B), _MM_SHUFFLE((W), (Z), (Y), (X)))
+#else
+#define CANARY_SIMD_SSE 0
+#endif
+
+static_assert(sizeof(glm::quat) == 4 * sizeof(float), "SimdMath expects tightly packed quaternions");
+
+namespace SimdMath
+{
+#if CANARY_SIMD_SSE
+	inline __m128 Load(const glm::vec4& Value) { return _mm_loadu_ps(&Value.x); }
+	inline __m128 Load(const glm::quat& Value) { return _mm_loadu_ps(&Value.x); }
+	inline void Store(glm::vec4& Out, __m128 Value) { _mm_storeu_ps(&Out.x, Value); }
+	inline void Store(glm::quat& Out, __m128 Value) { _mm_storeu_ps(&Out.x, Value); }
+
+	// Dot product of all four lanes, broadcast to every lane
+	inline __m128 Dot4(__m128 A, __m128 B)
+	{
+		__m128 Product = _mm_mul_ps(A, B);
+		Product = _mm_add_ps(Product, CANARY_SIMD_PERMUTE(Product, 1, 0, 3, 2));
+		return _mm_add_ps(Product, CANARY_SIMD_PERMUTE(Product, 2, 3, 0, 1));
+	}
+#endif
+
+	// Out = A * B, Out may be A or B
+	inline void MultiplyMatrices(const glm::mat4& A, const glm::mat4& B, glm::mat4& Out)
+	{
+#if CANARY_SIMD_SSE
+		const __m128 A0 = _mm_loadu_ps(&A[0][0]);
+		const __m128 A1 = _mm_loadu_ps(&A[1][0]);
+		const __m128 A2 = _mm_loadu_ps(&A[2][0]);
+		const __m128 A3 = _mm_loadu_ps(&A[3][0]);
+
+		__m128 Columns[4];
+		for (int Column = 0; Column < 4; Column++)
+		{
+			const __m128 BColumn = _mm_loadu_ps(&B[Column][0]);
+			__m128 Result = _mm_mul_ps(A0, CANARY_SIMD_PERMUTE(BColumn, 0, 0, 0, 0));
+			Result = _mm_add_ps(Result, _mm_mul_ps(A1, CANARY_SIMD_PERMUTE(BColumn, 1, 1, 1, 1)));
+			Result = _mm_add_ps(Result, _mm_mul_ps(A2, CANARY_SIMD_PERMUTE(BColumn, 2, 2, 2, 2)));
+			Result = _mm_add_ps(Result, _mm_mul_ps(A3, CANARY_SIMD_PERMUTE(BColumn, 3, 3, 3, 3)));
+			Columns[Column] = Result;
+		}
+
+		for (int Column = 0; Column < 4; Column++)
+		{
+			_mm_storeu_ps(&Out[Column][0], Columns[Column]);
+		}
+#else
+		Out = A * B;
+#endif
+	}
+
+	// Translation * Rotation * Scale, the w of Translation and Scale is ignored. Rotation must be normalised.
+	inline void ComposeTransform(const glm::quat& Rotation, const glm::vec4& Translation, const glm::vec4& Scale, glm::mat4& Out)
+	{
+#if CANARY_SIMD_SSE
+		const __m128 Q = Load(Rotation);
+		const __m128 Q2 = _mm_add_ps(Q, Q);
+		const __m128 Mask3 = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+
+		// diagonal: 1 - 2yy - 2zz, 1 - 2xx - 2zz, 1 - 2xx - 2yy
+		const __m128 Squares = _mm_mul_ps(Q, Q2);
+		const __m128 SquaresYXX = _mm_and_ps(CANARY_SIMD_PERMUTE(Squares, 1, 0, 0, 3), Mask3);
+		const __m128 SquaresZZY = _mm_and_ps(CANARY_SIMD_PERMUTE(Squares, 2, 2, 1, 3), Mask3);
+		const __m128 Diagonal = _mm_sub_ps(_mm_sub_ps(_mm_set_ps(0.0f, 1.0f, 1.0f, 1.0f), SquaresYXX), SquaresZZY);
+
+		// 2xz, 2xy, 2yz and 2wy, 2wz, 2wx
+		const __m128 Cross = _mm_mul_ps(CANARY_SIMD_PERMUTE(Q, 0, 0, 1, 3), CANARY_SIMD_PERMUTE(Q2, 2, 1, 2, 3));
+		const __m128 WTerms = _mm_mul_ps(CANARY_SIMD_PERMUTE(Q, 3, 3, 3, 3), CANARY_SIMD_PERMUTE(Q2, 1, 2, 0, 3));
+		const __m128 Sum = _mm_add_ps(Cross, WTerms);        // xz + wy, xy + wz, yz + wx
+		const __m128 Difference = _mm_sub_ps(Cross, WTerms); // xz - wy, xy - wz, yz - wx
+
+		// xy + wz, xz - wy, xy - wz, yz + wx
+		const __m128 OffA = CANARY_SIMD_PERMUTE(CANARY_SIMD_SHUFFLE(Sum, Difference, 1, 2, 0, 1), 0, 2, 3, 1);
+		// xz + wy, yz - wx, xz + wy, yz - wx
+		const __m128 OffB = CANARY_SIMD_PERMUTE(CANARY_SIMD_SHUFFLE(Sum, Difference, 0, 0, 2, 2), 0, 2, 0, 2);
+
+		const __m128 Column0 = CANARY_SIMD_PERMUTE(CANARY_SIMD_SHUFFLE(Diagonal, OffA, 0, 3, 0, 1), 0, 2, 3, 1);
+		const __m128 Column1 = CANARY_SIMD_PERMUTE(CANARY_SIMD_SHUFFLE(Diagonal, OffA, 1, 3, 2, 3), 2, 0, 3, 1);
+		const __m128 Column2 = CANARY_SIMD_SHUFFLE(OffB, Diagonal, 0, 1, 2, 3);
+
+		const __m128 S = Load(Scale);
+		_mm_storeu_ps(&Out[0][0], _mm_mul_ps(Column0, CANARY_SIMD_PERMUTE(S, 0, 0, 0, 0)));
+		_mm_storeu_ps(&Out[1][0], _mm_mul_ps(Column1, CANARY_SIMD_PERMUTE(S, 1, 1, 1, 1)));
+		_mm_storeu_ps(&Out[2][0], _mm_mul_ps(Column2, CANARY_SIMD_PERMUTE(S, 2, 2, 2, 2)));
+		Out[3] = glm::vec4(Translation.x, Translation.y, Translation.z, 1.0f);
+#else
+		Out = glm::mat4_cast(Rotation);
+		Out[0] *= Scale.x;
+		Out[1] *= Scale.y;
+		Out[2] *= Scale.z;
+		Out[3] = glm::vec4(Translation.x, Translation.y, Translation.z, 1.0f);
+#endif
+	}
+
+	// A + (B - A) * T on all four components
+	inline void Lerp(const glm::vec4& A, const glm::vec4& B, float T, glm::vec4& Out)
+	{
+#if CANARY_SIMD_SSE
+		const __m128 VA = Load(A);
+		Store(Out, _mm_add_ps(VA, _mm_mul_ps(_mm_sub_ps(Load(B), VA), _mm_set1_ps(T))));
+#else
+		Out = A + (B - A) * T;
+#endif
+	}
+
+	// Normalised linear interpolation along the shorter arc, close enough to slerp between neighbouring keys and for
+	// pose blending at a fraction of the cost. Quaternions are four floats x, y, z, w, Out may be A or B.
+	inline void Nlerp(const float* A, const float* B, float T, float* Out)
+	{
+#if CANARY_SIMD_SSE
+		const __m128 VA = _mm_loadu_ps(A);
+		__m128 VB = _mm_loadu_ps(B);
+
+		// flip B into A's hemisphere by copying the sign of the dot product onto it
+		const __m128 SignBit = _mm_set1_ps(-0.0f);
+		VB = _mm_xor_ps(VB, _mm_and_ps(Dot4(VA, VB), SignBit));
+
+		const __m128 Blended = _mm_add_ps(VA, _mm_mul_ps(_mm_sub_ps(VB, VA), _mm_set1_ps(T)));
+		_mm_storeu_ps(Out, _mm_div_ps(Blended, _mm_sqrt_ps(Dot4(Blended, Blended))));
+#else
+		const float Sign = A[0] * B[0] + A[1] * B[1] + A[2] * B[2] + A[3] * B[3] < 0.0f ? -1.0f : 1.0f;
+		float Blended[4];
+		float LengthSquared = 0.0f;
+		for (int Component = 0; Component < 4; Component++)
+		{
+			Blended[Component] = A[Component] + (B[Component] * Sign - A[Component]) * T;
+			LengthSquared += Blended[Component] * Blended[Component];
+		}
+		const float InverseLength = 1.0f / std::sqrt(LengthSquared);
+		for (int Component = 0; Component < 4; Component++)
+		{
+			Out[Component] = Blended[Component] * InverseLength;
+		}
+#endif
+	}
+
+	inline void Nlerp(const glm::quat& A, const glm::quat& B, float T, glm::quat& Out)
+	{
+		Nlerp(&A.x, &B.x, T, &Out.x);
+	}
+
+	// Weights.x * A + Weights.y * B + Weights.z * C + Weights.w * D, the four point form of a cubic spline segment
+	inline void WeightedSum(const glm::vec4& A, const glm::vec4& B, const glm::vec4& C, const glm::vec4& D, const glm::vec4& Weights, glm::vec4& Out)
+	{
+#if CANARY_SIMD_SSE
+		const __m128 W = Load(Weights);
+		__m128 Result = _mm_mul_ps(Load(A), CANARY_SIMD_PERMUTE(W, 0, 0, 0, 0));
+		Result = _mm_add_ps(Result, _mm_mul_ps(Load(B), CANARY_SIMD_PERMUTE(W, 1, 1, 1, 1)));
+		Result = _mm_add_ps(Result, _mm_mul_ps(Load(C), CANARY_SIMD_PERMUTE(W, 2, 2, 2, 2)));
+		Store(Out, _mm_add_ps(Result, _mm_mul_ps(Load(D), CANARY_SIMD_PERMUTE(W, 3, 3, 3, 3))));
+#else
+		Out = A * Weights.x + B * Weights.y + C * Weights.z + D * Weights.w;
+#endif
+	}
+
+	// Same for quaternions stored x, y, z, w: A, C and D are flipped into B's hemisphere first and the result is
+	// normalised
+	inline void WeightedSumRotations(const glm::vec4& A, const glm::vec4& B, const glm::vec4& C, const glm::vec4& D, const glm::vec4& Weights, glm::quat& Out)
+	{
+#if CANARY_SIMD_SSE
+		const __m128 SignBit = _mm_set1_ps(-0.0f);
+		const __m128 W = Load(Weights);
+		const __m128 VB = Load(B);
+		const __m128 VA = Load(A);
+		const __m128 VC = Load(C);
+		const __m128 VD = Load(D);
+
+		__m128 Result = _mm_mul_ps(VB, CANARY_SIMD_PERMUTE(W, 1, 1, 1, 1));
+		Result = _mm_add_ps(Result, _mm_mul_ps(_mm_xor_ps(VA, _mm_and_ps(Dot4(VA, VB), SignBit)), CANARY_SIMD_PERMUTE(W, 0, 0, 0, 0)));
+		Result = _mm_add_ps(Result, _mm_mul_ps(_mm_xor_ps(VC, _mm_and_ps(Dot4(VC, VB), SignBit)), CANARY_SIMD_PERMUTE(W, 2, 2, 2, 2)));
+		Result = _mm_add_ps(Result, _mm_mul_ps(_mm_xor_ps(VD, _mm_and_ps(Dot4(VD, VB), SignBit)), CANARY_SIMD_PERMUTE(W, 3, 3, 3, 3)));
+		Store(Out, _mm_div_ps(Result, _mm_sqrt_ps(Dot4(Result, Result))));
+#else
+		auto Aligned = [&B](const glm::vec4& Value)
+		{
+			return glm::dot(Value, B) < 0.0f ? -Value : Value;
+		};
+		const glm::vec4 Result = glm::normalize(Aligned(A) * Weights.x + B * Weights.y + Aligned(C) * Weights.z + Aligned(D) * Weights.w);
+		Out = glm::quat(Result.w, Result.x, Result.y, Result.z);
+#endif
+	}
+}
@@ -0,0 +1,151 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace
+{
+	// Shared between the caller of ParallelFor and the helper jobs it queues. Helpers that only get to run
+	// after the loop has finished find no work left and exit without touching the callable.
+	struct ParallelForState
+	{
+		std::atomic<size_t> NextIndex{ 0 };
+		std::atomic<size_t> Finished{ 0 };
+		size_t Count = 0;
+		const std::function<void(size_t)>* Func = nullptr;
+
+		std::mutex DoneMutex;
+		std::condition_variable Done;
+
+		void Run()
+		{
+			for (;;)
+			{
+				const size_t Index = NextIndex.fetch_add(1);
+				if (Index >= Count)
+				{
+					return;
+				}
+
+				(*Func)(Index);
+
+				if (Finished.fetch_add(1) + 1 == Count)
+				{
+					std::lock_guard<std::mutex> Lock(DoneMutex);
+					Done.notify_all();
+				}
+			}
+		}
+	};
+}
+
+ThreadPool::ThreadPool(unsigned int InThreadCount)
+{
+	if (InThreadCount == 0)
+	{
+		const unsigned int HardwareThreads = std::thread::hardware_concurrency();
+		InThreadCount = HardwareThreads > 1 ? HardwareThreads - 1 : 1;
+	}
+
+	Workers.reserve(InThreadCount);
+	for (unsigned int i = 0; i < InThreadCount; i++)
+	{
+		Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> Lock(QueueMutex);
+		bStopping = true;
+	}
+	JobAvailable.notify_all();
+
+	for (std::thread& Worker : Workers)
+	{
+		Worker.join();
+	}
+}
+
+ThreadPool& ThreadPool::Get()
+{
+	static ThreadPool Pool;
+	return Pool;
+}
+
+void ThreadPool::Submit(std::function<void()> Job)
+{
+	{
+		std::lock_guard<std::mutex> Lock(QueueMutex);
+		Jobs.push_back(std::move(Job));
+	}
+	JobAvailable.notify_one();
+}
+
+void ThreadPool::ParallelFor(size_t Count, const std::function<void(size_t)>& Func)
+{
+	if (Count == 0)
+	{
+		return;
+	}
+	if (Count == 1)
+	{
+		Func(0);
+		return;
+	}
+
+	std::shared_ptr<ParallelForState> State = std::make_shared<ParallelForState>();
+	State->Count = Count;
+	State->Func = &Func;
+
+	const size_t Helpers = std::min<size_t>(Workers.size(), Count - 1);
+	for (size_t i = 0; i < Helpers; i++)
+	{
+		Submit([State]() { State->Run(); });
+	}
+
+	State->Run();
+
+	std::unique_lock<std::mutex> Lock(State->DoneMutex);
+	State->Done.wait(Lock, [&State]() { return State->Finished.load() == State->Count; });
+}
+
+void ThreadPool::WaitIdle()
+{
+	std::unique_lock<std::mutex> Lock(QueueMutex);
+	Idle.wait(Lock, [this]() { return Jobs.empty() && ActiveJobs == 0; });
+}
+
+void ThreadPool::WorkerLoop()
+{
+	for (;;)
+	{
+		std::function<void()> Job;
+		{
+			std::unique_lock<std::mutex> Lock(QueueMutex);
+			JobAvailable.wait(Lock, [this]() { return bStopping || !Jobs.empty(); });
+
+			if (bStopping && Jobs.empty())
+			{
+				return;
+			}
+
+			Job = std::move(Jobs.front());
+			Jobs.pop_front();
+			ActiveJobs++;
+		}
+
+		Job();
+
+		{
+			std::lock_guard<std::mutex> Lock(QueueMutex);
+			ActiveJobs--;
+			if (Jobs.empty() && ActiveJobs == 0)
+			{
+				Idle.notify_all();
+			}
+		}
+	}
+}
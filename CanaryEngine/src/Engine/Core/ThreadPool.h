@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads pulling jobs from a shared queue. Get() returns the engine-wide pool which
+// is sized to leave one core for the main (GL) thread.
+class ThreadPool
+{
+public:
+	// A thread count of 0 uses one worker per hardware thread minus one
+	explicit ThreadPool(unsigned int InThreadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	static ThreadPool& Get();
+
+	// Queues a job to run on one of the workers
+	void Submit(std::function<void()> Job);
+
+	// Calls Func(Index) for every index in [0, Count) and returns once all of them have finished. The calling
+	// thread takes part in the work, so this is safe to call from inside a job.
+	void ParallelFor(size_t Count, const std::function<void(size_t)>& Func);
+
+	// Blocks until the queue is empty and every worker is idle
+	void WaitIdle();
+
+	unsigned int GetThreadCount() const { return static_cast<unsigned int>(Workers.size()); }
+
+private:
+	void WorkerLoop();
+
+	std::vector<std::thread> Workers;
+	std::deque<std::function<void()>> Jobs;
+
+	std::mutex QueueMutex;
+	std::condition_variable JobAvailable;
+	std::condition_variable Idle;
+
+	unsigned int ActiveJobs = 0;
+	bool bStopping = false;
+};
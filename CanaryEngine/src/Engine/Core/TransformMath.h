@@ -0,0 +1,18 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+// Helpers for the affine transforms objects are placed with
+namespace TransformMath
+{
+	// Length of the longest of the first three columns, the most the transform stretches any distance. Bounding
+	// sphere radii and model space errors are scaled by it.
+	inline float GetMaxAxisScale(const glm::mat4& Transform)
+	{
+		return std::sqrt(std::max(glm::dot(glm::vec3(Transform[0]), glm::vec3(Transform[0])),
+			std::max(glm::dot(glm::vec3(Transform[1]), glm::vec3(Transform[1])), glm::dot(glm::vec3(Transform[2]), glm::vec3(Transform[2])))));
+	}
+}
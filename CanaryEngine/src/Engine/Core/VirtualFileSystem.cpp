@@ -0,0 +1,169 @@
+#include "VirtualFileSystem.h"
+
+#include <iostream>
+
+#include <sys/stat.h>
+
+namespace
+{
+	bool GetLooseModifiedTime(const std::string& FilePath, int64_t& OutTime)
+	{
+		struct stat FileStat;
+		if (stat(FilePath.c_str(), &FileStat) != 0)
+		{
+			return false;
+		}
+		OutTime = static_cast<int64_t>(FileStat.st_mtime);
+		return true;
+	}
+
+	bool GetLooseSize(const std::string& FilePath, uint64_t& OutSize)
+	{
+		struct stat FileStat;
+		if (stat(FilePath.c_str(), &FileStat) != 0)
+		{
+			return false;
+		}
+		OutSize = static_cast<uint64_t>(FileStat.st_size);
+		return true;
+	}
+}
+
+bool VirtualFile::Open(const std::string& FilePath)
+{
+	return VirtualFileSystem::Get().Open(FilePath, *this);
+}
+
+void VirtualFile::Close()
+{
+	Loose.Close();
+	Decompressed.clear();
+	Decompressed.shrink_to_fit();
+
+	Data = nullptr;
+	Size = 0;
+}
+
+VirtualFileSystem& VirtualFileSystem::Get()
+{
+	static VirtualFileSystem FileSystem;
+	return FileSystem;
+}
+
+bool VirtualFileSystem::MountPak(const std::string& PakPath)
+{
+	std::unique_ptr<PakFile> Pak(new PakFile());
+	if (!Pak->Open(PakPath))
+	{
+		return false;
+	}
+
+	std::cout << "Mounted " << PakPath << " (" << Pak->GetEntryCount() << " files)" << std::endl;
+	Paks.push_back(std::move(Pak));
+	return true;
+}
+
+void VirtualFileSystem::UnmountAll()
+{
+	Paks.clear();
+}
+
+const PakArchive::EntryRecord* VirtualFileSystem::FindInPaks(const std::string& FilePath, const PakFile*& OutPak) const
+{
+	for (size_t i = Paks.size(); i-- > 0;)
+	{
+		if (const PakArchive::EntryRecord* Entry = Paks[i]->Find(FilePath))
+		{
+			OutPak = Paks[i].get();
+			return Entry;
+		}
+	}
+	return nullptr;
+}
+
+bool VirtualFileSystem::Open(const std::string& FilePath, VirtualFile& OutFile) const
+{
+	OutFile.Close();
+
+	// a failed open is the only cost of the override, no separate stat
+	if (bLooseFileOverride && OutFile.Loose.Open(FilePath))
+	{
+		OutFile.Data = OutFile.Loose.GetData();
+		OutFile.Size = OutFile.Loose.GetSize();
+		return true;
+	}
+
+	const PakFile* Pak = nullptr;
+	if (const PakArchive::EntryRecord* Entry = FindInPaks(FilePath, Pak))
+	{
+		const uint8_t* Data = nullptr;
+		if (!Pak->Read(*Entry, Data, OutFile.Decompressed))
+		{
+			return false;
+		}
+		OutFile.Data = Data;
+		OutFile.Size = static_cast<size_t>(Entry->Size);
+		return true;
+	}
+
+	if (!bLooseFileOverride && OutFile.Loose.Open(FilePath))
+	{
+		OutFile.Data = OutFile.Loose.GetData();
+		OutFile.Size = OutFile.Loose.GetSize();
+		return true;
+	}
+
+	return false;
+}
+
+bool VirtualFileSystem::ReadText(const std::string& FilePath, std::string& OutText) const
+{
+	VirtualFile File;
+	if (!Open(FilePath, File))
+	{
+		return false;
+	}
+
+	OutText.assign(reinterpret_cast<const char*>(File.GetData()), File.GetSize());
+	return true;
+}
+
+bool VirtualFileSystem::Exists(const std::string& FilePath) const
+{
+	int64_t ModifiedTime;
+	return GetModifiedTime(FilePath, ModifiedTime);
+}
+
+bool VirtualFileSystem::GetModifiedTime(const std::string& FilePath, int64_t& OutTime) const
+{
+	if (bLooseFileOverride && GetLooseModifiedTime(FilePath, OutTime))
+	{
+		return true;
+	}
+
+	const PakFile* Pak = nullptr;
+	if (const PakArchive::EntryRecord* Entry = FindInPaks(FilePath, Pak))
+	{
+		OutTime = Entry->ModifiedTime;
+		return true;
+	}
+
+	return !bLooseFileOverride && GetLooseModifiedTime(FilePath, OutTime);
+}
+
+bool VirtualFileSystem::GetSize(const std::string& FilePath, uint64_t& OutSize) const
+{
+	if (bLooseFileOverride && GetLooseSize(FilePath, OutSize))
+	{
+		return true;
+	}
+
+	const PakFile* Pak = nullptr;
+	if (const PakArchive::EntryRecord* Entry = FindInPaks(FilePath, Pak))
+	{
+		OutSize = Entry->Size;
+		return true;
+	}
+
+	return !bLooseFileOverride && GetLooseSize(FilePath, OutSize);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "PakArchive.h"
+
+// Contents of one file opened through the VirtualFileSystem. Depending on where it came from the data is a mapping
+// of the loose file, a range of a mounted pak's mapping or a decompressed copy; callers only see the bytes.
+class VirtualFile
+{
+public:
+	VirtualFile() = default;
+
+	VirtualFile(const VirtualFile&) = delete;
+	VirtualFile& operator=(const VirtualFile&) = delete;
+
+	// Shorthand for VirtualFileSystem::Get().Open
+	bool Open(const std::string& FilePath);
+	void Close();
+
+	bool IsOpen() const { return Data != nullptr; }
+
+	const unsigned char* GetData() const { return Data; }
+	size_t GetSize() const { return Size; }
+
+private:
+	friend class VirtualFileSystem;
+
+	MappedFile Loose;
+	std::vector<uint8_t> Decompressed;
+
+	const unsigned char* Data = nullptr;
+	size_t Size = 0;
+};
+
+// Single entry point for reading engine data. Files are looked up in the mounted pak archives (the last mounted
+// wins) and on disk. With the loose file override on, which is the default, a file on disk shadows the pak entry so
+// edited assets show up without repacking. Mount everything before loading starts; opening files is then safe from
+// any thread.
+class VirtualFileSystem
+{
+public:
+	static VirtualFileSystem& Get();
+
+	// Returns false if the archive is missing or invalid
+	bool MountPak(const std::string& PakPath);
+	void UnmountAll();
+
+	void SetLooseFileOverride(bool bInOverride) { bLooseFileOverride = bInOverride; }
+	bool GetLooseFileOverride() const { return bLooseFileOverride; }
+
+	bool Open(const std::string& FilePath, VirtualFile& OutFile) const;
+
+	// Whole file as text, e.g. shader sources
+	bool ReadText(const std::string& FilePath, std::string& OutText) const;
+
+	bool Exists(const std::string& FilePath) const;
+
+	// Modification time of the loose file, or of the source file when it was packed
+	bool GetModifiedTime(const std::string& FilePath, int64_t& OutTime) const;
+
+	// Size of the file as Open returns it, decompressed for packed files
+	bool GetSize(const std::string& FilePath, uint64_t& OutSize) const;
+
+	size_t GetMountedPakCount() const { return Paks.size(); }
+
+private:
+	const PakArchive::EntryRecord* FindInPaks(const std::string& FilePath, const PakFile*& OutPak) const;
+
+	std::vector<std::unique_ptr<PakFile>> Paks;
+	bool bLooseFileOverride = true;
+};
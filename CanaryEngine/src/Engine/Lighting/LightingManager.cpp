@@ -9,6 +9,11 @@ void LightManager::AddLight(const Light& InLight)
     }
 }
 
+void LightManager::ClearLights()
+{
+    Lights.clear();
+}
+
 void LightManager::UpdateLights(ShaderProgram& Shader)
 {
     // Technically better to use UBOs for this, but I had a lot of trouble getting that setup working 
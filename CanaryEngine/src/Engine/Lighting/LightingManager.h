@@ -24,6 +24,9 @@ public:
     // Add a light to the scene
     void AddLight(const Light& light);
 
+    // Removes every light, e.g. before adding a streamed scene's lights again
+    void ClearLights();
+
     // Updates all existing light objects
     void UpdateLights(ShaderProgram& Shader);
 
@@ -0,0 +1,470 @@
+#include "CookedMesh.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "Engine/Core/CookedFile.h"
+
+namespace
+{
+	using CookedFile::AlignUp;
+
+	struct ChunkPayload
+	{
+		uint32_t Id;
+		const void* Data;
+		uint64_t Size;
+	};
+}
+
+std::string CookedMesh::GetCookedPath(const std::string& SourcePath)
+{
+	return SourcePath + ".cmesh";
+}
+
+bool CookedMesh::Write(const std::string& FilePath, const std::vector<MeshData>& InMeshes, EVertexFormat PreferredFormat,
+	const AnimationSet* Animation, const DistanceFieldData* DistanceField)
+{
+	std::vector<MeshRecord> Records;
+	std::vector<unsigned char> AllVertices;
+	std::vector<unsigned char> AllIndices;
+	std::vector<MeshLod> AllLods;
+	std::vector<Meshlet> AllMeshlets;
+	std::vector<TextureRefRecord> TextureRefs;
+	std::vector<VertexSkin> AllSkin;
+	std::string Strings;
+
+	Records.reserve(InMeshes.size());
+
+	EncodedMesh Encoded;
+	for (const MeshData& Data : InMeshes)
+	{
+		VertexFormat::Encode(Data.Vertices, Data.Indices, PreferredFormat, Encoded);
+		const MeshUploadData& Upload = Encoded.Upload;
+		const size_t VertexBytes = Upload.VertexCount * VertexFormat::GetVertexStride(Upload.VertexFormat);
+		const size_t IndexBytes = Upload.IndexCount * Upload.IndexSize;
+
+		MeshRecord Record;
+		Record.VertexOffset = AllVertices.size();
+		Record.IndexOffset = AllIndices.size();
+		Record.VertexCount = static_cast<uint32_t>(Upload.VertexCount);
+		Record.IndexCount = static_cast<uint32_t>(Upload.IndexCount);
+		Record.VertexFormat = static_cast<uint32_t>(Upload.VertexFormat);
+		Record.IndexSize = Upload.IndexSize;
+		for (int Axis = 0; Axis < 3; Axis++)
+		{
+			Record.PositionOffset[Axis] = Upload.Quantisation.Offset[Axis];
+			Record.PositionScale[Axis] = Upload.Quantisation.Scale[Axis];
+			Record.BoundsMin[Axis] = Upload.BoundsMin[Axis];
+			Record.BoundsMax[Axis] = Upload.BoundsMax[Axis];
+		}
+		Record.FirstLod = static_cast<uint32_t>(AllLods.size());
+		Record.LodCount = static_cast<uint32_t>(Data.Lods.size());
+		Record.FirstMeshlet = static_cast<uint32_t>(AllMeshlets.size());
+		Record.MeshletCount = static_cast<uint32_t>(Data.Meshlets.size());
+		Record.FirstTextureRef = static_cast<uint32_t>(TextureRefs.size());
+		Record.TextureRefCount = static_cast<uint32_t>(Data.TextureRefs.size());
+		Record.SkinOffset = AllSkin.size() * sizeof(VertexSkin);
+		Record.Flags = Data.Skin.size() == Data.Vertices.size() && !Data.Skin.empty() ? MeshFlagSkinned : 0;
+		Record.Reserved = 0;
+		Records.push_back(Record);
+
+		if (Record.Flags & MeshFlagSkinned)
+		{
+			AllSkin.insert(AllSkin.end(), Data.Skin.begin(), Data.Skin.end());
+		}
+
+		// every mesh starts aligned so 16 bit index arrays of odd length never misalign the next mesh
+		const unsigned char* VertexData = static_cast<const unsigned char*>(Upload.Vertices);
+		const unsigned char* IndexData = static_cast<const unsigned char*>(Upload.Indices);
+		AllVertices.insert(AllVertices.end(), VertexData, VertexData + VertexBytes);
+		AllVertices.resize(AlignUp(AllVertices.size(), ChunkAlignment));
+		AllIndices.insert(AllIndices.end(), IndexData, IndexData + IndexBytes);
+		AllIndices.resize(AlignUp(AllIndices.size(), ChunkAlignment));
+		AllLods.insert(AllLods.end(), Data.Lods.begin(), Data.Lods.end());
+		AllMeshlets.insert(AllMeshlets.end(), Data.Meshlets.begin(), Data.Meshlets.end());
+
+		for (const MaterialTextureRef& Ref : Data.TextureRefs)
+		{
+			TextureRefRecord RefRecord;
+			RefRecord.TypeOffset = static_cast<uint32_t>(Strings.size());
+			Strings.append(Ref.Type).push_back('\0');
+			RefRecord.PathOffset = static_cast<uint32_t>(Strings.size());
+			Strings.append(Ref.Path).push_back('\0');
+			TextureRefs.push_back(RefRecord);
+		}
+	}
+
+	std::vector<BoneRecord> Bones;
+	std::vector<ClipRecord> Clips;
+	std::vector<AnimationTrack> Tracks;
+	std::vector<CompressedKey> Keys;
+	if (Animation)
+	{
+		const SkeletonData& Skeleton = Animation->Skeleton;
+		for (size_t Bone = 0; Bone < Skeleton.GetBoneCount(); Bone++)
+		{
+			const BoneTransform& Bind = Skeleton.BindPose[Bone];
+
+			BoneRecord BoneEntry;
+			BoneEntry.NameOffset = static_cast<uint32_t>(Strings.size());
+			Strings.append(Skeleton.BoneNames[Bone]).push_back('\0');
+			BoneEntry.Parent = Skeleton.Parents[Bone];
+			std::memcpy(BoneEntry.InverseBind, &Skeleton.InverseBindMatrices[Bone][0][0], sizeof(BoneEntry.InverseBind));
+			std::memcpy(BoneEntry.Rotation, &Bind.Rotation.x, sizeof(BoneEntry.Rotation));
+			std::memcpy(BoneEntry.Translation, &Bind.Translation.x, sizeof(BoneEntry.Translation));
+			std::memcpy(BoneEntry.Scale, &Bind.Scale.x, sizeof(BoneEntry.Scale));
+			Bones.push_back(BoneEntry);
+		}
+
+		for (const AnimationClip& Clip : Animation->Clips)
+		{
+			ClipRecord ClipEntry;
+			ClipEntry.NameOffset = static_cast<uint32_t>(Strings.size());
+			Strings.append(Clip.Name).push_back('\0');
+			ClipEntry.Duration = Clip.Duration;
+			ClipEntry.FirstTrack = static_cast<uint32_t>(Tracks.size());
+			ClipEntry.TrackCount = static_cast<uint32_t>(Clip.Tracks.size());
+			ClipEntry.FirstKey = static_cast<uint32_t>(Keys.size());
+			ClipEntry.KeyCount = static_cast<uint32_t>(Clip.Keys.size());
+			Clips.push_back(ClipEntry);
+
+			Tracks.insert(Tracks.end(), Clip.Tracks.begin(), Clip.Tracks.end());
+			Keys.insert(Keys.end(), Clip.Keys.begin(), Clip.Keys.end());
+		}
+	}
+
+	std::vector<unsigned char> DistanceFieldBytes;
+	if (DistanceField && !DistanceField->IsEmpty())
+	{
+		DistanceFieldRecord FieldRecord;
+		for (int Axis = 0; Axis < 3; Axis++)
+		{
+			FieldRecord.Resolution[Axis] = DistanceField->Resolution[Axis];
+			FieldRecord.BoundsMin[Axis] = DistanceField->BoundsMin[Axis];
+		}
+		FieldRecord.VoxelSize = DistanceField->VoxelSize;
+		FieldRecord.MaxDistance = DistanceField->MaxDistance;
+
+		const unsigned char* RecordData = reinterpret_cast<const unsigned char*>(&FieldRecord);
+		const unsigned char* VoxelData = reinterpret_cast<const unsigned char*>(DistanceField->Distances.data());
+		DistanceFieldBytes.insert(DistanceFieldBytes.end(), RecordData, RecordData + sizeof(FieldRecord));
+		DistanceFieldBytes.insert(DistanceFieldBytes.end(), VoxelData, VoxelData + DistanceField->Distances.size() * sizeof(int16_t));
+	}
+
+	const ChunkPayload Chunks[] =
+	{
+		{ ChunkMeshes, Records.data(), Records.size() * sizeof(MeshRecord) },
+		{ ChunkVertices, AllVertices.data(), AllVertices.size() },
+		{ ChunkIndices, AllIndices.data(), AllIndices.size() },
+		{ ChunkLods, AllLods.data(), AllLods.size() * sizeof(MeshLod) },
+		{ ChunkMeshlets, AllMeshlets.data(), AllMeshlets.size() * sizeof(Meshlet) },
+		{ ChunkTextures, TextureRefs.data(), TextureRefs.size() * sizeof(TextureRefRecord) },
+		{ ChunkStrings, Strings.data(), Strings.size() },
+		{ ChunkSkin, AllSkin.data(), AllSkin.size() * sizeof(VertexSkin) },
+		{ ChunkBones, Bones.data(), Bones.size() * sizeof(BoneRecord) },
+		{ ChunkClips, Clips.data(), Clips.size() * sizeof(ClipRecord) },
+		{ ChunkTracks, Tracks.data(), Tracks.size() * sizeof(AnimationTrack) },
+		{ ChunkKeys, Keys.data(), Keys.size() * sizeof(CompressedKey) },
+		{ ChunkDistanceField, DistanceFieldBytes.data(), DistanceFieldBytes.size() },
+	};
+	const uint32_t ChunkCount = sizeof(Chunks) / sizeof(Chunks[0]);
+
+	FileHeader Header;
+	Header.Magic = Magic;
+	Header.Version = Version;
+	Header.VertexStride = sizeof(Vertex);
+	Header.ChunkCount = ChunkCount;
+
+	std::vector<ChunkEntry> Table(ChunkCount);
+	uint64_t Offset = AlignUp(sizeof(FileHeader) + ChunkCount * sizeof(ChunkEntry), ChunkAlignment);
+	for (uint32_t i = 0; i < ChunkCount; i++)
+	{
+		Table[i].Id = Chunks[i].Id;
+		Table[i].Reserved = 0;
+		Table[i].Offset = Offset;
+		Table[i].Size = Chunks[i].Size;
+		Offset = AlignUp(Offset + Chunks[i].Size, ChunkAlignment);
+	}
+
+	std::ofstream File(FilePath, std::ios::binary | std::ios::trunc);
+	if (!File)
+	{
+		std::cout << "ERROR::COOKEDMESH::Could not open " << FilePath << " for writing" << std::endl;
+		return false;
+	}
+
+	static const char Padding[ChunkAlignment] = {};
+
+	File.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+	File.write(reinterpret_cast<const char*>(Table.data()), Table.size() * sizeof(ChunkEntry));
+
+	uint64_t Written = sizeof(FileHeader) + ChunkCount * sizeof(ChunkEntry);
+	for (uint32_t i = 0; i < ChunkCount; i++)
+	{
+		File.write(Padding, static_cast<std::streamsize>(Table[i].Offset - Written));
+		File.write(static_cast<const char*>(Chunks[i].Data), static_cast<std::streamsize>(Chunks[i].Size));
+		Written = Table[i].Offset + Chunks[i].Size;
+	}
+
+	return File.good();
+}
+
+bool CookedMeshFile::Open(const std::string& FilePath)
+{
+	Close();
+
+	if (!File.Open(FilePath))
+	{
+		return false;
+	}
+
+	if (File.GetSize() < sizeof(CookedMesh::FileHeader))
+	{
+		std::cout << "ERROR::COOKEDMESH::File is truncated: " << FilePath << std::endl;
+		Close();
+		return false;
+	}
+
+	const CookedMesh::FileHeader* Header = reinterpret_cast<const CookedMesh::FileHeader*>(File.GetData());
+	if (Header->Magic != CookedMesh::Magic || Header->Version != CookedMesh::Version || Header->VertexStride != sizeof(Vertex))
+	{
+		std::cout << "ERROR::COOKEDMESH::Unsupported file version, re-cook " << FilePath << std::endl;
+		Close();
+		return false;
+	}
+
+	uint64_t MeshesSize = 0, TextureRefsSize = 0;
+	Meshes = reinterpret_cast<const CookedMesh::MeshRecord*>(FindChunk(CookedMesh::ChunkMeshes, MeshesSize));
+	Vertices = FindChunk(CookedMesh::ChunkVertices, VerticesSize);
+	Indices = FindChunk(CookedMesh::ChunkIndices, IndicesSize);
+	Lods = reinterpret_cast<const MeshLod*>(FindChunk(CookedMesh::ChunkLods, LodsSize));
+	Meshlets = reinterpret_cast<const Meshlet*>(FindChunk(CookedMesh::ChunkMeshlets, MeshletsSize));
+	TextureRefs = reinterpret_cast<const CookedMesh::TextureRefRecord*>(FindChunk(CookedMesh::ChunkTextures, TextureRefsSize));
+	Strings = reinterpret_cast<const char*>(FindChunk(CookedMesh::ChunkStrings, StringsSize));
+	Skin = reinterpret_cast<const VertexSkin*>(FindChunk(CookedMesh::ChunkSkin, SkinSize));
+
+	if (!Meshes || !Vertices || !Indices)
+	{
+		std::cout << "ERROR::COOKEDMESH::Missing chunks in " << FilePath << std::endl;
+		Close();
+		return false;
+	}
+
+	MeshCount = static_cast<uint32_t>(MeshesSize / sizeof(CookedMesh::MeshRecord));
+	for (uint32_t i = 0; i < MeshCount; i++)
+	{
+		const CookedMesh::MeshRecord& Record = Meshes[i];
+		const EVertexFormat Format = static_cast<EVertexFormat>(Record.VertexFormat);
+		if (Record.VertexOffset + uint64_t(Record.VertexCount) * VertexFormat::GetVertexStride(Format) > VerticesSize
+			|| Record.IndexOffset + uint64_t(Record.IndexCount) * Record.IndexSize > IndicesSize
+			|| (uint64_t(Record.FirstLod) + Record.LodCount) * sizeof(MeshLod) > LodsSize
+			|| (uint64_t(Record.FirstMeshlet) + Record.MeshletCount) * sizeof(Meshlet) > MeshletsSize
+			|| ((Record.Flags & CookedMesh::MeshFlagSkinned) && Record.SkinOffset + uint64_t(Record.VertexCount) * sizeof(VertexSkin) > SkinSize))
+		{
+			std::cout << "ERROR::COOKEDMESH::Mesh " << i << " is out of bounds in " << FilePath << std::endl;
+			Close();
+			return false;
+		}
+	}
+	return true;
+}
+
+MeshUploadData CookedMeshFile::GetUploadData(const CookedMesh::MeshRecord& Record) const
+{
+	MeshUploadData Upload;
+	Upload.VertexFormat = static_cast<EVertexFormat>(Record.VertexFormat);
+	Upload.Vertices = Vertices + Record.VertexOffset;
+	Upload.VertexCount = Record.VertexCount;
+	Upload.Indices = Indices + Record.IndexOffset;
+	Upload.IndexCount = Record.IndexCount;
+	Upload.IndexSize = Record.IndexSize;
+	Upload.Quantisation.Offset = glm::vec3(Record.PositionOffset[0], Record.PositionOffset[1], Record.PositionOffset[2]);
+	Upload.Quantisation.Scale = glm::vec3(Record.PositionScale[0], Record.PositionScale[1], Record.PositionScale[2]);
+	Upload.BoundsMin = glm::vec3(Record.BoundsMin[0], Record.BoundsMin[1], Record.BoundsMin[2]);
+	Upload.BoundsMax = glm::vec3(Record.BoundsMax[0], Record.BoundsMax[1], Record.BoundsMax[2]);
+	Upload.Lods = Record.LodCount > 0 ? Lods + Record.FirstLod : nullptr;
+	Upload.LodCount = Record.LodCount;
+	Upload.Meshlets = Record.MeshletCount > 0 ? Meshlets + Record.FirstMeshlet : nullptr;
+	Upload.MeshletCount = Record.MeshletCount;
+	Upload.Skin = GetSkin(Record);
+	return Upload;
+}
+
+const VertexSkin* CookedMeshFile::GetSkin(const CookedMesh::MeshRecord& Record) const
+{
+	if (!(Record.Flags & CookedMesh::MeshFlagSkinned))
+	{
+		return nullptr;
+	}
+	return reinterpret_cast<const VertexSkin*>(reinterpret_cast<const unsigned char*>(Skin) + Record.SkinOffset);
+}
+
+bool CookedMeshFile::ReadAnimation(AnimationSet& OutAnimation) const
+{
+	OutAnimation = AnimationSet();
+
+	uint64_t BonesSize = 0, ClipsSize = 0, TracksSize = 0, KeysSize = 0;
+	const CookedMesh::BoneRecord* Bones = reinterpret_cast<const CookedMesh::BoneRecord*>(FindChunk(CookedMesh::ChunkBones, BonesSize));
+	const CookedMesh::ClipRecord* Clips = reinterpret_cast<const CookedMesh::ClipRecord*>(FindChunk(CookedMesh::ChunkClips, ClipsSize));
+	const AnimationTrack* Tracks = reinterpret_cast<const AnimationTrack*>(FindChunk(CookedMesh::ChunkTracks, TracksSize));
+	const CompressedKey* Keys = reinterpret_cast<const CompressedKey*>(FindChunk(CookedMesh::ChunkKeys, KeysSize));
+
+	const uint64_t BoneCount = BonesSize / sizeof(CookedMesh::BoneRecord);
+	const uint64_t ClipCount = ClipsSize / sizeof(CookedMesh::ClipRecord);
+	const uint64_t KeyCount = KeysSize / sizeof(CompressedKey);
+	if (BoneCount == 0)
+	{
+		return true;
+	}
+	if (BoneCount > SkeletonData::MaxBones)
+	{
+		std::cout << "ERROR::COOKEDMESH::Skeleton has " << BoneCount << " bones, at most " << SkeletonData::MaxBones << " are supported" << std::endl;
+		return false;
+	}
+
+	SkeletonData& Skeleton = OutAnimation.Skeleton;
+	for (uint64_t Bone = 0; Bone < BoneCount; Bone++)
+	{
+		const CookedMesh::BoneRecord& Record = Bones[Bone];
+		if (Record.NameOffset >= StringsSize || Record.Parent >= int32_t(Bone))
+		{
+			std::cout << "ERROR::COOKEDMESH::Bone " << Bone << " is out of bounds" << std::endl;
+			OutAnimation = AnimationSet();
+			return false;
+		}
+
+		BoneTransform Bind;
+		std::memcpy(&Bind.Rotation.x, Record.Rotation, sizeof(Record.Rotation));
+		Bind.Translation = glm::vec4(Record.Translation[0], Record.Translation[1], Record.Translation[2], 0.0f);
+		Bind.Scale = glm::vec4(Record.Scale[0], Record.Scale[1], Record.Scale[2], 0.0f);
+
+		glm::mat4 InverseBind;
+		std::memcpy(&InverseBind[0][0], Record.InverseBind, sizeof(Record.InverseBind));
+
+		Skeleton.BoneNames.push_back(GetString(Record.NameOffset));
+		Skeleton.Parents.push_back(std::max(Record.Parent, -1));
+		Skeleton.BindPose.push_back(Bind);
+		Skeleton.InverseBindMatrices.push_back(InverseBind);
+	}
+
+	for (uint64_t ClipIndex = 0; ClipIndex < ClipCount; ClipIndex++)
+	{
+		const CookedMesh::ClipRecord& Record = Clips[ClipIndex];
+		if (Record.NameOffset >= StringsSize
+			|| (uint64_t(Record.FirstTrack) + Record.TrackCount) * sizeof(AnimationTrack) > TracksSize
+			|| uint64_t(Record.FirstKey) + Record.KeyCount > KeyCount)
+		{
+			std::cout << "ERROR::COOKEDMESH::Clip " << ClipIndex << " is out of bounds" << std::endl;
+			OutAnimation = AnimationSet();
+			return false;
+		}
+
+		AnimationClip Clip;
+		Clip.Name = GetString(Record.NameOffset);
+		Clip.Duration = Record.Duration;
+		Clip.Tracks.assign(Tracks + Record.FirstTrack, Tracks + Record.FirstTrack + Record.TrackCount);
+		Clip.Keys.assign(Keys + Record.FirstKey, Keys + Record.FirstKey + Record.KeyCount);
+
+		for (const AnimationTrack& Track : Clip.Tracks)
+		{
+			const AnimationKeyRange* Ranges[] = { &Track.Translation, &Track.Rotation, &Track.Scale };
+			bool bValid = Track.Bone < BoneCount;
+			for (const AnimationKeyRange* Range : Ranges)
+			{
+				bValid = bValid && uint64_t(Range->First) + Range->Count <= Record.KeyCount;
+			}
+			if (!bValid)
+			{
+				std::cout << "ERROR::COOKEDMESH::Track of bone " << Track.Bone << " is out of bounds in clip " << Clip.Name << std::endl;
+				OutAnimation = AnimationSet();
+				return false;
+			}
+		}
+
+		OutAnimation.Clips.push_back(std::move(Clip));
+	}
+	return true;
+}
+
+bool CookedMeshFile::ReadDistanceField(DistanceFieldData& OutField) const
+{
+	OutField = DistanceFieldData();
+
+	uint64_t Size = 0;
+	const unsigned char* Data = FindChunk(CookedMesh::ChunkDistanceField, Size);
+	if (!Data || Size == 0)
+	{
+		return true;
+	}
+
+	CookedMesh::DistanceFieldRecord Record;
+	if (Size < sizeof(Record))
+	{
+		std::cout << "ERROR::COOKEDMESH::Distance field is truncated" << std::endl;
+		return false;
+	}
+	std::memcpy(&Record, Data, sizeof(Record));
+
+	const uint64_t VoxelCount = uint64_t(std::max(Record.Resolution[0], 0)) * std::max(Record.Resolution[1], 0) * std::max(Record.Resolution[2], 0);
+	if (VoxelCount == 0 || sizeof(Record) + VoxelCount * sizeof(int16_t) > Size)
+	{
+		std::cout << "ERROR::COOKEDMESH::Distance field of " << Record.Resolution[0] << "x" << Record.Resolution[1] << "x" << Record.Resolution[2]
+			<< " voxels is out of bounds" << std::endl;
+		return false;
+	}
+
+	OutField.Resolution = glm::ivec3(Record.Resolution[0], Record.Resolution[1], Record.Resolution[2]);
+	OutField.BoundsMin = glm::vec3(Record.BoundsMin[0], Record.BoundsMin[1], Record.BoundsMin[2]);
+	OutField.VoxelSize = Record.VoxelSize;
+	OutField.MaxDistance = Record.MaxDistance;
+	OutField.Distances.resize(VoxelCount);
+	std::memcpy(OutField.Distances.data(), Data + sizeof(Record), VoxelCount * sizeof(int16_t));
+	return true;
+}
+
+void CookedMeshFile::Close()
+{
+	File.Close();
+
+	MeshCount = 0;
+	Meshes = nullptr;
+	Vertices = nullptr;
+	VerticesSize = 0;
+	Indices = nullptr;
+	IndicesSize = 0;
+	Lods = nullptr;
+	LodsSize = 0;
+	Meshlets = nullptr;
+	MeshletsSize = 0;
+	TextureRefs = nullptr;
+	Strings = nullptr;
+	StringsSize = 0;
+	Skin = nullptr;
+	SkinSize = 0;
+}
+
+const unsigned char* CookedMeshFile::FindChunk(uint32_t Id, uint64_t& OutSize) const
+{
+	const CookedMesh::FileHeader* Header = reinterpret_cast<const CookedMesh::FileHeader*>(File.GetData());
+	const uint64_t TableEnd = sizeof(CookedMesh::FileHeader) + uint64_t(Header->ChunkCount) * sizeof(CookedMesh::ChunkEntry);
+	if (TableEnd > File.GetSize())
+	{
+		return nullptr;
+	}
+
+	const CookedMesh::ChunkEntry* Table = reinterpret_cast<const CookedMesh::ChunkEntry*>(File.GetData() + sizeof(CookedMesh::FileHeader));
+	for (uint32_t i = 0; i < Header->ChunkCount; i++)
+	{
+		if (Table[i].Id == Id && Table[i].Offset + Table[i].Size <= File.GetSize())
+		{
+			OutSize = Table[i].Size;
+			return File.GetData() + Table[i].Offset;
+		}
+	}
+
+	OutSize = 0;
+	return nullptr;
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Engine/Animation/AnimationData.h"
+#include "Engine/Core/VirtualFileSystem.h"
+#include "DistanceField.h"
+#include "Mesh.h"
+
+// Cooked meshes (.cmesh) are written offline by CanaryCooker and hold the output of Model::ImportMeshData laid out
+// exactly as the GPU wants it. The file is a small header followed by a table of chunks, every chunk starts on a
+// 16 byte boundary so the vertex and index arrays can be passed to glBufferData straight out of the mapping.
+// Vertices and indices are stored already encoded (see VertexFormat.h), so each mesh records its own format.
+// Skinned models also carry their skin weights, skeleton and animation clips (see AnimationData.h), static ones a
+// signed distance field of the whole model (see DistanceField.h).
+namespace CookedMesh
+{
+	const uint32_t Magic = 0x48534D43; // "CMSH"
+	const uint32_t Version = 7;
+	const uint32_t ChunkAlignment = 16;
+
+	// Chunk identifiers (four character codes)
+	const uint32_t ChunkMeshes = 0x4853454D;   // "MESH" - MeshRecord array
+	const uint32_t ChunkVertices = 0x54524556; // "VERT" - encoded vertex arrays of all meshes
+	const uint32_t ChunkIndices = 0x58444E49;  // "INDX" - 16 or 32 bit index arrays, indices are local to each mesh
+	const uint32_t ChunkLods = 0x53444F4C;     // "LODS" - MeshLod array, index ranges are local to each mesh
+	const uint32_t ChunkMeshlets = 0x54454C4D; // "MLET" - Meshlet array, index ranges are local to each mesh
+	const uint32_t ChunkTextures = 0x46455254; // "TREF" - TextureRefRecord array
+	const uint32_t ChunkStrings = 0x53525453;  // "STRS" - null terminated strings referenced by offset
+	const uint32_t ChunkSkin = 0x4E494B53;     // "SKIN" - VertexSkin arrays of the skinned meshes
+	const uint32_t ChunkBones = 0x454E4F42;    // "BONE" - BoneRecord array, parents first
+	const uint32_t ChunkClips = 0x50494C43;    // "CLIP" - ClipRecord array
+	const uint32_t ChunkTracks = 0x4B435254;   // "TRCK" - AnimationTrack array, key ranges are local to each clip
+	const uint32_t ChunkKeys = 0x5359454B;     // "KEYS" - CompressedKey arrays of all clips
+	const uint32_t ChunkDistanceField = 0x46445344; // "DSDF" - DistanceFieldRecord followed by its int16 voxels
+
+	// MeshRecord::Flags
+	const uint32_t MeshFlagSkinned = 1; // VertexCount VertexSkin entries at SkinOffset
+
+	struct FileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t VertexStride; // sizeof(Vertex) at cook time, the file is rejected if this no longer matches
+		uint32_t ChunkCount;
+	};
+
+	struct ChunkEntry
+	{
+		uint32_t Id;
+		uint32_t Reserved;
+		uint64_t Offset;
+		uint64_t Size;
+	};
+
+	struct MeshRecord
+	{
+		uint64_t VertexOffset; // byte offsets into the vertex and index chunks, aligned to ChunkAlignment
+		uint64_t IndexOffset;
+		uint32_t VertexCount;
+		uint32_t IndexCount;
+		uint32_t VertexFormat; // EVertexFormat
+		uint32_t IndexSize;
+		float PositionOffset[3]; // VertexQuantisation for packed meshes
+		float PositionScale[3];
+		float BoundsMin[3];
+		float BoundsMax[3];
+		uint32_t FirstLod;
+		uint32_t LodCount;
+		uint32_t FirstMeshlet;
+		uint32_t MeshletCount;
+		uint32_t FirstTextureRef;
+		uint32_t TextureRefCount;
+		uint64_t SkinOffset; // byte offset into the skin chunk
+		uint32_t Flags;
+		uint32_t Reserved;
+	};
+
+	struct TextureRefRecord
+	{
+		uint32_t TypeOffset; // offsets into the string chunk
+		uint32_t PathOffset;
+	};
+
+	struct BoneRecord
+	{
+		uint32_t NameOffset;
+		int32_t Parent;
+		float InverseBind[16];
+		float Rotation[4]; // bind pose, x y z w
+		float Translation[3];
+		float Scale[3];
+	};
+
+	struct DistanceFieldRecord
+	{
+		int32_t Resolution[3];
+		float BoundsMin[3];
+		float VoxelSize;
+		float MaxDistance;
+	};
+
+	struct ClipRecord
+	{
+		uint32_t NameOffset;
+		float Duration;
+		uint32_t FirstTrack;
+		uint32_t TrackCount;
+		uint32_t FirstKey; // into the key time and value chunks
+		uint32_t KeyCount;
+	};
+
+	// Returns the path the cooker writes the cooked version of a source model to
+	std::string GetCookedPath(const std::string& SourcePath);
+
+	// Serialises imported mesh data into a cooked mesh file, encoding vertices in the preferred format where possible.
+	// Animation may be null or empty for static models, DistanceField null or empty for models without one.
+	bool Write(const std::string& FilePath, const std::vector<MeshData>& Meshes, EVertexFormat PreferredFormat = EVertexFormat::Packed,
+		const AnimationSet* Animation = nullptr, const DistanceFieldData* DistanceField = nullptr);
+}
+
+// Read-only view over a .cmesh opened through the VirtualFileSystem (a mapping unless it was compressed in a pak).
+// All pointers point into the file's data and are only valid while it is open.
+class CookedMeshFile
+{
+public:
+	bool Open(const std::string& FilePath);
+	void Close();
+
+	uint32_t GetMeshCount() const { return MeshCount; }
+	const CookedMesh::MeshRecord& GetMesh(uint32_t Index) const { return Meshes[Index]; }
+
+	// Describes the mesh's vertex, index and skin ranges inside the mapping, ready for Mesh to upload
+	MeshUploadData GetUploadData(const CookedMesh::MeshRecord& Record) const;
+
+	const CookedMesh::TextureRefRecord& GetTextureRef(uint32_t Index) const { return TextureRefs[Index]; }
+	const char* GetString(uint32_t Offset) const { return Strings + Offset; }
+
+	// Skin weights of a skinned mesh, nullptr for a static one
+	const VertexSkin* GetSkin(const CookedMesh::MeshRecord& Record) const;
+
+	// Copies the skeleton and clips out of the file, OutAnimation is left empty for a static model. Returns false if
+	// the animation chunks are inconsistent.
+	bool ReadAnimation(AnimationSet& OutAnimation) const;
+
+	// Copies the distance field out of the file, OutField is left empty when the model has none. Returns false if the
+	// chunk is inconsistent.
+	bool ReadDistanceField(DistanceFieldData& OutField) const;
+
+private:
+	// Returns the chunk with the given id or nullptr, OutSize receives its size in bytes
+	const unsigned char* FindChunk(uint32_t Id, uint64_t& OutSize) const;
+
+	VirtualFile File;
+
+	uint32_t MeshCount = 0;
+	const CookedMesh::MeshRecord* Meshes = nullptr;
+	const unsigned char* Vertices = nullptr;
+	uint64_t VerticesSize = 0;
+	const unsigned char* Indices = nullptr;
+	uint64_t IndicesSize = 0;
+	const MeshLod* Lods = nullptr;
+	uint64_t LodsSize = 0;
+	const Meshlet* Meshlets = nullptr;
+	uint64_t MeshletsSize = 0;
+	const CookedMesh::TextureRefRecord* TextureRefs = nullptr;
+	const char* Strings = nullptr;
+	uint64_t StringsSize = 0;
+	const VertexSkin* Skin = nullptr;
+	uint64_t SkinSize = 0;
+};
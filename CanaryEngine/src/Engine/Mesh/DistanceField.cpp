@@ -0,0 +1,459 @@
+#include "DistanceField.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Engine/Core/SimdMath.h"
+#include "Engine/Core/ThreadPool.h"
+
+namespace
+{
+	struct Triangle
+	{
+		glm::vec3 A;
+		glm::vec3 B;
+		glm::vec3 C;
+	};
+
+	// Four triangles in structure of arrays layout with everything the distance test needs precomputed, lanes past
+	// a leaf's last triangle repeat it. [Axis][Lane] throughout.
+	struct TrianglePacket
+	{
+		float A[3][4];
+		float Edges[3][3][4];       // B - A, C - B, A - C
+		float EdgeNormals[3][3][4]; // cross(Edge, Normal), pointing into the triangle
+		float Normal[3][4];         // cross(B - A, A - C)
+		float InvEdgeLengths2[3][4];
+		float InvNormalLength2[4];
+	};
+
+	struct BvhNode
+	{
+		glm::vec3 Min;
+		uint32_t First; // a leaf's packet, an inner node's first child (the second follows it)
+		glm::vec3 Max;
+		uint32_t Count; // triangles in a leaf, 0 for inner nodes
+	};
+
+	// Small offsets of the sign rays from the voxel centers, in voxels, so a ray through a row of voxels does not run
+	// exactly along the edges of axis aligned geometry and count the crossing on both triangles of the edge
+	const float RayJitterU = 0.0137f;
+	const float RayJitterV = 0.0291f;
+
+	float GetBoxDistanceSquared(const BvhNode& Node, const glm::vec3& Point)
+	{
+		const glm::vec3 Outside = glm::max(glm::max(Node.Min - Point, Point - Node.Max), glm::vec3(0.0f));
+		return glm::dot(Outside, Outside);
+	}
+
+	// Squared distances from Point to the four triangles of a packet (Quilez's branchless point-triangle distance:
+	// the distance to the plane when the point projects inside all three edges, to the nearest edge otherwise)
+	void GetDistancesSquared(const TrianglePacket& Packet, const glm::vec3& Point, float OutDistances[4])
+	{
+#if CANARY_SIMD_SSE
+		struct Vec3x4
+		{
+			__m128 V[3];
+		};
+		auto Load = [](const float Source[3][4])
+		{
+			Vec3x4 Result = { { _mm_loadu_ps(Source[0]), _mm_loadu_ps(Source[1]), _mm_loadu_ps(Source[2]) } };
+			return Result;
+		};
+		auto Dot = [](const Vec3x4& A, const Vec3x4& B)
+		{
+			return _mm_add_ps(_mm_add_ps(_mm_mul_ps(A.V[0], B.V[0]), _mm_mul_ps(A.V[1], B.V[1])), _mm_mul_ps(A.V[2], B.V[2]));
+		};
+
+		const Vec3x4 A = Load(Packet.A);
+		Vec3x4 ToPoint[3];
+		for (int Axis = 0; Axis < 3; Axis++)
+		{
+			ToPoint[0].V[Axis] = _mm_sub_ps(_mm_set1_ps(Point[Axis]), A.V[Axis]);
+			ToPoint[1].V[Axis] = _mm_sub_ps(ToPoint[0].V[Axis], _mm_loadu_ps(Packet.Edges[0][Axis])); // P - B
+			ToPoint[2].V[Axis] = _mm_add_ps(ToPoint[0].V[Axis], _mm_loadu_ps(Packet.Edges[2][Axis])); // P - C
+		}
+
+		const __m128 Zero = _mm_setzero_ps();
+		const __m128 One = _mm_set1_ps(1.0f);
+		__m128 Inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		__m128 EdgeDistance = _mm_set1_ps(std::numeric_limits<float>::max());
+		for (int Edge = 0; Edge < 3; Edge++)
+		{
+			const Vec3x4 EdgeVector = Load(Packet.Edges[Edge]);
+			Inside = _mm_and_ps(Inside, _mm_cmpge_ps(Dot(Load(Packet.EdgeNormals[Edge]), ToPoint[Edge]), Zero));
+
+			const __m128 T = _mm_min_ps(_mm_max_ps(_mm_mul_ps(Dot(EdgeVector, ToPoint[Edge]), _mm_loadu_ps(Packet.InvEdgeLengths2[Edge])), Zero), One);
+			Vec3x4 Offset;
+			for (int Axis = 0; Axis < 3; Axis++)
+			{
+				Offset.V[Axis] = _mm_sub_ps(_mm_mul_ps(EdgeVector.V[Axis], T), ToPoint[Edge].V[Axis]);
+			}
+			EdgeDistance = _mm_min_ps(EdgeDistance, Dot(Offset, Offset));
+		}
+
+		const __m128 PlaneDot = Dot(Load(Packet.Normal), ToPoint[0]);
+		const __m128 PlaneDistance = _mm_mul_ps(_mm_mul_ps(PlaneDot, PlaneDot), _mm_loadu_ps(Packet.InvNormalLength2));
+		_mm_storeu_ps(OutDistances, _mm_or_ps(_mm_and_ps(Inside, PlaneDistance), _mm_andnot_ps(Inside, EdgeDistance)));
+#else
+		for (int Lane = 0; Lane < 4; Lane++)
+		{
+			auto Get = [Lane](const float Source[3][4]) { return glm::vec3(Source[0][Lane], Source[1][Lane], Source[2][Lane]); };
+
+			glm::vec3 ToPoint[3];
+			ToPoint[0] = Point - Get(Packet.A);
+			ToPoint[1] = ToPoint[0] - Get(Packet.Edges[0]);
+			ToPoint[2] = ToPoint[0] + Get(Packet.Edges[2]);
+
+			bool bInside = true;
+			float EdgeDistance = std::numeric_limits<float>::max();
+			for (int Edge = 0; Edge < 3; Edge++)
+			{
+				const glm::vec3 EdgeVector = Get(Packet.Edges[Edge]);
+				bInside = bInside && glm::dot(Get(Packet.EdgeNormals[Edge]), ToPoint[Edge]) >= 0.0f;
+
+				const float T = glm::clamp(glm::dot(EdgeVector, ToPoint[Edge]) * Packet.InvEdgeLengths2[Edge][Lane], 0.0f, 1.0f);
+				const glm::vec3 Offset = EdgeVector * T - ToPoint[Edge];
+				EdgeDistance = std::min(EdgeDistance, glm::dot(Offset, Offset));
+			}
+
+			const float PlaneDot = glm::dot(Get(Packet.Normal), ToPoint[0]);
+			OutDistances[Lane] = bInside ? PlaneDot * PlaneDot * Packet.InvNormalLength2[Lane] : EdgeDistance;
+		}
+#endif
+	}
+
+	// Median split on the longest axis of the centroids, leaves hold up to LeafTriangles triangles
+	class TriangleBvh
+	{
+	public:
+		// Reorders Triangles
+		void Build(std::vector<Triangle>& Triangles)
+		{
+			Nodes.clear();
+			Packets.clear();
+			LeafTriangles.clear();
+			if (Triangles.empty())
+			{
+				return;
+			}
+
+			Nodes.reserve(Triangles.size() / DistanceFieldBuilder::LeafTriangles * 2 + 1);
+			Nodes.emplace_back();
+			BuildNode(0, Triangles, 0, Triangles.size());
+		}
+
+		// Squared distance to the nearest triangle closer than BestSquared, BestSquared itself when there is none
+		float FindNearest(const glm::vec3& Point, float BestSquared) const
+		{
+			if (Nodes.empty())
+			{
+				return BestSquared;
+			}
+
+			uint32_t Stack[64];
+			int StackSize = 0;
+			Stack[StackSize++] = 0;
+			while (StackSize > 0)
+			{
+				const BvhNode& Node = Nodes[Stack[--StackSize]];
+				if (GetBoxDistanceSquared(Node, Point) >= BestSquared)
+				{
+					continue;
+				}
+
+				if (Node.Count > 0)
+				{
+					float Distances[4];
+					GetDistancesSquared(Packets[Node.First], Point, Distances);
+					BestSquared = std::min(BestSquared, std::min(std::min(Distances[0], Distances[1]), std::min(Distances[2], Distances[3])));
+					continue;
+				}
+
+				// the nearer child goes on top so it is searched first and tightens the bound for the other one
+				const float Left = GetBoxDistanceSquared(Nodes[Node.First], Point);
+				const float Right = GetBoxDistanceSquared(Nodes[Node.First + 1], Point);
+				const uint32_t Near = Left <= Right ? Node.First : Node.First + 1;
+				const uint32_t Far = Left <= Right ? Node.First + 1 : Node.First;
+				if (std::max(Left, Right) < BestSquared)
+				{
+					Stack[StackSize++] = Far;
+				}
+				if (std::min(Left, Right) < BestSquared)
+				{
+					Stack[StackSize++] = Near;
+				}
+			}
+			return BestSquared;
+		}
+
+		// Appends where the line through Point along Axis crosses a triangle, as coordinates on that axis
+		void CollectCrossings(int Axis, const glm::vec3& Point, std::vector<float>& OutCrossings) const
+		{
+			if (Nodes.empty())
+			{
+				return;
+			}
+
+			const int U = (Axis + 1) % 3;
+			const int V = (Axis + 2) % 3;
+			uint32_t Stack[64];
+			int StackSize = 0;
+			Stack[StackSize++] = 0;
+			while (StackSize > 0)
+			{
+				const BvhNode& Node = Nodes[Stack[--StackSize]];
+				if (Point[U] < Node.Min[U] || Point[U] > Node.Max[U] || Point[V] < Node.Min[V] || Point[V] > Node.Max[V])
+				{
+					continue;
+				}
+				if (Node.Count == 0)
+				{
+					Stack[StackSize++] = Node.First;
+					Stack[StackSize++] = Node.First + 1;
+					continue;
+				}
+
+				for (uint32_t i = 0; i < Node.Count; i++)
+				{
+					// barycentric coordinates of the point in the triangle projected along the axis
+					const Triangle& Current = LeafTriangles[Node.First * DistanceFieldBuilder::LeafTriangles + i];
+					const glm::vec2 P(Point[U], Point[V]);
+					const glm::vec2 A(Current.A[U], Current.A[V]);
+					const glm::vec2 B(Current.B[U], Current.B[V]);
+					const glm::vec2 C(Current.C[U], Current.C[V]);
+					const float Area = Cross(B - A, C - A);
+					if (Area == 0.0f)
+					{
+						continue;
+					}
+
+					const float WeightA = Cross(B - P, C - P) / Area;
+					const float WeightB = Cross(C - P, A - P) / Area;
+					const float WeightC = 1.0f - WeightA - WeightB;
+					if (WeightA >= 0.0f && WeightB >= 0.0f && WeightC >= 0.0f)
+					{
+						OutCrossings.push_back(WeightA * Current.A[Axis] + WeightB * Current.B[Axis] + WeightC * Current.C[Axis]);
+					}
+				}
+			}
+		}
+
+	private:
+		static float Cross(const glm::vec2& A, const glm::vec2& B)
+		{
+			return A.x * B.y - A.y * B.x;
+		}
+
+		void BuildNode(uint32_t NodeIndex, std::vector<Triangle>& Triangles, size_t First, size_t Count)
+		{
+			glm::vec3 Min(std::numeric_limits<float>::max());
+			glm::vec3 Max(-std::numeric_limits<float>::max());
+			glm::vec3 CentroidMin = Min;
+			glm::vec3 CentroidMax = Max;
+			for (size_t i = First; i < First + Count; i++)
+			{
+				const Triangle& Current = Triangles[i];
+				Min = glm::min(Min, glm::min(Current.A, glm::min(Current.B, Current.C)));
+				Max = glm::max(Max, glm::max(Current.A, glm::max(Current.B, Current.C)));
+				const glm::vec3 Centroid = (Current.A + Current.B + Current.C) / 3.0f;
+				CentroidMin = glm::min(CentroidMin, Centroid);
+				CentroidMax = glm::max(CentroidMax, Centroid);
+			}
+			Nodes[NodeIndex].Min = Min;
+			Nodes[NodeIndex].Max = Max;
+
+			if (Count <= DistanceFieldBuilder::LeafTriangles)
+			{
+				Nodes[NodeIndex].First = static_cast<uint32_t>(Packets.size());
+				Nodes[NodeIndex].Count = static_cast<uint32_t>(Count);
+				AddPacket(Triangles, First, Count);
+				return;
+			}
+
+			const glm::vec3 Extent = CentroidMax - CentroidMin;
+			const int Axis = Extent.x >= Extent.y && Extent.x >= Extent.z ? 0 : (Extent.y >= Extent.z ? 1 : 2);
+			const size_t Middle = First + Count / 2;
+			std::nth_element(Triangles.begin() + First, Triangles.begin() + Middle, Triangles.begin() + First + Count,
+				[Axis](const Triangle& Left, const Triangle& Right)
+			{
+				return Left.A[Axis] + Left.B[Axis] + Left.C[Axis] < Right.A[Axis] + Right.B[Axis] + Right.C[Axis];
+			});
+
+			const uint32_t Children = static_cast<uint32_t>(Nodes.size());
+			Nodes[NodeIndex].First = Children;
+			Nodes[NodeIndex].Count = 0;
+			Nodes.emplace_back();
+			Nodes.emplace_back();
+			BuildNode(Children, Triangles, First, Middle - First);
+			BuildNode(Children + 1, Triangles, Middle, First + Count - Middle);
+		}
+
+		void AddPacket(const std::vector<Triangle>& Triangles, size_t First, size_t Count)
+		{
+			TrianglePacket Packet;
+			for (size_t Lane = 0; Lane < DistanceFieldBuilder::LeafTriangles; Lane++)
+			{
+				const Triangle& Current = Triangles[First + std::min(Lane, Count - 1)];
+				LeafTriangles.push_back(Current);
+
+				const glm::vec3 Edges[3] = { Current.B - Current.A, Current.C - Current.B, Current.A - Current.C };
+				const glm::vec3 Normal = glm::cross(Edges[0], Edges[2]);
+				for (int Axis = 0; Axis < 3; Axis++)
+				{
+					Packet.A[Axis][Lane] = Current.A[Axis];
+					Packet.Normal[Axis][Lane] = Normal[Axis];
+				}
+				for (int Edge = 0; Edge < 3; Edge++)
+				{
+					const glm::vec3 EdgeNormal = glm::cross(Edges[Edge], Normal);
+					for (int Axis = 0; Axis < 3; Axis++)
+					{
+						Packet.Edges[Edge][Axis][Lane] = Edges[Edge][Axis];
+						Packet.EdgeNormals[Edge][Axis][Lane] = EdgeNormal[Axis];
+					}
+					Packet.InvEdgeLengths2[Edge][Lane] = 1.0f / glm::dot(Edges[Edge], Edges[Edge]);
+				}
+				Packet.InvNormalLength2[Lane] = 1.0f / glm::dot(Normal, Normal);
+			}
+			Packets.push_back(Packet);
+		}
+
+		std::vector<BvhNode> Nodes;
+		std::vector<TrianglePacket> Packets;
+		std::vector<Triangle> LeafTriangles; // LeafTriangles per packet, padded the same way
+	};
+}
+
+float DistanceFieldData::Sample(const glm::vec3& Position) const
+{
+	if (IsEmpty())
+	{
+		return MaxDistance;
+	}
+
+	const glm::vec3 Local = glm::clamp((Position - BoundsMin) / VoxelSize - 0.5f, glm::vec3(0.0f), glm::vec3(Resolution - 1));
+	const glm::ivec3 Low = glm::ivec3(Local);
+	const glm::ivec3 High = glm::min(Low + 1, Resolution - 1);
+	const glm::vec3 T = Local - glm::vec3(Low);
+
+	const float X00 = glm::mix(GetDistance(Low.x, Low.y, Low.z), GetDistance(High.x, Low.y, Low.z), T.x);
+	const float X10 = glm::mix(GetDistance(Low.x, High.y, Low.z), GetDistance(High.x, High.y, Low.z), T.x);
+	const float X01 = glm::mix(GetDistance(Low.x, Low.y, High.z), GetDistance(High.x, Low.y, High.z), T.x);
+	const float X11 = glm::mix(GetDistance(Low.x, High.y, High.z), GetDistance(High.x, High.y, High.z), T.x);
+	return glm::mix(glm::mix(X00, X10, T.y), glm::mix(X01, X11, T.y), T.z);
+}
+
+bool DistanceFieldBuilder::Build(const std::vector<MeshData>& Meshes, DistanceFieldData& OutField, const DistanceFieldSettings& Settings)
+{
+	OutField = DistanceFieldData();
+
+	// degenerate triangles have no plane to measure against, their edges are shared with the triangles around them
+	std::vector<Triangle> Triangles;
+	glm::vec3 BoundsMin(std::numeric_limits<float>::max());
+	glm::vec3 BoundsMax(-std::numeric_limits<float>::max());
+	for (const MeshData& Data : Meshes)
+	{
+		const size_t IndexCount = Data.Lods.empty() ? Data.Indices.size() : Data.Lods[0].IndexCount;
+		for (size_t i = 0; i + 2 < IndexCount; i += 3)
+		{
+			const Triangle Current = { Data.Vertices[Data.Indices[i]].Position, Data.Vertices[Data.Indices[i + 1]].Position,
+				Data.Vertices[Data.Indices[i + 2]].Position };
+			const glm::vec3 Normal = glm::cross(Current.B - Current.A, Current.A - Current.C);
+			if (!(glm::dot(Normal, Normal) > 0.0f))
+			{
+				continue;
+			}
+			Triangles.push_back(Current);
+			BoundsMin = glm::min(BoundsMin, glm::min(Current.A, glm::min(Current.B, Current.C)));
+			BoundsMax = glm::max(BoundsMax, glm::max(Current.A, glm::max(Current.B, Current.C)));
+		}
+	}
+	if (Triangles.empty())
+	{
+		return false;
+	}
+
+	// cubic voxels, the longest axis gets the requested resolution including the padding
+	const glm::vec3 Extent = BoundsMax - BoundsMin;
+	const unsigned int Padding = std::min(Settings.Padding, std::max(Settings.Resolution, 3u) / 3);
+	const unsigned int InnerVoxels = std::max(Settings.Resolution, 3u) - 2 * Padding;
+	const float LongestAxis = std::max(Extent.x, std::max(Extent.y, Extent.z));
+	OutField.VoxelSize = LongestAxis > 0.0f ? LongestAxis / InnerVoxels : 1.0f;
+	for (int Axis = 0; Axis < 3; Axis++)
+	{
+		const int Inner = std::max(1, static_cast<int>(std::ceil(Extent[Axis] / OutField.VoxelSize)));
+		OutField.Resolution[Axis] = Inner + 2 * static_cast<int>(Padding);
+
+		// the bounds sit in the middle, what the rounding up added is split between both sides
+		OutField.BoundsMin[Axis] = (BoundsMin[Axis] + BoundsMax[Axis]) * 0.5f - OutField.Resolution[Axis] * OutField.VoxelSize * 0.5f;
+	}
+	OutField.MaxDistance = glm::length(glm::vec3(OutField.Resolution)) * OutField.VoxelSize;
+
+	TriangleBvh Bvh;
+	Bvh.Build(Triangles);
+
+	const glm::ivec3 Resolution = OutField.Resolution;
+	const size_t VoxelCount = size_t(Resolution.x) * Resolution.y * Resolution.z;
+	auto GetVoxelCenter = [&OutField](const glm::ivec3& Voxel)
+	{
+		return OutField.BoundsMin + (glm::vec3(Voxel) + 0.5f) * OutField.VoxelSize;
+	};
+	auto GetVoxelIndex = [&Resolution](const glm::ivec3& Voxel)
+	{
+		return (size_t(Voxel.z) * Resolution.y + Voxel.y) * Resolution.x + Voxel.x;
+	};
+
+	// sign: one ray per row of voxels along each axis, every voxel is written by exactly one row per axis
+	std::vector<uint8_t> InsideVotes(VoxelCount, 0);
+	for (int Axis = 0; Axis < 3; Axis++)
+	{
+		const int U = (Axis + 1) % 3;
+		const int V = (Axis + 2) % 3;
+		ThreadPool::Get().ParallelFor(size_t(Resolution[U]) * Resolution[V], [&](size_t Row)
+		{
+			glm::ivec3 Voxel(0);
+			Voxel[U] = static_cast<int>(Row % Resolution[U]);
+			Voxel[V] = static_cast<int>(Row / Resolution[U]);
+
+			glm::vec3 Origin = GetVoxelCenter(Voxel);
+			Origin[U] += RayJitterU * OutField.VoxelSize;
+			Origin[V] += RayJitterV * OutField.VoxelSize;
+
+			std::vector<float> Crossings;
+			Bvh.CollectCrossings(Axis, Origin, Crossings);
+			std::sort(Crossings.begin(), Crossings.end());
+
+			size_t Passed = 0;
+			for (Voxel[Axis] = 0; Voxel[Axis] < Resolution[Axis]; Voxel[Axis]++)
+			{
+				const float Coordinate = GetVoxelCenter(Voxel)[Axis];
+				while (Passed < Crossings.size() && Crossings[Passed] < Coordinate)
+				{
+					Passed++;
+				}
+				InsideVotes[GetVoxelIndex(Voxel)] += Passed & 1;
+			}
+		});
+	}
+
+	// distance: rows along X, each voxel is at most one voxel further from the surface than the one before it
+	OutField.Distances.resize(VoxelCount);
+	ThreadPool::Get().ParallelFor(size_t(Resolution.y) * Resolution.z, [&](size_t Row)
+	{
+		glm::ivec3 Voxel(0, static_cast<int>(Row % Resolution.y), static_cast<int>(Row / Resolution.y));
+		float Previous = std::numeric_limits<float>::max();
+		for (; Voxel.x < Resolution.x; Voxel.x++)
+		{
+			const float Bound = Voxel.x > 0 ? (Previous + OutField.VoxelSize) * 1.001f : std::sqrt(std::numeric_limits<float>::max());
+			const float Distance = std::sqrt(Bvh.FindNearest(GetVoxelCenter(Voxel), Bound * Bound));
+			Previous = Distance;
+
+			const size_t Index = GetVoxelIndex(Voxel);
+			const float Signed = InsideVotes[Index] >= 2 ? -Distance : Distance;
+			OutField.Distances[Index] = static_cast<int16_t>(std::lround(glm::clamp(Signed / OutField.MaxDistance, -1.0f, 1.0f) * 32767.0f));
+		}
+	});
+	return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+
+// Low resolution signed distance volume of a whole model in model space, for ambient occlusion, soft shadows and
+// collision queries that would otherwise trace triangles. Voxels store the distance from their center to the nearest
+// triangle, negative inside the surface, as snorm16 of MaxDistance. X varies fastest, then Y, then Z.
+struct DistanceFieldData
+{
+	glm::ivec3 Resolution = glm::ivec3(0);
+	glm::vec3 BoundsMin = glm::vec3(0.0f); // corner of the first voxel
+	float VoxelSize = 0.0f;
+	float MaxDistance = 0.0f;
+	std::vector<int16_t> Distances;
+
+	bool IsEmpty() const { return Distances.empty(); }
+
+	glm::vec3 GetBoundsMax() const { return BoundsMin + glm::vec3(Resolution) * VoxelSize; }
+
+	float GetDistance(int X, int Y, int Z) const
+	{
+		return Distances[(size_t(Z) * Resolution.y + Y) * Resolution.x + X] * (MaxDistance / 32767.0f);
+	}
+
+	// Trilinear filtered distance at a model space position, positions outside the volume read its border
+	float Sample(const glm::vec3& Position) const;
+};
+
+struct DistanceFieldSettings
+{
+	// Voxels along the longest axis of the model's bounds, the other axes get as many as keep the voxels cubic
+	unsigned int Resolution = 32;
+
+	// Voxels added around the bounds on every side so the field falls off outside the surface too
+	unsigned int Padding = 2;
+};
+
+// Cook-time generation of DistanceFieldData from imported meshes. Triangles go into a BVH whose leaves hold up to
+// four of them, laid out so one SSE pass computes the distance to all four (the branchless point-triangle distance,
+// falling back to scalar code without SSE). Voxels are swept row by row on the thread pool: each voxel searches the
+// BVH nearest child first and starts from the previous voxel's distance plus one voxel, which prunes most of the
+// tree. The sign comes from the same rows: a ray along each axis through every row counts surface crossings, and a
+// voxel is inside when at least two of the three axes see it inside, so small holes in open meshes only flip the
+// voxels where the rays happen to pass through them.
+namespace DistanceFieldBuilder
+{
+	// Triangles per BVH leaf, one SIMD packet
+	const unsigned int LeafTriangles = 4;
+
+	// Builds the field of the LOD 0 triangles of every mesh, OutField is left empty when there are none
+	bool Build(const std::vector<MeshData>& Meshes, DistanceFieldData& OutField, const DistanceFieldSettings& Settings = DistanceFieldSettings());
+}
@@ -2,27 +2,324 @@
 
 #include <glad/glad.h> // Holds all OpenGL type declarations
 
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include <glm/gtc/packing.hpp>
+
+#include "Engine/Renderer/GLStateCache.h"
+#include "Engine/Renderer/RenderStats.h"
+#include "Engine/Renderer/RenderView.h"
 #include "Engine/Shader/ShaderProgram.h"
+#include "Engine/Texture/TextureAtlas.h"
+#include "Engine/Texture/TextureResidency.h"
+#include "Engine/Texture/VirtualTextureSystem.h"
+
+namespace
+{
+    void ReadVertex(const MeshUploadData& InData, uint32_t Index, glm::vec3& OutPosition, glm::vec2& OutTexCoords)
+    {
+        if (InData.VertexFormat == EVertexFormat::Packed)
+        {
+            const PackedVertex& Packed = static_cast<const PackedVertex*>(InData.Vertices)[Index];
+            const glm::vec3 Quantised = glm::vec3(Packed.Position[0], Packed.Position[1], Packed.Position[2]) / 65535.0f;
+            OutPosition = InData.Quantisation.Offset + Quantised * InData.Quantisation.Scale;
+            OutTexCoords = glm::vec2(glm::unpackHalf1x16(Packed.TexCoords[0]), glm::unpackHalf1x16(Packed.TexCoords[1]));
+        }
+        else
+        {
+            const Vertex& Full = static_cast<const Vertex*>(InData.Vertices)[Index];
+            OutPosition = Full.Position;
+            OutTexCoords = Full.TexCoords;
+        }
+    }
+
+    // Texture coordinate units per model space unit over LOD 0, from the ratio of the triangles' areas in both spaces
+    float ComputeTexCoordDensity(const MeshUploadData& InData)
+    {
+        const size_t FirstIndex = InData.LodCount > 0 ? InData.Lods[0].FirstIndex : 0;
+        const size_t EndIndex = InData.LodCount > 0 ? std::min<size_t>(FirstIndex + InData.Lods[0].IndexCount, InData.IndexCount) : InData.IndexCount;
+
+        double ModelArea = 0.0;
+        double TexCoordArea = 0.0;
+        for (size_t i = FirstIndex; i + 3 <= EndIndex; i += 3)
+        {
+            glm::vec3 Positions[3];
+            glm::vec2 TexCoords[3];
+            for (uint32_t Corner = 0; Corner < 3; Corner++)
+            {
+                const uint32_t Index = InData.IndexSize == 2 ? static_cast<const uint16_t*>(InData.Indices)[i + Corner]
+                    : static_cast<const uint32_t*>(InData.Indices)[i + Corner];
+                ReadVertex(InData, Index, Positions[Corner], TexCoords[Corner]);
+            }
+
+            ModelArea += glm::length(glm::cross(Positions[1] - Positions[0], Positions[2] - Positions[0]));
+            const glm::vec2 EdgeA = TexCoords[1] - TexCoords[0];
+            const glm::vec2 EdgeB = TexCoords[2] - TexCoords[0];
+            TexCoordArea += std::abs(EdgeA.x * EdgeB.y - EdgeA.y * EdgeB.x);
+        }
+
+        return ModelArea > 0.0 ? static_cast<float>(std::sqrt(TexCoordArea / ModelArea)) : 0.0f;
+    }
+}
+
+EVertexFormat Mesh::PreferredVertexFormat = EVertexFormat::Packed;
+bool Mesh::bRetainCpuGeometry = true;
 
 Mesh::Mesh(std::vector<Vertex> InVertices, std::vector<unsigned int> InIndices, std::vector<Texture> InTextures)
+    : Vertices(std::move(InVertices))
+    , Indices(std::move(InIndices))
+    , Textures(std::move(InTextures))
+{
+    SetupFromCpuGeometry(Vertices, Indices, nullptr);
+    if (!bRetainCpuGeometry)
+    {
+        ReleaseCpuGeometry();
+    }
+}
+
+Mesh::Mesh(const MeshData& InData, std::vector<Texture> InTextures)
+    : Textures(std::move(InTextures))
+{
+    // encoded straight from the imported arrays, they are only copied when the mesh keeps them
+    SetupFromCpuGeometry(InData.Vertices, InData.Indices, &InData);
+    if (bRetainCpuGeometry)
+    {
+        Vertices = InData.Vertices;
+        Indices = InData.Indices;
+    }
+}
+
+Mesh::Mesh(MeshData&& InData, std::vector<Texture> InTextures)
+    : Textures(std::move(InTextures))
+{
+    SetupFromCpuGeometry(InData.Vertices, InData.Indices, &InData);
+    if (bRetainCpuGeometry)
+    {
+        Vertices = std::move(InData.Vertices);
+        Indices = std::move(InData.Indices);
+    }
+}
+
+Mesh::Mesh(const MeshUploadData& InData, std::vector<Texture> InTextures)
+    : Textures(std::move(InTextures))
+{
+    SetupMesh(InData);
+}
+
+Mesh::~Mesh()
+{
+    ReleaseGpuResources();
+}
+
+Mesh::Mesh(Mesh&& Other) noexcept
+{
+    *this = std::move(Other);
+}
+
+Mesh& Mesh::operator=(Mesh&& Other) noexcept
+{
+    if (this == &Other)
+    {
+        return *this;
+    }
+
+    ReleaseGpuResources();
+
+    Vertices = std::move(Other.Vertices);
+    Indices = std::move(Other.Indices);
+    Textures = std::move(Other.Textures);
+    VAO = Other.VAO;
+    VBO = Other.VBO;
+    EBO = Other.EBO;
+    SkinVBO = Other.SkinVBO;
+    GpuBytes = Other.GpuBytes;
+    IndexSize = Other.IndexSize;
+    IndexType = Other.IndexType;
+    Lods = std::move(Other.Lods);
+    Meshlets = std::move(Other.Meshlets);
+    BoundsCenter = Other.BoundsCenter;
+    BoundsRadius = Other.BoundsRadius;
+    TexCoordDensity = Other.TexCoordDensity;
+    Format = Other.Format;
+    Quantisation = Other.Quantisation;
+
+    // the moved-from mesh no longer owns the GL objects
+    Other.VAO = Other.VBO = Other.EBO = Other.SkinVBO = 0;
+    Other.GpuBytes = 0;
+    return *this;
+}
+
+void Mesh::ReleaseCpuGeometry()
 {
-	Vertices = InVertices;
-	Indices = InIndices;
-	Textures = InTextures;
+    std::vector<Vertex>().swap(Vertices);
+    std::vector<unsigned int>().swap(Indices);
+}
+
+void Mesh::SetupFromCpuGeometry(const std::vector<Vertex>& InVertices, const std::vector<unsigned int>& InIndices, const MeshData* InData)
+{
+    EncodedMesh Encoded;
+    VertexFormat::Encode(InVertices, InIndices, PreferredVertexFormat, Encoded);
+    if (InData)
+    {
+        Encoded.Upload.Lods = InData->Lods.data();
+        Encoded.Upload.LodCount = InData->Lods.size();
+        Encoded.Upload.Meshlets = InData->Meshlets.data();
+        Encoded.Upload.MeshletCount = InData->Meshlets.size();
+        Encoded.Upload.Skin = InData->Skin.size() == InVertices.size() && !InData->Skin.empty() ? InData->Skin.data() : nullptr;
+    }
+    SetupMesh(Encoded.Upload);
+}
+
+void Mesh::Draw(ShaderProgram& Shader, unsigned int LodIndex)
+{
+    BindForDraw(Shader);
+
+    const MeshLod& Lod = Lods[LodIndex];
+    DrawRange(Lod.FirstIndex, Lod.IndexCount);
+}
+
+void Mesh::SetRigidSkinAttributes()
+{
+    glVertexAttribI4ui(3, 0, 0, 0, 0);
+    glVertexAttrib4f(4, 0.0f, 0.0f, 0.0f, 0.0f);
+}
+
+void Mesh::DrawInstanced(ShaderProgram& Shader, unsigned int LodIndex, unsigned int FirstInstance, unsigned int InstanceCount)
+{
+    BindForDraw(Shader);
+    Shader.SetInt("InstanceOffset", static_cast<int>(FirstInstance));
+
+    const MeshLod& Lod = Lods[LodIndex];
+    glDrawElementsInstanced(GL_TRIANGLES, Lod.IndexCount, IndexType, (void*)(size_t(Lod.FirstIndex) * IndexSize), InstanceCount);
 
-    SetupMesh();
+    RenderStats& Stats = RenderStats::Get();
+    Stats.DrawCalls++;
+    Stats.TrianglesDrawn += Lod.IndexCount / 3 * InstanceCount;
 }
 
-void Mesh::Draw(ShaderProgram& Shader)
+void Mesh::DrawMeshlets(ShaderProgram& Shader, const glm::mat4& ModelMatrix, const RenderView& View)
 {
+    // bounds are in model space, the cone test is only valid while the transform scales uniformly
+    const glm::vec3 AxisScale(glm::length(glm::vec3(ModelMatrix[0])), glm::length(glm::vec3(ModelMatrix[1])), glm::length(glm::vec3(ModelMatrix[2])));
+    const float MaxScale = std::max(AxisScale.x, std::max(AxisScale.y, AxisScale.z));
+    const float MinScale = std::min(AxisScale.x, std::min(AxisScale.y, AxisScale.z));
+    const bool bConeCulling = MinScale > MaxScale * 0.99f;
+    const glm::mat3 Rotation = glm::mat3(ModelMatrix) * (1.0f / MaxScale);
+
+    BindForDraw(Shader);
+
+    RenderStats& Stats = RenderStats::Get();
+    uint32_t RangeStart = 0, RangeCount = 0;
+    for (const Meshlet& Cluster : Meshlets)
+    {
+        const glm::vec3 Center = glm::vec3(ModelMatrix * glm::vec4(Cluster.Center, 1.0f));
+        const float Radius = Cluster.Radius * MaxScale;
+
+        bool bVisible = View.ViewFrustum.IntersectsSphere(Center, Radius);
+        if (bVisible && bConeCulling && Cluster.ConeCutoff < 1.0f)
+        {
+            const glm::vec3 ToCluster = Center - View.CameraPosition;
+            bVisible = glm::dot(ToCluster, Rotation * Cluster.ConeAxis) < Cluster.ConeCutoff * glm::length(ToCluster) + Radius;
+        }
+
+        if (!bVisible)
+        {
+            Stats.ClustersCulled++;
+            continue;
+        }
+
+        // meshlets are consecutive in the index buffer, so visible neighbours extend the current range
+        if (RangeCount > 0 && RangeStart + RangeCount == Cluster.FirstIndex)
+        {
+            RangeCount += Cluster.IndexCount;
+        }
+        else
+        {
+            if (RangeCount > 0)
+            {
+                DrawRange(RangeStart, RangeCount);
+            }
+            RangeStart = Cluster.FirstIndex;
+            RangeCount = Cluster.IndexCount;
+        }
+        Stats.ClustersDrawn++;
+    }
+    if (RangeCount > 0)
+    {
+        DrawRange(RangeStart, RangeCount);
+    }
+}
+
+void Mesh::ReleaseGpuResources()
+{
+    // moved-from meshes own nothing and may be destroyed after the GL context is gone
+    if (VAO == 0 && VBO == 0 && EBO == 0 && SkinVBO == 0)
+    {
+        return;
+    }
+
+    GLStateCache& StateCache = GLStateCache::Get();
+    StateCache.DeleteVertexArrays(1, &VAO);
+    StateCache.DeleteBuffers(1, &VBO);
+    StateCache.DeleteBuffers(1, &EBO);
+    if (SkinVBO != 0)
+    {
+        StateCache.DeleteBuffers(1, &SkinVBO);
+    }
+    VAO = VBO = EBO = SkinVBO = 0;
+    GpuBytes = 0;
+}
+
+void Mesh::RequestTextureDetail(float PixelsPerUnit) const
+{
+    // without a known screen size, or for meshes without texture coordinates, this asks for full resolution
+    const float TexCoordsPerPixel = PixelsPerUnit > 0.0f ? TexCoordDensity / PixelsPerUnit : 0.0f;
+    for (const Texture& MeshTexture : Textures)
+    {
+        // atlas arrays are small and always resident, virtual textures get their detail from the feedback pass
+        if (MeshTexture.AtlasLayer < 0.0f && MeshTexture.VirtualTexture < 0)
+        {
+            TextureResidency::Get().MarkUsed(MeshTexture.ID, TexCoordsPerPixel);
+        }
+    }
+}
+
+void Mesh::BindForDraw(ShaderProgram& Shader)
+{
+    RenderStats& Stats = RenderStats::Get();
+    GLStateCache& StateCache = GLStateCache::Get();
+
+    // slots without an atlased texture sample their own texture_*1 sampler
+    bool bDiffuseAtlas = false;
+    bool bDiffuseVirtual = false;
+
     unsigned int DiffuseNum = 1;
     unsigned int SpecularNum = 1;
     for (unsigned int i = 0; i < Textures.size(); i++)
     {
-        glActiveTexture(GL_TEXTURE0 + i); // activate proper texture unit before binding
+        std::string Name = Textures[i].Type;
+        if (Textures[i].VirtualTexture >= 0)
+        {
+            VirtualTextureSystem::Get().Bind(Textures[i].VirtualTexture, Shader);
+            bDiffuseVirtual = true;
+            continue;
+        }
+        if (Textures[i].AtlasLayer >= 0.0f)
+        {
+            // the array stays bound to its unit across draws, only the rect and layer change per mesh
+            const unsigned int Unit = TextureAtlas::GetTextureUnit(Name);
+            TextureAtlas::Get().Bind(Textures[i].ID, Unit);
+            Shader.SetInt(Name + "_atlas", Unit);
+            Shader.SetVec4(Name + "_atlas_rect", Textures[i].AtlasRect);
+            Shader.SetFloat(Name + "_atlas_layer", Textures[i].AtlasLayer);
+            bDiffuseAtlas |= Name == "texture_diffuse";
+            continue;
+        }
+
         // retrieve texture number (the N in diffuse_textureN)
         std::string Number;
-        std::string Name = Textures[i].Type;
         if (Name == "texture_diffuse")
             Number = std::to_string(DiffuseNum++);
         else if (Name == "texture_specular")
@@ -30,20 +327,76 @@ void Mesh::Draw(ShaderProgram& Shader)
 
         // now set the sampler to the correct texture unit
         glUniform1i(glGetUniformLocation(Shader.ID, (Name + Number).c_str()), i);
-        glBindTexture(GL_TEXTURE_2D, Textures[i].ID);
+        // the cache skips the bind, and the unit switch before it, when a previous draw left the texture there
+        if (StateCache.BindTexture(i, GL_TEXTURE_2D, Textures[i].ID))
+        {
+            Stats.TextureBinds++;
+        }
     }
 
-    // Draw mesh
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, Indices.size(), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    // the array sampler always points at its own unit, sharing a unit with a sampler2D is an error even when the
+    // shader does not sample it. The shader has no specular maps, so only the diffuse slot has an atlas sampler.
+    if (!bDiffuseAtlas)
+    {
+        Shader.SetInt("texture_diffuse_atlas", TextureAtlas::GetTextureUnit("texture_diffuse"));
+        Shader.SetFloat("texture_diffuse_atlas_layer", -1.0f);
+    }
+    if (!bDiffuseVirtual)
+    {
+        VirtualTextureSystem::BindNone(Shader);
+    }
+
+    // packed vertices are decoded in the vertex shader, see VertexFormat.h
+    Shader.SetBool("bPackedVertices", Format == EVertexFormat::Packed);
+    if (Format == EVertexFormat::Packed)
+    {
+        Shader.SetVec3("PositionOffset", Quantisation.Offset);
+        Shader.SetVec3("PositionScale", Quantisation.Scale);
+    }
 
-    // always good practice to set everything back to defaults once configured.
-    glActiveTexture(GL_TEXTURE0);
+    // left bound after the draw, the next mesh's bind replaces it and draws of the same mesh skip it
+    StateCache.BindVertexArray(VAO);
 }
 
-void Mesh::SetupMesh()
+void Mesh::DrawRange(uint32_t FirstIndex, uint32_t IndexCount)
 {
+    glDrawElements(GL_TRIANGLES, IndexCount, IndexType, (void*)(size_t(FirstIndex) * IndexSize));
+
+    RenderStats& Stats = RenderStats::Get();
+    Stats.DrawCalls++;
+    Stats.TrianglesDrawn += IndexCount / 3;
+}
+
+void Mesh::SetupMesh(const MeshUploadData& InData)
+{
+    IndexSize = InData.IndexSize;
+    IndexType = InData.IndexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    Format = InData.VertexFormat;
+    Quantisation = InData.Quantisation;
+
+    BoundsCenter = (InData.BoundsMin + InData.BoundsMax) * 0.5f;
+    BoundsRadius = glm::length(InData.BoundsMax - InData.BoundsMin) * 0.5f;
+    TexCoordDensity = ComputeTexCoordDensity(InData);
+
+    if (InData.LodCount > 0)
+    {
+        Lods.assign(InData.Lods, InData.Lods + InData.LodCount);
+    }
+    else
+    {
+        MeshLod FullMesh;
+        FullMesh.IndexCount = static_cast<uint32_t>(InData.IndexCount);
+        Lods.push_back(FullMesh);
+    }
+
+    Meshlets.assign(InData.Meshlets, InData.Meshlets + InData.MeshletCount);
+
+    GpuBytes = InData.VertexCount * VertexFormat::GetVertexStride(InData.VertexFormat) + InData.IndexCount * InData.IndexSize;
+    if (InData.Skin)
+    {
+        GpuBytes += InData.VertexCount * sizeof(VertexSkin);
+    }
+
     //////////////////////////////////////
     // VERTEX ARAY OBJECT (VBO)         //
     /////////////////////////////////////
@@ -62,19 +415,20 @@ void Mesh::SetupMesh()
     // or current so that any operations you perform apply to that object.
     // bind the Vertex Array Object first, then bind and set vertex buffer(s), and then configure vertex attributes(s).
 
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    GLStateCache& StateCache = GLStateCache::Get();
+    StateCache.BindVertexArray(VAO);
+    StateCache.BindBuffer(GL_ARRAY_BUFFER, VBO);
 
     // In this case, we are specifying the target of the buffer (GL_ARRAY_BUFFER), the size of the data (in bytes),
     // The actual data (our array of vertices) and a usage hint telling OpenGL that the data will not change often
-    glBufferData(GL_ARRAY_BUFFER, Vertices.size() * sizeof(Vertex), &Vertices[0], GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, InData.VertexCount * VertexFormat::GetVertexStride(InData.VertexFormat), InData.Vertices, GL_STATIC_DRAW);
 
     // An EBO is a buffer, just like a vertex buffer object, that stores indices that OpenGL uses to decide what vertices to draw.
     // If we want to draw a square using two triangles. Instead of defining each corner of the square multiple times,
     // we can define each corner once and then use indices to refer to these corners.
     // This makes our program more memory efficient as we dont need to repeat vertex data for vertices that are shared between shapes.
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, Indices.size() * sizeof(unsigned int), &Indices[0], GL_STATIC_DRAW);
+    StateCache.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, InData.IndexCount * InData.IndexSize, InData.Indices, GL_STATIC_DRAW);
     
     // glVertexAttribPointer defines how OpenGL should interpret the vertex data stored in a Vertex Buffer Object (VBO).
 
@@ -93,15 +447,42 @@ void Mesh::SetupMesh()
 
     // (void*)0): This parameter is the offset within the buffer where this attribute begins.
 
-    // vertex positions
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    // vertex normals
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-    // vertex texture coords
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-
-    glBindVertexArray(0);
+    if (InData.VertexFormat == EVertexFormat::Packed)
+    {
+        // quantised positions and octahedral normals are normalized integers, so the shader sees them in [0, 1] / [-1, 1]
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, TexCoords));
+    }
+    else
+    {
+        // vertex positions
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        // vertex normals
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        // vertex texture coords
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+    }
+
+    if (InData.Skin)
+    {
+        // bone indices stay integers (note the I in glVertexAttribIPointer), weights are normalized to [0, 1]
+        glGenBuffers(1, &SkinVBO);
+        StateCache.BindBuffer(GL_ARRAY_BUFFER, SkinVBO);
+        glBufferData(GL_ARRAY_BUFFER, InData.VertexCount * sizeof(VertexSkin), InData.Skin, GL_STATIC_DRAW);
+
+        glEnableVertexAttribArray(3);
+        glVertexAttribIPointer(3, 4, GL_UNSIGNED_BYTE, sizeof(VertexSkin), (void*)offsetof(VertexSkin, Bones));
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(VertexSkin), (void*)offsetof(VertexSkin, Weights));
+    }
+
+    // unbound so element array binds made for other purposes cannot land in this VAO
+    StateCache.BindVertexArray(0);
 }
\ No newline at end of file
@@ -1,11 +1,16 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <glm/glm.hpp>
 
+#include "VertexFormat.h"
+
 class ShaderProgram;
+struct RenderView;
 
 struct Vertex {
     glm::vec3 Position;
@@ -13,20 +18,136 @@ struct Vertex {
     glm::vec2 TexCoords;
 };
 
+// Up to four bone influences of a skinned vertex. Indices refer to the model's skeleton (see AnimationData.h),
+// weights are unorm8 summing to 255 and sorted from strongest to weakest, unused influences have weight 0.
+// Skinned meshes upload these as a second vertex stream next to their Vertex or PackedVertex buffer (attributes 3
+// and 4 of SkinnedVertexShader.vert), so static meshes do not pay for them.
+struct VertexSkin {
+    uint8_t Bones[4];
+    uint8_t Weights[4];
+};
+
 struct Texture {
     unsigned int ID;
     std::string Type;
     std::string Path;  // we store the path of the texture to compare with other textures
+
+    // Textures packed into the material atlas (see TextureAtlas.h): ID is the array texture, the layer and rect
+    // locate the texture inside it. -1 for a texture of its own.
+    float AtlasLayer = -1.0f;
+    glm::vec4 AtlasRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+
+    // Index into VirtualTextureSystem for textures streamed page by page, ID is unused then. -1 otherwise.
+    int VirtualTexture = -1;
 };
 
+// A texture referenced by a mesh's material before it has been loaded
+struct MaterialTextureRef {
+    std::string Type;
+    std::string Path;
+};
+
+// Content hashes of texture files by the path Model::LoadMaterialTextures acquires them through, computed away from
+// the GL thread so AssetRegistry::AcquireTexture does not read the files there
+using TextureContentHashes = std::unordered_map<std::string, uint64_t>;
+
+// CPU side geometry produced by the importer, independent of any GL state so it can be cooked offline
+struct MeshData {
+    std::vector<Vertex> Vertices;
+    std::vector<unsigned int> Indices; // LOD 0 followed by the simplified LODs, if any
+    std::vector<MeshLod> Lods;         // empty until MeshSimplifier::BuildLodChain has run
+    std::vector<Meshlet> Meshlets;     // clusters of LOD 0, empty until MeshletBuilder::BuildMeshlets has run
+    std::vector<MaterialTextureRef> TextureRefs;
+    std::vector<VertexSkin> Skin;      // one per vertex for skinned meshes, empty otherwise
+};
+
+// Owns its VAO and buffers and deletes them when destroyed, so it can be moved but not copied. Textures belong to
+// the asset registry, which releases them together with the model's meshes.
 class Mesh
 {
 public:
     Mesh(std::vector<Vertex> InVertices, std::vector<unsigned int> InIndices, std::vector<Texture> InTextures);
 
-    void Draw(ShaderProgram& Shader);
+    // Uploads imported data including its LOD chain. The rvalue version takes the vertices and indices over instead
+    // of copying them when the CPU geometry is kept.
+    Mesh(const MeshData& InData, std::vector<Texture> InTextures);
+    Mesh(MeshData&& InData, std::vector<Texture> InTextures);
+
+    // Uploads already encoded data directly without keeping a CPU copy (used for memory mapped cooked meshes)
+    Mesh(const MeshUploadData& InData, std::vector<Texture> InTextures);
+
+    ~Mesh();
+
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+    Mesh(Mesh&& Other) noexcept;
+    Mesh& operator=(Mesh&& Other) noexcept;
+
+    void Draw(ShaderProgram& Shader, unsigned int LodIndex = 0);
+
+    // Draws LOD 0 cluster by cluster, skipping meshlets outside the frustum or facing away from the camera.
+    // Neighbouring visible meshlets are merged into one glDrawElements range.
+    void DrawMeshlets(ShaderProgram& Shader, const glm::mat4& ModelMatrix, const RenderView& View);
+
+    // Draws InstanceCount instances of the LOD in one call. The shader reads each instance's data at
+    // InstanceOffset + gl_InstanceID, InstanceOffset being set to FirstInstance here.
+    void DrawInstanced(ShaderProgram& Shader, unsigned int LodIndex, unsigned int FirstInstance, unsigned int InstanceCount);
+
+    bool HasMeshlets() const { return !Meshlets.empty(); }
+
+    // Skinned meshes have bone indices and weights per vertex and are drawn with SkinnedVertexShader.vert
+    bool IsSkinned() const { return SkinVBO != 0; }
+
+    // A mesh without a skin stream reads the current generic values of the skin attributes, this sets them to no
+    // weights, which SkinnedVertexShader.vert leaves in mesh space. The values are context state and undefined after
+    // a draw with the skin arrays enabled, so it is called before every such mesh drawn with the skinned shader.
+    static void SetRigidSkinAttributes();
+
+    // Memory held in vertex/index buffers and in the CPU side copy of the geometry
+    size_t GetGpuBytes() const { return GpuBytes; }
+    size_t GetCpuBytes() const { return Vertices.size() * sizeof(Vertex) + Indices.size() * sizeof(unsigned int); }
+
+    // CPU side copy of the geometry the mesh was built from, empty for cooked meshes and once released
+    bool HasCpuGeometry() const { return !Vertices.empty(); }
+    const std::vector<Vertex>& GetVertices() const { return Vertices; }
+    const std::vector<unsigned int>& GetIndices() const { return Indices; }
+
+    // Frees the CPU side copy, drawing only needs the buffers and the bounds
+    void ReleaseCpuGeometry();
+
+    unsigned int GetLodCount() const { return static_cast<unsigned int>(Lods.size()); }
+    const MeshLod& GetLod(unsigned int LodIndex) const { return Lods[LodIndex]; }
+
+    // Bounding sphere in model space
+    const glm::vec3& GetBoundsCenter() const { return BoundsCenter; }
+    float GetBoundsRadius() const { return BoundsRadius; }
+
+    // Reports the mesh's textures to TextureResidency as drawn this frame. PixelsPerUnit is the screen size of one
+    // model space unit at the mesh's nearest point, 0 asks for full resolution.
+    void RequestTextureDetail(float PixelsPerUnit) const;
+
+    // Format used for meshes built from CPU vertices, meshes that cannot be packed still fall back to Float
+    static void SetPreferredVertexFormat(EVertexFormat InFormat) { PreferredVertexFormat = InFormat; }
+    static EVertexFormat GetPreferredVertexFormat() { return PreferredVertexFormat; }
+
+    // Whether meshes built from CPU vertices keep a copy of them after the upload (the default). Without it a model
+    // costs its geometry once on the GPU and nothing but bounds and LOD ranges in system memory.
+    static void SetRetainCpuGeometry(bool bInRetain) { bRetainCpuGeometry = bInRetain; }
+    static bool GetRetainCpuGeometry() { return bRetainCpuGeometry; }
 private:
-    void SetupMesh();
+    void SetupMesh(const MeshUploadData& InData);
+
+    // Encodes and uploads the geometry, LODs, meshlets and skin come from InData when given
+    void SetupFromCpuGeometry(const std::vector<Vertex>& InVertices, const std::vector<unsigned int>& InIndices, const MeshData* InData);
+
+    // Deletes the VAO and buffers, safe to call on a moved-from mesh
+    void ReleaseGpuResources();
+
+    void BindForDraw(ShaderProgram& Shader);
+    void DrawRange(uint32_t FirstIndex, uint32_t IndexCount);
+
+    static EVertexFormat PreferredVertexFormat;
+    static bool bRetainCpuGeometry;
 
     // mesh data
     std::vector<Vertex> Vertices;
@@ -34,5 +155,16 @@ private:
     std::vector<Texture> Textures;
 
     //  render data
-    unsigned int VAO, VBO, EBO;
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    unsigned int SkinVBO = 0;
+    size_t GpuBytes = 0;
+    unsigned int IndexSize = 4;
+    unsigned int IndexType = 0;
+    std::vector<MeshLod> Lods;
+    std::vector<Meshlet> Meshlets;
+    glm::vec3 BoundsCenter = glm::vec3(0.0f);
+    float BoundsRadius = 0.0f;
+    float TexCoordDensity = 0.0f; // texture coordinate units per model space unit
+    EVertexFormat Format = EVertexFormat::Float;
+    VertexQuantisation Quantisation;
 };
\ No newline at end of file
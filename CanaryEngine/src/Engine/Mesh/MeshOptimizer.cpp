@@ -0,0 +1,504 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+#include <glm/glm.hpp>
+
+#include "Engine/Core/ThreadPool.h"
+
+namespace
+{
+	const unsigned int InvalidIndex = 0xFFFFFFFFu;
+
+	// FIFO post-transform cache model using timestamps: a vertex is resident if it was inserted less than
+	// CacheSize misses ago
+	struct FifoCache
+	{
+		std::vector<unsigned int> Timestamps;
+		unsigned int Time;
+
+		explicit FifoCache(size_t VertexCount)
+			: Timestamps(VertexCount, 0), Time(MeshOptimizer::CacheSize + 1)
+		{
+		}
+
+		void Reset()
+		{
+			Time += MeshOptimizer::CacheSize + 1;
+		}
+
+		// Returns true on a cache miss
+		bool Access(unsigned int Index)
+		{
+			if (Time - Timestamps[Index] > MeshOptimizer::CacheSize)
+			{
+				Timestamps[Index] = Time++;
+				return true;
+			}
+			return false;
+		}
+	};
+
+	uint32_t HashVertex(const Vertex& InVertex)
+	{
+		// FNV-1a over the raw bytes, welding only merges bitwise identical vertices
+		const unsigned char* Bytes = reinterpret_cast<const unsigned char*>(&InVertex);
+		uint32_t Hash = 2166136261u;
+		for (size_t i = 0; i < sizeof(Vertex); i++)
+		{
+			Hash = (Hash ^ Bytes[i]) * 16777619u;
+		}
+		return Hash;
+	}
+
+	// Vertex to triangle adjacency in compressed form
+	struct TriangleAdjacency
+	{
+		std::vector<unsigned int> Offsets;   // VertexCount + 1 entries
+		std::vector<unsigned int> Triangles;
+
+		void Build(const std::vector<unsigned int>& Indices, size_t VertexCount)
+		{
+			Offsets.assign(VertexCount + 1, 0);
+			for (unsigned int Index : Indices)
+			{
+				Offsets[Index + 1]++;
+			}
+			for (size_t v = 0; v < VertexCount; v++)
+			{
+				Offsets[v + 1] += Offsets[v];
+			}
+
+			std::vector<unsigned int> Fill(Offsets.begin(), Offsets.end() - 1);
+			Triangles.resize(Indices.size());
+			for (size_t i = 0; i < Indices.size(); i++)
+			{
+				Triangles[Fill[Indices[i]]++] = static_cast<unsigned int>(i / 3);
+			}
+		}
+	};
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<unsigned int>& Indices, size_t VertexCount)
+{
+	VertexCacheStats Stats;
+	if (Indices.empty() || VertexCount == 0)
+	{
+		return Stats;
+	}
+
+	FifoCache Cache(VertexCount);
+	std::vector<char> Used(VertexCount, 0);
+
+	size_t Misses = 0, UniqueVertices = 0;
+	for (unsigned int Index : Indices)
+	{
+		Misses += Cache.Access(Index) ? 1 : 0;
+		if (!Used[Index])
+		{
+			Used[Index] = 1;
+			UniqueVertices++;
+		}
+	}
+
+	Stats.Acmr = static_cast<float>(Misses) / static_cast<float>(Indices.size() / 3);
+	Stats.Atvr = static_cast<float>(Misses) / static_cast<float>(UniqueVertices);
+	return Stats;
+}
+
+void MeshOptimizer::WeldVertices(MeshData& Data)
+{
+	const size_t VertexCount = Data.Vertices.size();
+
+	size_t TableSize = 64;
+	while (TableSize < VertexCount * 2)
+	{
+		TableSize *= 2;
+	}
+
+	std::vector<unsigned int> Table(TableSize, InvalidIndex);
+	std::vector<unsigned int> Remap(VertexCount);
+	std::vector<Vertex> Welded;
+	Welded.reserve(VertexCount);
+
+	// skinned vertices only weld when their influences match too
+	const bool bSkinned = !Data.Skin.empty();
+	std::vector<VertexSkin> WeldedSkin;
+	WeldedSkin.reserve(Data.Skin.size());
+
+	for (size_t v = 0; v < VertexCount; v++)
+	{
+		const Vertex& Current = Data.Vertices[v];
+		size_t Slot = HashVertex(Current) & (TableSize - 1);
+		for (;;)
+		{
+			const unsigned int Existing = Table[Slot];
+			if (Existing == InvalidIndex)
+			{
+				Table[Slot] = static_cast<unsigned int>(Welded.size());
+				Remap[v] = Table[Slot];
+				Welded.push_back(Current);
+				if (bSkinned)
+				{
+					WeldedSkin.push_back(Data.Skin[v]);
+				}
+				break;
+			}
+			if (std::memcmp(&Welded[Existing], &Current, sizeof(Vertex)) == 0
+				&& (!bSkinned || std::memcmp(&WeldedSkin[Existing], &Data.Skin[v], sizeof(VertexSkin)) == 0))
+			{
+				Remap[v] = Existing;
+				break;
+			}
+			Slot = (Slot + 1) & (TableSize - 1);
+		}
+	}
+
+	for (unsigned int& Index : Data.Indices)
+	{
+		Index = Remap[Index];
+	}
+	Data.Vertices.swap(Welded);
+	Data.Skin.swap(WeldedSkin);
+}
+
+std::vector<size_t> MeshOptimizer::OptimizeVertexCache(std::vector<unsigned int>& Indices, size_t VertexCount)
+{
+	std::vector<size_t> HardClusters;
+
+	const size_t TriangleCount = Indices.size() / 3;
+	if (TriangleCount == 0)
+	{
+		return HardClusters;
+	}
+
+	TriangleAdjacency Adjacency;
+	Adjacency.Build(Indices, VertexCount);
+
+	std::vector<unsigned int> LiveTriangles(VertexCount);
+	for (size_t v = 0; v < VertexCount; v++)
+	{
+		LiveTriangles[v] = Adjacency.Offsets[v + 1] - Adjacency.Offsets[v];
+	}
+
+	std::vector<unsigned int> CacheTime(VertexCount, 0);
+	std::vector<char> Emitted(TriangleCount, 0);
+	std::vector<unsigned int> DeadEndStack;
+	std::vector<unsigned int> Candidates;
+
+	std::vector<unsigned int> Output;
+	Output.reserve(Indices.size());
+
+	unsigned int Time = CacheSize + 1;
+	unsigned int ScanCursor = 0;
+
+	// first fanning vertex is the first vertex that is actually used
+	int Fanning = -1;
+	while (ScanCursor < VertexCount && LiveTriangles[ScanCursor] == 0)
+	{
+		ScanCursor++;
+	}
+	Fanning = ScanCursor < VertexCount ? static_cast<int>(ScanCursor) : -1;
+	HardClusters.push_back(0);
+
+	while (Fanning >= 0)
+	{
+		Candidates.clear();
+
+		// emit every remaining triangle around the fanning vertex
+		for (unsigned int a = Adjacency.Offsets[Fanning]; a < Adjacency.Offsets[Fanning + 1]; a++)
+		{
+			const unsigned int Triangle = Adjacency.Triangles[a];
+			if (Emitted[Triangle])
+			{
+				continue;
+			}
+
+			for (unsigned int Corner = 0; Corner < 3; Corner++)
+			{
+				const unsigned int Index = Indices[Triangle * 3 + Corner];
+				Output.push_back(Index);
+				DeadEndStack.push_back(Index);
+				Candidates.push_back(Index);
+				LiveTriangles[Index]--;
+
+				if (Time - CacheTime[Index] > CacheSize)
+				{
+					CacheTime[Index] = Time++;
+				}
+			}
+			Emitted[Triangle] = 1;
+		}
+
+		// pick the candidate that will still be in the cache after its remaining triangles are emitted
+		int Next = -1;
+		int BestPriority = -1;
+		for (unsigned int Candidate : Candidates)
+		{
+			if (LiveTriangles[Candidate] == 0)
+			{
+				continue;
+			}
+
+			int Priority = 0;
+			if (Time - CacheTime[Candidate] + 2 * LiveTriangles[Candidate] <= CacheSize)
+			{
+				Priority = static_cast<int>(Time - CacheTime[Candidate]);
+			}
+			if (Priority > BestPriority)
+			{
+				BestPriority = Priority;
+				Next = static_cast<int>(Candidate);
+			}
+		}
+
+		if (Next == -1)
+		{
+			// dead end: fall back to recently used vertices, then to a linear scan. Either way the fan is
+			// broken here which makes it a hard cluster boundary for the overdraw pass.
+			while (!DeadEndStack.empty() && Next == -1)
+			{
+				const unsigned int Candidate = DeadEndStack.back();
+				DeadEndStack.pop_back();
+				if (LiveTriangles[Candidate] > 0)
+				{
+					Next = static_cast<int>(Candidate);
+				}
+			}
+
+			while (Next == -1 && ScanCursor < VertexCount)
+			{
+				if (LiveTriangles[ScanCursor] > 0)
+				{
+					Next = static_cast<int>(ScanCursor);
+				}
+				ScanCursor++;
+			}
+
+			if (Next != -1 && Output.size() / 3 < TriangleCount)
+			{
+				HardClusters.push_back(Output.size() / 3);
+			}
+		}
+
+		Fanning = Next;
+	}
+
+	Indices.swap(Output);
+	return HardClusters;
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<unsigned int>& Indices, const std::vector<Vertex>& Vertices, const std::vector<size_t>& HardClusters)
+{
+	const size_t TriangleCount = Indices.size() / 3;
+	if (TriangleCount == 0 || HardClusters.empty())
+	{
+		return;
+	}
+
+	// split hard clusters into smaller soft clusters wherever the cache efficiency so far is already within the
+	// threshold of the whole cluster, so sorting them costs little vertex cache efficiency
+	std::vector<size_t> Clusters;
+	FifoCache Cache(Vertices.size());
+
+	for (size_t c = 0; c < HardClusters.size(); c++)
+	{
+		const size_t Start = HardClusters[c];
+		const size_t End = c + 1 < HardClusters.size() ? HardClusters[c + 1] : TriangleCount;
+
+		Cache.Reset();
+		size_t ClusterMisses = 0;
+		for (size_t t = Start * 3; t < End * 3; t++)
+		{
+			ClusterMisses += Cache.Access(Indices[t]) ? 1 : 0;
+		}
+		const float ClusterAcmr = static_cast<float>(ClusterMisses) / static_cast<float>(End - Start);
+
+		Clusters.push_back(Start);
+		Cache.Reset();
+
+		size_t SoftStart = Start;
+		size_t Misses = 0;
+		for (size_t t = Start; t < End; t++)
+		{
+			for (size_t Corner = 0; Corner < 3; Corner++)
+			{
+				Misses += Cache.Access(Indices[t * 3 + Corner]) ? 1 : 0;
+			}
+
+			const float RunningAcmr = static_cast<float>(Misses) / static_cast<float>(t - SoftStart + 1);
+			if (t + 1 < End && RunningAcmr <= ClusterAcmr * OverdrawThreshold)
+			{
+				Clusters.push_back(t + 1);
+				SoftStart = t + 1;
+				Misses = 0;
+				Cache.Reset();
+			}
+		}
+	}
+
+	// view independent overdraw metric: clusters facing away from the mesh centre are likely to occlude the
+	// rest, so draw them first
+	glm::vec3 MeshCentroid(0.0f);
+	float MeshArea = 0.0f;
+
+	struct ClusterSortKey
+	{
+		float Metric;
+		size_t Cluster;
+	};
+	std::vector<ClusterSortKey> Keys(Clusters.size());
+	std::vector<glm::vec3> ClusterCentroids(Clusters.size());
+	std::vector<glm::vec3> ClusterNormals(Clusters.size());
+
+	for (size_t c = 0; c < Clusters.size(); c++)
+	{
+		const size_t Start = Clusters[c];
+		const size_t End = c + 1 < Clusters.size() ? Clusters[c + 1] : TriangleCount;
+
+		glm::vec3 Centroid(0.0f), Normal(0.0f);
+		float Area = 0.0f;
+		for (size_t t = Start; t < End; t++)
+		{
+			const glm::vec3& P0 = Vertices[Indices[t * 3 + 0]].Position;
+			const glm::vec3& P1 = Vertices[Indices[t * 3 + 1]].Position;
+			const glm::vec3& P2 = Vertices[Indices[t * 3 + 2]].Position;
+
+			const glm::vec3 Cross = glm::cross(P1 - P0, P2 - P0);
+			const float TriangleArea = glm::length(Cross);
+
+			Centroid += (P0 + P1 + P2) * (TriangleArea / 3.0f);
+			Normal += Cross;
+			Area += TriangleArea;
+		}
+
+		MeshCentroid += Centroid;
+		MeshArea += Area;
+
+		ClusterCentroids[c] = Area > 0.0f ? Centroid / Area : Vertices[Indices[Start * 3]].Position;
+		const float NormalLength = glm::length(Normal);
+		ClusterNormals[c] = NormalLength > 0.0f ? Normal / NormalLength : glm::vec3(0.0f);
+	}
+
+	if (MeshArea > 0.0f)
+	{
+		MeshCentroid /= MeshArea;
+	}
+
+	for (size_t c = 0; c < Clusters.size(); c++)
+	{
+		Keys[c].Metric = glm::dot(ClusterCentroids[c] - MeshCentroid, ClusterNormals[c]);
+		Keys[c].Cluster = c;
+	}
+
+	std::stable_sort(Keys.begin(), Keys.end(), [](const ClusterSortKey& A, const ClusterSortKey& B) { return A.Metric > B.Metric; });
+
+	std::vector<unsigned int> Sorted;
+	Sorted.reserve(Indices.size());
+	for (const ClusterSortKey& Key : Keys)
+	{
+		const size_t Start = Clusters[Key.Cluster];
+		const size_t End = Key.Cluster + 1 < Clusters.size() ? Clusters[Key.Cluster + 1] : TriangleCount;
+		Sorted.insert(Sorted.end(), Indices.begin() + Start * 3, Indices.begin() + End * 3);
+	}
+
+	Indices.swap(Sorted);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(MeshData& Data)
+{
+	std::vector<unsigned int> Remap(Data.Vertices.size(), InvalidIndex);
+	std::vector<Vertex> Reordered;
+	Reordered.reserve(Data.Vertices.size());
+	std::vector<VertexSkin> ReorderedSkin;
+	ReorderedSkin.reserve(Data.Skin.size());
+
+	// vertices end up in the order the index buffer first references them, unreferenced ones are dropped
+	for (unsigned int& Index : Data.Indices)
+	{
+		if (Remap[Index] == InvalidIndex)
+		{
+			Remap[Index] = static_cast<unsigned int>(Reordered.size());
+			Reordered.push_back(Data.Vertices[Index]);
+			if (!Data.Skin.empty())
+			{
+				ReorderedSkin.push_back(Data.Skin[Index]);
+			}
+		}
+		Index = Remap[Index];
+	}
+
+	Data.Vertices.swap(Reordered);
+	Data.Skin.swap(ReorderedSkin);
+}
+
+MeshOptimizerStats MeshOptimizer::Optimize(MeshData& Data)
+{
+	MeshOptimizerStats Stats;
+	Stats.VerticesBefore = Data.Vertices.size();
+	Stats.Triangles = Data.Indices.size() / 3;
+	Stats.Before = AnalyzeVertexCache(Data.Indices, Data.Vertices.size());
+
+	if (!Data.Indices.empty())
+	{
+		WeldVertices(Data);
+		const std::vector<size_t> HardClusters = OptimizeVertexCache(Data.Indices, Data.Vertices.size());
+		OptimizeOverdraw(Data.Indices, Data.Vertices, HardClusters);
+		OptimizeVertexFetch(Data);
+	}
+
+	Stats.VerticesAfter = Data.Vertices.size();
+	Stats.After = AnalyzeVertexCache(Data.Indices, Data.Vertices.size());
+	return Stats;
+}
+
+MeshOptimizerStats MeshOptimizer::OptimizeMeshes(std::vector<MeshData>& Meshes)
+{
+	std::vector<MeshOptimizerStats> MeshStats(Meshes.size());
+	ThreadPool::Get().ParallelFor(Meshes.size(), [&](size_t Index)
+	{
+		MeshStats[Index] = Optimize(Meshes[Index]);
+	});
+
+	MeshOptimizerStats Total;
+	for (const MeshOptimizerStats& Stats : MeshStats)
+	{
+		const float Weight = static_cast<float>(Stats.Triangles);
+		Total.Before.Acmr += Stats.Before.Acmr * Weight;
+		Total.Before.Atvr += Stats.Before.Atvr * static_cast<float>(Stats.VerticesBefore);
+		Total.After.Acmr += Stats.After.Acmr * Weight;
+		Total.After.Atvr += Stats.After.Atvr * static_cast<float>(Stats.VerticesAfter);
+		Total.VerticesBefore += Stats.VerticesBefore;
+		Total.VerticesAfter += Stats.VerticesAfter;
+		Total.Triangles += Stats.Triangles;
+	}
+
+	if (Total.Triangles > 0)
+	{
+		Total.Before.Acmr /= static_cast<float>(Total.Triangles);
+		Total.After.Acmr /= static_cast<float>(Total.Triangles);
+	}
+	if (Total.VerticesBefore > 0)
+	{
+		Total.Before.Atvr /= static_cast<float>(Total.VerticesBefore);
+	}
+	if (Total.VerticesAfter > 0)
+	{
+		Total.After.Atvr /= static_cast<float>(Total.VerticesAfter);
+	}
+
+	return Total;
+}
+
+void MeshOptimizer::PrintStats(const std::string& Label, const MeshOptimizerStats& Stats)
+{
+	std::cout << std::fixed << std::setprecision(3)
+		<< "Optimised " << Label << ": " << Stats.Triangles << " triangles, vertices " << Stats.VerticesBefore << " -> " << Stats.VerticesAfter
+		<< ", ACMR " << Stats.Before.Acmr << " -> " << Stats.After.Acmr
+		<< ", ATVR " << Stats.Before.Atvr << " -> " << Stats.After.Atvr << std::endl;
+	std::cout.unsetf(std::ios::floatfield);
+}
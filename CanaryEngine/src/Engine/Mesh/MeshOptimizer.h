@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Mesh.h"
+
+// Post-transform cache efficiency of an index buffer, simulated with a FIFO cache of MeshOptimizer::CacheSize
+// entries. ACMR is cache misses per triangle (0.5 is the practical best, 3 the worst), ATVR is cache misses per
+// unique vertex (1 is ideal).
+struct VertexCacheStats
+{
+	float Acmr = 0.0f;
+	float Atvr = 0.0f;
+};
+
+struct MeshOptimizerStats
+{
+	VertexCacheStats Before;
+	VertexCacheStats After;
+
+	size_t VerticesBefore = 0;
+	size_t VerticesAfter = 0;
+	size_t Triangles = 0;
+};
+
+// Import-time optimisation of imported geometry, run on MeshData before it reaches the Mesh constructor (and before
+// it is cooked). The passes run in this order:
+//   1. weld bitwise identical vertices
+//   2. reorder triangles for the post-transform cache (Tipsify, Sander et al. 2007)
+//   3. split the result into clusters and sort them outside-in to reduce overdraw
+//   4. renumber vertices in first-use order for vertex fetch locality
+namespace MeshOptimizer
+{
+	const unsigned int CacheSize = 16;
+
+	// How much the overdraw pass may degrade the cache order, 1.05 allows 5% more misses inside a cluster
+	const float OverdrawThreshold = 1.05f;
+
+	VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& Indices, size_t VertexCount);
+
+	void WeldVertices(MeshData& Data);
+
+	// Returns the index of the first triangle of every hard cluster (a restart of the Tipsify fan)
+	std::vector<size_t> OptimizeVertexCache(std::vector<unsigned int>& Indices, size_t VertexCount);
+
+	void OptimizeOverdraw(std::vector<unsigned int>& Indices, const std::vector<Vertex>& Vertices, const std::vector<size_t>& HardClusters);
+
+	void OptimizeVertexFetch(MeshData& Data);
+
+	// Runs every pass on a single mesh
+	MeshOptimizerStats Optimize(MeshData& Data);
+
+	// Optimises every mesh on the thread pool and returns the combined statistics (triangle weighted)
+	MeshOptimizerStats OptimizeMeshes(std::vector<MeshData>& Meshes);
+
+	// Prints the before/after vertex count, ACMR and ATVR
+	void PrintStats(const std::string& Label, const MeshOptimizerStats& Stats);
+}
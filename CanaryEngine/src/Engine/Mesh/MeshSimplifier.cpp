@@ -0,0 +1,600 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+#include "Engine/Core/ThreadPool.h"
+#include "MeshOptimizer.h"
+
+namespace
+{
+	// Planes added along open borders are weighted up so borders keep their outline
+	const double BorderWeight = 10.0;
+
+	// A collapse is rejected if a surrounding triangle's normal turns by more than ~75 degrees
+	const float MinNormalDot = 0.25f;
+
+	const unsigned int MaxPasses = 64;
+
+	enum class EVertexKind : unsigned char
+	{
+		Manifold,
+		Border, // on an open edge, may only collapse along that edge
+		Locked  // shares its position with another vertex (attribute seam), never collapses
+	};
+
+	// Symmetric 4x4 matrix summing the squared distances to a set of weighted planes, stored as its upper triangle
+	struct Quadric
+	{
+		double A00 = 0.0, A01 = 0.0, A02 = 0.0, A03 = 0.0;
+		double A11 = 0.0, A12 = 0.0, A13 = 0.0;
+		double A22 = 0.0, A23 = 0.0;
+		double A33 = 0.0;
+		double Weight = 0.0;
+
+		void AddPlane(const glm::dvec3& Normal, double Distance, double InWeight)
+		{
+			A00 += InWeight * Normal.x * Normal.x;
+			A01 += InWeight * Normal.x * Normal.y;
+			A02 += InWeight * Normal.x * Normal.z;
+			A03 += InWeight * Normal.x * Distance;
+			A11 += InWeight * Normal.y * Normal.y;
+			A12 += InWeight * Normal.y * Normal.z;
+			A13 += InWeight * Normal.y * Distance;
+			A22 += InWeight * Normal.z * Normal.z;
+			A23 += InWeight * Normal.z * Distance;
+			A33 += InWeight * Distance * Distance;
+			Weight += InWeight;
+		}
+
+		void Add(const Quadric& Other)
+		{
+			A00 += Other.A00; A01 += Other.A01; A02 += Other.A02; A03 += Other.A03;
+			A11 += Other.A11; A12 += Other.A12; A13 += Other.A13;
+			A22 += Other.A22; A23 += Other.A23;
+			A33 += Other.A33;
+			Weight += Other.Weight;
+		}
+
+		// Weighted RMS distance of the point to the planes
+		float GetError(const glm::vec3& Point) const
+		{
+			if (Weight <= 0.0)
+			{
+				return 0.0f;
+			}
+
+			const double X = Point.x, Y = Point.y, Z = Point.z;
+			const double Sum = A00 * X * X + 2.0 * A01 * X * Y + 2.0 * A02 * X * Z + 2.0 * A03 * X
+				+ A11 * Y * Y + 2.0 * A12 * Y * Z + 2.0 * A13 * Y
+				+ A22 * Z * Z + 2.0 * A23 * Z
+				+ A33;
+			return static_cast<float>(std::sqrt(std::max(Sum, 0.0) / Weight));
+		}
+	};
+
+	struct Collapse
+	{
+		unsigned int From;
+		unsigned int To;
+		float Error;
+	};
+
+	struct PositionHash
+	{
+		size_t operator()(const glm::vec3& Position) const
+		{
+			uint32_t Bits[3];
+			std::memcpy(Bits, &Position, sizeof(Bits));
+			return (Bits[0] * 73856093u) ^ (Bits[1] * 19349663u) ^ (Bits[2] * 83492791u);
+		}
+	};
+
+	// Connectivity of the current index list, rebuilt at the start of every pass
+	struct Topology
+	{
+		std::vector<unsigned int> TriangleOffsets; // triangles around vertex v are Triangles[Offsets[v], Offsets[v + 1])
+		std::vector<unsigned int> Triangles;
+		std::vector<uint64_t> Edges;               // sorted directed edges
+
+		void Build(const std::vector<unsigned int>& Indices, size_t VertexCount)
+		{
+			TriangleOffsets.assign(VertexCount + 1, 0);
+			for (unsigned int Index : Indices)
+			{
+				TriangleOffsets[Index + 1]++;
+			}
+			for (size_t v = 0; v < VertexCount; v++)
+			{
+				TriangleOffsets[v + 1] += TriangleOffsets[v];
+			}
+
+			Triangles.resize(Indices.size());
+			std::vector<unsigned int> Cursor(TriangleOffsets.begin(), TriangleOffsets.end() - 1);
+			for (size_t i = 0; i < Indices.size(); i++)
+			{
+				Triangles[Cursor[Indices[i]]++] = static_cast<unsigned int>(i / 3);
+			}
+
+			Edges.resize(Indices.size());
+			for (size_t i = 0; i < Indices.size(); i += 3)
+			{
+				for (int Corner = 0; Corner < 3; Corner++)
+				{
+					Edges[i + Corner] = EdgeKey(Indices[i + Corner], Indices[i + (Corner + 1) % 3]);
+				}
+			}
+			std::sort(Edges.begin(), Edges.end());
+		}
+
+		bool HasEdge(unsigned int A, unsigned int B) const
+		{
+			return std::binary_search(Edges.begin(), Edges.end(), EdgeKey(A, B));
+		}
+
+		static uint64_t EdgeKey(unsigned int A, unsigned int B)
+		{
+			return (uint64_t(A) << 32) | B;
+		}
+	};
+
+	void FindSeams(const std::vector<Vertex>& Vertices, std::vector<bool>& OutSeams)
+	{
+		OutSeams.assign(Vertices.size(), false);
+
+		std::unordered_map<glm::vec3, unsigned int, PositionHash> FirstVertex;
+		FirstVertex.reserve(Vertices.size());
+		for (unsigned int v = 0; v < Vertices.size(); v++)
+		{
+			auto Result = FirstVertex.insert(std::make_pair(Vertices[v].Position, v));
+			if (!Result.second)
+			{
+				OutSeams[v] = true;
+				OutSeams[Result.first->second] = true;
+			}
+		}
+	}
+
+	// The LOD 0 planes every vertex stands for, a vertex takes over the planes of each vertex collapsed into it.
+	// Vertices never move, so the largest distance of a vertex to its planes bounds how far the simplified surface
+	// around it is from LOD 0, where the quadric only gives the RMS distance.
+	struct PlaneClusters
+	{
+		std::vector<glm::dvec4> Planes; // normal and distance
+		std::vector<std::vector<unsigned int>> VertexPlanes;
+
+		void Add(unsigned int Vert, const glm::dvec3& Normal, double Distance)
+		{
+			VertexPlanes[Vert].push_back(static_cast<unsigned int>(Planes.size()));
+			Planes.push_back(glm::dvec4(Normal, Distance));
+		}
+
+		// Largest distance of To to the planes From stands for, To already lies within its own bound
+		float GetCollapseError(const std::vector<Vertex>& Vertices, unsigned int From, unsigned int To) const
+		{
+			const glm::dvec4 Point(glm::dvec3(Vertices[To].Position), 1.0);
+			double Error = 0.0;
+			for (unsigned int Plane : VertexPlanes[From])
+			{
+				Error = std::max(Error, std::abs(glm::dot(Planes[Plane], Point)));
+			}
+			return static_cast<float>(Error);
+		}
+
+		void Collapse(unsigned int From, unsigned int To)
+		{
+			std::vector<unsigned int>& Target = VertexPlanes[To];
+			Target.insert(Target.end(), VertexPlanes[From].begin(), VertexPlanes[From].end());
+			std::sort(Target.begin(), Target.end());
+			Target.erase(std::unique(Target.begin(), Target.end()), Target.end());
+			std::vector<unsigned int>().swap(VertexPlanes[From]);
+		}
+	};
+
+	// Fills OutClusters too when given, with the same planes unweighted
+	void BuildQuadrics(const std::vector<Vertex>& Vertices, const std::vector<unsigned int>& Indices, const Topology& Topo, std::vector<Quadric>& OutQuadrics,
+		PlaneClusters* OutClusters = nullptr)
+	{
+		OutQuadrics.assign(Vertices.size(), Quadric());
+		if (OutClusters)
+		{
+			OutClusters->Planes.clear();
+			OutClusters->VertexPlanes.assign(Vertices.size(), std::vector<unsigned int>());
+		}
+
+		for (size_t i = 0; i < Indices.size(); i += 3)
+		{
+			const glm::dvec3 P0 = Vertices[Indices[i]].Position;
+			const glm::dvec3 P1 = Vertices[Indices[i + 1]].Position;
+			const glm::dvec3 P2 = Vertices[Indices[i + 2]].Position;
+
+			glm::dvec3 Normal = glm::cross(P1 - P0, P2 - P0);
+			const double Length = glm::length(Normal);
+			if (Length <= 0.0)
+			{
+				continue;
+			}
+			Normal /= Length;
+
+			// area weighted so small sliver triangles do not dominate the error
+			const double Area = Length * 0.5;
+			const double Distance = -glm::dot(Normal, P0);
+			for (int Corner = 0; Corner < 3; Corner++)
+			{
+				OutQuadrics[Indices[i + Corner]].AddPlane(Normal, Distance, Area);
+				if (OutClusters)
+				{
+					OutClusters->Add(Indices[i + Corner], Normal, Distance);
+				}
+			}
+
+			// open edges get a plane perpendicular to the triangle through the edge
+			for (int Corner = 0; Corner < 3; Corner++)
+			{
+				const unsigned int A = Indices[i + Corner];
+				const unsigned int B = Indices[i + (Corner + 1) % 3];
+				if (Topo.HasEdge(B, A))
+				{
+					continue;
+				}
+
+				const glm::dvec3 PA = Vertices[A].Position;
+				const glm::dvec3 Edge = glm::dvec3(Vertices[B].Position) - PA;
+				glm::dvec3 EdgeNormal = glm::cross(Edge, Normal);
+				const double EdgeLength = glm::length(EdgeNormal);
+				if (EdgeLength <= 0.0)
+				{
+					continue;
+				}
+				EdgeNormal /= EdgeLength;
+
+				const double EdgeDistance = -glm::dot(EdgeNormal, PA);
+				const double EdgeWeight = glm::dot(Edge, Edge) * BorderWeight;
+				OutQuadrics[A].AddPlane(EdgeNormal, EdgeDistance, EdgeWeight);
+				OutQuadrics[B].AddPlane(EdgeNormal, EdgeDistance, EdgeWeight);
+				if (OutClusters)
+				{
+					OutClusters->Add(A, EdgeNormal, EdgeDistance);
+					OutClusters->Add(B, EdgeNormal, EdgeDistance);
+				}
+			}
+		}
+	}
+
+	bool CanCollapse(const std::vector<EVertexKind>& Kinds, unsigned int From, unsigned int To, bool bBorderEdge)
+	{
+		switch (Kinds[From])
+		{
+		case EVertexKind::Manifold:
+			return true;
+		case EVertexKind::Border:
+			return bBorderEdge && Kinds[To] != EVertexKind::Manifold;
+		default:
+			return false;
+		}
+	}
+
+	void GatherNeighbours(const std::vector<unsigned int>& Indices, const Topology& Topo, unsigned int Vert, std::vector<unsigned int>& OutNeighbours)
+	{
+		OutNeighbours.clear();
+		for (unsigned int t = Topo.TriangleOffsets[Vert]; t < Topo.TriangleOffsets[Vert + 1]; t++)
+		{
+			const unsigned int* Triangle = &Indices[Topo.Triangles[t] * 3];
+			for (int Corner = 0; Corner < 3; Corner++)
+			{
+				if (Triangle[Corner] != Vert)
+				{
+					OutNeighbours.push_back(Triangle[Corner]);
+				}
+			}
+		}
+		std::sort(OutNeighbours.begin(), OutNeighbours.end());
+		OutNeighbours.erase(std::unique(OutNeighbours.begin(), OutNeighbours.end()), OutNeighbours.end());
+	}
+
+	// Counts the triangles the collapse removes and checks the link condition: the two vertices may only share the
+	// neighbours opposite their common edge, otherwise the collapse would pinch the surface into a non-manifold edge
+	bool CheckTopology(const std::vector<unsigned int>& Indices, const Topology& Topo, unsigned int From, unsigned int To,
+		std::vector<unsigned int>& ScratchA, std::vector<unsigned int>& ScratchB, unsigned int& OutRemovedTriangles)
+	{
+		OutRemovedTriangles = 0;
+		for (unsigned int t = Topo.TriangleOffsets[From]; t < Topo.TriangleOffsets[From + 1]; t++)
+		{
+			const unsigned int* Triangle = &Indices[Topo.Triangles[t] * 3];
+			if (Triangle[0] == To || Triangle[1] == To || Triangle[2] == To)
+			{
+				OutRemovedTriangles++;
+			}
+		}
+
+		GatherNeighbours(Indices, Topo, From, ScratchA);
+		GatherNeighbours(Indices, Topo, To, ScratchB);
+
+		unsigned int Shared = 0;
+		std::vector<unsigned int>::const_iterator A = ScratchA.begin(), B = ScratchB.begin();
+		while (A != ScratchA.end() && B != ScratchB.end())
+		{
+			if (*A < *B) ++A;
+			else if (*B < *A) ++B;
+			else { Shared++; ++A; ++B; }
+		}
+		return OutRemovedTriangles > 0 && Shared <= OutRemovedTriangles;
+	}
+
+	// True if moving From onto To would flip or badly distort any triangle that survives the collapse
+	bool FlipsTriangles(const std::vector<Vertex>& Vertices, const std::vector<unsigned int>& Indices, const Topology& Topo, unsigned int From, unsigned int To)
+	{
+		const glm::vec3& Target = Vertices[To].Position;
+		for (unsigned int t = Topo.TriangleOffsets[From]; t < Topo.TriangleOffsets[From + 1]; t++)
+		{
+			const unsigned int* Triangle = &Indices[Topo.Triangles[t] * 3];
+			if (Triangle[0] == To || Triangle[1] == To || Triangle[2] == To)
+			{
+				continue;
+			}
+
+			glm::vec3 Before[3], After[3];
+			for (int Corner = 0; Corner < 3; Corner++)
+			{
+				Before[Corner] = Vertices[Triangle[Corner]].Position;
+				After[Corner] = Triangle[Corner] == From ? Target : Before[Corner];
+			}
+
+			const glm::vec3 NormalBefore = glm::cross(Before[1] - Before[0], Before[2] - Before[0]);
+			const glm::vec3 NormalAfter = glm::cross(After[1] - After[0], After[2] - After[0]);
+			if (glm::dot(NormalBefore, NormalAfter) < MinNormalDot * glm::length(NormalBefore) * glm::length(NormalAfter))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Simplify against clusters that may already hold the planes of earlier steps, builds them from Indices when empty
+	float SimplifyClusters(const std::vector<Vertex>& Vertices, const unsigned int* Indices, size_t IndexCount, size_t TargetIndexCount, float TargetError,
+		PlaneClusters& InOutClusters, std::vector<unsigned int>& OutIndices)
+	{
+		const size_t VertexCount = Vertices.size();
+		OutIndices.assign(Indices, Indices + IndexCount);
+		if (IndexCount <= TargetIndexCount || TargetError <= 0.0f)
+		{
+			return 0.0f;
+		}
+
+		std::vector<bool> Seams;
+		FindSeams(Vertices, Seams);
+
+		Topology Topo;
+		Topo.Build(OutIndices, VertexCount);
+
+		std::vector<Quadric> Quadrics;
+		BuildQuadrics(Vertices, OutIndices, Topo, Quadrics, InOutClusters.VertexPlanes.empty() ? &InOutClusters : nullptr);
+
+		std::vector<EVertexKind> Kinds(VertexCount);
+		std::vector<Collapse> Collapses;
+		std::vector<unsigned int> Remap(VertexCount);
+		std::vector<unsigned char> Touched(VertexCount);
+		std::vector<unsigned int> ScratchA, ScratchB;
+
+		float MaxError = 0.0f;
+
+		for (unsigned int Pass = 0; Pass < MaxPasses && OutIndices.size() > TargetIndexCount; Pass++)
+		{
+			if (Pass > 0)
+			{
+				Topo.Build(OutIndices, VertexCount);
+			}
+
+			// classify against the current topology, collapses can open up new border edges
+			for (size_t v = 0; v < VertexCount; v++)
+			{
+				Kinds[v] = Seams[v] ? EVertexKind::Locked : EVertexKind::Manifold;
+			}
+			for (uint64_t Edge : Topo.Edges)
+			{
+				const unsigned int A = static_cast<unsigned int>(Edge >> 32);
+				const unsigned int B = static_cast<unsigned int>(Edge & 0xFFFFFFFFu);
+				if (!Topo.HasEdge(B, A))
+				{
+					for (unsigned int Vert : { A, B })
+					{
+						if (Kinds[Vert] == EVertexKind::Manifold)
+						{
+							Kinds[Vert] = EVertexKind::Border;
+						}
+					}
+				}
+			}
+
+			// cheapest valid direction of every edge
+			Collapses.clear();
+			for (size_t i = 0; i < OutIndices.size(); i += 3)
+			{
+				for (int Corner = 0; Corner < 3; Corner++)
+				{
+					const unsigned int A = OutIndices[i + Corner];
+					const unsigned int B = OutIndices[i + (Corner + 1) % 3];
+					const bool bBorderEdge = !Topo.HasEdge(B, A);
+
+					// interior edges are seen from both of their triangles, only take them once
+					if (!bBorderEdge && A > B)
+					{
+						continue;
+					}
+
+					Quadric Merged = Quadrics[A];
+					Merged.Add(Quadrics[B]);
+
+					Collapse Best = { A, B, -1.0f };
+					if (CanCollapse(Kinds, A, B, bBorderEdge))
+					{
+						Best.Error = Merged.GetError(Vertices[B].Position);
+					}
+					if (CanCollapse(Kinds, B, A, bBorderEdge))
+					{
+						const float Error = Merged.GetError(Vertices[A].Position);
+						if (Best.Error < 0.0f || Error < Best.Error)
+						{
+							Best = { B, A, Error };
+						}
+					}
+					if (Best.Error >= 0.0f && Best.Error <= TargetError)
+					{
+						Collapses.push_back(Best);
+					}
+				}
+			}
+
+			if (Collapses.empty())
+			{
+				break;
+			}
+
+			std::sort(Collapses.begin(), Collapses.end(), [](const Collapse& A, const Collapse& B) { return A.Error < B.Error; });
+
+			for (size_t v = 0; v < VertexCount; v++)
+			{
+				Remap[v] = static_cast<unsigned int>(v);
+			}
+			std::fill(Touched.begin(), Touched.end(), 0);
+
+			const size_t TrianglesToRemove = (OutIndices.size() - TargetIndexCount) / 3;
+			size_t RemovedTriangles = 0;
+			size_t Applied = 0;
+
+			for (const Collapse& Candidate : Collapses)
+			{
+				if (RemovedTriangles >= TrianglesToRemove)
+				{
+					break;
+				}
+				if (Touched[Candidate.From] || Touched[Candidate.To])
+				{
+					continue;
+				}
+
+				unsigned int Removed = 0;
+				if (!CheckTopology(OutIndices, Topo, Candidate.From, Candidate.To, ScratchA, ScratchB, Removed)
+					|| FlipsTriangles(Vertices, OutIndices, Topo, Candidate.From, Candidate.To))
+				{
+					continue;
+				}
+
+				// the quadric only ranks the collapses, the bound decides if one stays within TargetError
+				const float Bound = InOutClusters.GetCollapseError(Vertices, Candidate.From, Candidate.To);
+				if (Bound > TargetError)
+				{
+					continue;
+				}
+
+				// everything around From changes shape, so none of it may collapse again this pass
+				for (unsigned int t = Topo.TriangleOffsets[Candidate.From]; t < Topo.TriangleOffsets[Candidate.From + 1]; t++)
+				{
+					const unsigned int* Triangle = &OutIndices[Topo.Triangles[t] * 3];
+					Touched[Triangle[0]] = Touched[Triangle[1]] = Touched[Triangle[2]] = 1;
+				}
+
+				Remap[Candidate.From] = Candidate.To;
+				Quadrics[Candidate.To].Add(Quadrics[Candidate.From]);
+				InOutClusters.Collapse(Candidate.From, Candidate.To);
+				MaxError = std::max(MaxError, Bound);
+				RemovedTriangles += Removed;
+				Applied++;
+			}
+
+			if (Applied == 0)
+			{
+				break;
+			}
+
+			size_t Write = 0;
+			for (size_t i = 0; i < OutIndices.size(); i += 3)
+			{
+				const unsigned int A = Remap[OutIndices[i]];
+				const unsigned int B = Remap[OutIndices[i + 1]];
+				const unsigned int C = Remap[OutIndices[i + 2]];
+				if (A != B && B != C && A != C)
+				{
+					OutIndices[Write++] = A;
+					OutIndices[Write++] = B;
+					OutIndices[Write++] = C;
+				}
+			}
+			OutIndices.resize(Write);
+		}
+
+		return MaxError;
+	}
+}
+
+float MeshSimplifier::Simplify(const std::vector<Vertex>& Vertices, const unsigned int* Indices, size_t IndexCount, size_t TargetIndexCount, float TargetError, std::vector<unsigned int>& OutIndices)
+{
+	PlaneClusters Clusters;
+	return SimplifyClusters(Vertices, Indices, IndexCount, TargetIndexCount, TargetError, Clusters, OutIndices);
+}
+
+void MeshSimplifier::BuildLodChain(MeshData& Data)
+{
+	if (!Data.Lods.empty() || Data.Indices.empty() || Data.Vertices.empty())
+	{
+		return;
+	}
+
+	MeshLod BaseLod;
+	BaseLod.IndexCount = static_cast<uint32_t>(Data.Indices.size());
+	Data.Lods.push_back(BaseLod);
+
+	glm::vec3 Min = Data.Vertices[0].Position;
+	glm::vec3 Max = Min;
+	for (const Vertex& Vert : Data.Vertices)
+	{
+		Min = glm::min(Min, Vert.Position);
+		Max = glm::max(Max, Vert.Position);
+	}
+	const float ErrorLimit = MaxLodError * glm::length(Max - Min) * 0.5f;
+
+	// every LOD is simplified from the previous one, the clusters carry the LOD 0 planes through the whole chain so
+	// each step's bound is still measured against LOD 0 and the LOD's error is the largest bound so far
+	std::vector<unsigned int> Previous(Data.Indices);
+	std::vector<unsigned int> Simplified;
+	PlaneClusters Clusters;
+	float Error = 0.0f;
+
+	for (unsigned int Lod = 1; Lod <= MaxLodCount; Lod++)
+	{
+		const size_t TargetIndexCount = static_cast<size_t>(Previous.size() / 3 * LodReduction) * 3;
+		if (TargetIndexCount < MinLodTriangles * 3)
+		{
+			break;
+		}
+
+		const float StepError = SimplifyClusters(Data.Vertices, Previous.data(), Previous.size(), TargetIndexCount, ErrorLimit, Clusters, Simplified);
+		if (Simplified.size() > Previous.size() * MinLodReduction)
+		{
+			break;
+		}
+		Error = std::max(Error, StepError);
+
+		MeshOptimizer::OptimizeVertexCache(Simplified, Data.Vertices.size());
+
+		MeshLod NewLod;
+		NewLod.FirstIndex = static_cast<uint32_t>(Data.Indices.size());
+		NewLod.IndexCount = static_cast<uint32_t>(Simplified.size());
+		NewLod.Error = Error;
+		Data.Indices.insert(Data.Indices.end(), Simplified.begin(), Simplified.end());
+		Data.Lods.push_back(NewLod);
+
+		Previous.swap(Simplified);
+	}
+}
+
+void MeshSimplifier::BuildLodChains(std::vector<MeshData>& Meshes)
+{
+	ThreadPool::Get().ParallelFor(Meshes.size(), [&Meshes](size_t Index)
+	{
+		BuildLodChain(Meshes[Index]);
+	});
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Mesh.h"
+
+// Import-time LOD generation using quadric error metrics (Garland and Heckbert 1997). Only half-edge collapses are
+// performed, a vertex is merged into one of its neighbours instead of being moved, so every LOD is just another index
+// list over the original vertex buffer. Vertices on UV/normal seams are locked and open borders may only slide
+// along themselves, which keeps LODs crack free without touching the vertex data.
+namespace MeshSimplifier
+{
+	// Most simplified LODs built per mesh (on top of LOD 0)
+	const unsigned int MaxLodCount = 4;
+
+	// Each LOD aims for this fraction of the previous LOD's triangles
+	const float LodReduction = 0.5f;
+
+	// Chains stop once a LOD's error (see MeshLod::Error) would exceed this fraction of the mesh's bounding radius
+	const float MaxLodError = 0.1f;
+
+	// Chains also stop when a step removes too little to be worth its index memory, or the mesh gets this small
+	const float MinLodReduction = 0.85f;
+	const size_t MinLodTriangles = 32;
+
+	// Collapses edges until the index count drops to TargetIndexCount or no collapse is left whose error stays within
+	// TargetError (model units). Collapses are ranked by the quadric's RMS error, but each is bounded by the largest
+	// distance of the kept vertex to the input planes of every vertex merged into it. Returns the largest bound.
+	float Simplify(const std::vector<Vertex>& Vertices, const unsigned int* Indices, size_t IndexCount, size_t TargetIndexCount, float TargetError, std::vector<unsigned int>& OutIndices);
+
+	// Appends simplified LODs to Data.Indices and fills in Data.Lods. Must run after MeshOptimizer, which rewrites
+	// the index buffer assuming it only holds LOD 0.
+	void BuildLodChain(MeshData& Data);
+
+	// Builds the LOD chains of every mesh on the thread pool
+	void BuildLodChains(std::vector<MeshData>& Meshes);
+}
@@ -0,0 +1,135 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Engine/Core/ThreadPool.h"
+
+namespace
+{
+	// Cones wider than this (cosine of the half angle) almost never cull anything, they are disabled instead
+	const float MinConeDot = 0.1f;
+
+	void ComputeBounds(const MeshData& Data, Meshlet& OutMeshlet)
+	{
+		const unsigned int* Indices = Data.Indices.data() + OutMeshlet.FirstIndex;
+
+		glm::vec3 Min = Data.Vertices[Indices[0]].Position;
+		glm::vec3 Max = Min;
+		for (uint32_t i = 0; i < OutMeshlet.IndexCount; i++)
+		{
+			Min = glm::min(Min, Data.Vertices[Indices[i]].Position);
+			Max = glm::max(Max, Data.Vertices[Indices[i]].Position);
+		}
+
+		OutMeshlet.Center = (Min + Max) * 0.5f;
+		OutMeshlet.Radius = 0.0f;
+		for (uint32_t i = 0; i < OutMeshlet.IndexCount; i++)
+		{
+			OutMeshlet.Radius = std::max(OutMeshlet.Radius, glm::length(Data.Vertices[Indices[i]].Position - OutMeshlet.Center));
+		}
+
+		// the cone axis is the area weighted average face normal, its spread decides the cutoff
+		std::vector<glm::vec3> FaceNormals;
+		FaceNormals.reserve(OutMeshlet.IndexCount / 3);
+		glm::vec3 AxisSum(0.0f);
+		for (uint32_t i = 0; i < OutMeshlet.IndexCount; i += 3)
+		{
+			const glm::vec3& P0 = Data.Vertices[Indices[i]].Position;
+			const glm::vec3& P1 = Data.Vertices[Indices[i + 1]].Position;
+			const glm::vec3& P2 = Data.Vertices[Indices[i + 2]].Position;
+			const glm::vec3 Normal = glm::cross(P1 - P0, P2 - P0);
+			const float Length = glm::length(Normal);
+			if (Length > 0.0f)
+			{
+				AxisSum += Normal;
+				FaceNormals.push_back(Normal / Length);
+			}
+		}
+
+		OutMeshlet.ConeAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+		OutMeshlet.ConeCutoff = 1.0f;
+
+		const float AxisLength = glm::length(AxisSum);
+		if (AxisLength <= 0.0f || FaceNormals.empty())
+		{
+			return;
+		}
+
+		const glm::vec3 Axis = AxisSum / AxisLength;
+		float MinDot = 1.0f;
+		for (const glm::vec3& Normal : FaceNormals)
+		{
+			MinDot = std::min(MinDot, glm::dot(Normal, Axis));
+		}
+
+		if (MinDot > MinConeDot)
+		{
+			OutMeshlet.ConeAxis = Axis;
+			OutMeshlet.ConeCutoff = std::sqrt(1.0f - MinDot * MinDot);
+		}
+	}
+}
+
+void MeshletBuilder::BuildMeshlets(MeshData& Data)
+{
+	Data.Meshlets.clear();
+
+	const size_t IndexCount = Data.Lods.empty() ? Data.Indices.size() : Data.Lods[0].IndexCount;
+	if (IndexCount / 3 < MinTriangles)
+	{
+		return;
+	}
+
+	// MeshletOf[v] is the last meshlet that used vertex v, which makes the unique vertex count cheap to track
+	std::vector<size_t> MeshletOf(Data.Vertices.size(), size_t(-1));
+
+	Meshlet Current;
+	size_t VertexCount = 0;
+	for (size_t i = 0; i < IndexCount; i += 3)
+	{
+		size_t NewVertices = 0;
+		for (int Corner = 0; Corner < 3; Corner++)
+		{
+			if (MeshletOf[Data.Indices[i + Corner]] != Data.Meshlets.size())
+			{
+				NewVertices++;
+			}
+		}
+
+		if (Current.IndexCount / 3 + 1 > MaxTriangles || VertexCount + NewVertices > MaxVertices)
+		{
+			ComputeBounds(Data, Current);
+			Data.Meshlets.push_back(Current);
+
+			Current = Meshlet();
+			Current.FirstIndex = static_cast<uint32_t>(i);
+			VertexCount = 0;
+		}
+
+		for (int Corner = 0; Corner < 3; Corner++)
+		{
+			size_t& Owner = MeshletOf[Data.Indices[i + Corner]];
+			if (Owner != Data.Meshlets.size())
+			{
+				Owner = Data.Meshlets.size();
+				VertexCount++;
+			}
+		}
+		Current.IndexCount += 3;
+	}
+
+	if (Current.IndexCount > 0)
+	{
+		ComputeBounds(Data, Current);
+		Data.Meshlets.push_back(Current);
+	}
+}
+
+void MeshletBuilder::BuildAllMeshlets(std::vector<MeshData>& Meshes)
+{
+	ThreadPool::Get().ParallelFor(Meshes.size(), [&Meshes](size_t Index)
+	{
+		BuildMeshlets(Meshes[Index]);
+	});
+}
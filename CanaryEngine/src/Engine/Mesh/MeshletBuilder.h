@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Mesh.h"
+
+// Splits LOD 0 of a mesh into meshlets (see Meshlet in VertexFormat.h) for cluster culling. Triangles are taken in
+// index buffer order, which MeshOptimizer has already made spatially coherent, so every meshlet is a contiguous
+// range of the existing index buffer and can be drawn with a plain ranged glDrawElements call.
+namespace MeshletBuilder
+{
+	const size_t MaxVertices = 64;
+	const size_t MaxTriangles = 124;
+
+	// Meshes with fewer triangles than this are drawn whole, culling would not pay for its overhead
+	const size_t MinTriangles = MaxTriangles * 4;
+
+	void BuildMeshlets(MeshData& Data);
+
+	// Builds the meshlets of every mesh on the thread pool
+	void BuildAllMeshlets(std::vector<MeshData>& Meshes);
+}
@@ -1,55 +1,458 @@
 #include "Model.h"
 
-#include <stb/stb_image.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+
+#include "CookedMesh.h"
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "ObjParser.h"
+#include "Engine/Animation/AnimationCompressor.h"
+#include "Engine/Animation/AnimationImporter.h"
+#include "Engine/Asset/AssetRegistry.h"
+#include "Engine/Core/CookedFile.h"
+#include "Engine/Core/Hash.h"
+#include "Engine/Core/ThreadPool.h"
+#include "Engine/Core/TransformMath.h"
+#include "Engine/Core/VirtualFileSystem.h"
+#include "Engine/Renderer/RenderStats.h"
+#include "Engine/Texture/TextureAtlas.h"
+#include "Engine/Texture/VirtualTextureSystem.h"
+
+namespace
+{
+	// Reads a file opened through the virtual file system
+	class VirtualIOStream : public Assimp::IOStream
+	{
+	public:
+		explicit VirtualIOStream(std::unique_ptr<VirtualFile> InFile)
+			: File(std::move(InFile))
+		{
+		}
+
+		size_t Read(void* Buffer, size_t Size, size_t Count) override
+		{
+			if (Size == 0)
+			{
+				return 0;
+			}
+
+			const size_t ReadCount = std::min(Count, (File->GetSize() - Position) / Size);
+			std::memcpy(Buffer, File->GetData() + Position, ReadCount * Size);
+			Position += ReadCount * Size;
+			return ReadCount;
+		}
+
+		size_t Write(const void* /*Buffer*/, size_t /*Size*/, size_t /*Count*/) override
+		{
+			return 0;
+		}
+
+		aiReturn Seek(size_t Offset, aiOrigin Origin) override
+		{
+			const size_t Base = Origin == aiOrigin_SET ? 0 : (Origin == aiOrigin_CUR ? Position : File->GetSize());
+			if (Base + Offset > File->GetSize())
+			{
+				return aiReturn_FAILURE;
+			}
+			Position = Base + Offset;
+			return aiReturn_SUCCESS;
+		}
+
+		size_t Tell() const override { return Position; }
+		size_t FileSize() const override { return File->GetSize(); }
+		void Flush() override {}
+
+	private:
+		std::unique_ptr<VirtualFile> File;
+		size_t Position = 0;
+	};
+
+	// Lets assimp find models and the files they reference (.mtl, ...) in pak archives as well as on disk
+	class VirtualIOSystem : public Assimp::IOSystem
+	{
+	public:
+		// Dependencies, when given, collects the path of every file assimp opens or looks for. Files that are missing
+		// are recorded too, the cook key changes once they appear.
+		explicit VirtualIOSystem(std::vector<std::string>* InDependencies = nullptr)
+			: Dependencies(InDependencies)
+		{
+		}
+
+		bool Exists(const char* FilePath) const override
+		{
+			const bool bExists = VirtualFileSystem::Get().Exists(FilePath);
+			if (!bExists && Dependencies)
+			{
+				Dependencies->push_back(FilePath);
+			}
+			return bExists;
+		}
+
+		char getOsSeparator() const override
+		{
+			return '/';
+		}
+
+		Assimp::IOStream* Open(const char* FilePath, const char* Mode) override
+		{
+			// read only, the archive cannot be written to
+			if (std::strchr(Mode, 'w') || std::strchr(Mode, 'a'))
+			{
+				return nullptr;
+			}
+
+			if (Dependencies)
+			{
+				Dependencies->push_back(FilePath);
+			}
+
+			std::unique_ptr<VirtualFile> File(new VirtualFile());
+			if (!File->Open(FilePath))
+			{
+				return nullptr;
+			}
+			return new VirtualIOStream(std::move(File));
+		}
+
+		void Close(Assimp::IOStream* Stream) override
+		{
+			delete Stream;
+		}
+
+	private:
+		std::vector<std::string>* Dependencies;
+	};
+
+	unsigned int SelectLod(const Mesh& InMesh, float PixelsPerUnit, const RenderView& View, unsigned int CurrentLod)
+	{
+		const unsigned int LodCount = InMesh.GetLodCount();
+		CurrentLod = std::min(CurrentLod, LodCount - 1);
+
+		// coarsest LOD whose error is still invisible
+		unsigned int Desired = 0;
+		for (unsigned int Lod = 1; Lod < LodCount; Lod++)
+		{
+			if (InMesh.GetLod(Lod).Error * PixelsPerUnit <= View.MaxScreenError)
+			{
+				Desired = Lod;
+			}
+		}
+
+		// refine immediately, but only coarsen as far as the hysteresis band allows
+		if (Desired <= CurrentLod)
+		{
+			return Desired;
+		}
+
+		const float CoarsenError = View.MaxScreenError * (1.0f - View.Hysteresis);
+		unsigned int Selected = CurrentLod;
+		for (unsigned int Lod = CurrentLod + 1; Lod <= Desired; Lod++)
+		{
+			if (InMesh.GetLod(Lod).Error * PixelsPerUnit <= CoarsenError)
+			{
+				Selected = Lod;
+			}
+		}
+		return Selected;
+	}
+}
 
 Model::Model(std::string FilePath)
 {
-	LoadModel(FilePath);
+	Directory = FilePath.substr(0, FilePath.find_last_of('/'));
+
+	// meshes (and the textures they use) are shared with every other model loaded from the same file
+	MeshAsset = AssetRegistry::Get().AcquireMeshes(FilePath, [&FilePath](std::vector<Mesh>& OutMeshes, std::vector<TextureHandle>& OutTextures, AnimationSet& OutAnimation)
+	{
+		return LoadModel(FilePath, OutMeshes, OutTextures, OutAnimation);
+	});
+}
+
+Model::Model(ModelLoad& Load)
+{
+	Directory = Load.Directory;
+	MeshAsset = AssetRegistry::Get().AcquireMeshes(Load.FilePath, [&Load](std::vector<Mesh>& OutMeshes, std::vector<TextureHandle>& OutTextures, AnimationSet& OutAnimation)
+	{
+		return Load.TakeResult(OutMeshes, OutTextures, OutAnimation);
+	}, Load.ContentHash);
+}
+
+Model::~Model()
+{
+	AssetRegistry::Get().Release(MeshAsset);
+}
+
+Model::Model(Model&& Other)
+	: Directory(std::move(Other.Directory))
+	, MeshAsset(Other.MeshAsset)
+{
+	Other.MeshAsset = MeshHandle();
+}
+
+Model& Model::operator=(Model&& Other)
+{
+	if (this != &Other)
+	{
+		AssetRegistry::Get().Release(MeshAsset);
+		Directory = std::move(Other.Directory);
+		MeshAsset = Other.MeshAsset;
+		Other.MeshAsset = MeshHandle();
+	}
+	return *this;
+}
+
+const AnimationSet* Model::GetAnimation() const
+{
+	return AssetRegistry::Get().GetAnimation(MeshAsset);
 }
 
 void Model::Draw(ShaderProgram& Shader)
 {
+	std::vector<Mesh>* Meshes = AssetRegistry::Get().GetMeshes(MeshAsset);
+	if (!Meshes)
+	{
+		return;
+	}
+
+	for (unsigned int i = 0; i < Meshes->size(); i++)
+	{
+		(*Meshes)[i].RequestTextureDetail(0.0f);
+		(*Meshes)[i].Draw(Shader);
+	}
+}
+
+void Model::Draw(ShaderProgram& Shader, const glm::mat4& ModelMatrix, const RenderView& View, ModelLodState& State)
+{
+	std::vector<Mesh>* LoadedMeshes = AssetRegistry::Get().GetMeshes(MeshAsset);
+	if (!LoadedMeshes)
+	{
+		return;
+	}
+	std::vector<Mesh>& Meshes = *LoadedMeshes;
+
+	Shader.SetMat4("ModelMatrix", ModelMatrix);
+
+	State.MeshLods.resize(Meshes.size(), 0);
+
+	// only a skinned model is drawn with the skinned shader
+	const bool bSkinnedModel = GetAnimation() != nullptr;
+
+	// errors are in model units, so scale them by the largest axis scale of the transform
+	const float MaxScale = TransformMath::GetMaxAxisScale(ModelMatrix);
+
+	RenderStats& Stats = RenderStats::Get();
 	for (unsigned int i = 0; i < Meshes.size(); i++)
 	{
-		Meshes[i].Draw(Shader);
+		const Mesh& CurrentMesh = Meshes[i];
+		const glm::vec3 Center = glm::vec3(ModelMatrix * glm::vec4(CurrentMesh.GetBoundsCenter(), 1.0f));
+		const float Distance = std::max(glm::length(Center - View.CameraPosition) - CurrentMesh.GetBoundsRadius() * MaxScale, 0.01f);
+		const float PixelsPerUnit = View.ProjectionScale * MaxScale / Distance;
+
+		const unsigned int Lod = SelectLod(CurrentMesh, PixelsPerUnit, View, State.MeshLods[i]);
+		State.MeshLods[i] = Lod;
+		CurrentMesh.RequestTextureDetail(PixelsPerUnit);
+
+		Stats.TrianglesSavedByLod += (CurrentMesh.GetLod(0).IndexCount - CurrentMesh.GetLod(Lod).IndexCount) / 3;
+		if (bSkinnedModel && !CurrentMesh.IsSkinned())
+		{
+			Mesh::SetRigidSkinAttributes();
+		}
+
+		// meshlet bounds and cones are for the bind pose, skinned vertices move away from them
+		if (Lod == 0 && View.bClusterCulling && CurrentMesh.HasMeshlets() && !CurrentMesh.IsSkinned())
+		{
+			Meshes[i].DrawMeshlets(Shader, ModelMatrix, View);
+		}
+		else
+		{
+			Meshes[i].Draw(Shader, Lod);
+		}
 	}
 }
 
-void Model::LoadModel(std::string FilePath)
+void Model::DrawInstanced(ShaderProgram& Shader, const std::vector<float>& InstancePixelsPerUnit, const RenderView& View)
 {
+	std::vector<Mesh>* LoadedMeshes = AssetRegistry::Get().GetMeshes(MeshAsset);
+	if (!LoadedMeshes || InstancePixelsPerUnit.empty())
+	{
+		return;
+	}
+
+	RenderStats& Stats = RenderStats::Get();
+	const unsigned int InstanceCount = static_cast<unsigned int>(InstancePixelsPerUnit.size());
+	for (Mesh& CurrentMesh : *LoadedMeshes)
+	{
+		if (!CurrentMesh.IsSkinned())
+		{
+			Mesh::SetRigidSkinAttributes();
+		}
+
+		// the nearest instance decides how much texture detail is needed
+		CurrentMesh.RequestTextureDetail(InstancePixelsPerUnit[0]);
+
+		// starting from the coarsest LOD selects the wanted LOD directly, LODs only get coarser along the array
+		const unsigned int CoarsestLod = CurrentMesh.GetLodCount() - 1;
+		unsigned int First = 0;
+		while (First < InstanceCount)
+		{
+			const unsigned int Lod = SelectLod(CurrentMesh, InstancePixelsPerUnit[First], View, CoarsestLod);
+			unsigned int End = First + 1;
+			while (End < InstanceCount && SelectLod(CurrentMesh, InstancePixelsPerUnit[End], View, CoarsestLod) == Lod)
+			{
+				End++;
+			}
+
+			Stats.TrianglesSavedByLod += (CurrentMesh.GetLod(0).IndexCount - CurrentMesh.GetLod(Lod).IndexCount) / 3 * (End - First);
+			CurrentMesh.DrawInstanced(Shader, Lod, First, End - First);
+			First = End;
+		}
+	}
+}
+
+bool Model::GetBounds(glm::vec3& OutCenter, float& OutRadius) const
+{
+	std::vector<Mesh>* LoadedMeshes = AssetRegistry::Get().GetMeshes(MeshAsset);
+	if (!LoadedMeshes || LoadedMeshes->empty())
+	{
+		return false;
+	}
+
+	// grow the first mesh's sphere until it contains every other one
+	OutCenter = (*LoadedMeshes)[0].GetBoundsCenter();
+	OutRadius = (*LoadedMeshes)[0].GetBoundsRadius();
+	for (const Mesh& CurrentMesh : *LoadedMeshes)
+	{
+		const glm::vec3 Offset = CurrentMesh.GetBoundsCenter() - OutCenter;
+		const float Distance = glm::length(Offset);
+		if (Distance + CurrentMesh.GetBoundsRadius() <= OutRadius)
+		{
+			continue;
+		}
+		if (Distance + OutRadius <= CurrentMesh.GetBoundsRadius())
+		{
+			OutCenter = CurrentMesh.GetBoundsCenter();
+			OutRadius = CurrentMesh.GetBoundsRadius();
+			continue;
+		}
+
+		const float Radius = (Distance + OutRadius + CurrentMesh.GetBoundsRadius()) * 0.5f;
+		OutCenter += Offset * ((Radius - OutRadius) / Distance);
+		OutRadius = Radius;
+	}
+	return true;
+}
+
+size_t Model::GetMemoryBytes() const
+{
+	std::vector<Mesh>* LoadedMeshes = AssetRegistry::Get().GetMeshes(MeshAsset);
+	if (!LoadedMeshes)
+	{
+		return 0;
+	}
+
+	size_t Bytes = 0;
+	for (const Mesh& CurrentMesh : *LoadedMeshes)
+	{
+		Bytes += CurrentMesh.GetGpuBytes() + CurrentMesh.GetCpuBytes();
+	}
+	return Bytes;
+}
+
+bool Model::LoadModel(const std::string& FilePath, std::vector<Mesh>& OutMeshes, std::vector<TextureHandle>& OutTextures, AnimationSet& OutAnimation)
+{
+	ModelLoad Load(FilePath);
+	size_t BytesUsed = 0;
+	return Load.Prepare() && Load.Upload(BytesUsed, SIZE_MAX) && Load.TakeResult(OutMeshes, OutTextures, OutAnimation);
+}
+
+bool Model::ImportMeshData(const std::string& FilePath, std::vector<MeshData>& OutMeshes, EModelImporter InImporter,
+	std::vector<std::string>* OutDependencies, AnimationSetData* OutAnimation)
+{
+	if (OutAnimation)
+	{
+		*OutAnimation = AnimationSetData();
+	}
+
+	const bool bIsObj = FilePath.size() > 4 && FilePath.compare(FilePath.size() - 4, 4, ".obj") == 0;
+
+	if (InImporter == EModelImporter::NativeObj || (InImporter == EModelImporter::Auto && bIsObj))
+	{
+		if (ObjParser::Parse(FilePath, OutMeshes, OutDependencies))
+		{
+			return true;
+		}
+		if (InImporter == EModelImporter::NativeObj)
+		{
+			return false;
+		}
+		std::cout << "Native OBJ import failed, falling back to assimp for " << FilePath << std::endl;
+		if (OutDependencies)
+		{
+			OutDependencies->clear();
+		}
+		OutMeshes.clear();
+	}
+
 	Assimp::Importer Importer;
+	Importer.SetIOHandler(new VirtualIOSystem(OutDependencies)); // the importer takes ownership
 	const aiScene* Scene = Importer.ReadFile(FilePath, aiProcess_Triangulate | aiProcess_FlipUVs);
 
 	if (!Scene || Scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !Scene->mRootNode)
 	{
 		std::cout << "ERROR::ASSIMP::" << Importer.GetErrorString() << std::endl;
-		return;
+		return false;
 	}
-	Directory = FilePath.substr(0, FilePath.find_last_of('/'));
 
-	ProcessNode(Scene->mRootNode, Scene);
+	// the skeleton is needed before any mesh so skin weights can refer to bones by index
+	const SkeletonData* Skeleton = nullptr;
+	if (OutAnimation && AnimationImporter::ImportSkeleton(Scene, OutAnimation->Skeleton))
+	{
+		AnimationImporter::ImportClips(Scene, OutAnimation->Skeleton, OutAnimation->Clips);
+		Skeleton = &OutAnimation->Skeleton;
+	}
+
+	std::vector<aiMesh*> SceneMeshes;
+	ProcessNode(Scene->mRootNode, Scene, SceneMeshes);
+
+	// every mesh is converted on its own and written to its slot, so the order does not depend on the scheduling
+	const size_t FirstMesh = OutMeshes.size();
+	OutMeshes.resize(FirstMesh + SceneMeshes.size());
+	ThreadPool::Get().ParallelFor(SceneMeshes.size(), [&](size_t Index)
+	{
+		OutMeshes[FirstMesh + Index] = ProcessMesh(SceneMeshes[Index], Scene, Skeleton);
+	});
+	return true;
 }
 
-void Model::ProcessNode(aiNode* Node, const aiScene* Scene)
+void Model::ProcessNode(aiNode* Node, const aiScene* Scene, std::vector<aiMesh*>& OutMeshes)
 {
-	// process all the node's meshes (if any)
+	// collect all the node's meshes (if any)
 	for (unsigned int i = 0; i < Node->mNumMeshes; i++)
 	{
-		aiMesh* mesh = Scene->mMeshes[Node->mMeshes[i]];
-		Meshes.push_back(ProcessMesh(mesh, Scene));
+		OutMeshes.push_back(Scene->mMeshes[Node->mMeshes[i]]);
 	}
 	// then do the same for each of its children
 	for (unsigned int i = 0; i < Node->mNumChildren; i++)
 	{
-		ProcessNode(Node->mChildren[i], Scene);
+		ProcessNode(Node->mChildren[i], Scene, OutMeshes);
 	}
 }
 
-Mesh Model::ProcessMesh(aiMesh* InMesh, const aiScene* Scene)
+MeshData Model::ProcessMesh(aiMesh* InMesh, const aiScene* Scene, const SkeletonData* Skeleton)
 {
-	std::vector<Vertex> vertices;
-	std::vector<unsigned int> indices;
-	std::vector<Texture> textures;
+	MeshData Data;
+	std::vector<Vertex>& vertices = Data.Vertices;
+	std::vector<unsigned int>& indices = Data.Indices;
+
+	vertices.reserve(InMesh->mNumVertices);
+	indices.reserve(InMesh->mNumFaces * 3);
 
 	for (unsigned int i = 0; i < InMesh->mNumVertices; i++)
 	{
@@ -71,6 +474,10 @@ Mesh Model::ProcessMesh(aiMesh* InMesh, const aiScene* Scene)
 			vector.z = InMesh->mNormals[i].z;
 			vertex.Normal = vector;
 		}
+		else
+		{
+			vertex.Normal = glm::vec3(0.0f, 0.0f, 0.0f);
+		}
 
 		if (InMesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
 		{
@@ -89,99 +496,306 @@ Mesh Model::ProcessMesh(aiMesh* InMesh, const aiScene* Scene)
 
 	for (unsigned int i = 0; i < InMesh->mNumFaces; i++)
 	{
-		aiFace face = InMesh->mFaces[i];
+		// by reference, copying an aiFace allocates its index array
+		const aiFace& face = InMesh->mFaces[i];
 		for (unsigned int j = 0; j < face.mNumIndices; j++)
 		{
 			indices.push_back(face.mIndices[j]);
 		}
 	}
 
+	if (Skeleton && InMesh->HasBones())
+	{
+		AnimationImporter::ImportSkin(InMesh, *Skeleton, Data.Skin);
+	}
+
 	if (InMesh->mMaterialIndex >= 0)
 	{
 		aiMaterial* material = Scene->mMaterials[InMesh->mMaterialIndex];
 
-		std::vector<Texture> DiffuseMaps = LoadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-		textures.insert(textures.end(), DiffuseMaps.begin(), DiffuseMaps.end());
+		GetMaterialTextureRefs(material, aiTextureType_DIFFUSE, "texture_diffuse", Data.TextureRefs);
+		GetMaterialTextureRefs(material, aiTextureType_SPECULAR, "texture_specular", Data.TextureRefs);
 
-		std::vector<Texture> SpecularMaps = LoadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-		textures.insert(textures.end(), SpecularMaps.begin(), SpecularMaps.end());
+		// OBJ bump maps (map_Bump) come through as height maps, they hold tangent space normals like the NORMALS slot
+		GetMaterialTextureRefs(material, aiTextureType_NORMALS, "texture_normal", Data.TextureRefs);
+		GetMaterialTextureRefs(material, aiTextureType_HEIGHT, "texture_normal", Data.TextureRefs);
 	}
 
-	return Mesh(vertices, indices, textures);
+	return Data;
 }
 
-std::vector<Texture> Model::LoadMaterialTextures(aiMaterial* Material, aiTextureType Type, std::string TypeName)
+void Model::GetMaterialTextureRefs(aiMaterial* Material, aiTextureType Type, const std::string& TypeName, std::vector<MaterialTextureRef>& OutRefs)
 {
-	std::vector<Texture> textures;
 	for (unsigned int i = 0; i < Material->GetTextureCount(Type); i++)
 	{
 		aiString str;
 		Material->GetTexture(Type, i, &str);
-		bool skip = false;
-		for (unsigned int j = 0; j < LoadedTextures.size(); j++)
+		OutRefs.push_back({ TypeName, str.C_Str() });
+	}
+}
+
+std::vector<Texture> Model::LoadMaterialTextures(const std::string& Directory, const std::vector<MaterialTextureRef>& TextureRefs, std::vector<TextureHandle>& OutTextures,
+	const TextureContentHashes* Hashes)
+{
+	std::vector<Texture> textures;
+	for (const MaterialTextureRef& Ref : TextureRefs)
+	{
+		// large textures cooked into pages stream through the virtual texture cache instead of being loaded whole
+		const int VirtualTexture = VirtualTextureSystem::Get().Find(Directory + '/' + Ref.Path, Ref.Type);
+		if (VirtualTexture >= 0)
 		{
-			if (std::strcmp(LoadedTextures[j].Path.data(), str.C_Str()) == 0)
-			{
-				textures.push_back(LoadedTextures[j]);
-				skip = true;
-				break;
-			}
+			Texture texture;
+			texture.ID = 0;
+			texture.Type = Ref.Type;
+			texture.Path = Ref.Path;
+			texture.VirtualTexture = VirtualTexture;
+			textures.push_back(texture);
+			continue;
 		}
-		if (!skip)
-		{   // if texture hasn't been loaded already, load it
+
+		// small textures packed by the cooker share an array texture owned by the atlas, not the registry
+		if (const TextureAtlas::Entry* AtlasEntry = TextureAtlas::Get().Find(Directory + '/' + Ref.Path))
+		{
 			Texture texture;
-			texture.ID = TextureFromFile(str.C_Str(), Directory);
-			texture.Type = TypeName;
-			texture.Path = str.C_Str();
+			texture.ID = AtlasEntry->TextureID;
+			texture.Type = Ref.Type;
+			texture.Path = Ref.Path;
+			texture.AtlasLayer = AtlasEntry->Layer;
+			texture.AtlasRect = AtlasEntry->Rect;
 			textures.push_back(texture);
-			LoadedTextures.push_back(texture); // add to loaded textures
+			continue;
 		}
+
+		// the registry hands back the already resident texture when any model has loaded this file before
+		const std::string TexturePath = Directory + '/' + Ref.Path;
+		auto FoundHash = Hashes ? Hashes->find(TexturePath) : TextureContentHashes::const_iterator();
+		const uint64_t TextureHash = Hashes && FoundHash != Hashes->end() ? FoundHash->second : 0;
+		const TextureHandle Handle = AssetRegistry::Get().AcquireTexture(TexturePath, Ref.Type, TextureHash);
+		OutTextures.push_back(Handle);
+
+		Texture texture;
+		texture.ID = AssetRegistry::Get().GetTextureID(Handle);
+		texture.Type = Ref.Type;
+		texture.Path = Ref.Path;
+		textures.push_back(texture);
 	}
 	return textures;
 }
 
-unsigned int Model::TextureFromFile(const char* InFilePath, const std::string& InDirectory, bool bGamma)
+void Model::HashMaterialTextures(const std::string& Directory, const std::vector<MaterialTextureRef>& TextureRefs, TextureContentHashes& InOutHashes)
 {
-	std::string Filename = std::string(InFilePath);
-	Filename = InDirectory + '/' + Filename;
+	for (const MaterialTextureRef& Ref : TextureRefs)
+	{
+		const std::string TexturePath = Directory + '/' + Ref.Path;
+		uint64_t TextureHash;
+		if (InOutHashes.count(TexturePath) == 0 && Hash::File(TexturePath, TextureHash))
+		{
+			InOutHashes[TexturePath] = TextureHash;
+		}
+	}
+}
 
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
+ModelLoad::ModelLoad(std::string InFilePath)
+	: FilePath(std::move(InFilePath))
+{
+	Directory = FilePath.substr(0, FilePath.find_last_of('/'));
+}
 
-	int width, height, nrComponents;
-	unsigned char* data = stbi_load(Filename.c_str(), &width, &height, &nrComponents, 0);
-	if (data)
+ModelLoad::~ModelLoad()
+{
+	// meshes free their buffers themselves, textures are only referenced
+	for (TextureHandle Texture : Textures)
 	{
-		GLenum format;
-		if (nrComponents == 1) 
+		AssetRegistry::Get().Release(Texture);
+	}
+}
+
+bool ModelLoad::Prepare(bool bHashContent)
+{
+	if (bHashContent && !Hash::File(FilePath, ContentHash))
+	{
+		ContentHash = 0;
+	}
+
+	// prefer the cooked version of the model when the cooker has produced one
+	const std::string CookedPath = CookedMesh::GetCookedPath(FilePath);
+	if (CookedFile::IsUpToDate(CookedPath, FilePath))
+	{
+		Cooked.reset(new CookedMeshFile());
+		if (Cooked->Open(CookedPath) && Cooked->ReadAnimation(Animation))
 		{
-			format = GL_RED;
+			bPrepared = true;
 		}
-		else if (nrComponents == 3)
+		else
 		{
-			format = GL_RGB;
+			Cooked.reset();
+			Animation = AnimationSet();
 		}
-		else if (nrComponents == 4)
+	}
+
+	if (!Cooked)
+	{
+		AnimationSetData ImportedAnimation;
+		if (!Model::ImportMeshData(FilePath, Imported, EModelImporter::Auto, nullptr, &ImportedAnimation))
 		{
-			format = GL_RGBA;
+			return false;
 		}
 
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+		MeshOptimizer::OptimizeMeshes(Imported);
+		if (!ImportedAnimation.IsEmpty())
+		{
+			AnimationCompressor::Compress(ImportedAnimation, Animation);
+		}
+		MeshSimplifier::BuildLodChains(Imported);
+		MeshletBuilder::BuildAllMeshlets(Imported);
+		bPrepared = true;
+	}
 
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	if (bHashContent)
+	{
+		std::vector<MaterialTextureRef> TextureRefs;
+		for (size_t i = 0; i < GetMeshCount(); i++)
+		{
+			GetTextureRefs(i, TextureRefs);
+			Model::HashMaterialTextures(Directory, TextureRefs, TextureHashes);
+		}
+	}
+	return true;
+}
 
-		stbi_image_free(data);
+bool ModelLoad::PrepareGeometry()
+{
+	const std::string CookedPath = CookedMesh::GetCookedPath(FilePath);
+	if (CookedFile::IsUpToDate(CookedPath, FilePath))
+	{
+		Cooked.reset(new CookedMeshFile());
+		if (Cooked->Open(CookedPath))
+		{
+			bPrepared = bGeometryOnly = true;
+			return true;
+		}
+		Cooked.reset();
 	}
-	else
+
+	// the skeleton is still needed, skinned meshes only get their weights with it
+	AnimationSetData ImportedAnimation;
+	if (!Model::ImportMeshData(FilePath, Imported, EModelImporter::Auto, nullptr, &ImportedAnimation))
 	{
-		std::cout << "Texture failed to load at path: " << InFilePath << std::endl;
-		stbi_image_free(data);
+		return false;
 	}
 
-	return textureID;
-}
\ No newline at end of file
+	MeshOptimizer::OptimizeMeshes(Imported);
+	bPrepared = bGeometryOnly = true;
+	return true;
+}
+
+size_t ModelLoad::GetMeshCount() const
+{
+	return Cooked ? Cooked->GetMeshCount() : Imported.size();
+}
+
+bool ModelLoad::ReadMesh(size_t MeshIndex, MeshData& OutData) const
+{
+	OutData = MeshData();
+	if (!bPrepared || MeshIndex >= GetMeshCount() || NextMesh > 0)
+	{
+		return false;
+	}
+
+	if (!Cooked)
+	{
+		const MeshData& Source = Imported[MeshIndex];
+		const size_t IndexCount = Source.Lods.empty() ? Source.Indices.size() : Source.Lods[0].IndexCount;
+		OutData.Vertices = Source.Vertices;
+		OutData.Indices.assign(Source.Indices.begin(), Source.Indices.begin() + IndexCount);
+		OutData.TextureRefs = Source.TextureRefs;
+		OutData.Skin = Source.Skin;
+		return true;
+	}
+
+	const CookedMesh::MeshRecord& Record = Cooked->GetMesh(static_cast<uint32_t>(MeshIndex));
+	const MeshUploadData Upload = Cooked->GetUploadData(Record);
+	VertexFormat::Decode(Upload, OutData.Vertices, OutData.Indices);
+	GetTextureRefs(MeshIndex, OutData.TextureRefs);
+	if (Upload.Skin)
+	{
+		OutData.Skin.assign(Upload.Skin, Upload.Skin + Upload.VertexCount);
+	}
+	return true;
+}
+
+bool ModelLoad::Upload(size_t& InOutBytesUsed, size_t Budget)
+{
+	if (!bPrepared || bGeometryOnly)
+	{
+		return false;
+	}
+
+	Meshes.reserve(GetMeshCount());
+
+	std::vector<MaterialTextureRef> TextureRefs;
+	for (bool bFirst = true; NextMesh < GetMeshCount() && (bFirst || InOutBytesUsed < Budget); bFirst = false, NextMesh++)
+	{
+		if (Cooked)
+		{
+			const CookedMesh::MeshRecord& Record = Cooked->GetMesh(static_cast<uint32_t>(NextMesh));
+			GetTextureRefs(NextMesh, TextureRefs);
+
+			// glBufferData copies out of the mapping, so the file can be closed as soon as every mesh is uploaded
+			const MeshUploadData Upload = Cooked->GetUploadData(Record);
+			Meshes.emplace_back(Upload, Model::LoadMaterialTextures(Directory, TextureRefs, Textures, &TextureHashes));
+		}
+		else
+		{
+			// the mesh takes the imported arrays over, they are not needed here once it is uploaded
+			MeshData& Data = Imported[NextMesh];
+			std::vector<Texture> MeshTextures = Model::LoadMaterialTextures(Directory, Data.TextureRefs, Textures, &TextureHashes);
+			Meshes.emplace_back(std::move(Data), std::move(MeshTextures));
+		}
+		InOutBytesUsed += Meshes.back().GetGpuBytes();
+	}
+
+	if (NextMesh < GetMeshCount())
+	{
+		return false;
+	}
+
+	// nothing else reads the source data once every mesh is on the GPU
+	Cooked.reset();
+	Imported.clear();
+	Imported.shrink_to_fit();
+	TextureHashes.clear();
+	return true;
+}
+
+void ModelLoad::GetTextureRefs(size_t MeshIndex, std::vector<MaterialTextureRef>& OutRefs) const
+{
+	if (!Cooked)
+	{
+		OutRefs = Imported[MeshIndex].TextureRefs;
+		return;
+	}
+
+	const CookedMesh::MeshRecord& Record = Cooked->GetMesh(static_cast<uint32_t>(MeshIndex));
+	OutRefs.clear();
+	for (uint32_t j = 0; j < Record.TextureRefCount; j++)
+	{
+		const CookedMesh::TextureRefRecord& Ref = Cooked->GetTextureRef(Record.FirstTextureRef + j);
+		OutRefs.push_back({ Cooked->GetString(Ref.TypeOffset), Cooked->GetString(Ref.PathOffset) });
+	}
+}
+
+bool ModelLoad::TakeResult(std::vector<Mesh>& OutMeshes, std::vector<TextureHandle>& OutTextures, AnimationSet& OutAnimation)
+{
+	if (!IsUploaded())
+	{
+		return false;
+	}
+
+	OutMeshes = std::move(Meshes);
+	OutTextures = std::move(Textures);
+	OutAnimation = std::move(Animation);
+	Meshes.clear();
+	Textures.clear();
+	return true;
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -7,29 +10,165 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "Engine/Animation/AnimationData.h"
+#include "Engine/Asset/AssetRegistry.h"
+#include "Engine/Renderer/RenderView.h"
 #include "Engine/Shader/ShaderProgram.h"
 #include "Mesh.h"
 
+// Which importer Model::ImportMeshData goes through
+enum class EModelImporter
+{
+	Auto,      // native OBJ reader for .obj files (falling back to assimp if it fails), assimp for everything else
+	Assimp,
+	NativeObj
+};
+
+class CookedMeshFile;
+
+// A model load split in two, so the file can be read or imported away from the GL thread and its meshes created a
+// few at a time. Prepare makes no GL calls and may run on any thread, Upload and the Model constructor taking the
+// load run on the GL thread. Meshes and textures of a load that never becomes a model are freed with it.
+class ModelLoad
+{
+public:
+	explicit ModelLoad(std::string InFilePath);
+	~ModelLoad();
+
+	ModelLoad(const ModelLoad&) = delete;
+	ModelLoad& operator=(const ModelLoad&) = delete;
+
+	// Maps the cooked model, or imports and processes the source when there is no up to date one. bHashContent
+	// also hashes the file and its textures for the asset registry, so finishing the load does not read them on the
+	// GL thread.
+	bool Prepare(bool bHashContent = false);
+
+	// Prepares only what ReadMesh returns, for code that merges the geometry instead of uploading the model: the
+	// cooked model is mapped without copying its animation out, a source is imported without compressing its clips
+	// or building LODs and meshlets. Upload fails afterwards.
+	bool PrepareGeometry();
+
+	// Creates meshes until InOutBytesUsed reaches Budget, at least one per call so a mesh larger than the budget
+	// still goes through. Returns true once every mesh has been created.
+	bool Upload(size_t& InOutBytesUsed, size_t Budget);
+
+	bool IsUploaded() const { return bPrepared && NextMesh == GetMeshCount(); }
+	const std::string& GetFilePath() const { return FilePath; }
+	const std::string& GetDirectory() const { return Directory; }
+
+	size_t GetMeshCount() const;
+
+	// Full vertices and LOD 0 indices of a prepared mesh with its texture references and skin, decoded from the
+	// cooked file when there is one. For code merging geometry on the CPU, only valid before Upload.
+	bool ReadMesh(size_t MeshIndex, MeshData& OutData) const;
+
+private:
+	friend class Model;
+
+	// Hands the created meshes, their textures and the animation to the asset registry
+	bool TakeResult(std::vector<Mesh>& OutMeshes, std::vector<TextureHandle>& OutTextures, AnimationSet& OutAnimation);
+
+	// Texture references of a prepared mesh, read from the cooked file when there is one
+	void GetTextureRefs(size_t MeshIndex, std::vector<MaterialTextureRef>& OutRefs) const;
+
+	std::string FilePath;
+	std::string Directory;
+	uint64_t ContentHash = 0;
+	TextureContentHashes TextureHashes;
+	bool bPrepared = false;
+	bool bGeometryOnly = false;
+
+	// exactly one of them holds the meshes once prepared
+	std::unique_ptr<CookedMeshFile> Cooked;
+	std::vector<MeshData> Imported;
+
+	AnimationSet Animation;
+	std::vector<Mesh> Meshes;
+	std::vector<TextureHandle> Textures;
+	size_t NextMesh = 0;
+};
+
+// LOD chosen for each mesh last frame. Selection depends on it, so every placement of a model needs its own.
+struct ModelLodState
+{
+	std::vector<unsigned int> MeshLods;
+};
+
 class Model
 {
 public:
 	Model(std::string FilePath);
 
+	// Finishes a load prepared off the GL thread, meshes another model loaded from the file in the meantime are
+	// shared instead and the load's own are left to be freed with it
+	explicit Model(ModelLoad& Load);
+
+	~Model();
+
+	// a model owns one reference to its meshes, so it can be moved but not copied
+	Model(const Model&) = delete;
+	Model& operator=(const Model&) = delete;
+	Model(Model&& Other);
+	Model& operator=(Model&& Other);
+
 	void Draw(ShaderProgram& Shader);
 
+	// Sets the model matrix and draws every mesh at the LOD its projected error allows, meshes drawn at LOD 0 are
+	// cluster culled when they have meshlets. A skinned model has to be drawn with SkinnedVertexShader.vert and the
+	// pose bound (SkinningPalette::Bind).
+	void Draw(ShaderProgram& Shader, const glm::mat4& ModelMatrix, const RenderView& View, ModelLodState& State);
+
+	// Draws one instance per entry of InstancePixelsPerUnit, each instance's screen size in pixels per model unit
+	// sorted from largest to smallest. LODs follow the sort order, so every mesh takes one instanced draw per LOD in
+	// use and the shader's per-instance data has to be in the same order. Instances have no LOD state of their own,
+	// so there is no hysteresis.
+	void DrawInstanced(ShaderProgram& Shader, const std::vector<float>& InstancePixelsPerUnit, const RenderView& View);
+
+	// Bounding sphere of every mesh in model space, false if the model failed to load
+	bool GetBounds(glm::vec3& OutCenter, float& OutRadius) const;
+
+	// Vertex and index memory of the meshes on the GPU and in their CPU side copies, shared with every other model
+	// loaded from the file
+	size_t GetMemoryBytes() const;
+
+	// Acquires every texture from the asset registry, the handles are added to OutTextures and have to be released
+	// by the caller, a model releases them together with its meshes. Paths are relative to Directory. Textures found
+	// in Hashes are not read again when the registry misses on their path.
+	static std::vector<Texture> LoadMaterialTextures(const std::string& Directory, const std::vector<MaterialTextureRef>& TextureRefs, std::vector<TextureHandle>& OutTextures,
+		const TextureContentHashes* Hashes = nullptr);
+
+	// Hashes the files of the references not in InOutHashes yet, any thread
+	static void HashMaterialTextures(const std::string& Directory, const std::vector<MaterialTextureRef>& TextureRefs, TextureContentHashes& InOutHashes);
+
+	// Skeleton and clips of a skinned model, null for a static one. Shared by every model loaded from the file and
+	// valid for as long as this model is.
+	const AnimationSet* GetAnimation() const;
+
+	// Imports the file and converts every mesh into CPU side data, no GL calls are made so this is
+	// also what the offline cooker uses. OutDependencies, when given, receives every file the importer read or
+	// looked for (the model itself, material libraries, ...), missing ones included, so the cooker can tell when a
+	// re-import is needed.
+	// OutAnimation, when given, receives the skeleton and uncompressed clips of a skinned model (see
+	// AnimationCompressor) and skinned meshes get their weights in MeshData::Skin. It is left empty for static models.
+	static bool ImportMeshData(const std::string& FilePath, std::vector<MeshData>& OutMeshes, EModelImporter InImporter = EModelImporter::Auto,
+		std::vector<std::string>* OutDependencies = nullptr, AnimationSetData* OutAnimation = nullptr);
+
 private:
-    void LoadModel(std::string FilePath);
+    friend class ModelLoad;
 
-    void ProcessNode(aiNode* Node, const aiScene* Scene);
-    Mesh ProcessMesh(aiMesh* InMesh, const aiScene* Scene);
+    // Called by the asset registry when no other model has loaded the file yet, prepares and uploads in one go
+    static bool LoadModel(const std::string& FilePath, std::vector<Mesh>& OutMeshes, std::vector<TextureHandle>& OutTextures, AnimationSet& OutAnimation);
 
-    std::vector<Texture> LoadMaterialTextures(aiMaterial* Material, aiTextureType Type, std::string TypeName);
+    // Collects the meshes of the node and its children depth first, which is the order the model keeps them in
+    static void ProcessNode(aiNode* Node, const aiScene* Scene, std::vector<aiMesh*>& OutMeshes);
 
-    unsigned int TextureFromFile(const char* InFilePath, const std::string& InDirectory, bool bGamma = false);
+    // Converts one mesh, only reads the scene so meshes convert in parallel. Skeleton is null when the scene has
+    // none or the caller did not ask for animation.
+    static MeshData ProcessMesh(aiMesh* InMesh, const aiScene* Scene, const SkeletonData* Skeleton);
+
+    static void GetMaterialTextureRefs(aiMaterial* Material, aiTextureType Type, const std::string& TypeName, std::vector<MaterialTextureRef>& OutRefs);
 
     // model data
-    std::vector<Mesh> Meshes;
     std::string Directory;
-
-    std::vector<Texture> LoadedTextures;
-};
\ No newline at end of file
+    MeshHandle MeshAsset;
+};
@@ -0,0 +1,668 @@
+#include "ObjParser.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+#include "Engine/Core/VirtualFileSystem.h"
+#include "Engine/Core/ThreadPool.h"
+
+namespace
+{
+	// Indices are 0-based once a chunk has been fixed up, -1 marks a missing texture coordinate or normal
+	struct ObjCorner
+	{
+		int32_t Position;
+		int32_t TexCoord;
+		int32_t Normal;
+	};
+
+	enum class EObjEvent : uint8_t
+	{
+		NewMesh,        // 'o' or 'g'
+		UseMaterial,
+		MaterialLibrary
+	};
+
+	struct ObjEvent
+	{
+		EObjEvent Type;
+		uint32_t FaceIndex; // index of the first face (within the chunk) the event applies to
+		std::string Name;
+	};
+
+	struct ObjChunk
+	{
+		const char* Begin = nullptr;
+		const char* End = nullptr;
+
+		std::vector<glm::vec3> Positions;
+		std::vector<glm::vec2> TexCoords;
+		std::vector<glm::vec3> Normals;
+
+		std::vector<ObjCorner> Corners;
+		std::vector<uint32_t> FaceStarts; // first corner of each face, plus a trailing end marker
+		std::vector<ObjEvent> Events;
+
+		// Negative OBJ indices are relative to the vertices read so far, which a chunk only knows locally.
+		// They are stored chunk-relative and listed here (corner * 3 + component) so they can be rebased later.
+		std::vector<uint32_t> RelativeComponents;
+
+		size_t PositionBase = 0;
+		size_t TexCoordBase = 0;
+		size_t NormalBase = 0;
+	};
+
+	struct ObjMaterial
+	{
+		std::vector<MaterialTextureRef> TextureRefs;
+	};
+
+	struct ObjFaceRange
+	{
+		uint32_t Chunk;
+		uint32_t FirstFace;
+		uint32_t EndFace;
+	};
+
+	struct ObjMeshBuild
+	{
+		std::string Material;
+		std::vector<ObjFaceRange> Ranges;
+	};
+
+	bool IsLineSpace(char C)
+	{
+		return C == ' ' || C == '\t';
+	}
+
+	void SkipLineSpace(const char*& Cursor, const char* End)
+	{
+		while (Cursor < End && IsLineSpace(*Cursor))
+		{
+			Cursor++;
+		}
+	}
+
+	const char* FindLineEnd(const char* Cursor, const char* End)
+	{
+		while (Cursor < End && *Cursor != '\n' && *Cursor != '\r')
+		{
+			Cursor++;
+		}
+		return Cursor;
+	}
+
+	// Locale independent float parser, a lot faster than strtof for the plain decimal numbers exporters write
+	float ParseFloat(const char*& Cursor, const char* End)
+	{
+		SkipLineSpace(Cursor, End);
+
+		bool bNegative = false;
+		if (Cursor < End && (*Cursor == '-' || *Cursor == '+'))
+		{
+			bNegative = *Cursor == '-';
+			Cursor++;
+		}
+
+		double Value = 0.0;
+		while (Cursor < End && *Cursor >= '0' && *Cursor <= '9')
+		{
+			Value = Value * 10.0 + (*Cursor - '0');
+			Cursor++;
+		}
+
+		if (Cursor < End && *Cursor == '.')
+		{
+			Cursor++;
+			double Scale = 0.1;
+			while (Cursor < End && *Cursor >= '0' && *Cursor <= '9')
+			{
+				Value += (*Cursor - '0') * Scale;
+				Scale *= 0.1;
+				Cursor++;
+			}
+		}
+
+		if (Cursor < End && (*Cursor == 'e' || *Cursor == 'E'))
+		{
+			Cursor++;
+			bool bNegativeExponent = false;
+			if (Cursor < End && (*Cursor == '-' || *Cursor == '+'))
+			{
+				bNegativeExponent = *Cursor == '-';
+				Cursor++;
+			}
+
+			int Exponent = 0;
+			while (Cursor < End && *Cursor >= '0' && *Cursor <= '9')
+			{
+				Exponent = Exponent * 10 + (*Cursor - '0');
+				Cursor++;
+			}
+
+			double Power = 1.0;
+			for (int i = 0; i < Exponent && i < 64; i++)
+			{
+				Power *= 10.0;
+			}
+			Value = bNegativeExponent ? Value / Power : Value * Power;
+		}
+
+		return static_cast<float>(bNegative ? -Value : Value);
+	}
+
+	bool ParseInt(const char*& Cursor, const char* End, int32_t& OutValue)
+	{
+		bool bNegative = false;
+		if (Cursor < End && *Cursor == '-')
+		{
+			bNegative = true;
+			Cursor++;
+		}
+
+		if (Cursor >= End || *Cursor < '0' || *Cursor > '9')
+		{
+			return false;
+		}
+
+		int32_t Value = 0;
+		while (Cursor < End && *Cursor >= '0' && *Cursor <= '9')
+		{
+			Value = Value * 10 + (*Cursor - '0');
+			Cursor++;
+		}
+
+		OutValue = bNegative ? -Value : Value;
+		return true;
+	}
+
+	std::string ParseName(const char* Cursor, const char* End)
+	{
+		SkipLineSpace(Cursor, End);
+		const char* NameEnd = End;
+		while (NameEnd > Cursor && IsLineSpace(*(NameEnd - 1)))
+		{
+			NameEnd--;
+		}
+		return std::string(Cursor, NameEnd);
+	}
+
+	// Converts a 1-based (or negative, relative) OBJ index into a 0-based index. Relative indices are resolved
+	// against the chunk-local count and recorded for rebasing once the chunk bases are known.
+	int32_t ResolveIndex(int32_t RawIndex, size_t LocalCount, ObjChunk& Chunk, uint32_t Component)
+	{
+		if (RawIndex > 0)
+		{
+			return RawIndex - 1;
+		}
+
+		Chunk.RelativeComponents.push_back(Component);
+		return static_cast<int32_t>(LocalCount) + RawIndex;
+	}
+
+	void ParseFace(const char* Cursor, const char* End, ObjChunk& Chunk)
+	{
+		Chunk.FaceStarts.push_back(static_cast<uint32_t>(Chunk.Corners.size()));
+
+		for (;;)
+		{
+			SkipLineSpace(Cursor, End);
+			if (Cursor >= End)
+			{
+				break;
+			}
+
+			const uint32_t CornerIndex = static_cast<uint32_t>(Chunk.Corners.size());
+			ObjCorner Corner = { -1, -1, -1 };
+			int32_t Value;
+
+			if (!ParseInt(Cursor, End, Value))
+			{
+				break;
+			}
+			Corner.Position = ResolveIndex(Value, Chunk.Positions.size(), Chunk, CornerIndex * 3 + 0);
+
+			if (Cursor < End && *Cursor == '/')
+			{
+				Cursor++;
+				if (ParseInt(Cursor, End, Value))
+				{
+					Corner.TexCoord = ResolveIndex(Value, Chunk.TexCoords.size(), Chunk, CornerIndex * 3 + 1);
+				}
+				if (Cursor < End && *Cursor == '/')
+				{
+					Cursor++;
+					if (ParseInt(Cursor, End, Value))
+					{
+						Corner.Normal = ResolveIndex(Value, Chunk.Normals.size(), Chunk, CornerIndex * 3 + 2);
+					}
+				}
+			}
+
+			Chunk.Corners.push_back(Corner);
+
+			// skip anything unexpected up to the next separator
+			while (Cursor < End && !IsLineSpace(*Cursor))
+			{
+				Cursor++;
+			}
+		}
+
+		// lines and points are dropped, only polygons make it into the meshes
+		if (Chunk.Corners.size() - Chunk.FaceStarts.back() < 3)
+		{
+			Chunk.Corners.resize(Chunk.FaceStarts.back());
+			Chunk.FaceStarts.pop_back();
+		}
+	}
+
+	void ParseChunk(ObjChunk& Chunk)
+	{
+		const char* Cursor = Chunk.Begin;
+		const char* End = Chunk.End;
+
+		while (Cursor < End)
+		{
+			SkipLineSpace(Cursor, End);
+			const char* LineEnd = FindLineEnd(Cursor, End);
+
+			if (LineEnd - Cursor >= 2)
+			{
+				const char C0 = Cursor[0];
+				const char C1 = Cursor[1];
+
+				if (C0 == 'v' && IsLineSpace(C1))
+				{
+					const char* Values = Cursor + 2;
+					glm::vec3 Position;
+					Position.x = ParseFloat(Values, LineEnd);
+					Position.y = ParseFloat(Values, LineEnd);
+					Position.z = ParseFloat(Values, LineEnd);
+					Chunk.Positions.push_back(Position);
+				}
+				else if (C0 == 'v' && C1 == 't')
+				{
+					const char* Values = Cursor + 2;
+					glm::vec2 TexCoord;
+					TexCoord.x = ParseFloat(Values, LineEnd);
+					TexCoord.y = ParseFloat(Values, LineEnd);
+					Chunk.TexCoords.push_back(TexCoord);
+				}
+				else if (C0 == 'v' && C1 == 'n')
+				{
+					const char* Values = Cursor + 2;
+					glm::vec3 Normal;
+					Normal.x = ParseFloat(Values, LineEnd);
+					Normal.y = ParseFloat(Values, LineEnd);
+					Normal.z = ParseFloat(Values, LineEnd);
+					Chunk.Normals.push_back(Normal);
+				}
+				else if (C0 == 'f' && IsLineSpace(C1))
+				{
+					ParseFace(Cursor + 2, LineEnd, Chunk);
+				}
+				else if ((C0 == 'o' || C0 == 'g') && IsLineSpace(C1))
+				{
+					Chunk.Events.push_back({ EObjEvent::NewMesh, static_cast<uint32_t>(Chunk.FaceStarts.size()), ParseName(Cursor + 2, LineEnd) });
+				}
+				else if (LineEnd - Cursor > 7 && std::equal(Cursor, Cursor + 7, "usemtl "))
+				{
+					Chunk.Events.push_back({ EObjEvent::UseMaterial, static_cast<uint32_t>(Chunk.FaceStarts.size()), ParseName(Cursor + 7, LineEnd) });
+				}
+				else if (LineEnd - Cursor > 7 && std::equal(Cursor, Cursor + 7, "mtllib "))
+				{
+					Chunk.Events.push_back({ EObjEvent::MaterialLibrary, static_cast<uint32_t>(Chunk.FaceStarts.size()), ParseName(Cursor + 7, LineEnd) });
+				}
+			}
+
+			Cursor = LineEnd;
+			while (Cursor < End && (*Cursor == '\n' || *Cursor == '\r'))
+			{
+				Cursor++;
+			}
+		}
+
+		Chunk.FaceStarts.push_back(static_cast<uint32_t>(Chunk.Corners.size()));
+	}
+
+	void RebaseChunk(ObjChunk& Chunk)
+	{
+		for (uint32_t Component : Chunk.RelativeComponents)
+		{
+			ObjCorner& Corner = Chunk.Corners[Component / 3];
+			switch (Component % 3)
+			{
+			case 0: Corner.Position += static_cast<int32_t>(Chunk.PositionBase); break;
+			case 1: Corner.TexCoord += static_cast<int32_t>(Chunk.TexCoordBase); break;
+			case 2: Corner.Normal += static_cast<int32_t>(Chunk.NormalBase); break;
+			}
+		}
+	}
+
+	// A material statement naming a texture. Bump maps are tangent space normal maps in practice, assimp imports them
+	// as height maps and ProcessMesh treats those as normal maps too.
+	struct TextureStatement
+	{
+		const char* Prefix;
+		const char* Type;
+	};
+
+	const TextureStatement TextureStatements[] = {
+		{ "map_Kd ", "texture_diffuse" },
+		{ "map_Ks ", "texture_specular" },
+		{ "norm ", "texture_normal" },
+		{ "map_Bump ", "texture_normal" },
+		{ "map_bump ", "texture_normal" },
+		{ "bump ", "texture_normal" },
+	};
+
+	const TextureStatement* FindTextureStatement(const std::string& Line)
+	{
+		for (const TextureStatement& Statement : TextureStatements)
+		{
+			if (Line.compare(0, std::strlen(Statement.Prefix), Statement.Prefix) == 0)
+			{
+				return &Statement;
+			}
+		}
+		return nullptr;
+	}
+
+	int GetTextureTypeOrder(const std::string& Type)
+	{
+		return Type == "texture_diffuse" ? 0 : (Type == "texture_specular" ? 1 : 2);
+	}
+
+	void ParseMaterialLibrary(const std::string& FilePath, std::unordered_map<std::string, ObjMaterial>& OutMaterials)
+	{
+		VirtualFile File;
+		if (!File.Open(FilePath))
+		{
+			std::cout << "ERROR::OBJPARSER::Could not open material library " << FilePath << std::endl;
+			return;
+		}
+
+		const char* Cursor = reinterpret_cast<const char*>(File.GetData());
+		const char* End = Cursor + File.GetSize();
+		ObjMaterial* Current = nullptr;
+
+		while (Cursor < End)
+		{
+			SkipLineSpace(Cursor, End);
+			const char* LineEnd = FindLineEnd(Cursor, End);
+			const std::string Line(Cursor, LineEnd);
+
+			if (Line.compare(0, 7, "newmtl ") == 0)
+			{
+				Current = &OutMaterials[ParseName(Line.c_str() + 7, Line.c_str() + Line.size())];
+			}
+			else if (const TextureStatement* Statement = Current ? FindTextureStatement(Line) : nullptr)
+			{
+				// texture options (-bm 1.0 etc.) come before the file name, so only the last token is kept
+				std::string Path = ParseName(Line.c_str() + std::strlen(Statement->Prefix), Line.c_str() + Line.size());
+				const size_t LastSpace = Path.find_last_of(" \t");
+				if (LastSpace != std::string::npos)
+				{
+					Path = Path.substr(LastSpace + 1);
+				}
+
+				Current->TextureRefs.push_back({ Statement->Type, Path });
+			}
+
+			Cursor = LineEnd;
+			while (Cursor < End && (*Cursor == '\n' || *Cursor == '\r'))
+			{
+				Cursor++;
+			}
+		}
+
+		// keep the same order ProcessMesh uses, diffuse maps first then specular maps then normal maps
+		for (auto& Material : OutMaterials)
+		{
+			std::stable_sort(Material.second.TextureRefs.begin(), Material.second.TextureRefs.end(),
+				[](const MaterialTextureRef& A, const MaterialTextureRef& B) { return GetTextureTypeOrder(A.Type) < GetTextureTypeOrder(B.Type); });
+		}
+	}
+
+	uint32_t HashCorner(const ObjCorner& Corner)
+	{
+		uint32_t Hash = static_cast<uint32_t>(Corner.Position) * 73856093u;
+		Hash ^= static_cast<uint32_t>(Corner.TexCoord) * 19349663u;
+		Hash ^= static_cast<uint32_t>(Corner.Normal) * 83492791u;
+		return Hash;
+	}
+
+	bool BuildMesh(const ObjMeshBuild& Build, const std::vector<ObjChunk>& Chunks, const std::vector<glm::vec3>& Positions,
+		const std::vector<glm::vec2>& TexCoords, const std::vector<glm::vec3>& Normals, MeshData& OutData)
+	{
+		size_t CornerCount = 0;
+		for (const ObjFaceRange& Range : Build.Ranges)
+		{
+			const ObjChunk& Chunk = Chunks[Range.Chunk];
+			CornerCount += Chunk.FaceStarts[Range.EndFace] - Chunk.FaceStarts[Range.FirstFace];
+		}
+
+		// open addressing table mapping unique corners to output vertices
+		size_t TableSize = 64;
+		while (TableSize < CornerCount * 2)
+		{
+			TableSize *= 2;
+		}
+		std::vector<uint32_t> Table(TableSize, UINT32_MAX);
+		std::vector<ObjCorner> UniqueCorners;
+		UniqueCorners.reserve(CornerCount / 2);
+
+		std::vector<uint32_t> FaceVertices;
+		OutData.Indices.reserve(CornerCount * 3 / 2);
+
+		for (const ObjFaceRange& Range : Build.Ranges)
+		{
+			const ObjChunk& Chunk = Chunks[Range.Chunk];
+			for (uint32_t Face = Range.FirstFace; Face < Range.EndFace; Face++)
+			{
+				FaceVertices.clear();
+				for (uint32_t c = Chunk.FaceStarts[Face]; c < Chunk.FaceStarts[Face + 1]; c++)
+				{
+					const ObjCorner& Corner = Chunk.Corners[c];
+					if (Corner.Position < 0 || static_cast<size_t>(Corner.Position) >= Positions.size() ||
+						static_cast<size_t>(Corner.TexCoord + 1) > TexCoords.size() || static_cast<size_t>(Corner.Normal + 1) > Normals.size())
+					{
+						std::cout << "ERROR::OBJPARSER::Face references a vertex that does not exist" << std::endl;
+						return false;
+					}
+
+					size_t Slot = HashCorner(Corner) & (TableSize - 1);
+					for (;;)
+					{
+						const uint32_t Existing = Table[Slot];
+						if (Existing == UINT32_MAX)
+						{
+							Table[Slot] = static_cast<uint32_t>(UniqueCorners.size());
+							FaceVertices.push_back(Table[Slot]);
+							UniqueCorners.push_back(Corner);
+							break;
+						}
+
+						const ObjCorner& Other = UniqueCorners[Existing];
+						if (Other.Position == Corner.Position && Other.TexCoord == Corner.TexCoord && Other.Normal == Corner.Normal)
+						{
+							FaceVertices.push_back(Existing);
+							break;
+						}
+						Slot = (Slot + 1) & (TableSize - 1);
+					}
+				}
+
+				for (size_t i = 1; i + 1 < FaceVertices.size(); i++)
+				{
+					OutData.Indices.push_back(FaceVertices[0]);
+					OutData.Indices.push_back(FaceVertices[i]);
+					OutData.Indices.push_back(FaceVertices[i + 1]);
+				}
+			}
+		}
+
+		OutData.Vertices.resize(UniqueCorners.size());
+		for (size_t i = 0; i < UniqueCorners.size(); i++)
+		{
+			const ObjCorner& Corner = UniqueCorners[i];
+			Vertex& Out = OutData.Vertices[i];
+			Out.Position = Positions[Corner.Position];
+			Out.Normal = Corner.Normal >= 0 ? Normals[Corner.Normal] : glm::vec3(0.0f, 0.0f, 0.0f);
+			// matches aiProcess_FlipUVs
+			Out.TexCoords = Corner.TexCoord >= 0 ? glm::vec2(TexCoords[Corner.TexCoord].x, 1.0f - TexCoords[Corner.TexCoord].y) : glm::vec2(0.0f, 0.0f);
+		}
+
+		return true;
+	}
+}
+
+bool ObjParser::Parse(const std::string& FilePath, std::vector<MeshData>& OutMeshes, std::vector<std::string>* OutDependencies)
+{
+	VirtualFile File;
+	if (!File.Open(FilePath))
+	{
+		std::cout << "ERROR::OBJPARSER::Could not open " << FilePath << std::endl;
+		return false;
+	}
+	if (OutDependencies)
+	{
+		OutDependencies->push_back(FilePath);
+	}
+
+	ThreadPool& Pool = ThreadPool::Get();
+
+	// split the file into a few chunks per thread, every chunk ends just after a newline
+	const char* FileBegin = reinterpret_cast<const char*>(File.GetData());
+	const char* FileEnd = FileBegin + File.GetSize();
+
+	const size_t MinChunkSize = 256 * 1024;
+	const size_t DesiredChunks = std::max<size_t>(1, std::min<size_t>((Pool.GetThreadCount() + 1) * 4, File.GetSize() / MinChunkSize));
+	const size_t ChunkSize = File.GetSize() / DesiredChunks + 1;
+
+	std::vector<ObjChunk> Chunks;
+	Chunks.reserve(DesiredChunks);
+
+	const char* ChunkBegin = FileBegin;
+	while (ChunkBegin < FileEnd)
+	{
+		const char* ChunkEnd = FileEnd - ChunkBegin > static_cast<ptrdiff_t>(ChunkSize) ? ChunkBegin + ChunkSize : FileEnd;
+		while (ChunkEnd < FileEnd && *(ChunkEnd - 1) != '\n')
+		{
+			ChunkEnd++;
+		}
+
+		Chunks.emplace_back();
+		Chunks.back().Begin = ChunkBegin;
+		Chunks.back().End = ChunkEnd;
+		ChunkBegin = ChunkEnd;
+	}
+
+	Pool.ParallelFor(Chunks.size(), [&Chunks](size_t Index) { ParseChunk(Chunks[Index]); });
+
+	// every chunk now knows how many attributes came before it
+	size_t PositionCount = 0, TexCoordCount = 0, NormalCount = 0;
+	for (ObjChunk& Chunk : Chunks)
+	{
+		Chunk.PositionBase = PositionCount;
+		Chunk.TexCoordBase = TexCoordCount;
+		Chunk.NormalBase = NormalCount;
+		PositionCount += Chunk.Positions.size();
+		TexCoordCount += Chunk.TexCoords.size();
+		NormalCount += Chunk.Normals.size();
+	}
+
+	std::vector<glm::vec3> Positions(PositionCount);
+	std::vector<glm::vec2> TexCoords(TexCoordCount);
+	std::vector<glm::vec3> Normals(NormalCount);
+
+	Pool.ParallelFor(Chunks.size(), [&](size_t Index)
+	{
+		ObjChunk& Chunk = Chunks[Index];
+		std::copy(Chunk.Positions.begin(), Chunk.Positions.end(), Positions.begin() + Chunk.PositionBase);
+		std::copy(Chunk.TexCoords.begin(), Chunk.TexCoords.end(), TexCoords.begin() + Chunk.TexCoordBase);
+		std::copy(Chunk.Normals.begin(), Chunk.Normals.end(), Normals.begin() + Chunk.NormalBase);
+		RebaseChunk(Chunk);
+	});
+
+	// walk the object/material events in file order to find out which faces belong to which mesh
+	const std::string Directory = FilePath.substr(0, FilePath.find_last_of('/') + 1);
+	std::unordered_map<std::string, ObjMaterial> Materials;
+	std::vector<ObjMeshBuild> Builds(1);
+
+	for (uint32_t ChunkIndex = 0; ChunkIndex < Chunks.size(); ChunkIndex++)
+	{
+		const ObjChunk& Chunk = Chunks[ChunkIndex];
+		const uint32_t FaceCount = static_cast<uint32_t>(Chunk.FaceStarts.size() - 1);
+		uint32_t RangeStart = 0;
+
+		auto CloseRange = [&](uint32_t RangeEnd)
+		{
+			if (RangeEnd > RangeStart)
+			{
+				Builds.back().Ranges.push_back({ ChunkIndex, RangeStart, RangeEnd });
+			}
+			RangeStart = RangeEnd;
+		};
+
+		for (const ObjEvent& Event : Chunk.Events)
+		{
+			if (Event.Type == EObjEvent::MaterialLibrary)
+			{
+				ParseMaterialLibrary(Directory + Event.Name, Materials);
+				if (OutDependencies)
+				{
+					OutDependencies->push_back(Directory + Event.Name);
+				}
+				continue;
+			}
+
+			CloseRange(Event.FaceIndex);
+
+			const std::string Material = Builds.back().Material;
+			if (!Builds.back().Ranges.empty())
+			{
+				Builds.emplace_back();
+				Builds.back().Material = Material;
+			}
+			if (Event.Type == EObjEvent::UseMaterial)
+			{
+				Builds.back().Material = Event.Name;
+			}
+		}
+
+		CloseRange(FaceCount);
+	}
+
+	if (Builds.back().Ranges.empty())
+	{
+		Builds.pop_back();
+	}
+
+	const size_t FirstMesh = OutMeshes.size();
+	OutMeshes.resize(FirstMesh + Builds.size());
+
+	std::vector<char> Succeeded(Builds.size(), 0);
+	Pool.ParallelFor(Builds.size(), [&](size_t Index)
+	{
+		MeshData& Data = OutMeshes[FirstMesh + Index];
+		Succeeded[Index] = BuildMesh(Builds[Index], Chunks, Positions, TexCoords, Normals, Data);
+
+		auto Material = Materials.find(Builds[Index].Material);
+		if (Material != Materials.end())
+		{
+			Data.TextureRefs = Material->second.TextureRefs;
+		}
+	});
+
+	if (std::find(Succeeded.begin(), Succeeded.end(), 0) != Succeeded.end())
+	{
+		OutMeshes.resize(FirstMesh);
+		return false;
+	}
+
+	return true;
+}
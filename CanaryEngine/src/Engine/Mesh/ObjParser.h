@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Mesh.h"
+
+// Native Wavefront OBJ/MTL reader used as the fast import path for .obj files. The file is memory mapped and split
+// into chunks on line boundaries which are parsed on every core of the engine thread pool. The output matches what
+// assimp produces with aiProcess_Triangulate | aiProcess_FlipUVs: one mesh per object/group and material, polygons
+// fan triangulated and the V texture coordinate flipped. Unlike assimp, identical position/uv/normal corners inside
+// a mesh share a single vertex.
+namespace ObjParser
+{
+	// OutDependencies, when given, receives every file that was read: the OBJ itself and its material libraries,
+	// including libraries that could not be opened
+	bool Parse(const std::string& FilePath, std::vector<MeshData>& OutMeshes, std::vector<std::string>* OutDependencies = nullptr);
+}
@@ -0,0 +1,186 @@
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/packing.hpp>
+
+#include "Mesh.h"
+
+namespace
+{
+	int16_t PackSnorm16(float Value)
+	{
+		return static_cast<int16_t>(std::lround(glm::clamp(Value, -1.0f, 1.0f) * 32767.0f));
+	}
+
+	uint16_t PackUnorm16(float Value)
+	{
+		return static_cast<uint16_t>(std::lround(glm::clamp(Value, 0.0f, 1.0f) * 65535.0f));
+	}
+
+	float SignNotZero(float Value)
+	{
+		return Value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	void EncodePackedVertices(const std::vector<Vertex>& Vertices, EncodedMesh& OutMesh)
+	{
+		// Flat axes keep a scale of one so decoding never has to special case them
+		const glm::vec3 Extent = OutMesh.Upload.BoundsMax - OutMesh.Upload.BoundsMin;
+		VertexQuantisation& Quantisation = OutMesh.Upload.Quantisation;
+		Quantisation.Offset = OutMesh.Upload.BoundsMin;
+		Quantisation.Scale = glm::vec3(Extent.x > 0.0f ? Extent.x : 1.0f, Extent.y > 0.0f ? Extent.y : 1.0f, Extent.z > 0.0f ? Extent.z : 1.0f);
+
+		OutMesh.VertexBytes.resize(Vertices.size() * sizeof(PackedVertex));
+		PackedVertex* Packed = reinterpret_cast<PackedVertex*>(OutMesh.VertexBytes.data());
+
+		for (size_t i = 0; i < Vertices.size(); i++)
+		{
+			const Vertex& Vert = Vertices[i];
+			const glm::vec3 Normalised = (Vert.Position - Quantisation.Offset) / Quantisation.Scale;
+			const glm::vec2 Octahedral = VertexFormat::EncodeOctahedral(Vert.Normal);
+
+			Packed[i].Position[0] = PackUnorm16(Normalised.x);
+			Packed[i].Position[1] = PackUnorm16(Normalised.y);
+			Packed[i].Position[2] = PackUnorm16(Normalised.z);
+			Packed[i].Position[3] = 0;
+			Packed[i].Normal[0] = PackSnorm16(Octahedral.x);
+			Packed[i].Normal[1] = PackSnorm16(Octahedral.y);
+			Packed[i].TexCoords[0] = glm::packHalf1x16(Vert.TexCoords.x);
+			Packed[i].TexCoords[1] = glm::packHalf1x16(Vert.TexCoords.y);
+		}
+
+		OutMesh.Upload.VertexFormat = EVertexFormat::Packed;
+		OutMesh.Upload.Vertices = OutMesh.VertexBytes.data();
+	}
+}
+
+size_t VertexFormat::GetVertexStride(EVertexFormat Format)
+{
+	return Format == EVertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+}
+
+bool VertexFormat::CanPack(const std::vector<Vertex>& Vertices)
+{
+	if (Vertices.empty())
+	{
+		return false;
+	}
+
+	for (const Vertex& Vert : Vertices)
+	{
+		if (std::abs(Vert.TexCoords.x) > MaxPackedTexCoord || std::abs(Vert.TexCoords.y) > MaxPackedTexCoord)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+uint32_t VertexFormat::GetIndexSize(size_t VertexCount)
+{
+	return VertexCount <= 65536 ? 2 : 4;
+}
+
+void VertexFormat::Encode(const std::vector<Vertex>& Vertices, const std::vector<unsigned int>& Indices, EVertexFormat PreferredFormat, EncodedMesh& OutMesh)
+{
+	OutMesh = EncodedMesh();
+	OutMesh.Upload.VertexCount = Vertices.size();
+	OutMesh.Upload.IndexCount = Indices.size();
+
+	if (!Vertices.empty())
+	{
+		OutMesh.Upload.BoundsMin = Vertices[0].Position;
+		OutMesh.Upload.BoundsMax = Vertices[0].Position;
+		for (const Vertex& Vert : Vertices)
+		{
+			OutMesh.Upload.BoundsMin = glm::min(OutMesh.Upload.BoundsMin, Vert.Position);
+			OutMesh.Upload.BoundsMax = glm::max(OutMesh.Upload.BoundsMax, Vert.Position);
+		}
+	}
+
+	if (PreferredFormat == EVertexFormat::Packed && CanPack(Vertices))
+	{
+		EncodePackedVertices(Vertices, OutMesh);
+	}
+	else
+	{
+		OutMesh.Upload.VertexFormat = EVertexFormat::Float;
+		OutMesh.Upload.Vertices = Vertices.data();
+	}
+
+	OutMesh.Upload.IndexSize = GetIndexSize(Vertices.size());
+	if (OutMesh.Upload.IndexSize == 2)
+	{
+		OutMesh.IndexBytes.resize(Indices.size() * sizeof(uint16_t));
+		uint16_t* ShortIndices = reinterpret_cast<uint16_t*>(OutMesh.IndexBytes.data());
+		for (size_t i = 0; i < Indices.size(); i++)
+		{
+			ShortIndices[i] = static_cast<uint16_t>(Indices[i]);
+		}
+		OutMesh.Upload.Indices = OutMesh.IndexBytes.data();
+	}
+	else
+	{
+		OutMesh.Upload.Indices = Indices.data();
+	}
+}
+
+void VertexFormat::Decode(const MeshUploadData& InData, std::vector<Vertex>& OutVertices, std::vector<unsigned int>& OutIndices)
+{
+	OutVertices.resize(InData.VertexCount);
+	if (InData.VertexFormat == EVertexFormat::Packed)
+	{
+		const PackedVertex* Packed = static_cast<const PackedVertex*>(InData.Vertices);
+		for (size_t i = 0; i < InData.VertexCount; i++)
+		{
+			const glm::vec3 Quantised = glm::vec3(Packed[i].Position[0], Packed[i].Position[1], Packed[i].Position[2]) / 65535.0f;
+			const glm::vec2 Octahedral = glm::clamp(glm::vec2(Packed[i].Normal[0], Packed[i].Normal[1]) / 32767.0f, -1.0f, 1.0f);
+			OutVertices[i].Position = InData.Quantisation.Offset + Quantised * InData.Quantisation.Scale;
+			OutVertices[i].Normal = DecodeOctahedral(Octahedral);
+			OutVertices[i].TexCoords = glm::vec2(glm::unpackHalf1x16(Packed[i].TexCoords[0]), glm::unpackHalf1x16(Packed[i].TexCoords[1]));
+		}
+	}
+	else
+	{
+		const Vertex* Full = static_cast<const Vertex*>(InData.Vertices);
+		OutVertices.assign(Full, Full + InData.VertexCount);
+	}
+
+	const size_t FirstIndex = InData.LodCount > 0 ? InData.Lods[0].FirstIndex : 0;
+	const size_t IndexCount = InData.LodCount > 0 ? InData.Lods[0].IndexCount : InData.IndexCount;
+	OutIndices.resize(IndexCount);
+	for (size_t i = 0; i < IndexCount; i++)
+	{
+		OutIndices[i] = InData.IndexSize == 2 ? static_cast<const uint16_t*>(InData.Indices)[FirstIndex + i]
+			: static_cast<const uint32_t*>(InData.Indices)[FirstIndex + i];
+	}
+}
+
+glm::vec2 VertexFormat::EncodeOctahedral(const glm::vec3& Normal)
+{
+	const float Length = std::abs(Normal.x) + std::abs(Normal.y) + std::abs(Normal.z);
+	if (Length <= 0.0f)
+	{
+		return glm::vec2(0.0f);
+	}
+
+	// Project onto the octahedron, then fold the lower hemisphere over the diagonals
+	glm::vec2 Encoded = glm::vec2(Normal.x, Normal.y) / Length;
+	if (Normal.z < 0.0f)
+	{
+		Encoded = glm::vec2((1.0f - std::abs(Encoded.y)) * SignNotZero(Encoded.x), (1.0f - std::abs(Encoded.x)) * SignNotZero(Encoded.y));
+	}
+	return Encoded;
+}
+
+glm::vec3 VertexFormat::DecodeOctahedral(const glm::vec2& Encoded)
+{
+	// Must match DecodeOctahedral in ObjectVertexShader.vert
+	glm::vec3 Normal(Encoded.x, Encoded.y, 1.0f - std::abs(Encoded.x) - std::abs(Encoded.y));
+	const float Fold = std::max(-Normal.z, 0.0f);
+	Normal.x += Normal.x >= 0.0f ? -Fold : Fold;
+	Normal.y += Normal.y >= 0.0f ? -Fold : Fold;
+	return glm::normalize(Normal);
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+struct Vertex;
+struct VertexSkin;
+
+// Vertex layouts a mesh can be uploaded with. Float is the plain 32 byte Vertex and is kept as the fallback for
+// meshes that cannot be packed without visible precision loss.
+enum class EVertexFormat : uint32_t
+{
+	Float = 0,
+	Packed = 1
+};
+
+// 16 byte compressed vertex. The position is quantised to 16 bits per axis inside the mesh bounds, the normal is
+// octahedral encoded into two snorm16 values and the texture coordinates are half floats.
+struct PackedVertex
+{
+	uint16_t Position[4]; // xyz in [0, 65535] across the mesh bounds, w is padding
+	int16_t Normal[2];
+	uint16_t TexCoords[2];
+};
+
+// Maps quantised positions back to model space: Position = Offset + Quantised * Scale (Quantised in [0, 1])
+struct VertexQuantisation
+{
+	glm::vec3 Offset = glm::vec3(0.0f);
+	glm::vec3 Scale = glm::vec3(1.0f);
+};
+
+// A level of detail inside a mesh's index buffer. All LODs of a mesh share its vertices, LOD 0 is the full mesh.
+struct MeshLod
+{
+	uint32_t FirstIndex = 0;
+	uint32_t IndexCount = 0;
+	float Error = 0.0f; // bound on the distance from LOD 0 in model units: the largest distance of a kept vertex to the LOD 0 planes merged into it
+};
+
+// A cluster of up to MeshletBuilder::MaxTriangles consecutive LOD 0 triangles with its culling bounds in model space.
+// Triangles facing away from every direction in the normal cone can be skipped when the camera sees the cluster from
+// behind: dot(Center - Camera, ConeAxis) >= ConeCutoff * |Center - Camera| + Radius.
+struct Meshlet
+{
+	uint32_t FirstIndex = 0;
+	uint32_t IndexCount = 0;
+	glm::vec3 Center = glm::vec3(0.0f);
+	float Radius = 0.0f;
+	glm::vec3 ConeAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+	float ConeCutoff = 1.0f; // sine of the cone's half angle, 1 when the cone is too wide to ever cull
+};
+
+// Vertex and index data in the exact layout Mesh::SetupMesh uploads. The pointers are not owned.
+struct MeshUploadData
+{
+	EVertexFormat VertexFormat = EVertexFormat::Float;
+	const void* Vertices = nullptr;
+	size_t VertexCount = 0;
+	const void* Indices = nullptr;
+	size_t IndexCount = 0;
+	uint32_t IndexSize = 4; // 2 or 4 bytes
+	VertexQuantisation Quantisation;
+	glm::vec3 BoundsMin = glm::vec3(0.0f);
+	glm::vec3 BoundsMax = glm::vec3(0.0f);
+	const MeshLod* Lods = nullptr; // no LODs means the whole index range is LOD 0
+	size_t LodCount = 0;
+	const Meshlet* Meshlets = nullptr;
+	size_t MeshletCount = 0;
+	const VertexSkin* Skin = nullptr; // VertexCount entries for skinned meshes, uploaded as a second vertex stream
+};
+
+// Output of VertexFormat::Encode. Vertex or index bytes are only filled in when they had to be converted, otherwise
+// the upload data points straight at the source arrays which have to outlive it.
+struct EncodedMesh
+{
+	MeshUploadData Upload;
+	std::vector<unsigned char> VertexBytes;
+	std::vector<unsigned char> IndexBytes;
+};
+
+namespace VertexFormat
+{
+	// Texture coordinates outside this range lose too much precision as half floats, meshes using them stay Float
+	const float MaxPackedTexCoord = 2.0f;
+
+	size_t GetVertexStride(EVertexFormat Format);
+
+	// True if every vertex of the mesh can be represented by PackedVertex
+	bool CanPack(const std::vector<Vertex>& Vertices);
+
+	// Index width used for a mesh with the given vertex count (16 bit whenever every index fits)
+	uint32_t GetIndexSize(size_t VertexCount);
+
+	// Converts the mesh into the preferred format, falling back to Float if it cannot be packed. LODs are left to the
+	// caller since they only describe ranges of the index buffer.
+	void Encode(const std::vector<Vertex>& Vertices, const std::vector<unsigned int>& Indices, EVertexFormat PreferredFormat, EncodedMesh& OutMesh);
+
+	// Expands encoded data back into full vertices and the 32 bit indices of LOD 0, for code that works on cooked
+	// geometry on the CPU
+	void Decode(const MeshUploadData& InData, std::vector<Vertex>& OutVertices, std::vector<unsigned int>& OutIndices);
+
+	glm::vec2 EncodeOctahedral(const glm::vec3& Normal);
+	glm::vec3 DecodeOctahedral(const glm::vec2& Encoded);
+}
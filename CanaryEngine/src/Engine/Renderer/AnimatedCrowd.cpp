@@ -0,0 +1,181 @@
+#include "AnimatedCrowd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include <glad/glad.h>
+
+#include "GLStateCache.h"
+#include "RenderStats.h"
+#include "RenderView.h"
+#include "SkinningPalette.h"
+#include "Engine/Core/TransformMath.h"
+#include "Engine/Mesh/Model.h"
+#include "Engine/Shader/ShaderProgram.h"
+
+namespace
+{
+	// A skinned vertex is a weighted average of its bind position moved by each of its bones, so it stays inside the
+	// smallest sphere holding the bind bounds moved by every bone of every frame
+	float ComputeClipRadius(const BakedAnimation& Baked, const BakedClip& Clip, const glm::vec3& Center, float BindRadius)
+	{
+		const glm::vec4 Point(Center, 1.0f);
+		float Radius = 0.0f;
+		for (uint32_t Frame = Clip.FirstFrame; Frame < Clip.FirstFrame + Clip.FrameCount; Frame++)
+		{
+			const glm::vec4* Rows = Baked.Texels.data() + size_t(Frame) * Baked.BoneCount * AnimationBaker::TexelsPerBone;
+			for (uint32_t Bone = 0; Bone < Baked.BoneCount; Bone++, Rows += AnimationBaker::TexelsPerBone)
+			{
+				const glm::vec3 Moved(glm::dot(Rows[0], Point), glm::dot(Rows[1], Point), glm::dot(Rows[2], Point));
+				const float Scale = std::sqrt(std::max(glm::dot(glm::vec3(Rows[0]), glm::vec3(Rows[0])),
+					std::max(glm::dot(glm::vec3(Rows[1]), glm::vec3(Rows[1])), glm::dot(glm::vec3(Rows[2]), glm::vec3(Rows[2])))));
+				Radius = std::max(Radius, glm::length(Moved - Center) + BindRadius * Scale);
+			}
+		}
+		return Radius;
+	}
+}
+
+AnimatedCrowd::AnimatedCrowd(Model& InModel, float FrameRate)
+	: CrowdModel(InModel)
+{
+	const AnimationSet* Animation = CrowdModel.GetAnimation();
+	float BindRadius = 0.0f;
+	if (!Animation || Animation->IsEmpty() || Animation->Clips.empty() || !CrowdModel.GetBounds(BoundsCenter, BindRadius))
+	{
+		std::cout << "ERROR::CROWD::MODEL_HAS_NO_ANIMATION" << std::endl;
+		return;
+	}
+
+	AnimationBaker::Bake(*Animation, FrameRate, Baked);
+
+	// a row per frame, so long clips run into the texture height limit before anything else
+	GLint MaxTextureSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &MaxTextureSize);
+	const GLsizei Width = static_cast<GLsizei>(Baked.BoneCount * AnimationBaker::TexelsPerBone);
+	const GLsizei Height = static_cast<GLsizei>(Baked.FrameCount);
+	if (Width > MaxTextureSize || Height > MaxTextureSize)
+	{
+		std::cout << "ERROR::CROWD::ANIMATION_TEXTURE_TOO_LARGE: " << Width << "x" << Height << std::endl;
+		Baked.Texels.clear();
+		return;
+	}
+
+	for (const BakedClip& Clip : Baked.Clips)
+	{
+		ClipBoundsRadius.push_back(ComputeClipRadius(Baked, Clip, BoundsCenter, BindRadius));
+	}
+
+	// frames are blended in the shader, filtering would also blend neighbouring bones
+	glGenTextures(1, &AnimationTexture);
+	GLStateCache::Get().BindTexture(GL_TEXTURE_2D, AnimationTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, Width, Height, 0, GL_RGBA, GL_FLOAT, Baked.Texels.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	AnimationTextureBytes = Baked.GetMemoryBytes();
+	std::vector<glm::vec4>().swap(Baked.Texels);
+}
+
+AnimatedCrowd::~AnimatedCrowd()
+{
+	if (AnimationTexture != 0)
+	{
+		GLStateCache::Get().DeleteTextures(1, &AnimationTexture);
+	}
+	InstanceBuffer.Release();
+}
+
+void AnimatedCrowd::Update(float DeltaTime)
+{
+	for (CrowdInstance& Instance : Instances)
+	{
+		if (Instance.Clip < 0 || Instance.Clip >= static_cast<int>(Baked.Clips.size()))
+		{
+			continue;
+		}
+
+		const float Duration = Baked.Clips[Instance.Clip].Duration;
+		Instance.Time += DeltaTime * Instance.Speed;
+		if (Duration > 0.0f)
+		{
+			Instance.Time = std::fmod(Instance.Time, Duration);
+			if (Instance.Time < 0.0f)
+			{
+				Instance.Time += Duration;
+			}
+		}
+	}
+}
+
+void AnimatedCrowd::Draw(ShaderProgram& Shader, const RenderView& View)
+{
+	if (!IsValid() || Instances.empty())
+	{
+		return;
+	}
+
+	RenderStats& Stats = RenderStats::Get();
+
+	VisibleInstances.clear();
+	for (uint32_t Index = 0; Index < Instances.size(); Index++)
+	{
+		const CrowdInstance& Instance = Instances[Index];
+		if (Instance.Clip < 0 || Instance.Clip >= static_cast<int>(Baked.Clips.size()))
+		{
+			continue;
+		}
+
+		const float MaxScale = TransformMath::GetMaxAxisScale(Instance.Transform);
+		const glm::vec3 Center = glm::vec3(Instance.Transform * glm::vec4(BoundsCenter, 1.0f));
+		const float Radius = ClipBoundsRadius[Instance.Clip] * MaxScale;
+		if (!View.ViewFrustum.IntersectsSphere(Center, Radius))
+		{
+			Stats.CrowdInstancesCulled++;
+			continue;
+		}
+
+		const float Distance = std::max(glm::length(Center - View.CameraPosition) - Radius, 0.01f);
+		VisibleInstances.push_back(std::make_pair(View.ProjectionScale * MaxScale / Distance, Index));
+	}
+	if (VisibleInstances.empty())
+	{
+		return;
+	}
+
+	// nearest first, which keeps each LOD a contiguous run of instances and lets early depth testing reject more
+	std::sort(VisibleInstances.begin(), VisibleInstances.end(), [](const std::pair<float, uint32_t>& A, const std::pair<float, uint32_t>& B)
+	{
+		return A.first > B.first;
+	});
+
+	// per instance: the top three rows of its transform, then the frames around its time and the fraction between them
+	InstancePixelsPerUnit.resize(VisibleInstances.size());
+	InstanceTexels.resize(VisibleInstances.size() * 4);
+	for (size_t Visible = 0; Visible < VisibleInstances.size(); Visible++)
+	{
+		const CrowdInstance& Instance = Instances[VisibleInstances[Visible].second];
+		InstancePixelsPerUnit[Visible] = VisibleInstances[Visible].first;
+
+		glm::vec4* Out = InstanceTexels.data() + Visible * 4;
+		AnimationBaker::StoreBoneRows(Instance.Transform, Out);
+
+		uint32_t FirstFrame, SecondFrame;
+		float Fraction;
+		AnimationBaker::FindFrames(Baked.Clips[Instance.Clip], Instance.Time, FirstFrame, SecondFrame, Fraction);
+		Out[3] = glm::vec4(float(FirstFrame), float(SecondFrame), Fraction, 0.0f);
+	}
+
+	InstanceBuffer.Upload(InstanceTexels.data(), InstanceTexels.size());
+	InstanceBuffer.Bind(SkinningPalette::InstanceTextureUnit);
+	GLStateCache::Get().BindTexture(SkinningPalette::AnimationTextureUnit, GL_TEXTURE_2D, AnimationTexture);
+
+	Shader.SetBool("bBakedAnimation", true);
+	CrowdModel.DrawInstanced(Shader, InstancePixelsPerUnit, View);
+	Shader.SetBool("bBakedAnimation", false);
+
+	Stats.CrowdInstancesDrawn += static_cast<unsigned int>(VisibleInstances.size());
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "StreamingTextureBuffer.h"
+#include "Engine/Animation/AnimationBaker.h"
+
+class Model;
+class ShaderProgram;
+struct RenderView;
+
+// One member of a crowd: where it stands and how far it is into which clip
+struct CrowdInstance
+{
+	glm::mat4 Transform = glm::mat4(1.0f);
+	int Clip = 0;
+	float Time = 0.0f;
+	float Speed = 1.0f;
+};
+
+// Thousands of copies of one skinned model playing baked clips. Every clip is sampled once at load into an animation
+// texture (see AnimationBaker.h), each frame the CPU only advances clip times, culls the instances and writes their
+// transform and animation frames to a buffer texture. SkinnedVertexShader.vert in baked mode then blends the two
+// frames around each instance's time, so posing costs the CPU nothing and the whole crowd is one instanced draw per
+// mesh and LOD. Clips always loop and cannot be blended with each other, characters needing that go through
+// SkinningPalette. GL thread only.
+class AnimatedCrowd
+{
+public:
+	// Bakes the clips of the model, which has to outlive the crowd. A model without animation leaves the crowd invalid.
+	explicit AnimatedCrowd(Model& InModel, float FrameRate = AnimationBaker::DefaultFrameRate);
+	~AnimatedCrowd();
+
+	AnimatedCrowd(const AnimatedCrowd&) = delete;
+	AnimatedCrowd& operator=(const AnimatedCrowd&) = delete;
+
+	bool IsValid() const { return AnimationTexture != 0; }
+
+	// -1 if there is no clip of that name
+	int FindClip(const std::string& Name) const { return Baked.FindClip(Name); }
+
+	void AddInstance(const CrowdInstance& Instance) { Instances.push_back(Instance); }
+	std::vector<CrowdInstance>& GetInstances() { return Instances; }
+
+	// Moves every instance along its clip, wrapping at the end
+	void Update(float DeltaTime);
+
+	// Culls the instances against the view and draws the visible ones nearest first. The shader has to be
+	// SkinnedVertexShader.vert with the view and projection already set.
+	void Draw(ShaderProgram& Shader, const RenderView& View);
+
+	size_t GetGpuBytes() const { return AnimationTextureBytes + InstanceBuffer.GetGpuBytes(); }
+
+private:
+	Model& CrowdModel;
+	BakedAnimation Baked; // clips and frame layout, the texels are released once uploaded
+
+	// Bounding sphere of the model across every frame of a clip, the center stays the bind pose's
+	glm::vec3 BoundsCenter = glm::vec3(0.0f);
+	std::vector<float> ClipBoundsRadius;
+
+	std::vector<CrowdInstance> Instances;
+
+	unsigned int AnimationTexture = 0;
+	size_t AnimationTextureBytes = 0;
+	StreamingTextureBuffer InstanceBuffer;
+
+	// Rebuilt every Draw: visible instances as (pixels per unit, index) sorted nearest first, then their shader data
+	std::vector<std::pair<float, uint32_t>> VisibleInstances;
+	std::vector<float> InstancePixelsPerUnit;
+	std::vector<glm::vec4> InstanceTexels;
+};
@@ -0,0 +1,271 @@
+#include "GLStateCache.h"
+
+#include <glad/glad.h>
+
+#include "RenderStats.h"
+
+namespace
+{
+	const unsigned int Unknown = ~0u;
+}
+
+GLStateCache& GLStateCache::Get()
+{
+	static GLStateCache Instance;
+	return Instance;
+}
+
+GLStateCache::GLStateCache()
+{
+	Invalidate();
+}
+
+bool GLStateCache::Change(unsigned int& Cached, unsigned int Value)
+{
+	RenderStats& Stats = RenderStats::Get();
+	if (Cached == Value)
+	{
+		Stats.StateChangesSkipped++;
+		return false;
+	}
+
+	Cached = Value;
+	Stats.StateChanges++;
+	return true;
+}
+
+int GLStateCache::GetTextureTarget(unsigned int Target)
+{
+	switch (Target)
+	{
+	case GL_TEXTURE_2D: return Texture2D;
+	case GL_TEXTURE_2D_ARRAY: return Texture2DArray;
+	case GL_TEXTURE_BUFFER: return TextureBuffer;
+	default: return -1;
+	}
+}
+
+int GLStateCache::GetBufferTarget(unsigned int Target)
+{
+	switch (Target)
+	{
+	case GL_ARRAY_BUFFER: return ArrayBuffer;
+	case GL_ELEMENT_ARRAY_BUFFER: return ElementArrayBuffer;
+	case GL_PIXEL_PACK_BUFFER: return PixelPackBuffer;
+	case GL_PIXEL_UNPACK_BUFFER: return PixelUnpackBuffer;
+	case GL_TEXTURE_BUFFER: return TextureBufferBuffer;
+	default: return -1;
+	}
+}
+
+void GLStateCache::UseProgram(unsigned int InProgram)
+{
+	if (Change(Program, InProgram))
+	{
+		glUseProgram(InProgram);
+	}
+}
+
+void GLStateCache::BindVertexArray(unsigned int InVertexArray)
+{
+	if (Change(VertexArray, InVertexArray))
+	{
+		glBindVertexArray(InVertexArray);
+		Buffers[ElementArrayBuffer] = Unknown;
+	}
+}
+
+void GLStateCache::ActiveTexture(unsigned int Unit)
+{
+	if (Change(ActiveUnit, Unit))
+	{
+		glActiveTexture(GL_TEXTURE0 + Unit);
+	}
+}
+
+void GLStateCache::BindTexture(unsigned int Target, unsigned int Texture)
+{
+	const int Index = GetTextureTarget(Target);
+	if (Index < 0 || ActiveUnit >= MaxTextureUnits)
+	{
+		// the active unit may be unknown too, forget whatever the bind replaced there
+		if (Index >= 0)
+		{
+			for (unsigned int Unit = 0; Unit < MaxTextureUnits; Unit++)
+			{
+				Textures[Unit][Index] = Unknown;
+			}
+		}
+		RenderStats::Get().StateChanges++;
+		glBindTexture(Target, Texture);
+		return;
+	}
+
+	if (Change(Textures[ActiveUnit][Index], Texture))
+	{
+		glBindTexture(Target, Texture);
+	}
+}
+
+bool GLStateCache::BindTexture(unsigned int Unit, unsigned int Target, unsigned int Texture)
+{
+	const int Index = GetTextureTarget(Target);
+	if (Index >= 0 && Unit < MaxTextureUnits && Textures[Unit][Index] == Texture)
+	{
+		RenderStats::Get().StateChangesSkipped++;
+		return false;
+	}
+
+	ActiveTexture(Unit);
+	BindTexture(Target, Texture);
+	return true;
+}
+
+void GLStateCache::BindBuffer(unsigned int Target, unsigned int Buffer)
+{
+	const int Index = GetBufferTarget(Target);
+	if (Index < 0)
+	{
+		RenderStats::Get().StateChanges++;
+		glBindBuffer(Target, Buffer);
+		return;
+	}
+
+	if (Change(Buffers[Index], Buffer))
+	{
+		glBindBuffer(Target, Buffer);
+	}
+}
+
+void GLStateCache::SetBlend(bool bEnabled)
+{
+	if (Change(Blend, bEnabled ? 1 : 0))
+	{
+		if (bEnabled)
+		{
+			glEnable(GL_BLEND);
+		}
+		else
+		{
+			glDisable(GL_BLEND);
+		}
+	}
+}
+
+void GLStateCache::SetBlendFunc(unsigned int Source, unsigned int Destination)
+{
+	if (BlendSource == Source && BlendDestination == Destination)
+	{
+		RenderStats::Get().StateChangesSkipped++;
+		return;
+	}
+
+	BlendSource = Source;
+	BlendDestination = Destination;
+	RenderStats::Get().StateChanges++;
+	glBlendFunc(Source, Destination);
+}
+
+void GLStateCache::SetDepthTest(bool bEnabled)
+{
+	if (Change(DepthTest, bEnabled ? 1 : 0))
+	{
+		if (bEnabled)
+		{
+			glEnable(GL_DEPTH_TEST);
+		}
+		else
+		{
+			glDisable(GL_DEPTH_TEST);
+		}
+	}
+}
+
+void GLStateCache::SetDepthWrite(bool bEnabled)
+{
+	if (Change(DepthWrite, bEnabled ? 1 : 0))
+	{
+		glDepthMask(bEnabled ? GL_TRUE : GL_FALSE);
+	}
+}
+
+void GLStateCache::SetDepthFunc(unsigned int Func)
+{
+	if (Change(DepthFunc, Func))
+	{
+		glDepthFunc(Func);
+	}
+}
+
+void GLStateCache::SetPolygonMode(unsigned int Mode)
+{
+	if (Change(PolygonMode, Mode))
+	{
+		glPolygonMode(GL_FRONT_AND_BACK, Mode);
+	}
+}
+
+void GLStateCache::DeleteTextures(size_t Count, const unsigned int* InTextures)
+{
+	for (size_t i = 0; i < Count; i++)
+	{
+		for (unsigned int Unit = 0; Unit < MaxTextureUnits; Unit++)
+		{
+			for (unsigned int& Bound : Textures[Unit])
+			{
+				Bound = Bound == InTextures[i] ? 0 : Bound;
+			}
+		}
+	}
+	glDeleteTextures(static_cast<GLsizei>(Count), InTextures);
+}
+
+void GLStateCache::DeleteBuffers(size_t Count, const unsigned int* InBuffers)
+{
+	for (size_t i = 0; i < Count; i++)
+	{
+		for (unsigned int& Bound : Buffers)
+		{
+			Bound = Bound == InBuffers[i] ? 0 : Bound;
+		}
+	}
+	glDeleteBuffers(static_cast<GLsizei>(Count), InBuffers);
+}
+
+void GLStateCache::DeleteVertexArrays(size_t Count, const unsigned int* VertexArrays)
+{
+	for (size_t i = 0; i < Count; i++)
+	{
+		if (VertexArray == VertexArrays[i])
+		{
+			VertexArray = 0;
+			Buffers[ElementArrayBuffer] = Unknown;
+		}
+	}
+	glDeleteVertexArrays(static_cast<GLsizei>(Count), VertexArrays);
+}
+
+void GLStateCache::Invalidate()
+{
+	Program = Unknown;
+	VertexArray = Unknown;
+	ActiveUnit = Unknown;
+	for (unsigned int Unit = 0; Unit < MaxTextureUnits; Unit++)
+	{
+		for (unsigned int& Bound : Textures[Unit])
+		{
+			Bound = Unknown;
+		}
+	}
+	for (unsigned int& Bound : Buffers)
+	{
+		Bound = Unknown;
+	}
+
+	Blend = Unknown;
+	BlendSource = BlendDestination = Unknown;
+	DepthTest = Unknown;
+	DepthWrite = Unknown;
+	DepthFunc = Unknown;
+	PolygonMode = Unknown;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+
+// Shadow copy of the GL state the engine changes, so asking for state that is already set costs a compare instead
+// of a driver call. Every engine path binds programs, vertex arrays, textures and buffers, switches texture units and
+// changes blend, depth and polygon mode state through Get(), and deletes those objects through it too: GL hands
+// deleted names out again, and a stale entry would skip the bind of the new object. Everything starts unknown so the
+// first call after Invalidate always reaches GL. The element array buffer belongs to the bound vertex array and is
+// forgotten whenever that changes. Code that changes state behind the cache's back has to restore it or call
+// Invalidate (the ImGui backend restores everything it touches). Calls passed on and skipped are counted in
+// RenderStats. GL thread only.
+class GLStateCache
+{
+public:
+	// Units tracked per target, binds to higher units are passed on every time
+	static const unsigned int MaxTextureUnits = 16;
+
+	static GLStateCache& Get();
+
+	void UseProgram(unsigned int Program);
+	void BindVertexArray(unsigned int VertexArray);
+
+	// Unit is the index, not GL_TEXTURE0 + index
+	void ActiveTexture(unsigned int Unit);
+
+	// Binds to the active unit, for creating and uploading textures
+	void BindTexture(unsigned int Target, unsigned int Texture);
+
+	// Binds to a unit for drawing, switching the active unit only when the texture is not already there. Returns
+	// whether glBindTexture was called.
+	bool BindTexture(unsigned int Unit, unsigned int Target, unsigned int Texture);
+
+	void BindBuffer(unsigned int Target, unsigned int Buffer);
+
+	void SetBlend(bool bEnabled);
+	void SetBlendFunc(unsigned int Source, unsigned int Destination);
+	void SetDepthTest(bool bEnabled);
+	void SetDepthWrite(bool bEnabled);
+	void SetDepthFunc(unsigned int Func);
+	void SetPolygonMode(unsigned int Mode); // GL_FRONT_AND_BACK
+
+	// Delete the objects and clear every binding of them, like GL does
+	void DeleteTextures(size_t Count, const unsigned int* Textures);
+	void DeleteBuffers(size_t Count, const unsigned int* Buffers);
+	void DeleteVertexArrays(size_t Count, const unsigned int* VertexArrays);
+
+	// Forgets all state, the next call of every kind reaches GL
+	void Invalidate();
+
+private:
+	enum TextureTarget
+	{
+		Texture2D,
+		Texture2DArray,
+		TextureBuffer,
+		TextureTargetCount
+	};
+
+	enum BufferTarget
+	{
+		ArrayBuffer,
+		ElementArrayBuffer,
+		PixelPackBuffer,
+		PixelUnpackBuffer,
+		TextureBufferBuffer,
+		BufferTargetCount
+	};
+
+	GLStateCache();
+
+	// Whether Value differs from Cached, which then holds it. Counts the call either way.
+	bool Change(unsigned int& Cached, unsigned int Value);
+
+	static int GetTextureTarget(unsigned int Target);
+	static int GetBufferTarget(unsigned int Target);
+
+	unsigned int Program;
+	unsigned int VertexArray;
+	unsigned int ActiveUnit;
+	unsigned int Textures[MaxTextureUnits][TextureTargetCount];
+	unsigned int Buffers[BufferTargetCount];
+
+	unsigned int Blend;
+	unsigned int BlendSource;
+	unsigned int BlendDestination;
+	unsigned int DepthTest;
+	unsigned int DepthWrite;
+	unsigned int DepthFunc;
+	unsigned int PolygonMode;
+};
@@ -0,0 +1,34 @@
+#include "RenderStats.h"
+
+namespace
+{
+	RenderStats CurrentFrame;
+	RenderStats LastFrame;
+}
+
+RenderStats& RenderStats::Get()
+{
+	return CurrentFrame;
+}
+
+const RenderStats& RenderStats::GetLastFrame()
+{
+	return LastFrame;
+}
+
+void RenderStats::BeginFrame()
+{
+	LastFrame = CurrentFrame;
+	CurrentFrame = RenderStats();
+}
+
+void RenderStats::EndFeedbackPass(const RenderStats& Before)
+{
+	RenderStats After = CurrentFrame;
+	CurrentFrame = Before;
+	CurrentFrame.FeedbackDrawCalls += After.DrawCalls - Before.DrawCalls;
+	CurrentFrame.FeedbackTrianglesDrawn += After.TrianglesDrawn - Before.TrianglesDrawn;
+	CurrentFrame.TextureBinds = After.TextureBinds;
+	CurrentFrame.StateChanges = After.StateChanges;
+	CurrentFrame.StateChangesSkipped = After.StateChangesSkipped;
+}
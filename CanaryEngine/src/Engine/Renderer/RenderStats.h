@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+
+// Counters gathered while a frame is being drawn. Get() is the frame in progress, BeginFrame() moves it to
+// GetLastFrame() so the debug window can show a complete frame.
+struct RenderStats
+{
+	unsigned int DrawCalls = 0;
+	unsigned int TrianglesDrawn = 0;
+
+	// Draws of the virtual texture feedback pass, kept out of the counters above
+	unsigned int FeedbackDrawCalls = 0;
+	unsigned int FeedbackTrianglesDrawn = 0;
+
+	// Scene objects skipped whole because their bounds are outside the view
+	unsigned int ObjectsCulled = 0;
+
+	// Triangles LOD selection avoided compared to drawing every mesh at LOD 0
+	unsigned int TrianglesSavedByLod = 0;
+
+	// Meshlets of LOD 0 meshes that passed or failed the frustum and normal cone tests
+	unsigned int ClustersDrawn = 0;
+	unsigned int ClustersCulled = 0;
+
+	// Texture streaming: bytes copied to the GPU this frame and requests still decoding or uploading
+	unsigned int TextureBytesUploaded = 0;
+	unsigned int TexturesStreaming = 0;
+
+	// Texture residency: video memory the streamed textures are heading for and how many of them are kept coarser
+	// than the screen asks for to stay inside the budget
+	size_t TextureTargetBytes = 0;
+	unsigned int TexturesDegraded = 0;
+
+	// glBindTexture calls made to draw materials, skipped when the unit already holds the texture
+	unsigned int TextureBinds = 0;
+
+	// Virtual texturing: pages in the physical cache, pages uploaded this frame and pages being read
+	unsigned int VirtualPagesResident = 0;
+	unsigned int VirtualPagesUploaded = 0;
+	unsigned int VirtualPagesPending = 0;
+
+	// Skinning: bones posed on the CPU and uploaded to the palette, crowd instances drawn from baked animation
+	unsigned int SkinningBonesUploaded = 0;
+	unsigned int CrowdInstancesDrawn = 0;
+	unsigned int CrowdInstancesCulled = 0;
+
+	// World streaming: sectors around the camera, those still waiting for models, the memory of their models and the
+	// mesh bytes created for them this frame
+	unsigned int SectorsResident = 0;
+	unsigned int SectorsLoading = 0;
+	size_t SectorBytes = 0;
+	unsigned int SectorBytesUploaded = 0;
+
+	// Static batching: merged chunks drawn and culled, and the objects the resident chunks stand in for
+	unsigned int BatchChunksDrawn = 0;
+	unsigned int BatchChunksCulled = 0;
+	unsigned int ObjectsBatched = 0;
+
+	// GL state changes made through GLStateCache that reached the driver and those it filtered out as redundant
+	unsigned int StateChanges = 0;
+	unsigned int StateChangesSkipped = 0;
+
+	static RenderStats& Get();
+	static const RenderStats& GetLastFrame();
+
+	static void BeginFrame();
+
+	// Ends a pass that draws the scene a second time: its draws move to the feedback counters and every other scene
+	// counter goes back to what it was at Before, so culling, LOD and batching stats describe the main pass only.
+	// Texture binds and GL state changes were made all the same and are kept.
+	static void EndFeedbackPass(const RenderStats& Before);
+};
@@ -0,0 +1,42 @@
+#include "RenderView.h"
+
+#include <cmath>
+
+void Frustum::Extract(const glm::mat4& ViewProjection)
+{
+	const glm::vec4 Row0(ViewProjection[0][0], ViewProjection[1][0], ViewProjection[2][0], ViewProjection[3][0]);
+	const glm::vec4 Row1(ViewProjection[0][1], ViewProjection[1][1], ViewProjection[2][1], ViewProjection[3][1]);
+	const glm::vec4 Row2(ViewProjection[0][2], ViewProjection[1][2], ViewProjection[2][2], ViewProjection[3][2]);
+	const glm::vec4 Row3(ViewProjection[0][3], ViewProjection[1][3], ViewProjection[2][3], ViewProjection[3][3]);
+
+	Planes[0] = Row3 + Row0; // left
+	Planes[1] = Row3 - Row0; // right
+	Planes[2] = Row3 + Row1; // bottom
+	Planes[3] = Row3 - Row1; // top
+	Planes[4] = Row3 + Row2; // near
+	Planes[5] = Row3 - Row2; // far
+
+	for (glm::vec4& Plane : Planes)
+	{
+		Plane /= glm::length(glm::vec3(Plane));
+	}
+}
+
+bool Frustum::IntersectsSphere(const glm::vec3& Center, float Radius) const
+{
+	for (const glm::vec4& Plane : Planes)
+	{
+		if (glm::dot(glm::vec3(Plane), Center) + Plane.w < -Radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+RenderView::RenderView(const glm::vec3& InCameraPosition, const glm::mat4& InViewProjection, float InFieldOfView, float InScreenHeight)
+{
+	CameraPosition = InCameraPosition;
+	ViewFrustum.Extract(InViewProjection);
+	ProjectionScale = InScreenHeight / (2.0f * std::tan(InFieldOfView * 0.5f));
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// View frustum as six world space planes (xyz normal pointing inwards, w distance)
+struct Frustum
+{
+	glm::vec4 Planes[6];
+
+	// Extracts the planes from a combined projection * view matrix (Gribb and Hartmann)
+	void Extract(const glm::mat4& ViewProjection);
+
+	bool IntersectsSphere(const glm::vec3& Center, float Radius) const;
+};
+
+// Camera state the draw code needs for LOD selection and culling, built once per frame
+struct RenderView
+{
+	RenderView(const glm::vec3& InCameraPosition, const glm::mat4& InViewProjection, float InFieldOfView, float InScreenHeight);
+
+	glm::vec3 CameraPosition;
+	Frustum ViewFrustum;
+	float ProjectionScale; // pixels covered by one unit at a distance of one unit
+
+	// LODs are picked so their error stays under this many pixels, a coarser LOD is only switched to once its error
+	// is below MaxScreenError * (1 - Hysteresis) so meshes near the threshold do not pop back and forth
+	float MaxScreenError = 1.0f;
+	float Hysteresis = 0.25f;
+
+	// Cull meshlets against the frustum and their normal cones before drawing LOD 0
+	bool bClusterCulling = true;
+};
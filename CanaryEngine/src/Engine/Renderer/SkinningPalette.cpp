@@ -0,0 +1,61 @@
+#include "SkinningPalette.h"
+
+#include "RenderStats.h"
+#include "Engine/Animation/AnimationBaker.h"
+#include "Engine/Shader/ShaderProgram.h"
+
+SkinningPalette& SkinningPalette::Get()
+{
+	static SkinningPalette Instance;
+	return Instance;
+}
+
+void SkinningPalette::SetupShader(ShaderProgram& Shader)
+{
+	Shader.Use();
+	Shader.SetInt("BonePalette", PaletteTextureUnit);
+	Shader.SetInt("InstanceData", InstanceTextureUnit);
+	Shader.SetInt("AnimationTexture", AnimationTextureUnit);
+}
+
+void SkinningPalette::BeginFrame()
+{
+	Rows.clear();
+	bDirty = false;
+}
+
+uint32_t SkinningPalette::Add(const std::vector<glm::mat4>& SkinningMatrices)
+{
+	const uint32_t FirstBone = static_cast<uint32_t>(Rows.size() / AnimationBaker::TexelsPerBone);
+
+	Rows.resize(Rows.size() + SkinningMatrices.size() * AnimationBaker::TexelsPerBone);
+	glm::vec4* Out = Rows.data() + size_t(FirstBone) * AnimationBaker::TexelsPerBone;
+	for (const glm::mat4& Matrix : SkinningMatrices)
+	{
+		AnimationBaker::StoreBoneRows(Matrix, Out);
+		Out += AnimationBaker::TexelsPerBone;
+	}
+
+	bDirty = true;
+	return FirstBone;
+}
+
+void SkinningPalette::Bind(ShaderProgram& Shader, uint32_t FirstBone)
+{
+	if (bDirty)
+	{
+		Buffer.Upload(Rows.data(), Rows.size());
+		RenderStats::Get().SkinningBonesUploaded += static_cast<unsigned int>(Rows.size() / AnimationBaker::TexelsPerBone);
+		bDirty = false;
+	}
+
+	Buffer.Bind(PaletteTextureUnit);
+	Shader.SetBool("bBakedAnimation", false);
+	Shader.SetInt("BonePaletteOffset", static_cast<int>(FirstBone));
+}
+
+void SkinningPalette::Shutdown()
+{
+	Buffer.Release();
+	Rows.clear();
+}
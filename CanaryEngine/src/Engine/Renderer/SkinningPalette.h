@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "StreamingTextureBuffer.h"
+
+class ShaderProgram;
+
+// Bone matrices of every skinned character drawn this frame, packed into one buffer texture that
+// SkinnedVertexShader.vert reads as BonePalette. Characters are posed on the CPU (PoseEvaluator::EvaluateInstances),
+// added here and drawn with their first bone as the palette offset. The palette is uploaded once, at the first
+// skinned draw after something was added. Crowds that need no CPU pose at all use AnimatedCrowd instead. GL thread only.
+class SkinningPalette
+{
+public:
+	// Units below VirtualTextureSystem's are taken by materials and atlases
+	static const unsigned int PaletteTextureUnit = 13;
+	static const unsigned int InstanceTextureUnit = 14;
+	static const unsigned int AnimationTextureUnit = 15;
+
+	static SkinningPalette& Get();
+
+	// Points the skinning samplers of a program using SkinnedVertexShader.vert at their units. Each needs a unit of
+	// its own even when unused, a samplerBuffer and a sampler2D on the same unit fail validation.
+	static void SetupShader(ShaderProgram& Shader);
+
+	// Clears the palette, called once at the start of every frame
+	void BeginFrame();
+
+	// Appends one character's skinning matrices, returns its first bone in the palette
+	uint32_t Add(const std::vector<glm::mat4>& SkinningMatrices);
+
+	// Uploads the palette if it changed and selects the character starting at FirstBone for the following draws
+	void Bind(ShaderProgram& Shader, uint32_t FirstBone);
+
+	size_t GetGpuBytes() const { return Buffer.GetGpuBytes(); }
+
+	void Shutdown();
+
+private:
+	std::vector<glm::vec4> Rows; // AnimationBaker::TexelsPerBone per bone
+	StreamingTextureBuffer Buffer;
+	bool bDirty = false;
+};
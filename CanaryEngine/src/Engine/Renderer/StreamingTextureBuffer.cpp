@@ -0,0 +1,46 @@
+#include "StreamingTextureBuffer.h"
+
+#include <algorithm>
+
+#include <glad/glad.h>
+
+#include "GLStateCache.h"
+
+void StreamingTextureBuffer::Upload(const glm::vec4* Texels, size_t TexelCount)
+{
+	if (Buffer == 0)
+	{
+		glGenBuffers(1, &Buffer);
+		glGenTextures(1, &Texture);
+
+		// the texture refers to the buffer object, so it keeps seeing the buffer's storage however often it is replaced
+		GLStateCache::Get().BindTexture(GL_TEXTURE_BUFFER, Texture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, Buffer);
+	}
+
+	const size_t Bytes = std::max<size_t>(TexelCount, 1) * sizeof(glm::vec4);
+	Capacity = std::max(Bytes, Capacity);
+
+	GLStateCache::Get().BindBuffer(GL_TEXTURE_BUFFER, Buffer);
+	glBufferData(GL_TEXTURE_BUFFER, Capacity, nullptr, GL_STREAM_DRAW);
+	if (TexelCount > 0)
+	{
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, TexelCount * sizeof(glm::vec4), Texels);
+	}
+}
+
+void StreamingTextureBuffer::Bind(unsigned int Unit) const
+{
+	GLStateCache::Get().BindTexture(Unit, GL_TEXTURE_BUFFER, Texture);
+}
+
+void StreamingTextureBuffer::Release()
+{
+	if (Buffer != 0)
+	{
+		GLStateCache::Get().DeleteTextures(1, &Texture);
+		GLStateCache::Get().DeleteBuffers(1, &Buffer);
+	}
+	Buffer = Texture = 0;
+	Capacity = 0;
+}
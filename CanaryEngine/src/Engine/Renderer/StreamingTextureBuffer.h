@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+// RGBA32F buffer texture rewritten every frame (bone palettes, crowd instance data). Each upload orphans the
+// buffer's storage so the driver can hand out fresh memory while the GPU still reads last frame's contents, the
+// storage only grows. GL thread only.
+class StreamingTextureBuffer
+{
+public:
+	StreamingTextureBuffer() = default;
+	~StreamingTextureBuffer() = default;
+
+	StreamingTextureBuffer(const StreamingTextureBuffer&) = delete;
+	StreamingTextureBuffer& operator=(const StreamingTextureBuffer&) = delete;
+
+	void Upload(const glm::vec4* Texels, size_t TexelCount);
+
+	// Binds the buffer texture to the unit, leaves GL_TEXTURE0 active
+	void Bind(unsigned int Unit) const;
+
+	// Deletes the buffer and texture while the GL context is current
+	void Release();
+
+	size_t GetGpuBytes() const { return Capacity; }
+
+private:
+	unsigned int Buffer = 0;
+	unsigned int Texture = 0; // GL_TEXTURE_BUFFER
+	size_t Capacity = 0;
+};
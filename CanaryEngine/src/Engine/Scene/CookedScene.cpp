@@ -0,0 +1,178 @@
+#include "CookedScene.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#include "Engine/Core/CookedFile.h"
+
+namespace
+{
+	// Byte range of one array of the file
+	struct ArrayRange
+	{
+		const void* Data;
+		uint64_t Offset;
+		uint64_t Size;
+	};
+
+	bool IsInFile(uint64_t Offset, uint64_t Count, uint64_t ElementSize, uint64_t FileSize)
+	{
+		return Offset % CookedScene::DataAlignment == 0 && Offset <= FileSize && Count <= (FileSize - Offset) / ElementSize;
+	}
+}
+
+std::string CookedScene::GetCookedPath(const std::string& SourcePath)
+{
+	return SourcePath + ".cscene";
+}
+
+bool CookedScene::Write(const std::string& FilePath, const SceneData& Scene)
+{
+	if (Scene.Transforms.size() != Scene.ObjectModels.size())
+	{
+		std::cout << "ERROR::COOKEDSCENE::Objects need one transform and one model each" << std::endl;
+		return false;
+	}
+
+	std::vector<ModelRecord> ModelTable(Scene.Models.size());
+	std::string Strings;
+	for (size_t i = 0; i < Scene.Models.size(); i++)
+	{
+		ModelTable[i].PathOffset = static_cast<uint32_t>(Strings.size());
+		ModelTable[i].Flags = Scene.Models[i].bCrowd ? ModelFlagCrowd : 0;
+
+		Strings += Scene.Models[i].Path;
+		Strings += '\0';
+	}
+
+	FileHeader Header = {};
+	Header.Magic = Magic;
+	Header.Version = Version;
+	Header.ModelCount = static_cast<uint32_t>(Scene.Models.size());
+	Header.ObjectCount = static_cast<uint32_t>(Scene.Transforms.size());
+	Header.LightCount = static_cast<uint32_t>(Scene.Lights.size());
+
+	ArrayRange Arrays[] =
+	{
+		{ ModelTable.data(), 0, ModelTable.size() * sizeof(ModelRecord) },
+		{ Scene.Transforms.data(), 0, Scene.Transforms.size() * sizeof(glm::mat4) },
+		{ Scene.ObjectModels.data(), 0, Scene.ObjectModels.size() * sizeof(uint32_t) },
+		{ Scene.Lights.data(), 0, Scene.Lights.size() * sizeof(SceneLight) },
+		{ Strings.data(), 0, Strings.size() }
+	};
+
+	uint64_t Offset = sizeof(FileHeader);
+	for (ArrayRange& Array : Arrays)
+	{
+		Array.Offset = CookedFile::AlignUp(Offset, DataAlignment);
+		Offset = Array.Offset + Array.Size;
+	}
+	Header.ModelsOffset = Arrays[0].Offset;
+	Header.TransformsOffset = Arrays[1].Offset;
+	Header.ObjectModelsOffset = Arrays[2].Offset;
+	Header.LightsOffset = Arrays[3].Offset;
+	Header.StringsOffset = Arrays[4].Offset;
+	Header.StringsSize = Arrays[4].Size;
+
+	std::ofstream File(FilePath, std::ios::binary | std::ios::trunc);
+	if (!File)
+	{
+		std::cout << "ERROR::COOKEDSCENE::Could not open " << FilePath << " for writing" << std::endl;
+		return false;
+	}
+
+	static const char Padding[DataAlignment] = {};
+
+	File.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+	uint64_t Written = sizeof(Header);
+	for (const ArrayRange& Array : Arrays)
+	{
+		File.write(Padding, static_cast<std::streamsize>(Array.Offset - Written));
+		File.write(static_cast<const char*>(Array.Data), static_cast<std::streamsize>(Array.Size));
+		Written = Array.Offset + Array.Size;
+	}
+
+	return File.good();
+}
+
+bool CookedSceneFile::Open(const std::string& FilePath)
+{
+	Close();
+
+	if (!File.Open(FilePath))
+	{
+		return false;
+	}
+
+	if (File.GetSize() < sizeof(CookedScene::FileHeader))
+	{
+		std::cout << "ERROR::COOKEDSCENE::File is truncated: " << FilePath << std::endl;
+		Close();
+		return false;
+	}
+
+	Header = reinterpret_cast<const CookedScene::FileHeader*>(File.GetData());
+	if (Header->Magic != CookedScene::Magic || Header->Version != CookedScene::Version)
+	{
+		std::cout << "ERROR::COOKEDSCENE::Unsupported file version, re-cook " << FilePath << std::endl;
+		Close();
+		return false;
+	}
+
+	const uint64_t FileSize = File.GetSize();
+	if (!IsInFile(Header->ModelsOffset, Header->ModelCount, sizeof(CookedScene::ModelRecord), FileSize)
+		|| !IsInFile(Header->TransformsOffset, Header->ObjectCount, sizeof(glm::mat4), FileSize)
+		|| !IsInFile(Header->ObjectModelsOffset, Header->ObjectCount, sizeof(uint32_t), FileSize)
+		|| !IsInFile(Header->LightsOffset, Header->LightCount, sizeof(SceneLight), FileSize)
+		|| !IsInFile(Header->StringsOffset, Header->StringsSize, 1, FileSize)
+		|| (Header->StringsSize > 0 && File.GetData()[Header->StringsOffset + Header->StringsSize - 1] != '\0'))
+	{
+		std::cout << "ERROR::COOKEDSCENE::Tables are out of bounds in " << FilePath << std::endl;
+		Close();
+		return false;
+	}
+
+	Models = reinterpret_cast<const CookedScene::ModelRecord*>(File.GetData() + Header->ModelsOffset);
+	Transforms = reinterpret_cast<const glm::mat4*>(File.GetData() + Header->TransformsOffset);
+	ObjectModels = reinterpret_cast<const uint32_t*>(File.GetData() + Header->ObjectModelsOffset);
+	Lights = reinterpret_cast<const SceneLight*>(File.GetData() + Header->LightsOffset);
+	Strings = reinterpret_cast<const char*>(File.GetData() + Header->StringsOffset);
+
+	for (uint32_t i = 0; i < Header->ModelCount; i++)
+	{
+		if (Models[i].PathOffset >= Header->StringsSize)
+		{
+			std::cout << "ERROR::COOKEDSCENE::Model " << i << " is out of bounds in " << FilePath << std::endl;
+			Close();
+			return false;
+		}
+	}
+
+	// the only pass over the objects, everything after this indexes the arrays without checking
+	uint32_t LargestModel = 0;
+	for (uint32_t i = 0; i < Header->ObjectCount; i++)
+	{
+		LargestModel = std::max(LargestModel, ObjectModels[i]);
+	}
+	if (Header->ObjectCount > 0 && LargestModel >= Header->ModelCount)
+	{
+		std::cout << "ERROR::COOKEDSCENE::Objects reference missing models in " << FilePath << std::endl;
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void CookedSceneFile::Close()
+{
+	File.Close();
+
+	Header = nullptr;
+	Models = nullptr;
+	Transforms = nullptr;
+	ObjectModels = nullptr;
+	Lights = nullptr;
+	Strings = nullptr;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <glm/glm.hpp>
+
+#include "SceneData.h"
+#include "Engine/Core/VirtualFileSystem.h"
+
+// Cooked scenes (.cscene) are written by CanaryCooker from the text format (see SceneImporter.h). The file is the
+// arrays of SceneData as they are in memory, so opening one maps it and checks the model indices, nothing is parsed
+// or allocated per object.
+// Layout: FileHeader, then each array starting on a 16 byte boundary: ModelRecord table, transforms (glm::mat4,
+// column major), object model indices, SceneLight table, string chunk.
+namespace CookedScene
+{
+	const uint32_t Magic = 0x4E435343; // "CSCN"
+	const uint32_t Version = 1;
+	const uint32_t DataAlignment = 16;
+
+	const uint32_t ModelFlagCrowd = 1; // see SceneModel::bCrowd
+
+	struct FileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t ModelCount;
+		uint32_t ObjectCount;
+		uint32_t LightCount;
+		uint32_t Reserved;
+		uint64_t ModelsOffset;
+		uint64_t TransformsOffset;
+		uint64_t ObjectModelsOffset;
+		uint64_t LightsOffset;
+		uint64_t StringsOffset;
+		uint64_t StringsSize;
+	};
+
+	struct ModelRecord
+	{
+		uint32_t PathOffset; // into the string chunk
+		uint32_t Flags;
+	};
+
+	// Where the cooker writes the cooked version of a scene and the engine looks for it
+	std::string GetCookedPath(const std::string& SourcePath);
+
+	bool Write(const std::string& FilePath, const SceneData& Scene);
+}
+
+// Read-only view over a .cscene opened through the VirtualFileSystem, pointers are only valid while the file is open
+class CookedSceneFile
+{
+public:
+	bool Open(const std::string& FilePath);
+	void Close();
+
+	uint32_t GetModelCount() const { return Header->ModelCount; }
+	const CookedScene::ModelRecord& GetModel(uint32_t Index) const { return Models[Index]; }
+	const char* GetModelPath(uint32_t Index) const { return Strings + Models[Index].PathOffset; }
+
+	uint32_t GetObjectCount() const { return Header->ObjectCount; }
+	const glm::mat4* GetTransforms() const { return Transforms; }
+	const uint32_t* GetObjectModels() const { return ObjectModels; }
+
+	uint32_t GetLightCount() const { return Header->LightCount; }
+	const SceneLight* GetLights() const { return Lights; }
+
+private:
+	VirtualFile File;
+
+	const CookedScene::FileHeader* Header = nullptr;
+	const CookedScene::ModelRecord* Models = nullptr;
+	const glm::mat4* Transforms = nullptr;
+	const uint32_t* ObjectModels = nullptr;
+	const SceneLight* Lights = nullptr;
+	const char* Strings = nullptr;
+};
@@ -0,0 +1,332 @@
+#include "Scene.h"
+
+#include <algorithm>
+
+#include "SceneImporter.h"
+#include "Engine/Core/CookedFile.h"
+#include "Engine/Core/TransformMath.h"
+#include "Engine/Lighting/LightingManager.h"
+#include "Engine/Renderer/AnimatedCrowd.h"
+#include "Engine/Renderer/RenderStats.h"
+#include "Engine/Renderer/RenderView.h"
+#include "Engine/Renderer/SkinningPalette.h"
+
+namespace
+{
+	// Spreads the crowd members' starting times so they do not all move in step, the crowd wraps them into the clip
+	const float CrowdTimeSpread = 0.618034f;
+
+	// Radius around the bind pose's center holding the posed model, the same bound AnimatedCrowd takes over a clip's
+	// frames: each vertex is a weighted average of its bind position moved by its bones
+	float GetPosedRadius(const std::vector<glm::mat4>& SkinningMatrices, const glm::vec3& Center, float BindRadius)
+	{
+		float Radius = BindRadius;
+		for (const glm::mat4& Bone : SkinningMatrices)
+		{
+			const glm::vec3 Moved(Bone * glm::vec4(Center, 1.0f));
+			Radius = std::max(Radius, glm::length(Moved - Center) + BindRadius * TransformMath::GetMaxAxisScale(Bone));
+		}
+		return Radius;
+	}
+}
+
+const char* const Scene::DefaultPath = "resources/Scenes/Default.scene";
+
+Scene::Scene()
+{
+}
+
+Scene::~Scene()
+{
+	Unload();
+}
+
+bool Scene::Load(const std::string& FilePath, const SectorStreamingSettings& Streaming)
+{
+	Unload();
+
+	// prefer the cooked version of the scene when the cooker has produced one
+	const std::string CookedPath = CookedScene::GetCookedPath(FilePath);
+	std::vector<std::string> ModelPaths;
+	std::vector<bool> CrowdModels;
+	if (CookedFile::IsUpToDate(CookedPath, FilePath) && Cooked.Open(CookedPath))
+	{
+		Transforms = Cooked.GetTransforms();
+		ObjectModels = Cooked.GetObjectModels();
+		ObjectCount = Cooked.GetObjectCount();
+		Lights = Cooked.GetLights();
+		LightCount = Cooked.GetLightCount();
+		for (uint32_t i = 0; i < Cooked.GetModelCount(); i++)
+		{
+			ModelPaths.push_back(Cooked.GetModelPath(i));
+			CrowdModels.push_back((Cooked.GetModel(i).Flags & CookedScene::ModelFlagCrowd) != 0);
+		}
+	}
+	else if (SceneImporter::Import(FilePath, Imported))
+	{
+		Transforms = Imported.Transforms.data();
+		ObjectModels = Imported.ObjectModels.data();
+		ObjectCount = Imported.Transforms.size();
+		Lights = Imported.Lights.data();
+		LightCount = Imported.Lights.size();
+		for (const SceneModel& SourceModel : Imported.Models)
+		{
+			ModelPaths.push_back(SourceModel.Path);
+			CrowdModels.push_back(SourceModel.bCrowd);
+		}
+	}
+	else
+	{
+		return false;
+	}
+
+	// crowds are loaded here, every other model is left to the streamer
+	std::vector<std::string> StreamedPaths(ModelPaths.size());
+	Models.resize(ModelPaths.size());
+	ModelCrowds.resize(ModelPaths.size(), -1);
+	for (size_t i = 0; i < ModelPaths.size(); i++)
+	{
+		if (CrowdModels[i])
+		{
+			std::unique_ptr<Model> CrowdModel(new Model(ModelPaths[i]));
+			std::unique_ptr<AnimatedCrowd> Crowd(new AnimatedCrowd(*CrowdModel));
+			if (Crowd->IsValid())
+			{
+				Models[i] = std::move(CrowdModel);
+				ModelCrowds[i] = static_cast<int>(Crowds.size());
+				Crowds.push_back(std::move(Crowd));
+				continue;
+			}
+		}
+
+		// a crowd model without clips is drawn like any other
+		StreamedPaths[i] = ModelPaths[i];
+	}
+
+	for (size_t Object = 0; Object < ObjectCount; Object++)
+	{
+		const int Crowd = ModelCrowds[ObjectModels[Object]];
+		if (Crowd >= 0)
+		{
+			CrowdInstance Instance;
+			Instance.Transform = Transforms[Object];
+			Instance.Time = float(Object) * CrowdTimeSpread;
+			Crowds[Crowd]->AddInstance(Instance);
+		}
+	}
+
+	Streamer.Build(Transforms, ObjectModels, ObjectCount, Lights, LightCount, StreamedPaths, Streaming);
+	LodStates.resize(ObjectCount);
+	ObjectCharacters.assign(ObjectCount, -1);
+
+	return true;
+}
+
+void Scene::Unload()
+{
+	// crowds reference their models
+	Streamer.Clear();
+	Crowds.clear();
+	Models.clear();
+	ModelCrowds.clear();
+	LodStates.clear();
+	Characters.clear();
+	CharacterObjects.clear();
+	ObjectCharacters.clear();
+
+	Cooked.Close();
+	Imported = SceneData();
+
+	Transforms = nullptr;
+	ObjectModels = nullptr;
+	ObjectCount = 0;
+	Lights = nullptr;
+	LightCount = 0;
+}
+
+void Scene::AddLights(LightManager& Manager) const
+{
+	std::vector<uint32_t> Added;
+	for (uint32_t i = 0; i < LightCount; i++)
+	{
+		if (Lights[i].Type == static_cast<int32_t>(ESceneLightType::Directional))
+		{
+			Added.push_back(i);
+		}
+	}
+	const std::vector<uint32_t>& SectorLights = Streamer.GetSectorLights();
+	for (const SectorStreamer::Sector& Current : Streamer.GetSectors())
+	{
+		if (Current.bResident)
+		{
+			Added.insert(Added.end(), SectorLights.begin() + Current.FirstLight, SectorLights.begin() + Current.FirstLight + Current.LightCount);
+		}
+	}
+
+	for (uint32_t i : Added)
+	{
+		const SceneLight& Source = Lights[i];
+
+		Light Value;
+		Value.LightPosition = glm::vec3(Source.Position[0], Source.Position[1], Source.Position[2]);
+		Value.LightColor = glm::vec3(Source.Color[0], Source.Color[1], Source.Color[2]);
+		Value.Intensity = Source.Intensity;
+		Value.LightType = Source.Type;
+		Value.LightRadius = Source.Radius;
+		Value.LightDirection = glm::vec3(Source.Direction[0], Source.Direction[1], Source.Direction[2]);
+		Value.LightCutOff = Source.CutOff;
+		Manager.AddLight(Value);
+	}
+}
+
+bool Scene::Update(float DeltaTime, const glm::vec3& CameraPosition)
+{
+	for (std::unique_ptr<AnimatedCrowd>& Crowd : Crowds)
+	{
+		Crowd->Update(DeltaTime);
+	}
+
+	const bool bChanged = Streamer.Update(CameraPosition);
+
+	// objects of released sectors give their LOD state back, it is rebuilt in a frame once they return. Characters
+	// go before posing, their model may have been released with the sector.
+	const std::vector<uint32_t>& SectorObjects = Streamer.GetSectorObjects();
+	for (uint32_t Released : Streamer.GetReleasedSectors())
+	{
+		const SectorStreamer::Sector& Current = Streamer.GetSectors()[Released];
+		for (uint32_t i = 0; i < Current.ObjectCount; i++)
+		{
+			LodStates[SectorObjects[Current.FirstObject + i]] = ModelLodState();
+			RemoveCharacter(SectorObjects[Current.FirstObject + i]);
+		}
+	}
+
+	AddCharacters();
+	PoseEvaluator::EvaluateInstances(Characters, DeltaTime);
+	return bChanged;
+}
+
+void Scene::AddCharacters()
+{
+	const std::vector<uint32_t>& SectorObjects = Streamer.GetSectorObjects();
+	for (const SectorStreamer::Sector& Current : Streamer.GetSectors())
+	{
+		if (!Current.bResident)
+		{
+			continue;
+		}
+
+		for (uint32_t i = 0; i < Current.ObjectCount; i++)
+		{
+			const uint32_t Object = SectorObjects[Current.FirstObject + i];
+			const Model* StreamedModel = ObjectCharacters[Object] < 0 ? Streamer.GetModel(ObjectModels[Object]) : nullptr;
+			const AnimationSet* Animation = StreamedModel ? StreamedModel->GetAnimation() : nullptr;
+			if (!Animation)
+			{
+				continue;
+			}
+
+			AnimationInstance Character;
+			Character.Animation = Animation;
+			Character.Time = float(Object) * CrowdTimeSpread;
+			ObjectCharacters[Object] = static_cast<int32_t>(Characters.size());
+			Characters.push_back(std::move(Character));
+			CharacterObjects.push_back(Object);
+		}
+	}
+}
+
+void Scene::RemoveCharacter(uint32_t Object)
+{
+	const int32_t Index = ObjectCharacters[Object];
+	if (Index < 0)
+	{
+		return;
+	}
+
+	// the last character takes the removed one's place
+	ObjectCharacters[CharacterObjects.back()] = Index;
+	Characters[Index] = std::move(Characters.back());
+	CharacterObjects[Index] = CharacterObjects.back();
+	Characters.pop_back();
+	CharacterObjects.pop_back();
+	ObjectCharacters[Object] = -1;
+}
+
+void Scene::Draw(ShaderProgram& Shader, const RenderView& View)
+{
+	RenderStats& Stats = RenderStats::Get();
+	const std::vector<uint32_t>& SectorObjects = Streamer.GetSectorObjects();
+	const std::vector<SectorStreamer::Sector>& Sectors = Streamer.GetSectors();
+	for (uint32_t SectorIndex = 0; SectorIndex < Sectors.size(); SectorIndex++)
+	{
+		const SectorStreamer::Sector& Current = Sectors[SectorIndex];
+		if (!Current.bResident)
+		{
+			continue;
+		}
+
+		// the merged objects first, only the ones the batch left out are drawn on their own
+		StaticBatch* Batch = Streamer.GetBatch(SectorIndex);
+		if (Batch)
+		{
+			Batch->Draw(Shader, View);
+		}
+
+		for (uint32_t i = 0; i < Current.ObjectCount; i++)
+		{
+			const uint32_t Object = SectorObjects[Current.FirstObject + i];
+			const uint32_t ModelIndex = ObjectModels[Object];
+			Model* StreamedModel = Streamer.GetModel(ModelIndex);
+			if (!StreamedModel || ObjectCharacters[Object] >= 0 || (Batch && Batch->IsModelBatched(ModelIndex)))
+			{
+				continue;
+			}
+
+			const glm::vec4& Bounds = Streamer.GetModelBounds(ModelIndex);
+			const glm::mat4& Transform = Transforms[Object];
+			const glm::vec3 Center = glm::vec3(Transform * glm::vec4(glm::vec3(Bounds), 1.0f));
+			if (!View.ViewFrustum.IntersectsSphere(Center, Bounds.w * TransformMath::GetMaxAxisScale(Transform)))
+			{
+				Stats.ObjectsCulled++;
+				continue;
+			}
+
+			StreamedModel->Draw(Shader, Transform, View, LodStates[Object]);
+		}
+	}
+}
+
+void Scene::DrawSkinned(ShaderProgram& SkinnedShader, const RenderView& View)
+{
+	for (std::unique_ptr<AnimatedCrowd>& Crowd : Crowds)
+	{
+		Crowd->Draw(SkinnedShader, View);
+	}
+
+	// every visible character is added before the first draw so the palette is uploaded once
+	RenderStats& Stats = RenderStats::Get();
+	SkinningPalette& Palette = SkinningPalette::Get();
+	VisibleCharacters.clear();
+	for (uint32_t i = 0; i < Characters.size(); i++)
+	{
+		const uint32_t Object = CharacterObjects[i];
+		const glm::vec4& Bounds = Streamer.GetModelBounds(ObjectModels[Object]);
+		const glm::mat4& Transform = Transforms[Object];
+		const glm::vec3 Center = glm::vec3(Transform * glm::vec4(glm::vec3(Bounds), 1.0f));
+		const float Radius = GetPosedRadius(Characters[i].SkinningMatrices, glm::vec3(Bounds), Bounds.w);
+		if (!View.ViewFrustum.IntersectsSphere(Center, Radius * TransformMath::GetMaxAxisScale(Transform)))
+		{
+			Stats.ObjectsCulled++;
+			continue;
+		}
+		VisibleCharacters.emplace_back(i, Palette.Add(Characters[i].SkinningMatrices));
+	}
+
+	for (const std::pair<uint32_t, uint32_t>& Visible : VisibleCharacters)
+	{
+		const uint32_t Object = CharacterObjects[Visible.first];
+		Palette.Bind(SkinnedShader, Visible.second);
+		Streamer.GetModel(ObjectModels[Object])->Draw(SkinnedShader, Transforms[Object], View, LodStates[Object]);
+	}
+}
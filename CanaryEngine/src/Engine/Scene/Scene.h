@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "CookedScene.h"
+#include "SceneData.h"
+#include "SectorStreamer.h"
+#include "Engine/Animation/PoseEvaluator.h"
+#include "Engine/Mesh/Model.h"
+
+class AnimatedCrowd;
+class LightManager;
+class ShaderProgram;
+struct RenderView;
+
+// The objects, models and lights of the level being played. Load maps the cooked scene when it is up to date and
+// imports the text scene otherwise, either way objects are drawn straight from the flat arrays: loading costs one
+// pass over the model indices to split them into sectors and one LOD state array for all objects. Static models and
+// point and spot lights then stream in and out with the sectors around the camera (see SectorStreamer.h), crowd
+// models are loaded with the scene. Objects of a streamed model that turns out to be skinned are characters: they
+// are posed on the CPU every frame (PoseEvaluator) and drawn by DrawSkinned through SkinningPalette.
+class Scene
+{
+public:
+	static const char* const DefaultPath;
+
+	Scene();
+	~Scene();
+
+	Scene(const Scene&) = delete;
+	Scene& operator=(const Scene&) = delete;
+
+	bool Load(const std::string& FilePath, const SectorStreamingSettings& Streaming = SectorStreamingSettings());
+
+	// Releases the models and crowds, has to happen while the GL context is current
+	void Unload();
+
+	size_t GetObjectCount() const { return ObjectCount; }
+	size_t GetModelCount() const { return Models.size(); }
+
+	// Directional lights and the lights of the resident sectors
+	void AddLights(LightManager& Manager) const;
+
+	// Advances the crowds' clips, streams sectors around the camera and poses the characters of the resident ones.
+	// Returns true when the lights changed and have to be added again.
+	bool Update(float DeltaTime, const glm::vec3& CameraPosition);
+
+	// Draws every object of a resident static model that intersects the view, merged objects through their sector's
+	// static batch. Characters are left to DrawSkinned.
+	void Draw(ShaderProgram& Shader, const RenderView& View);
+
+	// Draws the crowds and the characters, the shader has to be SkinnedVertexShader.vert
+	bool HasSkinnedObjects() const { return !Crowds.empty() || !Characters.empty(); }
+	void DrawSkinned(ShaderProgram& SkinnedShader, const RenderView& View);
+
+private:
+	// Starts posing the objects of resident sectors whose skinned model has finished loading
+	void AddCharacters();
+	void RemoveCharacter(uint32_t Object);
+
+	// Exactly one of them holds the arrays below
+	CookedSceneFile Cooked;
+	SceneData Imported;
+
+	const glm::mat4* Transforms = nullptr;
+	const uint32_t* ObjectModels = nullptr;
+	size_t ObjectCount = 0;
+	const SceneLight* Lights = nullptr;
+	size_t LightCount = 0;
+
+	std::vector<std::unique_ptr<Model>> Models; // crowd models, null for the static ones the streamer owns
+	std::vector<int> ModelCrowds;               // index into Crowds, -1 for static models
+	std::vector<std::unique_ptr<AnimatedCrowd>> Crowds;
+
+	SectorStreamer Streamer;
+
+	// allocated once for every object, each object's own array only once it is drawn and again once its sector goes
+	std::vector<ModelLodState> LodStates;
+
+	// Playback state of every character and the object it belongs to. ObjectCharacters holds each object's index
+	// into them, -1 for objects that are not characters.
+	std::vector<AnimationInstance> Characters;
+	std::vector<uint32_t> CharacterObjects;
+	std::vector<int32_t> ObjectCharacters;
+
+	// Rebuilt every DrawSkinned: the visible characters and their first bone in the palette
+	std::vector<std::pair<uint32_t, uint32_t>> VisibleCharacters;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// A scene as flat arrays: the models it uses, one transform and model index per object, and its lights. Objects are
+// nothing but an index into these arrays, so a scene of any size is a handful of allocations, and the cooked form
+// (see CookedScene.h) is the same arrays written out as they are.
+
+// Values of LightType in ObjectFragmentShader.frag
+enum class ESceneLightType : int32_t
+{
+	Directional = 0,
+	Point = 1,
+	Spot = 2
+};
+
+// Also the record stored in cooked scenes, plain floats so it has the same layout everywhere
+struct SceneLight
+{
+	float Position[3] = { 0.0f, 0.0f, 0.0f };
+	float Color[3] = { 1.0f, 1.0f, 1.0f };
+	float Intensity = 1.0f;
+	int32_t Type = static_cast<int32_t>(ESceneLightType::Point);
+	float Radius = 0.0f;
+	float Direction[3] = { 0.0f, 0.0f, 0.0f };
+	float CutOff = 0.0f; // spot lights, radians
+};
+
+struct SceneModel
+{
+	std::string Path;
+
+	// Objects of a crowd model are drawn as one AnimatedCrowd playing its first clip instead of one by one
+	bool bCrowd = false;
+};
+
+struct SceneData
+{
+	std::vector<SceneModel> Models;
+	std::vector<glm::mat4> Transforms;   // one per object
+	std::vector<uint32_t> ObjectModels;  // one per object, indexes Models
+	std::vector<SceneLight> Lights;
+};
@@ -0,0 +1,284 @@
+#include "SceneImporter.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Engine/Core/VirtualFileSystem.h"
+
+namespace
+{
+	struct SceneToken
+	{
+		const char* Begin;
+		const char* End;
+
+		bool Equals(const char* Text) const
+		{
+			const size_t Length = std::strlen(Text);
+			return size_t(End - Begin) == Length && std::memcmp(Begin, Text, Length) == 0;
+		}
+
+		std::string ToString() const { return std::string(Begin, End); }
+	};
+
+	bool IsSpace(char C)
+	{
+		return C == ' ' || C == '\t' || C == '\r';
+	}
+
+	// Splits a line into whitespace separated tokens, stopping at a comment
+	void Tokenise(const char* Cursor, const char* LineEnd, std::vector<SceneToken>& OutTokens)
+	{
+		OutTokens.clear();
+		while (Cursor < LineEnd && *Cursor != '#')
+		{
+			if (IsSpace(*Cursor))
+			{
+				Cursor++;
+				continue;
+			}
+
+			SceneToken Token;
+			Token.Begin = Cursor;
+			while (Cursor < LineEnd && !IsSpace(*Cursor) && *Cursor != '#')
+			{
+				Cursor++;
+			}
+			Token.End = Cursor;
+			OutTokens.push_back(Token);
+		}
+	}
+
+	// Tokens point into a null terminated string and end before whitespace or a comment, so strtof stops at the end
+	// of a valid number. The engine never changes the C locale, so the decimal point is always '.'.
+	bool ParseFloat(const SceneToken& Token, float& OutValue)
+	{
+		char* NumberEnd = nullptr;
+		OutValue = std::strtof(Token.Begin, &NumberEnd);
+		return NumberEnd == Token.End;
+	}
+
+	bool ParseFloats(const std::vector<SceneToken>& Tokens, size_t& Index, size_t Count, float* OutValues)
+	{
+		if (Index + Count > Tokens.size())
+		{
+			return false;
+		}
+		for (size_t i = 0; i < Count; i++)
+		{
+			if (!ParseFloat(Tokens[Index + i], OutValues[i]))
+			{
+				return false;
+			}
+		}
+		Index += Count;
+		return true;
+	}
+
+	bool ParseModel(const std::vector<SceneToken>& Tokens, std::unordered_map<std::string, uint32_t>& ModelNames, SceneData& OutScene)
+	{
+		if (Tokens.size() < 3 || Tokens.size() > 4 || (Tokens.size() == 4 && !Tokens[3].Equals("crowd")))
+		{
+			return false;
+		}
+		if (!ModelNames.emplace(Tokens[1].ToString(), static_cast<uint32_t>(OutScene.Models.size())).second)
+		{
+			return false;
+		}
+
+		SceneModel Model;
+		Model.Path = Tokens[2].ToString();
+		Model.bCrowd = Tokens.size() == 4;
+		OutScene.Models.push_back(Model);
+		return true;
+	}
+
+	bool ParseObject(const std::vector<SceneToken>& Tokens, const std::unordered_map<std::string, uint32_t>& ModelNames, SceneData& OutScene)
+	{
+		if (Tokens.size() < 2)
+		{
+			return false;
+		}
+		auto Found = ModelNames.find(Tokens[1].ToString());
+		if (Found == ModelNames.end())
+		{
+			return false;
+		}
+
+		glm::vec3 Position(0.0f);
+		glm::vec3 Rotation(0.0f);
+		glm::vec3 Scale(1.0f);
+		for (size_t Index = 2; Index < Tokens.size();)
+		{
+			const SceneToken& Keyword = Tokens[Index++];
+			if (Keyword.Equals("position"))
+			{
+				if (!ParseFloats(Tokens, Index, 3, &Position.x))
+				{
+					return false;
+				}
+			}
+			else if (Keyword.Equals("rotation"))
+			{
+				if (!ParseFloats(Tokens, Index, 3, &Rotation.x))
+				{
+					return false;
+				}
+			}
+			else if (Keyword.Equals("scale"))
+			{
+				// one value scales uniformly
+				if (!ParseFloats(Tokens, Index, 1, &Scale.x))
+				{
+					return false;
+				}
+				float Unused;
+				if (Index < Tokens.size() && ParseFloat(Tokens[Index], Unused))
+				{
+					if (!ParseFloats(Tokens, Index, 2, &Scale.y))
+					{
+						return false;
+					}
+				}
+				else
+				{
+					Scale = glm::vec3(Scale.x);
+				}
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		glm::mat4 Transform = glm::translate(glm::mat4(1.0f), Position);
+		Transform = glm::rotate(Transform, glm::radians(Rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+		Transform = glm::rotate(Transform, glm::radians(Rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+		Transform = glm::rotate(Transform, glm::radians(Rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+		Transform = glm::scale(Transform, Scale);
+
+		OutScene.Transforms.push_back(Transform);
+		OutScene.ObjectModels.push_back(Found->second);
+		return true;
+	}
+
+	bool ParseLight(const std::vector<SceneToken>& Tokens, SceneData& OutScene)
+	{
+		if (Tokens.size() < 2)
+		{
+			return false;
+		}
+
+		SceneLight Light;
+		if (Tokens[1].Equals("directional"))
+		{
+			Light.Type = static_cast<int32_t>(ESceneLightType::Directional);
+		}
+		else if (Tokens[1].Equals("point"))
+		{
+			Light.Type = static_cast<int32_t>(ESceneLightType::Point);
+		}
+		else if (Tokens[1].Equals("spot"))
+		{
+			Light.Type = static_cast<int32_t>(ESceneLightType::Spot);
+		}
+		else
+		{
+			return false;
+		}
+
+		for (size_t Index = 2; Index < Tokens.size();)
+		{
+			const SceneToken& Keyword = Tokens[Index++];
+			bool bParsed = false;
+			if (Keyword.Equals("position"))
+			{
+				bParsed = ParseFloats(Tokens, Index, 3, Light.Position);
+			}
+			else if (Keyword.Equals("color"))
+			{
+				bParsed = ParseFloats(Tokens, Index, 3, Light.Color);
+			}
+			else if (Keyword.Equals("intensity"))
+			{
+				bParsed = ParseFloats(Tokens, Index, 1, &Light.Intensity);
+			}
+			else if (Keyword.Equals("radius"))
+			{
+				bParsed = ParseFloats(Tokens, Index, 1, &Light.Radius);
+			}
+			else if (Keyword.Equals("direction"))
+			{
+				bParsed = ParseFloats(Tokens, Index, 3, Light.Direction);
+			}
+			else if (Keyword.Equals("cutoff"))
+			{
+				bParsed = ParseFloats(Tokens, Index, 1, &Light.CutOff);
+			}
+
+			if (!bParsed)
+			{
+				return false;
+			}
+		}
+
+		OutScene.Lights.push_back(Light);
+		return true;
+	}
+}
+
+bool SceneImporter::Import(const std::string& FilePath, SceneData& OutScene)
+{
+	OutScene = SceneData();
+
+	std::string Text;
+	if (!VirtualFileSystem::Get().ReadText(FilePath, Text))
+	{
+		std::cout << "ERROR::SCENE::FILE_NOT_SUCCESSFULLY_READ: " << FilePath << std::endl;
+		return false;
+	}
+
+	std::unordered_map<std::string, uint32_t> ModelNames;
+	std::vector<SceneToken> Tokens;
+
+	const char* Cursor = Text.c_str();
+	const char* End = Cursor + Text.size();
+	for (uint32_t LineNumber = 1; Cursor < End; LineNumber++)
+	{
+		const char* LineEnd = static_cast<const char*>(std::memchr(Cursor, '\n', size_t(End - Cursor)));
+		LineEnd = LineEnd ? LineEnd : End;
+
+		Tokenise(Cursor, LineEnd, Tokens);
+		if (!Tokens.empty())
+		{
+			bool bParsed = false;
+			if (Tokens[0].Equals("model"))
+			{
+				bParsed = ParseModel(Tokens, ModelNames, OutScene);
+			}
+			else if (Tokens[0].Equals("object"))
+			{
+				bParsed = ParseObject(Tokens, ModelNames, OutScene);
+			}
+			else if (Tokens[0].Equals("light"))
+			{
+				bParsed = ParseLight(Tokens, OutScene);
+			}
+
+			if (!bParsed)
+			{
+				std::cout << "ERROR::SCENE::Could not parse line " << LineNumber << " of " << FilePath << ": " << std::string(Cursor, LineEnd) << std::endl;
+				OutScene = SceneData();
+				return false;
+			}
+		}
+
+		Cursor = LineEnd + 1;
+	}
+
+	return true;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+
+#include "SceneData.h"
+
+// Reads the text scene format, one statement per line and # to the end of a line is a comment:
+//   model <name> <path> [crowd]
+//   object <model name> [position x y z] [rotation x y z] [scale s | scale x y z]
+//   light <directional|point|spot> [position x y z] [color r g b] [intensity i] [radius r] [direction x y z] [cutoff radians]
+// Rotations are in degrees, applied about x, then y, then z. Models have to be declared before the objects using
+// them. CanaryCooker turns these files into cooked scenes, the engine only imports them when there is no up to date
+// cooked version.
+namespace SceneImporter
+{
+	bool Import(const std::string& FilePath, SceneData& OutScene);
+}
@@ -0,0 +1,592 @@
+#include "SectorStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+#include "Engine/Asset/AssetRegistry.h"
+#include "Engine/Core/CookedFile.h"
+#include "Engine/Core/ThreadPool.h"
+#include "Engine/Core/VirtualFileSystem.h"
+#include "Engine/Mesh/CookedMesh.h"
+#include "Engine/Renderer/RenderStats.h"
+
+namespace
+{
+	uint64_t GetCellKey(int32_t X, int32_t Z)
+	{
+		return (uint64_t(uint32_t(X)) << 32) | uint32_t(Z);
+	}
+
+	float GetDistance(const glm::vec2& Point, const glm::vec2& Min, const glm::vec2& Max)
+	{
+		return glm::length(Point - glm::clamp(Point, Min, Max));
+	}
+
+	// Stands in for a model's memory until it has been loaded. The cooked file is mostly the encoded vertices and
+	// indices that get uploaded, without one the source file is imported and its size is the best guess at hand.
+	size_t EstimateModelBytes(const std::string& SourcePath)
+	{
+		const std::string CookedPath = CookedMesh::GetCookedPath(SourcePath);
+		const std::string& FilePath = CookedFile::IsUpToDate(CookedPath, SourcePath) ? CookedPath : SourcePath;
+
+		uint64_t Size = 0;
+		return VirtualFileSystem::Get().GetSize(FilePath, Size) ? static_cast<size_t>(Size) : 0;
+	}
+}
+
+SectorStreamer::SectorStreamer()
+{
+}
+
+SectorStreamer::~SectorStreamer()
+{
+	Clear();
+}
+
+void SectorStreamer::Build(const glm::mat4* InTransforms, const uint32_t* InObjectModels, size_t ObjectCount, const SceneLight* Lights, size_t LightCount,
+	const std::vector<std::string>& InModelPaths, const SectorStreamingSettings& InSettings)
+{
+	Clear();
+	Settings = InSettings;
+	Transforms = InTransforms;
+	ObjectModels = InObjectModels;
+	ModelPaths = std::make_shared<const std::vector<std::string>>(InModelPaths);
+
+	Models.resize(InModelPaths.size());
+	for (size_t i = 0; i < InModelPaths.size(); i++)
+	{
+		Models[i].Path = InModelPaths[i];
+		Models[i].Bytes = InModelPaths[i].empty() ? 0 : EstimateModelBytes(InModelPaths[i]);
+	}
+
+	// one hash lookup per object and light to find its cell, then a counting sort groups them by sector
+	std::unordered_map<uint64_t, uint32_t> SectorByCell;
+	auto GetSector = [this, &SectorByCell](float X, float Z)
+	{
+		const int32_t CellX = static_cast<int32_t>(std::floor(X / Settings.SectorSize));
+		const int32_t CellZ = static_cast<int32_t>(std::floor(Z / Settings.SectorSize));
+		auto Inserted = SectorByCell.emplace(GetCellKey(CellX, CellZ), static_cast<uint32_t>(Sectors.size()));
+		if (Inserted.second)
+		{
+			Sector NewSector;
+			NewSector.Min = glm::vec2(float(CellX), float(CellZ)) * Settings.SectorSize;
+			NewSector.Max = NewSector.Min + glm::vec2(Settings.SectorSize);
+			Sectors.push_back(NewSector);
+		}
+		return Inserted.first->second;
+	};
+
+	const uint32_t NoSector = ~0u;
+	std::vector<uint32_t> ObjectSectors(ObjectCount, NoSector);
+	for (size_t Object = 0; Object < ObjectCount; Object++)
+	{
+		if (!Models[ObjectModels[Object]].Path.empty())
+		{
+			ObjectSectors[Object] = GetSector(Transforms[Object][3].x, Transforms[Object][3].z);
+			Sectors[ObjectSectors[Object]].ObjectCount++;
+		}
+	}
+
+	// directional lights light everything and stay with the scene
+	std::vector<uint32_t> LightSectors(LightCount, NoSector);
+	for (size_t Light = 0; Light < LightCount; Light++)
+	{
+		if (Lights[Light].Type != static_cast<int32_t>(ESceneLightType::Directional))
+		{
+			LightSectors[Light] = GetSector(Lights[Light].Position[0], Lights[Light].Position[2]);
+			Sectors[LightSectors[Light]].LightCount++;
+		}
+	}
+
+	uint32_t FirstObject = 0;
+	uint32_t FirstLight = 0;
+	for (Sector& Current : Sectors)
+	{
+		Current.FirstObject = FirstObject;
+		Current.FirstLight = FirstLight;
+		FirstObject += Current.ObjectCount;
+		FirstLight += Current.LightCount;
+		Current.ObjectCount = 0;
+		Current.LightCount = 0;
+	}
+
+	SectorObjects.resize(FirstObject);
+	for (size_t Object = 0; Object < ObjectCount; Object++)
+	{
+		if (ObjectSectors[Object] != NoSector)
+		{
+			Sector& Owner = Sectors[ObjectSectors[Object]];
+			SectorObjects[Owner.FirstObject + Owner.ObjectCount++] = static_cast<uint32_t>(Object);
+		}
+	}
+
+	SectorLights.resize(FirstLight);
+	for (size_t Light = 0; Light < LightCount; Light++)
+	{
+		if (LightSectors[Light] != NoSector)
+		{
+			Sector& Owner = Sectors[LightSectors[Light]];
+			SectorLights[Owner.FirstLight + Owner.LightCount++] = static_cast<uint32_t>(Light);
+		}
+	}
+
+	// every model a sector's objects use, once
+	std::vector<uint32_t> ModelSeenIn(Models.size(), NoSector);
+	for (uint32_t SectorIndex = 0; SectorIndex < Sectors.size(); SectorIndex++)
+	{
+		Sector& Current = Sectors[SectorIndex];
+		Current.FirstModel = static_cast<uint32_t>(SectorModels.size());
+		for (uint32_t i = 0; i < Current.ObjectCount; i++)
+		{
+			const uint32_t ModelIndex = ObjectModels[SectorObjects[Current.FirstObject + i]];
+			if (ModelSeenIn[ModelIndex] != SectorIndex)
+			{
+				ModelSeenIn[ModelIndex] = SectorIndex;
+				SectorModels.push_back(ModelIndex);
+			}
+		}
+		Current.ModelCount = static_cast<uint32_t>(SectorModels.size()) - Current.FirstModel;
+	}
+
+	// a batch copies the geometry of every object it merges, a single object is never merged
+	SectorBatches.resize(Sectors.size());
+	for (uint32_t SectorIndex = 0; SectorIndex < Sectors.size() && Settings.bStaticBatching; SectorIndex++)
+	{
+		const Sector& Current = Sectors[SectorIndex];
+		for (uint32_t i = 0; i < Current.ObjectCount && Current.ObjectCount > 1; i++)
+		{
+			const size_t ModelBytes = Models[ObjectModels[SectorObjects[Current.FirstObject + i]]].Bytes;
+			SectorBatches[SectorIndex].Bytes += StaticBatch::EstimateObjectBytes(ModelBytes, Settings.StaticBatching);
+		}
+	}
+}
+
+void SectorStreamer::Clear()
+{
+	for (std::shared_ptr<PendingLoad>& Load : Uploads)
+	{
+		Load->bCancelled = true;
+	}
+	for (StreamedModel& Streamed : Models)
+	{
+		if (Streamed.Pending)
+		{
+			Streamed.Pending->bCancelled = true;
+		}
+	}
+	for (SectorBatch& Batch : SectorBatches)
+	{
+		if (Batch.Pending)
+		{
+			Batch.Pending->bCancelled = true;
+		}
+	}
+
+	// meshes of partly uploaded loads and batches are freed here, on the GL thread
+	Uploads.clear();
+	BatchUploads.clear();
+	SectorBatches.clear();
+	Models.clear();
+	Sectors.clear();
+	SectorObjects.clear();
+	SectorModels.clear();
+	SectorLights.clear();
+	ReleasedSectors.clear();
+	PendingModels = 0;
+	PendingBatches = 0;
+	Transforms = nullptr;
+	ObjectModels = nullptr;
+	ModelPaths.reset();
+
+	// jobs still preparing push into the old queues, which go away with the last of them
+	Prepared = std::make_shared<PreparedQueue>();
+	Built = std::make_shared<BuiltQueue>();
+}
+
+bool SectorStreamer::Update(const glm::vec3& CameraPosition)
+{
+	ReleasedSectors.clear();
+
+	ReceivePrepared();
+	ReceiveBatches();
+	const bool bChanged = PlanResidency(CameraPosition);
+
+	// models first, a sector's batch is only started once they are all in
+	size_t BytesUsed = 0;
+	UploadModels(BytesUsed);
+	RequestBatches();
+	UploadBatches(BytesUsed);
+
+	RenderStats& Stats = RenderStats::Get();
+	Stats.SectorBytesUploaded += static_cast<unsigned int>(BytesUsed);
+	for (uint32_t SectorIndex = 0; SectorIndex < Sectors.size(); SectorIndex++)
+	{
+		const Sector& Current = Sectors[SectorIndex];
+		if (!Current.bResident)
+		{
+			continue;
+		}
+
+		Stats.SectorsResident++;
+		if (const StaticBatch* Batch = SectorBatches[SectorIndex].Resident.get())
+		{
+			Stats.SectorBytes += SectorBatches[SectorIndex].Bytes;
+			Stats.ObjectsBatched += static_cast<unsigned int>(Batch->GetObjectCount());
+		}
+		for (uint32_t i = 0; i < Current.ModelCount; i++)
+		{
+			if (Models[SectorModels[Current.FirstModel + i]].Pending)
+			{
+				Stats.SectorsLoading++;
+				break;
+			}
+		}
+	}
+	for (const StreamedModel& Streamed : Models)
+	{
+		if (Streamed.Resident)
+		{
+			Stats.SectorBytes += Streamed.Bytes;
+		}
+	}
+
+	return bChanged;
+}
+
+Model* SectorStreamer::GetModel(uint32_t ModelIndex) const
+{
+	const StreamedModel& Streamed = Models[ModelIndex];
+	return Streamed.bFailed ? nullptr : Streamed.Resident.get();
+}
+
+StaticBatch* SectorStreamer::GetBatch(uint32_t SectorIndex) const
+{
+	return SectorBatches[SectorIndex].Resident.get();
+}
+
+bool SectorStreamer::PlanResidency(const glm::vec3& CameraPosition)
+{
+	const glm::vec2 Camera(CameraPosition.x, CameraPosition.z);
+
+	Candidates.clear();
+	for (uint32_t i = 0; i < Sectors.size(); i++)
+	{
+		const float Distance = GetDistance(Camera, Sectors[i].Min, Sectors[i].Max);
+		if (Distance <= Settings.LoadRadius || (Sectors[i].bResident && Distance <= Settings.UnloadRadius))
+		{
+			Candidates.push_back({ Distance, i });
+		}
+	}
+	std::sort(Candidates.begin(), Candidates.end(), [](const Candidate& A, const Candidate& B)
+	{
+		return A.Distance < B.Distance;
+	});
+
+	// nearest first, a model shared by several sectors is counted once. The nearest sector is always kept.
+	PlanStamp++;
+	size_t PlannedBytes = 0;
+	for (size_t i = 0; i < Candidates.size(); i++)
+	{
+		Sector& Current = Sectors[Candidates[i].Sector];
+
+		size_t AddedBytes = SectorBatches[Candidates[i].Sector].Bytes;
+		for (uint32_t j = 0; j < Current.ModelCount; j++)
+		{
+			const StreamedModel& Streamed = Models[SectorModels[Current.FirstModel + j]];
+			AddedBytes += Streamed.PlanStamp != PlanStamp ? Streamed.Bytes : 0;
+		}
+		if (i > 0 && PlannedBytes + AddedBytes > Settings.MemoryBudget)
+		{
+			Candidates.resize(i);
+			break;
+		}
+
+		for (uint32_t j = 0; j < Current.ModelCount; j++)
+		{
+			Models[SectorModels[Current.FirstModel + j]].PlanStamp = PlanStamp;
+		}
+		Current.PlanStamp = PlanStamp;
+		PlannedBytes += AddedBytes;
+	}
+
+	// release before requesting, so models moving from one sector to another stay resident
+	bool bChanged = false;
+	for (uint32_t i = 0; i < Sectors.size(); i++)
+	{
+		if (Sectors[i].bResident && Sectors[i].PlanStamp != PlanStamp)
+		{
+			ReleaseSector(i);
+			ReleasedSectors.push_back(i);
+			bChanged = true;
+		}
+	}
+
+	for (const Candidate& Kept : Candidates)
+	{
+		Sector& Current = Sectors[Kept.Sector];
+		if (Current.bResident)
+		{
+			continue;
+		}
+		if (PendingModels >= Settings.MaxPendingModels)
+		{
+			break;
+		}
+		RequestSector(Kept.Sector);
+		bChanged = true;
+	}
+	return bChanged;
+}
+
+void SectorStreamer::RequestSector(uint32_t SectorIndex)
+{
+	Sector& InSector = Sectors[SectorIndex];
+	InSector.bResident = true;
+	for (uint32_t i = 0; i < InSector.ModelCount; i++)
+	{
+		AcquireModel(SectorModels[InSector.FirstModel + i]);
+	}
+}
+
+void SectorStreamer::ReleaseSector(uint32_t SectorIndex)
+{
+	Sector& InSector = Sectors[SectorIndex];
+	InSector.bResident = false;
+	for (uint32_t i = 0; i < InSector.ModelCount; i++)
+	{
+		ReleaseModel(SectorModels[InSector.FirstModel + i]);
+	}
+
+	SectorBatch& Batch = SectorBatches[SectorIndex];
+	if (Batch.Pending)
+	{
+		Batch.Pending->bCancelled = true;
+		auto Found = std::find(BatchUploads.begin(), BatchUploads.end(), Batch.Pending);
+		if (Found != BatchUploads.end())
+		{
+			BatchUploads.erase(Found);
+		}
+		Batch.Pending.reset();
+		PendingBatches--;
+	}
+	Batch.Resident.reset();
+	Batch.bDone = false;
+}
+
+void SectorStreamer::AcquireModel(uint32_t ModelIndex)
+{
+	StreamedModel& Streamed = Models[ModelIndex];
+	if (Streamed.SectorRefs++ > 0 || Streamed.bFailed)
+	{
+		return;
+	}
+
+	// meshes another model already holds cost nothing to acquire
+	if (AssetRegistry::Get().HasMeshes(Streamed.Path))
+	{
+		FinishModel(Streamed, std::unique_ptr<Model>(new Model(Streamed.Path)));
+		return;
+	}
+
+	Streamed.Pending = std::make_shared<PendingLoad>(Streamed.Path, ModelIndex);
+	PendingModels++;
+
+	std::shared_ptr<PreparedQueue> Queue = Prepared;
+	std::shared_ptr<PendingLoad> Load = Streamed.Pending;
+	ThreadPool::Get().Submit([Queue, Load]()
+	{
+		Load->bPrepared = Load->Load.Prepare(true);
+
+		std::lock_guard<std::mutex> Lock(Queue->Mutex);
+		Queue->Loads.push_back(Load);
+	});
+}
+
+void SectorStreamer::ReleaseModel(uint32_t ModelIndex)
+{
+	StreamedModel& Streamed = Models[ModelIndex];
+	if (--Streamed.SectorRefs > 0)
+	{
+		return;
+	}
+
+	if (Streamed.Pending)
+	{
+		Streamed.Pending->bCancelled = true;
+		auto Found = std::find(Uploads.begin(), Uploads.end(), Streamed.Pending);
+		if (Found != Uploads.end())
+		{
+			Uploads.erase(Found);
+		}
+		Streamed.Pending.reset();
+		PendingModels--;
+	}
+	Streamed.Resident.reset();
+}
+
+void SectorStreamer::FinishModel(StreamedModel& InModel, std::unique_ptr<Model> Loaded)
+{
+	glm::vec3 Center;
+	float Radius;
+	InModel.bFailed = !Loaded->GetBounds(Center, Radius);
+	InModel.Bounds = InModel.bFailed ? glm::vec4(0.0f, 0.0f, 0.0f, -1.0f) : glm::vec4(Center, Radius);
+	InModel.Bytes = Loaded->GetMemoryBytes();
+	InModel.Resident = std::move(Loaded);
+}
+
+void SectorStreamer::ReceivePrepared()
+{
+	std::deque<std::shared_ptr<PendingLoad>> Received;
+	{
+		std::lock_guard<std::mutex> Lock(Prepared->Mutex);
+		Received.swap(Prepared->Loads);
+	}
+
+	for (std::shared_ptr<PendingLoad>& Load : Received)
+	{
+		if (Load->bCancelled)
+		{
+			continue;
+		}
+		if (!Load->bPrepared)
+		{
+			StreamedModel& Streamed = Models[Load->ModelIndex];
+			Streamed.bFailed = true;
+			Streamed.Pending.reset();
+			PendingModels--;
+			continue;
+		}
+		Uploads.push_back(Load);
+	}
+}
+
+void SectorStreamer::UploadModels(size_t& InOutBytesUsed)
+{
+	while (!Uploads.empty() && InOutBytesUsed < Settings.UploadBudget)
+	{
+		std::shared_ptr<PendingLoad> Load = Uploads.front();
+		if (!Load->Load.Upload(InOutBytesUsed, Settings.UploadBudget))
+		{
+			break;
+		}
+		Uploads.pop_front();
+
+		StreamedModel& Streamed = Models[Load->ModelIndex];
+		Streamed.Pending.reset();
+		PendingModels--;
+		FinishModel(Streamed, std::unique_ptr<Model>(new Model(Load->Load)));
+	}
+}
+
+void SectorStreamer::RequestBatches()
+{
+	if (!Settings.bStaticBatching)
+	{
+		return;
+	}
+
+	for (uint32_t SectorIndex = 0; SectorIndex < Sectors.size() && PendingBatches < Settings.MaxPendingModels; SectorIndex++)
+	{
+		const Sector& Current = Sectors[SectorIndex];
+		SectorBatch& Batch = SectorBatches[SectorIndex];
+		if (!Current.bResident || Batch.bDone || Batch.Pending)
+		{
+			continue;
+		}
+
+		bool bLoading = false;
+		for (uint32_t i = 0; i < Current.ModelCount && !bLoading; i++)
+		{
+			bLoading = Models[SectorModels[Current.FirstModel + i]].Pending != nullptr;
+		}
+		if (bLoading)
+		{
+			continue;
+		}
+
+		// a single object gains nothing from merging, failed models are left to fail on their own
+		std::vector<StaticBatchObject> Objects;
+		for (uint32_t i = 0; i < Current.ObjectCount; i++)
+		{
+			const uint32_t Object = SectorObjects[Current.FirstObject + i];
+			if (GetModel(ObjectModels[Object]))
+			{
+				StaticBatchObject Source;
+				Source.Object = Object;
+				Source.Model = ObjectModels[Object];
+				Source.Transform = Transforms[Object];
+				Objects.push_back(Source);
+			}
+		}
+		if (Objects.size() < 2)
+		{
+			Batch.bDone = true;
+			Batch.Bytes = 0;
+			continue;
+		}
+
+		Batch.Pending = std::make_shared<PendingBatch>(SectorIndex);
+		PendingBatches++;
+
+		std::shared_ptr<BuiltQueue> Queue = Built;
+		std::shared_ptr<PendingBatch> Job = Batch.Pending;
+		std::shared_ptr<const std::vector<std::string>> Paths = ModelPaths;
+		const StaticBatchSettings BatchSettings = Settings.StaticBatching;
+		ThreadPool::Get().Submit([Queue, Job, Paths, BatchSettings, Objects]()
+		{
+			Job->bBuilt = Job->Batch->Build(Objects, *Paths, BatchSettings);
+
+			std::lock_guard<std::mutex> Lock(Queue->Mutex);
+			Queue->Batches.push_back(Job);
+		});
+	}
+}
+
+void SectorStreamer::ReceiveBatches()
+{
+	std::deque<std::shared_ptr<PendingBatch>> Received;
+	{
+		std::lock_guard<std::mutex> Lock(Built->Mutex);
+		Received.swap(Built->Batches);
+	}
+
+	for (std::shared_ptr<PendingBatch>& Job : Received)
+	{
+		if (Job->bCancelled)
+		{
+			continue;
+		}
+		if (!Job->bBuilt)
+		{
+			// nothing to merge, the sector's objects are drawn one by one
+			SectorBatch& Batch = SectorBatches[Job->SectorIndex];
+			Batch.Pending.reset();
+			Batch.bDone = true;
+			Batch.Bytes = 0;
+			PendingBatches--;
+			continue;
+		}
+		BatchUploads.push_back(Job);
+	}
+}
+
+void SectorStreamer::UploadBatches(size_t& InOutBytesUsed)
+{
+	while (!BatchUploads.empty() && InOutBytesUsed < Settings.UploadBudget)
+	{
+		std::shared_ptr<PendingBatch> Job = BatchUploads.front();
+		if (!Job->Batch->Upload(InOutBytesUsed, Settings.UploadBudget))
+		{
+			break;
+		}
+		BatchUploads.pop_front();
+
+		SectorBatch& Batch = SectorBatches[Job->SectorIndex];
+		Batch.Pending.reset();
+		Batch.bDone = true;
+		Batch.Bytes = Job->Batch->GetMemoryBytes();
+		Batch.Resident = std::move(Job->Batch);
+		PendingBatches--;
+	}
+}
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "SceneData.h"
+#include "StaticBatch.h"
+#include "Engine/Mesh/Model.h"
+
+struct SectorStreamingSettings
+{
+	// Sectors are squares of this size on the XZ plane
+	float SectorSize = 32.0f;
+
+	// A sector is requested once the camera is within LoadRadius of it and released once it is further than
+	// UnloadRadius, the gap keeps a camera moving along the edge from loading and releasing it every frame
+	float LoadRadius = 120.0f;
+	float UnloadRadius = 160.0f;
+
+	// Vertex and index bytes created on the GL thread per frame
+	size_t UploadBudget = 8 * 1024 * 1024;
+
+	// Vertex and index memory of the models the resident sectors use
+	size_t MemoryBudget = 512 * 1024 * 1024;
+
+	// Model loads waiting for the thread pool or the GL thread, no more sectors are requested while they are in flight
+	unsigned int MaxPendingModels = 8;
+
+	// Merge the small static objects of each resident sector by material once its models have loaded (see
+	// StaticBatch.h). Batches are built on the thread pool, at most MaxPendingModels at a time, and uploaded within
+	// the same upload budget as the models.
+	bool bStaticBatching = true;
+	StaticBatchSettings StaticBatching;
+};
+
+// Keeps the part of a scene around the camera resident. Objects and point and spot lights are split into sectors
+// by position. Requesting a sector acquires the models its objects use: the file is mapped or imported on the thread
+// pool (ModelLoad::Prepare) and Update creates the meshes on the GL thread within the upload budget, so objects
+// appear model by model as they finish. Their textures are acquired with the meshes and streamed by TextureStreamer
+// within the TextureResidency budget. A model is shared by every sector using it and released with the last one.
+// Sectors are kept nearest first for as long as the models they add fit the memory budget, farther ones are released
+// even inside UnloadRadius, so residency stays bounded however large the scene is. Until a model has been loaded its
+// size is estimated from its cooked file (or its source when there is none), a wrong guess is corrected by the next
+// Update once the model is resident, which releases the farthest sectors again if the budget was overshot. With
+// static batching a sector's batch is built once all its models are resident and released with the sector, its
+// memory counts towards the sector in the budget, estimated the same way until it has been built.
+// GL thread only, except for the prepare jobs.
+class SectorStreamer
+{
+public:
+	struct Sector
+	{
+		glm::vec2 Min = glm::vec2(0.0f); // x and z
+		glm::vec2 Max = glm::vec2(0.0f);
+		uint32_t FirstObject = 0;        // into GetSectorObjects
+		uint32_t ObjectCount = 0;
+		uint32_t FirstModel = 0;         // into SectorModels, every model the objects use once
+		uint32_t ModelCount = 0;
+		uint32_t FirstLight = 0;         // into GetSectorLights
+		uint32_t LightCount = 0;
+		bool bResident = false;
+		uint64_t PlanStamp = 0;
+	};
+
+	SectorStreamer();
+	~SectorStreamer();
+
+	SectorStreamer(const SectorStreamer&) = delete;
+	SectorStreamer& operator=(const SectorStreamer&) = delete;
+
+	// Splits the scene into sectors, nothing is loaded until Update. The arrays have to stay valid until Clear.
+	// Objects of a model with an empty path are left out of every sector, their model is not streamed.
+	void Build(const glm::mat4* InTransforms, const uint32_t* InObjectModels, size_t ObjectCount, const SceneLight* Lights, size_t LightCount,
+		const std::vector<std::string>& InModelPaths, const SectorStreamingSettings& InSettings = SectorStreamingSettings());
+
+	// Releases every model, loads in flight are dropped. Needs the GL context to still be current.
+	void Clear();
+
+	// Requests and releases sectors around the camera and finishes prepared models within the upload budget, call
+	// once per frame. Returns true when sectors were requested or released, their lights change with them.
+	bool Update(const glm::vec3& CameraPosition);
+
+	const std::vector<Sector>& GetSectors() const { return Sectors; }
+	const std::vector<uint32_t>& GetSectorObjects() const { return SectorObjects; }
+	const std::vector<uint32_t>& GetSectorLights() const { return SectorLights; }
+
+	// Sectors released by the last Update
+	const std::vector<uint32_t>& GetReleasedSectors() const { return ReleasedSectors; }
+
+	// Null until the model has finished loading, and for models that failed to
+	Model* GetModel(uint32_t ModelIndex) const;
+
+	// Center and radius in model space, valid whenever GetModel is not null
+	const glm::vec4& GetModelBounds(uint32_t ModelIndex) const { return Models[ModelIndex].Bounds; }
+
+	// The merged static objects of a resident sector, null until the batch has been built and uploaded and for
+	// sectors with nothing to merge
+	StaticBatch* GetBatch(uint32_t SectorIndex) const;
+
+private:
+	// One model load, shared with the job preparing it so a cancelled load can still finish on the thread pool
+	struct PendingLoad
+	{
+		PendingLoad(const std::string& FilePath, uint32_t InModelIndex)
+			: Load(FilePath)
+			, ModelIndex(InModelIndex)
+		{
+		}
+
+		ModelLoad Load;
+		uint32_t ModelIndex = 0;
+		bool bPrepared = false;  // set by the job
+		bool bCancelled = false; // only touched on the GL thread
+	};
+
+	// Finished prepare jobs, shared with the jobs so they never outlive it
+	struct PreparedQueue
+	{
+		std::mutex Mutex;
+		std::deque<std::shared_ptr<PendingLoad>> Loads;
+	};
+
+	struct StreamedModel
+	{
+		std::string Path;
+		std::unique_ptr<Model> Resident;
+		std::shared_ptr<PendingLoad> Pending;
+		glm::vec4 Bounds = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);
+		size_t Bytes = 0;         // estimated at Build, exact after the first load and kept once released, for planning
+		uint32_t SectorRefs = 0;
+		uint64_t PlanStamp = 0;
+		bool bFailed = false;     // not requested again
+	};
+
+	// One batch build, shared with the job like PendingLoad
+	struct PendingBatch
+	{
+		explicit PendingBatch(uint32_t InSectorIndex)
+			: SectorIndex(InSectorIndex)
+		{
+		}
+
+		std::unique_ptr<StaticBatch> Batch = std::unique_ptr<StaticBatch>(new StaticBatch());
+		uint32_t SectorIndex = 0;
+		bool bBuilt = false;     // set by the job
+		bool bCancelled = false; // only touched on the GL thread
+	};
+
+	struct BuiltQueue
+	{
+		std::mutex Mutex;
+		std::deque<std::shared_ptr<PendingBatch>> Batches;
+	};
+
+	// Batch state of a sector, parallel to Sectors
+	struct SectorBatch
+	{
+		std::unique_ptr<StaticBatch> Resident;
+		std::shared_ptr<PendingBatch> Pending;
+		size_t Bytes = 0;        // estimated at Build, exact after the first build and kept once released, for planning
+		bool bDone = false;      // built, or found to have nothing to merge, while resident
+	};
+
+	struct Candidate
+	{
+		float Distance;
+		uint32_t Sector;
+	};
+
+	// Picks the sectors to keep and requests or releases the ones that change
+	bool PlanResidency(const glm::vec3& CameraPosition);
+
+	void RequestSector(uint32_t SectorIndex);
+	void ReleaseSector(uint32_t SectorIndex);
+
+	void AcquireModel(uint32_t ModelIndex);
+	void ReleaseModel(uint32_t ModelIndex);
+	void FinishModel(StreamedModel& InModel, std::unique_ptr<Model> Loaded);
+
+	void ReceivePrepared();
+	void UploadModels(size_t& InOutBytesUsed);
+
+	// Starts a build for every resident sector whose models have all finished loading
+	void RequestBatches();
+	void ReceiveBatches();
+	void UploadBatches(size_t& InOutBytesUsed);
+
+	SectorStreamingSettings Settings;
+	const glm::mat4* Transforms = nullptr;
+	const uint32_t* ObjectModels = nullptr;
+	std::shared_ptr<const std::vector<std::string>> ModelPaths; // shared with the batch jobs
+
+	std::vector<Sector> Sectors;
+	std::vector<uint32_t> SectorObjects;
+	std::vector<uint32_t> SectorModels;
+	std::vector<uint32_t> SectorLights;
+	std::vector<StreamedModel> Models;
+
+	std::shared_ptr<PreparedQueue> Prepared = std::make_shared<PreparedQueue>();
+	std::deque<std::shared_ptr<PendingLoad>> Uploads;
+	unsigned int PendingModels = 0;
+
+	std::vector<SectorBatch> SectorBatches;
+	std::shared_ptr<BuiltQueue> Built = std::make_shared<BuiltQueue>();
+	std::deque<std::shared_ptr<PendingBatch>> BatchUploads;
+	unsigned int PendingBatches = 0;
+
+	std::vector<Candidate> Candidates;
+	std::vector<uint32_t> ReleasedSectors;
+	uint64_t PlanStamp = 0;
+};
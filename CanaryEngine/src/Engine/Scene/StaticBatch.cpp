@@ -0,0 +1,271 @@
+#include "StaticBatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+#include "Engine/Mesh/Model.h"
+#include "Engine/Renderer/RenderStats.h"
+#include "Engine/Renderer/RenderView.h"
+#include "Engine/Shader/ShaderProgram.h"
+
+namespace
+{
+	// The meshes of one model as read for merging, shared by every object using it
+	struct SourceModel
+	{
+		bool bRead = false;
+		bool bEligible = false;
+		std::vector<MeshData> Meshes;
+		std::vector<uint32_t> MeshMaterials;
+	};
+
+	// One mesh of one object, sorted so that each chunk is a run of them
+	struct MergeEntry
+	{
+		uint32_t Material;
+		int32_t CellX;
+		int32_t CellZ;
+		uint32_t Object; // into the objects given to Build
+		uint32_t Mesh;
+
+		bool operator<(const MergeEntry& Other) const
+		{
+			if (Material != Other.Material) return Material < Other.Material;
+			if (CellX != Other.CellX) return CellX < Other.CellX;
+			if (CellZ != Other.CellZ) return CellZ < Other.CellZ;
+			if (Object != Other.Object) return Object < Other.Object;
+			return Mesh < Other.Mesh;
+		}
+	};
+
+	// Identifies a material by its texture files, in a fixed order so the same set from two models matches
+	std::string GetMaterialKey(const std::string& Directory, std::vector<MaterialTextureRef> TextureRefs)
+	{
+		std::sort(TextureRefs.begin(), TextureRefs.end(), [](const MaterialTextureRef& A, const MaterialTextureRef& B)
+		{
+			return A.Type != B.Type ? A.Type < B.Type : A.Path < B.Path;
+		});
+
+		std::string Key;
+		for (const MaterialTextureRef& Ref : TextureRefs)
+		{
+			Key += Ref.Type;
+			Key += '\n';
+			Key += Directory + '/' + Ref.Path;
+			Key += '\n';
+		}
+		return Key;
+	}
+}
+
+StaticBatch::Chunk::Chunk(PendingChunk& Source, std::vector<Texture> InTextures)
+	: ChunkMesh(std::move(Source.Vertices), std::move(Source.Indices), std::move(InTextures))
+	, Ranges(std::move(Source.Ranges))
+{
+}
+
+StaticBatch::StaticBatch()
+{
+}
+
+StaticBatch::~StaticBatch()
+{
+	// chunks free their buffers themselves, textures are only referenced
+	for (TextureHandle Texture : Textures)
+	{
+		AssetRegistry::Get().Release(Texture);
+	}
+}
+
+bool StaticBatch::Build(const std::vector<StaticBatchObject>& Objects, const std::vector<std::string>& ModelPaths, const StaticBatchSettings& Settings)
+{
+	// read every model once, a model is only merged when all of its meshes can be
+	std::vector<SourceModel> Sources(ModelPaths.size());
+	std::map<std::string, uint32_t> MaterialByKey;
+	for (const StaticBatchObject& Object : Objects)
+	{
+		SourceModel& Source = Sources[Object.Model];
+		if (Source.bRead)
+		{
+			continue;
+		}
+		Source.bRead = true;
+
+		ModelLoad Load(ModelPaths[Object.Model]);
+		if (!Load.PrepareGeometry())
+		{
+			continue;
+		}
+
+		Source.bEligible = Load.GetMeshCount() > 0;
+		Source.Meshes.resize(Load.GetMeshCount());
+		for (size_t i = 0; i < Source.Meshes.size() && Source.bEligible; i++)
+		{
+			MeshData& Data = Source.Meshes[i];
+			Source.bEligible = Load.ReadMesh(i, Data) && Data.Skin.empty() && Data.Vertices.size() <= Settings.MaxSourceVertices;
+		}
+		if (!Source.bEligible)
+		{
+			Source.Meshes.clear();
+			continue;
+		}
+
+		for (const MeshData& Data : Source.Meshes)
+		{
+			auto Inserted = MaterialByKey.emplace(GetMaterialKey(Load.GetDirectory(), Data.TextureRefs), static_cast<uint32_t>(Materials.size()));
+			if (Inserted.second)
+			{
+				Materials.push_back({ Load.GetDirectory(), Data.TextureRefs });
+				Model::HashMaterialTextures(Load.GetDirectory(), Data.TextureRefs, TextureHashes);
+			}
+			Source.MeshMaterials.push_back(Inserted.first->second);
+		}
+		BatchedModels.push_back(Object.Model);
+	}
+	std::sort(BatchedModels.begin(), BatchedModels.end());
+
+	std::vector<MergeEntry> Entries;
+	for (uint32_t i = 0; i < Objects.size(); i++)
+	{
+		const SourceModel& Source = Sources[Objects[i].Model];
+		if (!Source.bEligible)
+		{
+			continue;
+		}
+
+		const glm::vec3 Origin = glm::vec3(Objects[i].Transform[3]);
+		const int32_t CellX = static_cast<int32_t>(std::floor(Origin.x / Settings.ChunkSize));
+		const int32_t CellZ = static_cast<int32_t>(std::floor(Origin.z / Settings.ChunkSize));
+		for (uint32_t j = 0; j < Source.Meshes.size(); j++)
+		{
+			if (!Source.Meshes[j].Indices.empty())
+			{
+				Entries.push_back({ Source.MeshMaterials[j], CellX, CellZ, i, j });
+			}
+		}
+		ObjectCount++;
+	}
+	std::sort(Entries.begin(), Entries.end());
+
+	const MergeEntry* Previous = nullptr;
+	for (const MergeEntry& Entry : Entries)
+	{
+		const StaticBatchObject& Object = Objects[Entry.Object];
+		const MeshData& Data = Sources[Object.Model].Meshes[Entry.Mesh];
+
+		const bool bSameCell = Previous && Previous->Material == Entry.Material && Previous->CellX == Entry.CellX && Previous->CellZ == Entry.CellZ;
+		if (!bSameCell || Pending.back().Vertices.size() + Data.Vertices.size() > Settings.MaxChunkVertices)
+		{
+			Pending.emplace_back();
+			Pending.back().MaterialIndex = Entry.Material;
+		}
+		Previous = &Entry;
+
+		PendingChunk& Target = Pending.back();
+		const unsigned int FirstVertex = static_cast<unsigned int>(Target.Vertices.size());
+		const glm::mat3 NormalMatrix = glm::transpose(glm::inverse(glm::mat3(Object.Transform)));
+		for (const Vertex& Source : Data.Vertices)
+		{
+			Vertex World = Source;
+			World.Position = glm::vec3(Object.Transform * glm::vec4(Source.Position, 1.0f));
+			const glm::vec3 Normal = NormalMatrix * Source.Normal;
+			const float Length = glm::length(Normal);
+			World.Normal = Length > 0.0f ? Normal / Length : Normal;
+			Target.Vertices.push_back(World);
+		}
+
+		// a mirroring transform turns the triangles inside out, flip their winding back
+		const bool bMirrored = glm::determinant(glm::mat3(Object.Transform)) < 0.0f;
+		StaticBatchRange Range;
+		Range.Object = Object.Object;
+		Range.Mesh = Entry.Mesh;
+		Range.FirstIndex = static_cast<uint32_t>(Target.Indices.size());
+		for (size_t i = 0; i + 2 < Data.Indices.size(); i += 3)
+		{
+			Target.Indices.push_back(FirstVertex + Data.Indices[i]);
+			Target.Indices.push_back(FirstVertex + Data.Indices[bMirrored ? i + 2 : i + 1]);
+			Target.Indices.push_back(FirstVertex + Data.Indices[bMirrored ? i + 1 : i + 2]);
+		}
+		Range.IndexCount = static_cast<uint32_t>(Target.Indices.size()) - Range.FirstIndex;
+		Target.Ranges.push_back(Range);
+	}
+
+	bBuilt = !Pending.empty();
+	return bBuilt;
+}
+
+bool StaticBatch::Upload(size_t& InOutBytesUsed, size_t Budget)
+{
+	if (!bBuilt)
+	{
+		return false;
+	}
+
+	if (MaterialTextures.empty())
+	{
+		for (const Material& Source : Materials)
+		{
+			MaterialTextures.push_back(Model::LoadMaterialTextures(Source.Directory, Source.TextureRefs, Textures, &TextureHashes));
+		}
+		Chunks.reserve(Pending.size());
+	}
+
+	for (bool bFirst = true; Chunks.size() < Pending.size() && (bFirst || InOutBytesUsed < Budget); bFirst = false)
+	{
+		PendingChunk& Source = Pending[Chunks.size()];
+		Chunks.emplace_back(Source, MaterialTextures[Source.MaterialIndex]);
+		InOutBytesUsed += Chunks.back().ChunkMesh.GetGpuBytes();
+	}
+	return IsUploaded();
+}
+
+void StaticBatch::Draw(ShaderProgram& Shader, const RenderView& View)
+{
+	if (Chunks.empty())
+	{
+		return;
+	}
+
+	// chunks are already in world space
+	Shader.SetMat4("ModelMatrix", glm::mat4(1.0f));
+
+	RenderStats& Stats = RenderStats::Get();
+	for (Chunk& Current : Chunks)
+	{
+		const glm::vec3& Center = Current.ChunkMesh.GetBoundsCenter();
+		const float Radius = Current.ChunkMesh.GetBoundsRadius();
+		if (!View.ViewFrustum.IntersectsSphere(Center, Radius))
+		{
+			Stats.BatchChunksCulled++;
+			continue;
+		}
+
+		const float Distance = std::max(glm::length(Center - View.CameraPosition) - Radius, 0.01f);
+		Current.ChunkMesh.RequestTextureDetail(View.ProjectionScale / Distance);
+		Current.ChunkMesh.Draw(Shader);
+		Stats.BatchChunksDrawn++;
+	}
+}
+
+bool StaticBatch::IsModelBatched(uint32_t ModelIndex) const
+{
+	return std::binary_search(BatchedModels.begin(), BatchedModels.end(), ModelIndex);
+}
+
+size_t StaticBatch::GetMemoryBytes() const
+{
+	size_t Bytes = 0;
+	for (const Chunk& Current : Chunks)
+	{
+		Bytes += Current.ChunkMesh.GetGpuBytes() + Current.ChunkMesh.GetCpuBytes();
+	}
+	return Bytes;
+}
+
+size_t StaticBatch::EstimateObjectBytes(size_t ModelBytes, const StaticBatchSettings& Settings)
+{
+	// about two triangles per vertex, each copy holds the vertex and its six indices
+	const size_t MaxMeshBytes = size_t(Settings.MaxSourceVertices) * (sizeof(Vertex) + 6 * sizeof(unsigned int));
+	return 2 * std::min(ModelBytes, MaxMeshBytes);
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Engine/Asset/AssetRegistry.h"
+#include "Engine/Mesh/Mesh.h"
+
+class ShaderProgram;
+struct RenderView;
+
+struct StaticBatchSettings
+{
+	// Models with a mesh above this many vertices are left out and drawn on their own, they keep their LODs and
+	// meshlets and cost little per triangle in draw calls anyway
+	unsigned int MaxSourceVertices = 4096;
+
+	// Merged geometry is split on a grid of this size on the XZ plane, objects are assigned to a cell by their origin
+	float ChunkSize = 16.0f;
+
+	// Largest chunk, a cell with more vertices of one material is split into several
+	unsigned int MaxChunkVertices = 65536;
+};
+
+// An object of the scene that may be merged, Model indexes the model paths given to Build
+struct StaticBatchObject
+{
+	uint32_t Object = 0;
+	uint32_t Model = 0;
+	glm::mat4 Transform = glm::mat4(1.0f);
+};
+
+// The triangles one mesh of one object contributed to a chunk, in index buffer order
+struct StaticBatchRange
+{
+	uint32_t Object = 0;
+	uint32_t Mesh = 0;
+	uint32_t FirstIndex = 0;
+	uint32_t IndexCount = 0;
+};
+
+// Static objects merged by material: the meshes of every eligible object are transformed to world space and
+// appended to the chunk of their material and grid cell, so a cell full of props sharing textures is one draw call
+// and chunks are still culled by their bounds. Chunks are drawn at LOD 0 without meshlet culling. Each chunk keeps
+// the index range every source mesh ended up in so a picked triangle can be traced back to its object.
+// Build runs on the thread pool and reads the models again through ModelLoad::PrepareGeometry (cooked files are
+// mapped, sources are imported without their LODs and meshlets), Upload creates the chunk meshes on the GL thread
+// within a byte budget, like ModelLoad.
+class StaticBatch
+{
+public:
+	StaticBatch();
+	~StaticBatch();
+
+	StaticBatch(const StaticBatch&) = delete;
+	StaticBatch& operator=(const StaticBatch&) = delete;
+
+	// Merges the objects of every model without skinned or oversized meshes, ModelPaths is indexed by
+	// StaticBatchObject::Model. Any thread, returns false when nothing could be merged.
+	bool Build(const std::vector<StaticBatchObject>& Objects, const std::vector<std::string>& ModelPaths, const StaticBatchSettings& Settings = StaticBatchSettings());
+
+	// Creates chunk meshes until InOutBytesUsed reaches Budget, at least one per call. Returns true once every chunk
+	// has been created. GL thread only, after Build.
+	bool Upload(size_t& InOutBytesUsed, size_t Budget);
+	bool IsUploaded() const { return bBuilt && Chunks.size() == Pending.size(); }
+
+	// Draws every chunk that intersects the view with an identity model matrix
+	void Draw(ShaderProgram& Shader, const RenderView& View);
+
+	// Whether the objects of a model are drawn by the batch instead of by the model, valid after Build
+	bool IsModelBatched(uint32_t ModelIndex) const;
+
+	size_t GetChunkCount() const { return Chunks.size(); }
+	size_t GetObjectCount() const { return ObjectCount; }
+
+	// The source meshes of a chunk in index buffer order, for tracing a picked triangle back to its object
+	const std::vector<StaticBatchRange>& GetChunkRanges(size_t ChunkIndex) const { return Chunks[ChunkIndex].Ranges; }
+
+	// Vertex and index memory of the created chunks
+	size_t GetMemoryBytes() const;
+
+	// Guess at the memory one object adds to a batch from the size of its model's file, for planning before the
+	// batch is built. Chunks keep full vertices on the CPU and the GPU, about twice what a model holds, and an object
+	// adds at most what a mesh at MaxSourceVertices would, larger ones are not merged.
+	static size_t EstimateObjectBytes(size_t ModelBytes, const StaticBatchSettings& Settings = StaticBatchSettings());
+
+private:
+	// A model's directory and a mesh's texture references, chunks of the same material share its textures
+	struct Material
+	{
+		std::string Directory;
+		std::vector<MaterialTextureRef> TextureRefs;
+	};
+
+	// Merged geometry waiting for Upload
+	struct PendingChunk
+	{
+		uint32_t MaterialIndex = 0;
+		std::vector<Vertex> Vertices;
+		std::vector<unsigned int> Indices;
+		std::vector<StaticBatchRange> Ranges;
+	};
+
+	struct Chunk
+	{
+		Chunk(PendingChunk& Source, std::vector<Texture> InTextures);
+
+		Mesh ChunkMesh;
+		std::vector<StaticBatchRange> Ranges;
+	};
+
+	bool bBuilt = false;
+	size_t ObjectCount = 0;
+	std::vector<Material> Materials;
+	TextureContentHashes TextureHashes; // of every material's textures, hashed by Build
+	std::vector<PendingChunk> Pending;
+	std::vector<uint32_t> BatchedModels; // sorted
+
+	std::vector<std::vector<Texture>> MaterialTextures; // filled by the first Upload
+	std::vector<TextureHandle> Textures;
+	std::vector<Chunk> Chunks;
+};
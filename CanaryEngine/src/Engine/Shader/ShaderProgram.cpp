@@ -1,32 +1,21 @@
 #include "ShaderProgram.h"
 
+#include "Engine/Core/VirtualFileSystem.h"
+#include "Engine/Renderer/GLStateCache.h"
+
 ShaderProgram::ShaderProgram(const char* VertexPath, const char* FragmentPath)
 {
-    // 1. Retrieve the vertex/fragment source code from our filePath
+    // 1. Retrieve the vertex/fragment source code through the virtual file system (loose file or pak entry)
     std::string VertexCode;
     std::string FragmentCode;
-    std::ifstream VextexShaderFile;
-    std::ifstream FragmentShaderFile;
 
-    try
+    if (!VirtualFileSystem::Get().ReadText(VertexPath, VertexCode))
     {
-        // Open files
-        VextexShaderFile.open(VertexPath);
-        FragmentShaderFile.open(FragmentPath);
-        std::stringstream vShaderStream, fShaderStream;
-        // read file's buffer contents into streams
-        vShaderStream << VextexShaderFile.rdbuf();
-        fShaderStream << FragmentShaderFile.rdbuf();
-        // close file handlers
-        VextexShaderFile.close();
-        FragmentShaderFile.close();
-        // convert stream into string
-        VertexCode = vShaderStream.str();
-        FragmentCode = fShaderStream.str();
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << VertexPath << std::endl;
     }
-    catch (std::ifstream::failure& e)
+    if (!VirtualFileSystem::Get().ReadText(FragmentPath, FragmentCode))
     {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << FragmentPath << std::endl;
     }
 
     const char* VertexShaderCode = VertexCode.c_str();
@@ -63,7 +52,7 @@ ShaderProgram::ShaderProgram(const char* VertexPath, const char* FragmentPath)
 
 void ShaderProgram::Use()
 {
-    glUseProgram(ID);
+    GLStateCache::Get().UseProgram(ID);
 }
 
 void ShaderProgram::SetBool(const std::string& Name, bool Value) const
@@ -0,0 +1,219 @@
+#include "AtlasPacker.h"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include <Imgui/imstb_rectpack.h>
+#include <stb/stb_image.h>
+
+#include "CookedAtlas.h"
+#include "TextureCooker.h"
+#include "Engine/Core/ThreadPool.h"
+
+namespace
+{
+	struct LoadedImage
+	{
+		std::vector<uint8_t> Pixels;
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		ETextureFormat Format = ETextureFormat::BC1;
+		bool bLoaded = false;
+	};
+
+	// Cell a texture occupies including its gutter, in GutterSize units so every cell starts block aligned on the
+	// first mips
+	int GetCellUnits(uint32_t Size)
+	{
+		return static_cast<int>((Size + 2 * AtlasPacker::GutterSize + AtlasPacker::GutterSize - 1) / AtlasPacker::GutterSize);
+	}
+
+	// Packs as many rects as fit into one page, the ones placed have was_packed set
+	void PackPage(std::vector<stbrp_rect>& Rects, int PageUnits)
+	{
+		std::vector<stbrp_node> Nodes(PageUnits);
+		stbrp_context Context;
+		stbrp_init_target(&Context, PageUnits, PageUnits, Nodes.data(), PageUnits);
+		stbrp_pack_rects(&Context, Rects.data(), static_cast<int>(Rects.size()));
+	}
+
+	// Copies the image into its cell, filling the rest of the cell with texels wrapped around its edges
+	void BlitWithGutter(const LoadedImage& Image, uint32_t CellX, uint32_t CellY, uint32_t CellWidth, uint32_t CellHeight, uint32_t PageSize,
+		std::vector<uint8_t>& Page)
+	{
+		const uint32_t Gutter = AtlasPacker::GutterSize;
+		for (uint32_t Y = 0; Y < CellHeight; Y++)
+		{
+			const uint32_t SourceY = (Y + Image.Height - Gutter % Image.Height) % Image.Height;
+			uint8_t* Row = &Page[(size_t(CellY + Y) * PageSize + CellX) * 4];
+			for (uint32_t X = 0; X < CellWidth; X++)
+			{
+				const uint32_t SourceX = (X + Image.Width - Gutter % Image.Width) % Image.Width;
+				const uint8_t* Texel = &Image.Pixels[(size_t(SourceY) * Image.Width + SourceX) * 4];
+				std::copy(Texel, Texel + 4, Row + size_t(X) * 4);
+			}
+		}
+	}
+}
+
+bool AtlasPacker::IsCandidate(const std::string& FilePath, const PackOptions& Options)
+{
+	int Width, Height, Components;
+	if (!stbi_info(FilePath.c_str(), &Width, &Height, &Components))
+	{
+		return false;
+	}
+	return Width > 0 && Height > 0 && uint32_t(Width) <= Options.MaxEntrySize && uint32_t(Height) <= Options.MaxEntrySize;
+}
+
+bool AtlasPacker::Pack(const std::vector<SourceTexture>& Sources, const std::string& AtlasPath, const PackOptions& Options)
+{
+	if (Options.MaxEntrySize + 2 * GutterSize > Options.MaxPageSize)
+	{
+		std::cout << "ERROR::ATLASPACKER::Textures of " << Options.MaxEntrySize << " texels do not fit a " << Options.MaxPageSize << " page" << std::endl;
+		return false;
+	}
+
+	// the engine loads images flipped (see Application::Run), cooked data has to match
+	stbi_set_flip_vertically_on_load(true);
+
+	std::vector<LoadedImage> Images(Sources.size());
+	ThreadPool::Get().ParallelFor(Sources.size(), [&](size_t i)
+	{
+		int Width, Height, Components;
+		unsigned char* Data = stbi_load(Sources[i].Path.c_str(), &Width, &Height, &Components, 4);
+		if (!Data)
+		{
+			return;
+		}
+
+		LoadedImage& Image = Images[i];
+		Image.Pixels.assign(Data, Data + size_t(Width) * Height * 4);
+		Image.Width = static_cast<uint32_t>(Width);
+		Image.Height = static_cast<uint32_t>(Height);
+		stbi_image_free(Data);
+
+		bool bHasAlpha = false;
+		if (Components == 2 || Components == 4)
+		{
+			for (size_t Texel = 3; Texel < Image.Pixels.size() && !bHasAlpha; Texel += 4)
+			{
+				bHasAlpha = Image.Pixels[Texel] != 255;
+			}
+		}
+
+		TextureCooker::CookOptions CookOptions;
+		CookOptions.TextureType = Sources[i].TextureType;
+		CookOptions.bHighQuality = Options.bHighQuality;
+		Image.Format = TextureCooker::ChooseFormat(CookOptions, bHasAlpha);
+		Image.bLoaded = true;
+	});
+
+	std::map<ETextureFormat, std::vector<size_t>> Groups;
+	for (size_t i = 0; i < Images.size(); i++)
+	{
+		if (!Images[i].bLoaded || Images[i].Width > Options.MaxEntrySize || Images[i].Height > Options.MaxEntrySize)
+		{
+			std::cout << "ERROR::ATLASPACKER::Cannot pack " << Sources[i].Path << std::endl;
+			return false;
+		}
+		Groups[Images[i].Format].push_back(i);
+	}
+
+	std::vector<CookedAtlas::GroupData> GroupData;
+	std::vector<CookedAtlas::EntryData> Entries;
+	for (const auto& Group : Groups)
+	{
+		const std::vector<size_t>& Members = Group.second;
+
+		std::vector<stbrp_rect> Rects(Members.size());
+		for (size_t i = 0; i < Members.size(); i++)
+		{
+			Rects[i].id = static_cast<int>(i);
+			Rects[i].w = GetCellUnits(Images[Members[i]].Width);
+			Rects[i].h = GetCellUnits(Images[Members[i]].Height);
+		}
+
+		// the smallest page that holds the whole group, failing that as many full size pages as it takes
+		uint32_t PageSize = 4 * GutterSize;
+		for (; PageSize < Options.MaxPageSize; PageSize *= 2)
+		{
+			std::vector<stbrp_rect> Attempt = Rects;
+			PackPage(Attempt, static_cast<int>(PageSize / GutterSize));
+			if (std::all_of(Attempt.begin(), Attempt.end(), [](const stbrp_rect& Rect) { return Rect.was_packed != 0; }))
+			{
+				break;
+			}
+		}
+		PageSize = std::min(PageSize, Options.MaxPageSize);
+
+		std::vector<std::vector<uint8_t>> Pages;
+		std::vector<stbrp_rect> Remaining = Rects;
+		while (!Remaining.empty())
+		{
+			PackPage(Remaining, static_cast<int>(PageSize / GutterSize));
+
+			const uint32_t Layer = static_cast<uint32_t>(Pages.size());
+			Pages.emplace_back(size_t(PageSize) * PageSize * 4, 0);
+			std::vector<stbrp_rect> Unpacked;
+			for (const stbrp_rect& Rect : Remaining)
+			{
+				if (!Rect.was_packed)
+				{
+					Unpacked.push_back(Rect);
+					continue;
+				}
+
+				const LoadedImage& Image = Images[Members[Rect.id]];
+				const uint32_t CellX = uint32_t(Rect.x) * GutterSize;
+				const uint32_t CellY = uint32_t(Rect.y) * GutterSize;
+				BlitWithGutter(Image, CellX, CellY, uint32_t(Rect.w) * GutterSize, uint32_t(Rect.h) * GutterSize, PageSize, Pages.back());
+
+				CookedAtlas::EntryData Entry;
+				Entry.Path = Sources[Members[Rect.id]].Path;
+				Entry.Group = static_cast<uint32_t>(GroupData.size());
+				Entry.Layer = Layer;
+				Entry.Rect[0] = float(CellX + GutterSize) / PageSize;
+				Entry.Rect[1] = float(CellY + GutterSize) / PageSize;
+				Entry.Rect[2] = float(Image.Width) / PageSize;
+				Entry.Rect[3] = float(Image.Height) / PageSize;
+				Entries.push_back(Entry);
+			}
+			if (Unpacked.size() == Remaining.size())
+			{
+				std::cout << "ERROR::ATLASPACKER::Textures do not fit a " << PageSize << " page" << std::endl;
+				return false;
+			}
+			Remaining.swap(Unpacked);
+		}
+
+		CookedAtlas::GroupData Data;
+		Data.Record = {};
+		Data.Record.Format = static_cast<uint32_t>(Group.first);
+		Data.Record.Width = PageSize;
+		Data.Record.Height = PageSize;
+		Data.Record.LayerCount = static_cast<uint32_t>(Pages.size());
+
+		// level by level, every layer of a level next to each other
+		uint32_t LevelSize = PageSize;
+		std::vector<uint8_t> Blocks, NextLevel;
+		for (uint32_t Level = 0; Level < MaxMipCount && LevelSize >= 4; Level++, LevelSize /= 2)
+		{
+			for (std::vector<uint8_t>& Page : Pages)
+			{
+				TextureCooker::CompressLevel(Page, LevelSize, LevelSize, Group.first, Blocks);
+				Data.Data.insert(Data.Data.end(), Blocks.begin(), Blocks.end());
+
+				TextureCooker::DownsampleMip(Page, LevelSize, LevelSize, NextLevel);
+				Page.swap(NextLevel);
+			}
+			Data.Record.MipCount++;
+		}
+		GroupData.push_back(std::move(Data));
+	}
+
+	return CookedAtlas::Write(AtlasPath, GroupData, Entries);
+}
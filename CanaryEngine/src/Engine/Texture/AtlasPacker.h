@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Offline half of the texture atlas, used by CanaryCooker: packs small material textures into the pages of a
+// .catlas (see CookedAtlas.h) with the stb_rect_pack bundled with ImGui. Textures are grouped by the format
+// TextureCooker would pick for them, so colour, alpha and normal textures each get their own array.
+// Every texture is surrounded by a gutter of its own texels wrapped around as GL_REPEAT would, and starts on a
+// GutterSize aligned position, which keeps bilinear filtering and the first mips from bleeding between neighbours.
+namespace AtlasPacker
+{
+	// Enough for the gutter to still be a texel wide at the last mip level
+	const uint32_t GutterSize = 16;
+	const uint32_t MaxMipCount = 5;
+
+	struct PackOptions
+	{
+		// Pages are the smallest power of two up to this that fits a group on one page, or this size with more layers
+		uint32_t MaxPageSize = 2048;
+
+		// Larger textures keep their own .ctex, they gain little from sharing a binding
+		uint32_t MaxEntrySize = 512;
+
+		// Same meaning as TextureCooker::CookOptions::bHighQuality
+		bool bHighQuality = false;
+	};
+
+	struct SourceTexture
+	{
+		std::string Path;
+		std::string TextureType;
+	};
+
+	// True if the image exists and is no larger than MaxEntrySize, only the header is read
+	bool IsCandidate(const std::string& FilePath, const PackOptions& Options);
+
+	// Loads, packs and block compresses every source into one .catlas. Images are decoded on the thread pool.
+	bool Pack(const std::vector<SourceTexture>& Sources, const std::string& AtlasPath, const PackOptions& Options);
+}
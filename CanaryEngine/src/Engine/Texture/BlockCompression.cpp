@@ -0,0 +1,436 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <glm/glm.hpp>
+
+namespace
+{
+	const int BlockPixels = 16;
+
+	// BC7 4 bit index interpolation weights (out of 64)
+	const int BC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// Principal axis of a set of points through power iteration on their covariance matrix
+	template <int N>
+	glm::vec<N, float, glm::defaultp> PrincipalAxis(const glm::vec<N, float, glm::defaultp>* Points, int Count, const glm::vec<N, float, glm::defaultp>& Mean)
+	{
+		typedef glm::vec<N, float, glm::defaultp> VecN;
+
+		float Covariance[N][N] = {};
+		for (int i = 0; i < Count; i++)
+		{
+			const VecN Delta = Points[i] - Mean;
+			for (int Row = 0; Row < N; Row++)
+			{
+				for (int Column = 0; Column < N; Column++)
+				{
+					Covariance[Row][Column] += Delta[Row] * Delta[Column];
+				}
+			}
+		}
+
+		VecN Axis(1.0f);
+		for (int Iteration = 0; Iteration < 8; Iteration++)
+		{
+			VecN Next(0.0f);
+			for (int Row = 0; Row < N; Row++)
+			{
+				for (int Column = 0; Column < N; Column++)
+				{
+					Next[Row] += Covariance[Row][Column] * Axis[Column];
+				}
+			}
+
+			const float Length = glm::length(Next);
+			if (Length <= 1e-6f)
+			{
+				break;
+			}
+			Axis = Next / Length;
+		}
+		return Axis;
+	}
+
+	// Endpoints at the extremes of the points projected onto their principal axis, pulled in slightly because the
+	// outermost palette entries are rarely hit exactly
+	template <int N>
+	void FindEndpoints(const glm::vec<N, float, glm::defaultp>* Points, int Count, glm::vec<N, float, glm::defaultp>& OutStart, glm::vec<N, float, glm::defaultp>& OutEnd)
+	{
+		typedef glm::vec<N, float, glm::defaultp> VecN;
+
+		VecN Mean(0.0f);
+		for (int i = 0; i < Count; i++)
+		{
+			Mean += Points[i];
+		}
+		Mean /= float(Count);
+
+		const VecN Axis = PrincipalAxis<N>(Points, Count, Mean);
+
+		float MinProjection = 0.0f, MaxProjection = 0.0f;
+		for (int i = 0; i < Count; i++)
+		{
+			const float Projection = glm::dot(Points[i] - Mean, Axis);
+			MinProjection = std::min(MinProjection, Projection);
+			MaxProjection = std::max(MaxProjection, Projection);
+		}
+
+		const float Inset = (MaxProjection - MinProjection) / 16.0f;
+		OutStart = Mean + Axis * (MinProjection + Inset);
+		OutEnd = Mean + Axis * (MaxProjection - Inset);
+	}
+
+	// Least squares endpoints for fixed per pixel interpolation factors (0 = start, 1 = end)
+	template <int N>
+	bool FitEndpoints(const glm::vec<N, float, glm::defaultp>* Points, const float* Factors, int Count, glm::vec<N, float, glm::defaultp>& OutStart, glm::vec<N, float, glm::defaultp>& OutEnd)
+	{
+		typedef glm::vec<N, float, glm::defaultp> VecN;
+
+		float AA = 0.0f, BB = 0.0f, AB = 0.0f;
+		VecN AX(0.0f), BX(0.0f);
+		for (int i = 0; i < Count; i++)
+		{
+			const float T = Factors[i];
+			const float S = 1.0f - T;
+			AA += S * S;
+			BB += T * T;
+			AB += S * T;
+			AX += Points[i] * S;
+			BX += Points[i] * T;
+		}
+
+		const float Determinant = AA * BB - AB * AB;
+		if (std::abs(Determinant) < 1e-6f)
+		{
+			return false;
+		}
+
+		OutStart = (AX * BB - BX * AB) / Determinant;
+		OutEnd = (BX * AA - AX * AB) / Determinant;
+		return true;
+	}
+
+	uint16_t PackColor565(const glm::vec3& Color)
+	{
+		const glm::vec3 Clamped = glm::clamp(Color, 0.0f, 255.0f);
+		const int R = int(std::lround(Clamped.r * 31.0f / 255.0f));
+		const int G = int(std::lround(Clamped.g * 63.0f / 255.0f));
+		const int B = int(std::lround(Clamped.b * 31.0f / 255.0f));
+		return static_cast<uint16_t>((R << 11) | (G << 5) | B);
+	}
+
+	glm::vec3 UnpackColor565(uint16_t Packed)
+	{
+		const int R = (Packed >> 11) & 31;
+		const int G = (Packed >> 5) & 63;
+		const int B = Packed & 31;
+		return glm::vec3(float((R << 3) | (R >> 2)), float((G << 2) | (G >> 4)), float((B << 3) | (B >> 2)));
+	}
+
+	// Picks the nearest of the four palette entries per pixel, returns the squared error
+	float ChooseColorIndices(const glm::vec3* Colors, uint16_t Color0, uint16_t Color1, uint32_t& OutIndices)
+	{
+		const glm::vec3 C0 = UnpackColor565(Color0);
+		const glm::vec3 C1 = UnpackColor565(Color1);
+		const glm::vec3 Palette[4] = { C0, C1, (C0 * 2.0f + C1) / 3.0f, (C0 + C1 * 2.0f) / 3.0f };
+
+		float TotalError = 0.0f;
+		OutIndices = 0;
+		for (int i = 0; i < BlockPixels; i++)
+		{
+			int Best = 0;
+			float BestError = 1e30f;
+			for (int Entry = 0; Entry < 4; Entry++)
+			{
+				const glm::vec3 Delta = Colors[i] - Palette[Entry];
+				const float Error = glm::dot(Delta, Delta);
+				if (Error < BestError)
+				{
+					BestError = Error;
+					Best = Entry;
+				}
+			}
+			OutIndices |= uint32_t(Best) << (i * 2);
+			TotalError += BestError;
+		}
+		return TotalError;
+	}
+
+	void WriteColorBlock(uint16_t Color0, uint16_t Color1, uint32_t Indices, uint8_t* OutBlock)
+	{
+		std::memcpy(OutBlock, &Color0, 2);
+		std::memcpy(OutBlock + 2, &Color1, 2);
+		std::memcpy(OutBlock + 4, &Indices, 4);
+	}
+
+	// Four colour mode needs Color0 > Color1, swapping the endpoints swaps indices 0<->1 and 2<->3
+	void EncodeColorBlock(const uint8_t* Pixels, uint8_t* OutBlock)
+	{
+		glm::vec3 Colors[BlockPixels];
+		for (int i = 0; i < BlockPixels; i++)
+		{
+			Colors[i] = glm::vec3(Pixels[i * 4], Pixels[i * 4 + 1], Pixels[i * 4 + 2]);
+		}
+
+		glm::vec3 Start, End;
+		FindEndpoints<3>(Colors, BlockPixels, Start, End);
+
+		uint16_t Color0 = PackColor565(End);
+		uint16_t Color1 = PackColor565(Start);
+		uint32_t Indices = 0;
+		float Error = ChooseColorIndices(Colors, Color0, Color1, Indices);
+
+		// one least squares refinement with the chosen indices
+		static const float IndexFactors[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		float Factors[BlockPixels];
+		for (int i = 0; i < BlockPixels; i++)
+		{
+			Factors[i] = IndexFactors[(Indices >> (i * 2)) & 3];
+		}
+
+		glm::vec3 Fitted0, Fitted1;
+		if (FitEndpoints<3>(Colors, Factors, BlockPixels, Fitted0, Fitted1))
+		{
+			const uint16_t Refined0 = PackColor565(Fitted0);
+			const uint16_t Refined1 = PackColor565(Fitted1);
+			uint32_t RefinedIndices = 0;
+			const float RefinedError = ChooseColorIndices(Colors, Refined0, Refined1, RefinedIndices);
+			if (RefinedError < Error)
+			{
+				Color0 = Refined0;
+				Color1 = Refined1;
+				Indices = RefinedIndices;
+				Error = RefinedError;
+			}
+		}
+
+		if (Color0 < Color1)
+		{
+			std::swap(Color0, Color1);
+			Indices ^= 0x55555555u;
+		}
+		else if (Color0 == Color1)
+		{
+			Indices = 0;
+		}
+
+		WriteColorBlock(Color0, Color1, Indices, OutBlock);
+	}
+
+	// BC4: two 8 bit endpoints and 3 bit indices, using the eight value mode (Value0 > Value1)
+	void EncodeSingleChannelBlock(const uint8_t* Pixels, int Channel, uint8_t* OutBlock)
+	{
+		int MinValue = 255, MaxValue = 0;
+		for (int i = 0; i < BlockPixels; i++)
+		{
+			MinValue = std::min(MinValue, int(Pixels[i * 4 + Channel]));
+			MaxValue = std::max(MaxValue, int(Pixels[i * 4 + Channel]));
+		}
+
+		OutBlock[0] = static_cast<uint8_t>(MaxValue);
+		OutBlock[1] = static_cast<uint8_t>(MinValue);
+
+		uint64_t Indices = 0;
+		if (MaxValue > MinValue)
+		{
+			int Palette[8];
+			Palette[0] = MaxValue;
+			Palette[1] = MinValue;
+			for (int Entry = 2; Entry < 8; Entry++)
+			{
+				Palette[Entry] = ((8 - Entry) * MaxValue + (Entry - 1) * MinValue + 3) / 7;
+			}
+
+			for (int i = 0; i < BlockPixels; i++)
+			{
+				const int Value = Pixels[i * 4 + Channel];
+				int Best = 0;
+				int BestError = 256;
+				for (int Entry = 0; Entry < 8; Entry++)
+				{
+					const int Error = std::abs(Value - Palette[Entry]);
+					if (Error < BestError)
+					{
+						BestError = Error;
+						Best = Entry;
+					}
+				}
+				Indices |= uint64_t(Best) << (i * 3);
+			}
+		}
+
+		for (int Byte = 0; Byte < 6; Byte++)
+		{
+			OutBlock[2 + Byte] = static_cast<uint8_t>(Indices >> (Byte * 8));
+		}
+	}
+
+	// Packs bits least significant first, as every BC format expects
+	struct BitWriter
+	{
+		uint8_t* Block;
+		int Position = 0;
+
+		explicit BitWriter(uint8_t* InBlock) : Block(InBlock) { std::memset(Block, 0, 16); }
+
+		void Write(uint32_t Value, int BitCount)
+		{
+			for (int Bit = 0; Bit < BitCount; Bit++, Position++)
+			{
+				Block[Position >> 3] |= uint8_t(((Value >> Bit) & 1) << (Position & 7));
+			}
+		}
+	};
+
+	struct BC7Endpoint
+	{
+		int Quantised[4]; // 7 bits per channel
+		int PBit;
+
+		glm::vec4 Decode() const
+		{
+			return glm::vec4(float(Quantised[0] * 2 + PBit), float(Quantised[1] * 2 + PBit), float(Quantised[2] * 2 + PBit), float(Quantised[3] * 2 + PBit));
+		}
+	};
+
+	BC7Endpoint QuantiseBC7Endpoint(const glm::vec4& Value)
+	{
+		BC7Endpoint Best = {};
+		float BestError = 1e30f;
+		for (int PBit = 0; PBit < 2; PBit++)
+		{
+			BC7Endpoint Candidate;
+			Candidate.PBit = PBit;
+			for (int Channel = 0; Channel < 4; Channel++)
+			{
+				Candidate.Quantised[Channel] = glm::clamp(int(std::lround((glm::clamp(Value[Channel], 0.0f, 255.0f) - PBit) * 0.5f)), 0, 127);
+			}
+
+			const glm::vec4 Delta = Candidate.Decode() - Value;
+			const float Error = glm::dot(Delta, Delta);
+			if (Error < BestError)
+			{
+				BestError = Error;
+				Best = Candidate;
+			}
+		}
+		return Best;
+	}
+
+	float ChooseBC7Indices(const glm::vec4* Pixels, const BC7Endpoint& Start, const BC7Endpoint& End, int* OutIndices)
+	{
+		const glm::vec4 E0 = Start.Decode();
+		const glm::vec4 E1 = End.Decode();
+
+		glm::vec4 Palette[16];
+		for (int Entry = 0; Entry < 16; Entry++)
+		{
+			// matches the decoder: ((64 - w) * e0 + w * e1 + 32) >> 6
+			Palette[Entry] = glm::floor((E0 * float(64 - BC7Weights[Entry]) + E1 * float(BC7Weights[Entry]) + 32.0f) / 64.0f);
+		}
+
+		float TotalError = 0.0f;
+		for (int i = 0; i < BlockPixels; i++)
+		{
+			int Best = 0;
+			float BestError = 1e30f;
+			for (int Entry = 0; Entry < 16; Entry++)
+			{
+				const glm::vec4 Delta = Pixels[i] - Palette[Entry];
+				const float Error = glm::dot(Delta, Delta);
+				if (Error < BestError)
+				{
+					BestError = Error;
+					Best = Entry;
+				}
+			}
+			OutIndices[i] = Best;
+			TotalError += BestError;
+		}
+		return TotalError;
+	}
+}
+
+void BlockCompression::EncodeBC1(const uint8_t* Pixels, uint8_t* OutBlock)
+{
+	EncodeColorBlock(Pixels, OutBlock);
+}
+
+void BlockCompression::EncodeBC3(const uint8_t* Pixels, uint8_t* OutBlock)
+{
+	EncodeSingleChannelBlock(Pixels, 3, OutBlock);
+	EncodeColorBlock(Pixels, OutBlock + 8);
+}
+
+void BlockCompression::EncodeBC5(const uint8_t* Pixels, uint8_t* OutBlock)
+{
+	EncodeSingleChannelBlock(Pixels, 0, OutBlock);
+	EncodeSingleChannelBlock(Pixels, 1, OutBlock + 8);
+}
+
+void BlockCompression::EncodeBC7(const uint8_t* Pixels, uint8_t* OutBlock)
+{
+	glm::vec4 Colors[BlockPixels];
+	for (int i = 0; i < BlockPixels; i++)
+	{
+		Colors[i] = glm::vec4(Pixels[i * 4], Pixels[i * 4 + 1], Pixels[i * 4 + 2], Pixels[i * 4 + 3]);
+	}
+
+	glm::vec4 StartValue, EndValue;
+	FindEndpoints<4>(Colors, BlockPixels, StartValue, EndValue);
+
+	BC7Endpoint Start = QuantiseBC7Endpoint(StartValue);
+	BC7Endpoint End = QuantiseBC7Endpoint(EndValue);
+	int Indices[BlockPixels];
+	float Error = ChooseBC7Indices(Colors, Start, End, Indices);
+
+	float Factors[BlockPixels];
+	for (int i = 0; i < BlockPixels; i++)
+	{
+		Factors[i] = BC7Weights[Indices[i]] / 64.0f;
+	}
+
+	glm::vec4 Fitted0, Fitted1;
+	if (FitEndpoints<4>(Colors, Factors, BlockPixels, Fitted0, Fitted1))
+	{
+		const BC7Endpoint RefinedStart = QuantiseBC7Endpoint(Fitted0);
+		const BC7Endpoint RefinedEnd = QuantiseBC7Endpoint(Fitted1);
+		int RefinedIndices[BlockPixels];
+		const float RefinedError = ChooseBC7Indices(Colors, RefinedStart, RefinedEnd, RefinedIndices);
+		if (RefinedError < Error)
+		{
+			Start = RefinedStart;
+			End = RefinedEnd;
+			std::memcpy(Indices, RefinedIndices, sizeof(Indices));
+			Error = RefinedError;
+		}
+	}
+
+	// the anchor pixel's index drops its top bit, so it has to be in the lower half of the palette
+	if (Indices[0] & 8)
+	{
+		std::swap(Start, End);
+		for (int i = 0; i < BlockPixels; i++)
+		{
+			Indices[i] = 15 - Indices[i];
+		}
+	}
+
+	BitWriter Writer(OutBlock);
+	Writer.Write(1 << 6, 7); // mode 6
+	for (int Channel = 0; Channel < 4; Channel++)
+	{
+		Writer.Write(uint32_t(Start.Quantised[Channel]), 7);
+		Writer.Write(uint32_t(End.Quantised[Channel]), 7);
+	}
+	Writer.Write(uint32_t(Start.PBit), 1);
+	Writer.Write(uint32_t(End.PBit), 1);
+	Writer.Write(uint32_t(Indices[0]), 3);
+	for (int i = 1; i < BlockPixels; i++)
+	{
+		Writer.Write(uint32_t(Indices[i]), 4);
+	}
+}
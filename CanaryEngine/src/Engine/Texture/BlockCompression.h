@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+// CPU encoders for the block compressed formats the texture cooker writes. Every function takes one 4x4 block of
+// RGBA8 pixels (64 bytes, row major) and writes a single compressed block. They favour predictable quality and
+// speed over exhaustive searches: endpoints come from the principal axis of the block and are refined with one
+// least squares pass.
+namespace BlockCompression
+{
+	// 8 bytes, RGB with two 5:6:5 endpoints. Always uses the four colour mode, alpha is ignored.
+	void EncodeBC1(const uint8_t* Pixels, uint8_t* OutBlock);
+
+	// 16 bytes, BC4 alpha block followed by a BC1 colour block
+	void EncodeBC3(const uint8_t* Pixels, uint8_t* OutBlock);
+
+	// 16 bytes, two BC4 blocks holding the red and green channels (two channel normal maps)
+	void EncodeBC5(const uint8_t* Pixels, uint8_t* OutBlock);
+
+	// 16 bytes, BC7 mode 6 (one RGBA subset, 7 bit endpoints with p-bits and 4 bit indices)
+	void EncodeBC7(const uint8_t* Pixels, uint8_t* OutBlock);
+}
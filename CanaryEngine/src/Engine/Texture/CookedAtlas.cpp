@@ -0,0 +1,150 @@
+#include "CookedAtlas.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#include "Engine/Core/CookedFile.h"
+#include "Engine/Core/Paths.h"
+
+uint64_t CookedAtlas::GetLevelSize(const GroupRecord& Group, uint32_t Level)
+{
+	const uint32_t Width = std::max<uint32_t>(1, Group.Width >> Level);
+	const uint32_t Height = std::max<uint32_t>(1, Group.Height >> Level);
+	return CookedTexture::GetLevelSize(static_cast<ETextureFormat>(Group.Format), Width, Height) * Group.LayerCount;
+}
+
+bool CookedAtlas::Write(const std::string& FilePath, const std::vector<GroupData>& Groups, const std::vector<EntryData>& Entries)
+{
+	std::vector<EntryRecord> EntryTable(Entries.size());
+	std::string Strings;
+	for (size_t i = 0; i < Entries.size(); i++)
+	{
+		EntryTable[i].PathOffset = static_cast<uint32_t>(Strings.size());
+		EntryTable[i].Group = Entries[i].Group;
+		EntryTable[i].Layer = Entries[i].Layer;
+		EntryTable[i].Reserved = 0;
+		std::copy(Entries[i].Rect, Entries[i].Rect + 4, EntryTable[i].Rect);
+
+		Strings += Paths::ToArchivePath(Entries[i].Path);
+		Strings += '\0';
+	}
+
+	FileHeader Header;
+	Header.Magic = Magic;
+	Header.Version = Version;
+	Header.GroupCount = static_cast<uint32_t>(Groups.size());
+	Header.EntryCount = static_cast<uint32_t>(Entries.size());
+	Header.StringsOffset = sizeof(FileHeader) + Groups.size() * sizeof(GroupRecord) + Entries.size() * sizeof(EntryRecord);
+	Header.StringsSize = Strings.size();
+
+	std::vector<GroupRecord> GroupTable(Groups.size());
+	uint64_t Offset = CookedFile::AlignUp(Header.StringsOffset + Header.StringsSize, DataAlignment);
+	for (size_t i = 0; i < Groups.size(); i++)
+	{
+		GroupTable[i] = Groups[i].Record;
+		GroupTable[i].DataOffset = Offset;
+		GroupTable[i].DataSize = Groups[i].Data.size();
+		Offset = CookedFile::AlignUp(Offset + Groups[i].Data.size(), DataAlignment);
+	}
+
+	std::ofstream File(FilePath, std::ios::binary | std::ios::trunc);
+	if (!File)
+	{
+		std::cout << "ERROR::COOKEDATLAS::Could not open " << FilePath << " for writing" << std::endl;
+		return false;
+	}
+
+	static const char Padding[DataAlignment] = {};
+
+	File.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+	File.write(reinterpret_cast<const char*>(GroupTable.data()), GroupTable.size() * sizeof(GroupRecord));
+	File.write(reinterpret_cast<const char*>(EntryTable.data()), EntryTable.size() * sizeof(EntryRecord));
+	File.write(Strings.data(), static_cast<std::streamsize>(Strings.size()));
+
+	uint64_t Written = Header.StringsOffset + Header.StringsSize;
+	for (size_t i = 0; i < Groups.size(); i++)
+	{
+		File.write(Padding, static_cast<std::streamsize>(GroupTable[i].DataOffset - Written));
+		File.write(reinterpret_cast<const char*>(Groups[i].Data.data()), static_cast<std::streamsize>(Groups[i].Data.size()));
+		Written = GroupTable[i].DataOffset + Groups[i].Data.size();
+	}
+
+	return File.good();
+}
+
+bool CookedAtlasFile::Open(const std::string& FilePath)
+{
+	Close();
+
+	if (!File.Open(FilePath))
+	{
+		return false;
+	}
+
+	if (File.GetSize() < sizeof(CookedAtlas::FileHeader))
+	{
+		std::cout << "ERROR::COOKEDATLAS::File is truncated: " << FilePath << std::endl;
+		Close();
+		return false;
+	}
+
+	Header = reinterpret_cast<const CookedAtlas::FileHeader*>(File.GetData());
+	if (Header->Magic != CookedAtlas::Magic || Header->Version != CookedAtlas::Version)
+	{
+		std::cout << "ERROR::COOKEDATLAS::Unsupported file version, re-cook " << FilePath << std::endl;
+		Close();
+		return false;
+	}
+
+	const uint64_t TablesEnd = sizeof(CookedAtlas::FileHeader) + uint64_t(Header->GroupCount) * sizeof(CookedAtlas::GroupRecord)
+		+ uint64_t(Header->EntryCount) * sizeof(CookedAtlas::EntryRecord);
+	if (TablesEnd > Header->StringsOffset || Header->StringsOffset + Header->StringsSize > File.GetSize()
+		|| (Header->StringsSize > 0 && File.GetData()[Header->StringsOffset + Header->StringsSize - 1] != '\0'))
+	{
+		std::cout << "ERROR::COOKEDATLAS::Tables are out of bounds in " << FilePath << std::endl;
+		Close();
+		return false;
+	}
+
+	Groups = reinterpret_cast<const CookedAtlas::GroupRecord*>(File.GetData() + sizeof(CookedAtlas::FileHeader));
+	Entries = reinterpret_cast<const CookedAtlas::EntryRecord*>(Groups + Header->GroupCount);
+	Strings = reinterpret_cast<const char*>(File.GetData() + Header->StringsOffset);
+
+	for (uint32_t i = 0; i < Header->GroupCount; i++)
+	{
+		uint64_t ExpectedSize = 0;
+		for (uint32_t Level = 0; Level < Groups[i].MipCount; Level++)
+		{
+			ExpectedSize += CookedAtlas::GetLevelSize(Groups[i], Level);
+		}
+		if (Groups[i].MipCount == 0 || Groups[i].DataSize != ExpectedSize || Groups[i].DataOffset + Groups[i].DataSize > File.GetSize())
+		{
+			std::cout << "ERROR::COOKEDATLAS::Group " << i << " is out of bounds in " << FilePath << std::endl;
+			Close();
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < Header->EntryCount; i++)
+	{
+		if (Entries[i].Group >= Header->GroupCount || Entries[i].Layer >= Groups[Entries[i].Group].LayerCount
+			|| Entries[i].PathOffset >= Header->StringsSize)
+		{
+			std::cout << "ERROR::COOKEDATLAS::Entry " << i << " is out of bounds in " << FilePath << std::endl;
+			Close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void CookedAtlasFile::Close()
+{
+	File.Close();
+
+	Header = nullptr;
+	Groups = nullptr;
+	Entries = nullptr;
+	Strings = nullptr;
+}
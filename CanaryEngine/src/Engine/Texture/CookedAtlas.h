@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "CookedTexture.h"
+#include "Engine/Core/VirtualFileSystem.h"
+
+// Cooked atlases (.catlas) are written by CanaryCooker (see AtlasPacker.h) and hold small material textures packed
+// into pages. Textures that compress to the same format share a group, every page of a group is one layer of a 2D
+// array texture, so all the textures in a group are sampled through a single binding.
+// Layout: FileHeader, GroupRecord table, EntryRecord table, string chunk, then each group's data starting on a 16
+// byte boundary: mip 0 of every layer, then mip 1 of every layer and so on, matching glCompressedTexImage3D.
+namespace CookedAtlas
+{
+	const uint32_t Magic = 0x4C544143; // "CATL"
+	const uint32_t Version = 1;
+	const uint32_t DataAlignment = 16;
+
+	// Where the cooker writes the atlas and the engine looks for it
+	const char* const DefaultPath = "resources/MaterialAtlas.catlas";
+
+	struct FileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t GroupCount;
+		uint32_t EntryCount;
+		uint64_t StringsOffset;
+		uint64_t StringsSize;
+	};
+
+	struct GroupRecord
+	{
+		uint32_t Format; // ETextureFormat
+		uint32_t Width;  // of a page
+		uint32_t Height;
+		uint32_t LayerCount;
+		uint32_t MipCount;
+		uint32_t Reserved;
+		uint64_t DataOffset;
+		uint64_t DataSize;
+	};
+
+	struct EntryRecord
+	{
+		uint32_t PathOffset; // Paths::ToArchivePath of the source texture, into the string chunk
+		uint32_t Group;
+		uint32_t Layer;
+		uint32_t Reserved;
+		float Rect[4];       // offset and size of the texture inside its page, in texture coordinates
+	};
+
+	// Size of one mip level of a group, every layer included
+	uint64_t GetLevelSize(const GroupRecord& Group, uint32_t Level);
+
+	struct GroupData
+	{
+		GroupRecord Record;
+		std::vector<uint8_t> Data; // every level, laid out as described above
+	};
+
+	struct EntryData
+	{
+		std::string Path;
+		uint32_t Group;
+		uint32_t Layer;
+		float Rect[4];
+	};
+
+	bool Write(const std::string& FilePath, const std::vector<GroupData>& Groups, const std::vector<EntryData>& Entries);
+}
+
+// Read-only view over a .catlas opened through the VirtualFileSystem, pointers are only valid while the file is open
+class CookedAtlasFile
+{
+public:
+	bool Open(const std::string& FilePath);
+	void Close();
+
+	uint32_t GetGroupCount() const { return Header->GroupCount; }
+	const CookedAtlas::GroupRecord& GetGroup(uint32_t Index) const { return Groups[Index]; }
+	const uint8_t* GetGroupData(uint32_t Index) const { return File.GetData() + Groups[Index].DataOffset; }
+
+	uint32_t GetEntryCount() const { return Header->EntryCount; }
+	const CookedAtlas::EntryRecord& GetEntry(uint32_t Index) const { return Entries[Index]; }
+	const char* GetString(uint32_t Offset) const { return Strings + Offset; }
+
+private:
+	VirtualFile File;
+
+	const CookedAtlas::FileHeader* Header = nullptr;
+	const CookedAtlas::GroupRecord* Groups = nullptr;
+	const CookedAtlas::EntryRecord* Entries = nullptr;
+	const char* Strings = nullptr;
+};
@@ -0,0 +1,122 @@
+#include "CookedTexture.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#include "Engine/Core/CookedFile.h"
+
+std::string CookedTexture::GetCookedPath(const std::string& SourcePath)
+{
+	return SourcePath + ".ctex";
+}
+
+uint32_t CookedTexture::GetBlockSize(ETextureFormat Format)
+{
+	return Format == ETextureFormat::BC1 ? 8 : 16;
+}
+
+uint64_t CookedTexture::GetLevelSize(ETextureFormat Format, uint32_t Width, uint32_t Height)
+{
+	const uint64_t BlocksX = std::max<uint32_t>(1, (Width + 3) / 4);
+	const uint64_t BlocksY = std::max<uint32_t>(1, (Height + 3) / 4);
+	return BlocksX * BlocksY * GetBlockSize(Format);
+}
+
+bool CookedTexture::Write(const std::string& FilePath, ETextureFormat Format, uint32_t Width, uint32_t Height, const std::vector<std::vector<uint8_t>>& Mips)
+{
+	FileHeader Header;
+	Header.Magic = Magic;
+	Header.Version = Version;
+	Header.Format = static_cast<uint32_t>(Format);
+	Header.Width = Width;
+	Header.Height = Height;
+	Header.MipCount = static_cast<uint32_t>(Mips.size());
+
+	std::vector<MipRecord> Table(Mips.size());
+	uint64_t Offset = CookedFile::AlignUp(sizeof(FileHeader) + Mips.size() * sizeof(MipRecord), DataAlignment);
+	for (size_t Level = 0; Level < Mips.size(); Level++)
+	{
+		Table[Level].Offset = Offset;
+		Table[Level].Size = Mips[Level].size();
+		Table[Level].Width = std::max<uint32_t>(1, Width >> Level);
+		Table[Level].Height = std::max<uint32_t>(1, Height >> Level);
+		Offset = CookedFile::AlignUp(Offset + Mips[Level].size(), DataAlignment);
+	}
+
+	std::ofstream File(FilePath, std::ios::binary | std::ios::trunc);
+	if (!File)
+	{
+		std::cout << "ERROR::COOKEDTEXTURE::Could not open " << FilePath << " for writing" << std::endl;
+		return false;
+	}
+
+	static const char Padding[DataAlignment] = {};
+
+	File.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+	File.write(reinterpret_cast<const char*>(Table.data()), Table.size() * sizeof(MipRecord));
+
+	uint64_t Written = sizeof(FileHeader) + Table.size() * sizeof(MipRecord);
+	for (size_t Level = 0; Level < Mips.size(); Level++)
+	{
+		File.write(Padding, static_cast<std::streamsize>(Table[Level].Offset - Written));
+		File.write(reinterpret_cast<const char*>(Mips[Level].data()), static_cast<std::streamsize>(Mips[Level].size()));
+		Written = Table[Level].Offset + Mips[Level].size();
+	}
+
+	return File.good();
+}
+
+bool CookedTextureFile::Open(const std::string& FilePath)
+{
+	Close();
+
+	if (!File.Open(FilePath))
+	{
+		return false;
+	}
+
+	if (File.GetSize() < sizeof(CookedTexture::FileHeader))
+	{
+		std::cout << "ERROR::COOKEDTEXTURE::File is truncated: " << FilePath << std::endl;
+		Close();
+		return false;
+	}
+
+	Header = reinterpret_cast<const CookedTexture::FileHeader*>(File.GetData());
+	if (Header->Magic != CookedTexture::Magic || Header->Version != CookedTexture::Version)
+	{
+		std::cout << "ERROR::COOKEDTEXTURE::Unsupported file version, re-cook " << FilePath << std::endl;
+		Close();
+		return false;
+	}
+
+	const uint64_t TableEnd = sizeof(CookedTexture::FileHeader) + uint64_t(Header->MipCount) * sizeof(CookedTexture::MipRecord);
+	if (Header->MipCount == 0 || TableEnd > File.GetSize())
+	{
+		std::cout << "ERROR::COOKEDTEXTURE::Missing mip table in " << FilePath << std::endl;
+		Close();
+		return false;
+	}
+
+	Mips = reinterpret_cast<const CookedTexture::MipRecord*>(File.GetData() + sizeof(CookedTexture::FileHeader));
+	for (uint32_t Level = 0; Level < Header->MipCount; Level++)
+	{
+		if (Mips[Level].Offset + Mips[Level].Size > File.GetSize())
+		{
+			std::cout << "ERROR::COOKEDTEXTURE::Mip " << Level << " is out of bounds in " << FilePath << std::endl;
+			Close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void CookedTextureFile::Close()
+{
+	File.Close();
+
+	Header = nullptr;
+	Mips = nullptr;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Engine/Core/VirtualFileSystem.h"
+
+// Block compressed formats a cooked texture can be stored in
+enum class ETextureFormat : uint32_t
+{
+	BC1 = 1, // RGB, 4 bits per pixel
+	BC3 = 2, // RGBA, 8 bits per pixel
+	BC5 = 3, // RG (normal maps), 8 bits per pixel
+	BC7 = 4  // RGBA high quality, 8 bits per pixel
+};
+
+// Cooked textures (.ctex) are written offline by CanaryCooker and hold every mip level already block compressed, so
+// loading one is a memory mapping and a glCompressedTexImage2D call per level. Layout: FileHeader, MipRecord table,
+// then the mip data with every level starting on a 16 byte boundary.
+namespace CookedTexture
+{
+	const uint32_t Magic = 0x58455443; // "CTEX"
+	const uint32_t Version = 1;
+	const uint32_t DataAlignment = 16;
+
+	struct FileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t Format; // ETextureFormat
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t MipCount;
+	};
+
+	struct MipRecord
+	{
+		uint64_t Offset;
+		uint64_t Size;
+		uint32_t Width;
+		uint32_t Height;
+	};
+
+	std::string GetCookedPath(const std::string& SourcePath);
+
+	uint32_t GetBlockSize(ETextureFormat Format);
+
+	// Size in bytes of one compressed level, partial blocks at the edges are rounded up
+	uint64_t GetLevelSize(ETextureFormat Format, uint32_t Width, uint32_t Height);
+
+	bool Write(const std::string& FilePath, ETextureFormat Format, uint32_t Width, uint32_t Height, const std::vector<std::vector<uint8_t>>& Mips);
+}
+
+// Read-only view over a .ctex opened through the VirtualFileSystem, pointers are only valid while the file is open
+class CookedTextureFile
+{
+public:
+	bool Open(const std::string& FilePath);
+	void Close();
+
+	ETextureFormat GetFormat() const { return static_cast<ETextureFormat>(Header->Format); }
+	uint32_t GetWidth() const { return Header->Width; }
+	uint32_t GetHeight() const { return Header->Height; }
+	uint32_t GetMipCount() const { return Header->MipCount; }
+
+	const CookedTexture::MipRecord& GetMip(uint32_t Level) const { return Mips[Level]; }
+	const uint8_t* GetMipData(uint32_t Level) const { return File.GetData() + Mips[Level].Offset; }
+
+private:
+	VirtualFile File;
+
+	const CookedTexture::FileHeader* Header = nullptr;
+	const CookedTexture::MipRecord* Mips = nullptr;
+};
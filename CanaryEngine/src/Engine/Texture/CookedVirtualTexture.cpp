@@ -0,0 +1,140 @@
+#include "CookedVirtualTexture.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#include "Engine/Core/CookedFile.h"
+
+std::string CookedVirtualTexture::GetCookedPath(const std::string& SourcePath)
+{
+	return SourcePath + ".cvt";
+}
+
+uint32_t CookedVirtualTexture::GetLevelCount(uint32_t Size)
+{
+	uint32_t LevelCount = 1;
+	for (uint32_t Pages = Size / PageSize; Pages > 1; Pages /= 2)
+	{
+		LevelCount++;
+	}
+	return LevelCount;
+}
+
+uint32_t CookedVirtualTexture::GetPagesPerSide(uint32_t Size, uint32_t Level)
+{
+	return std::max<uint32_t>(1, (Size / PageSize) >> Level);
+}
+
+uint32_t CookedVirtualTexture::GetPageIndex(uint32_t Size, uint32_t Level, uint32_t PageX, uint32_t PageY)
+{
+	uint32_t FirstPage = 0;
+	for (uint32_t FinerLevel = 0; FinerLevel < Level; FinerLevel++)
+	{
+		const uint32_t Pages = GetPagesPerSide(Size, FinerLevel);
+		FirstPage += Pages * Pages;
+	}
+	return FirstPage + PageY * GetPagesPerSide(Size, Level) + PageX;
+}
+
+bool CookedVirtualTexture::Write(const std::string& FilePath, ETextureFormat Format, uint32_t Size, const std::vector<std::vector<uint8_t>>& Pages)
+{
+	FileHeader Header;
+	Header.Magic = Magic;
+	Header.Version = Version;
+	Header.Format = static_cast<uint32_t>(Format);
+	Header.Size = Size;
+	Header.LevelCount = GetLevelCount(Size);
+	Header.PageCount = static_cast<uint32_t>(Pages.size());
+
+	std::vector<PageRecord> Table(Pages.size());
+	uint64_t Offset = CookedFile::AlignUp(sizeof(FileHeader) + Pages.size() * sizeof(PageRecord), DataAlignment);
+	for (size_t Page = 0; Page < Pages.size(); Page++)
+	{
+		Table[Page].Offset = Offset;
+		Table[Page].Size = Pages[Page].size();
+		Offset = CookedFile::AlignUp(Offset + Pages[Page].size(), DataAlignment);
+	}
+
+	std::ofstream File(FilePath, std::ios::binary | std::ios::trunc);
+	if (!File)
+	{
+		std::cout << "ERROR::COOKEDVIRTUALTEXTURE::Could not open " << FilePath << " for writing" << std::endl;
+		return false;
+	}
+
+	static const char Padding[DataAlignment] = {};
+
+	File.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+	File.write(reinterpret_cast<const char*>(Table.data()), Table.size() * sizeof(PageRecord));
+
+	uint64_t Written = sizeof(FileHeader) + Table.size() * sizeof(PageRecord);
+	for (size_t Page = 0; Page < Pages.size(); Page++)
+	{
+		File.write(Padding, static_cast<std::streamsize>(Table[Page].Offset - Written));
+		File.write(reinterpret_cast<const char*>(Pages[Page].data()), static_cast<std::streamsize>(Pages[Page].size()));
+		Written = Table[Page].Offset + Pages[Page].size();
+	}
+
+	return File.good();
+}
+
+bool CookedVirtualTextureFile::Open(const std::string& FilePath)
+{
+	Close();
+
+	if (!File.Open(FilePath))
+	{
+		return false;
+	}
+
+	if (File.GetSize() < sizeof(CookedVirtualTexture::FileHeader))
+	{
+		std::cout << "ERROR::COOKEDVIRTUALTEXTURE::File is truncated: " << FilePath << std::endl;
+		Close();
+		return false;
+	}
+
+	Header = reinterpret_cast<const CookedVirtualTexture::FileHeader*>(File.GetData());
+	if (Header->Magic != CookedVirtualTexture::Magic || Header->Version != CookedVirtualTexture::Version)
+	{
+		std::cout << "ERROR::COOKEDVIRTUALTEXTURE::Unsupported file version, re-cook " << FilePath << std::endl;
+		Close();
+		return false;
+	}
+
+	// the page grid is implied by the size, so the table has to match it exactly
+	const uint32_t Size = Header->Size;
+	const bool bValidSize = Size >= CookedVirtualTexture::PageSize && (Size & (Size - 1)) == 0;
+	const uint32_t LevelCount = bValidSize ? CookedVirtualTexture::GetLevelCount(Size) : 0;
+	const uint64_t TableEnd = sizeof(CookedVirtualTexture::FileHeader) + uint64_t(Header->PageCount) * sizeof(CookedVirtualTexture::PageRecord);
+	if (!bValidSize || Header->LevelCount != LevelCount || Header->PageCount != CookedVirtualTexture::GetPageIndex(Size, LevelCount - 1, 0, 0) + 1
+		|| TableEnd > File.GetSize())
+	{
+		std::cout << "ERROR::COOKEDVIRTUALTEXTURE::Page table does not match the texture size in " << FilePath << std::endl;
+		Close();
+		return false;
+	}
+
+	const uint64_t PageBytes = CookedTexture::GetLevelSize(GetFormat(), CookedVirtualTexture::PageTotalSize, CookedVirtualTexture::PageTotalSize);
+	Pages = reinterpret_cast<const CookedVirtualTexture::PageRecord*>(File.GetData() + sizeof(CookedVirtualTexture::FileHeader));
+	for (uint32_t Page = 0; Page < Header->PageCount; Page++)
+	{
+		if (Pages[Page].Size != PageBytes || Pages[Page].Offset + Pages[Page].Size > File.GetSize())
+		{
+			std::cout << "ERROR::COOKEDVIRTUALTEXTURE::Page " << Page << " is out of bounds in " << FilePath << std::endl;
+			Close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void CookedVirtualTextureFile::Close()
+{
+	File.Close();
+
+	Header = nullptr;
+	Pages = nullptr;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "CookedTexture.h"
+#include "Engine/Core/VirtualFileSystem.h"
+
+// Cooked virtual textures (.cvt) are written by CanaryCooker (see VirtualTextureCooker.h) for images too large to
+// keep resident whole. The image is resampled to a power of two square and every mip level down to a single page is
+// cut into pages that VirtualTextureSystem streams into its physical page cache on demand.
+// Each page holds PageSize texels of content surrounded by a BorderSize border taken from its neighbours (wrapping
+// around the edges like GL_REPEAT), so bilinear filtering inside a page never reads the page next to it in the cache.
+// Layout: FileHeader, PageRecord table, then the block compressed pages starting on 16 byte boundaries. Pages are
+// ordered level by level from level 0, each level row by row.
+namespace CookedVirtualTexture
+{
+	const uint32_t Magic = 0x58545643; // "CVTX"
+	const uint32_t Version = 1;
+	const uint32_t DataAlignment = 16;
+
+	const uint32_t PageSize = 128;
+	const uint32_t BorderSize = 4;
+	const uint32_t PageTotalSize = PageSize + 2 * BorderSize; // a whole number of 4x4 blocks
+
+	struct FileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t Format;     // ETextureFormat of every page
+		uint32_t Size;       // texels along each side of level 0, a power of two no smaller than PageSize
+		uint32_t LevelCount; // the last level is a single page
+		uint32_t PageCount;
+	};
+
+	struct PageRecord
+	{
+		uint64_t Offset;
+		uint64_t Size;
+	};
+
+	std::string GetCookedPath(const std::string& SourcePath);
+
+	uint32_t GetLevelCount(uint32_t Size);
+	uint32_t GetPagesPerSide(uint32_t Size, uint32_t Level);
+
+	// Index of a page in the page table
+	uint32_t GetPageIndex(uint32_t Size, uint32_t Level, uint32_t PageX, uint32_t PageY);
+
+	// Pages must be in page table order
+	bool Write(const std::string& FilePath, ETextureFormat Format, uint32_t Size, const std::vector<std::vector<uint8_t>>& Pages);
+}
+
+// Read-only view over a .cvt opened through the VirtualFileSystem, pointers are only valid while the file is open.
+// Page data can be read from any thread.
+class CookedVirtualTextureFile
+{
+public:
+	bool Open(const std::string& FilePath);
+	void Close();
+
+	ETextureFormat GetFormat() const { return static_cast<ETextureFormat>(Header->Format); }
+	uint32_t GetSize() const { return Header->Size; }
+	uint32_t GetLevelCount() const { return Header->LevelCount; }
+	uint32_t GetPageCount() const { return Header->PageCount; }
+
+	const CookedVirtualTexture::PageRecord& GetPage(uint32_t Index) const { return Pages[Index]; }
+	const uint8_t* GetPageData(uint32_t Index) const { return File.GetData() + Pages[Index].Offset; }
+
+private:
+	VirtualFile File;
+
+	const CookedVirtualTexture::FileHeader* Header = nullptr;
+	const CookedVirtualTexture::PageRecord* Pages = nullptr;
+};
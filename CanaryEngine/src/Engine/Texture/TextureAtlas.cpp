@@ -0,0 +1,136 @@
+#include "TextureAtlas.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <iostream>
+
+#include "CookedAtlas.h"
+#include "TextureLoader.h"
+#include "Engine/Core/Paths.h"
+#include "Engine/Renderer/GLStateCache.h"
+#include "Engine/Renderer/RenderStats.h"
+
+const char* const TextureAtlas::DefaultPath = CookedAtlas::DefaultPath;
+
+TextureAtlas& TextureAtlas::Get()
+{
+	static TextureAtlas Atlas;
+	return Atlas;
+}
+
+bool TextureAtlas::Load(const std::string& FilePath)
+{
+	Shutdown();
+
+	if (!VirtualFileSystem::Get().Exists(FilePath))
+	{
+		return false;
+	}
+
+	CookedAtlasFile File;
+	if (!File.Open(FilePath))
+	{
+		return false;
+	}
+
+	// a group the driver cannot sample is left out, its textures fall back to their own .ctex
+	std::vector<unsigned int> GroupTextures(File.GetGroupCount(), 0);
+	for (uint32_t GroupIndex = 0; GroupIndex < File.GetGroupCount(); GroupIndex++)
+	{
+		const CookedAtlas::GroupRecord& Group = File.GetGroup(GroupIndex);
+		const ETextureFormat Format = static_cast<ETextureFormat>(Group.Format);
+		if (!TextureLoader::IsFormatSupported(Format))
+		{
+			std::cout << "ERROR::TEXTUREATLAS::Compressed format not supported by the driver, skipping group " << GroupIndex << std::endl;
+			continue;
+		}
+
+		unsigned int TextureID;
+		glGenTextures(1, &TextureID);
+		GLStateCache::Get().BindTexture(GL_TEXTURE_2D_ARRAY, TextureID);
+
+		const uint8_t* Data = File.GetGroupData(GroupIndex);
+		for (uint32_t Level = 0; Level < Group.MipCount; Level++)
+		{
+			const uint64_t LevelSize = CookedAtlas::GetLevelSize(Group, Level);
+			glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, Level, TextureLoader::GetInternalFormat(Format), std::max<uint32_t>(1, Group.Width >> Level),
+				std::max<uint32_t>(1, Group.Height >> Level), Group.LayerCount, 0, static_cast<GLsizei>(LevelSize), Data);
+			Data += LevelSize;
+			GpuBytes += static_cast<size_t>(LevelSize);
+		}
+
+		// textures wrap inside their rect in the shader, the gutter takes care of filtering across the edge
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, Group.MipCount - 1);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		GroupTextures[GroupIndex] = TextureID;
+		Textures.push_back(TextureID);
+	}
+
+	for (uint32_t i = 0; i < File.GetEntryCount(); i++)
+	{
+		const CookedAtlas::EntryRecord& Record = File.GetEntry(i);
+		if (GroupTextures[Record.Group] == 0)
+		{
+			continue;
+		}
+
+		Entry& NewEntry = Entries[File.GetString(Record.PathOffset)];
+		NewEntry.TextureID = GroupTextures[Record.Group];
+		NewEntry.Layer = static_cast<float>(Record.Layer);
+		NewEntry.Rect = glm::vec4(Record.Rect[0], Record.Rect[1], Record.Rect[2], Record.Rect[3]);
+	}
+
+	std::cout << "Loaded texture atlas " << FilePath << " (" << Entries.size() << " textures in " << Textures.size() << " arrays, "
+		<< GpuBytes / 1024 << " KB)" << std::endl;
+	return true;
+}
+
+const TextureAtlas::Entry* TextureAtlas::Find(const std::string& TexturePath) const
+{
+	if (Entries.empty())
+	{
+		return nullptr;
+	}
+
+	auto Found = Entries.find(Paths::ToArchivePath(TexturePath));
+	return Found != Entries.end() ? &Found->second : nullptr;
+}
+
+unsigned int TextureAtlas::GetTextureUnit(const std::string& TextureType)
+{
+	if (TextureType == "texture_specular")
+	{
+		return FirstTextureUnit + 1;
+	}
+	if (TextureType == "texture_normal")
+	{
+		return FirstTextureUnit + 2;
+	}
+	return FirstTextureUnit;
+}
+
+void TextureAtlas::Bind(unsigned int TextureID, unsigned int Unit)
+{
+	if (GLStateCache::Get().BindTexture(Unit, GL_TEXTURE_2D_ARRAY, TextureID))
+	{
+		RenderStats::Get().TextureBinds++;
+	}
+}
+
+void TextureAtlas::Shutdown()
+{
+	if (!Textures.empty())
+	{
+		GLStateCache::Get().DeleteTextures(Textures.size(), Textures.data());
+	}
+
+	Textures.clear();
+	Entries.clear();
+	GpuBytes = 0;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Runtime side of the material atlas cooked by CanaryCooker (see CookedAtlas.h). Every group of the atlas becomes a
+// 2D array texture, Model looks material textures up here before asking the asset registry, and meshes whose
+// textures are in the atlas sample it through the texture_*_atlas uniforms of ObjectFragmentShader.frag.
+// Array textures live on their own texture units, one per material slot, and GLStateCache skips the bind when the
+// unit already holds the array, so a run of props sharing an atlas binds it once. GL thread only.
+class TextureAtlas
+{
+public:
+	static const char* const DefaultPath;
+
+	// Units 8 and up are reserved for atlas arrays, meshes bind their own textures from unit 0
+	static const unsigned int FirstTextureUnit = 8;
+
+	struct Entry
+	{
+		unsigned int TextureID = 0; // GL_TEXTURE_2D_ARRAY
+		float Layer = 0.0f;
+		glm::vec4 Rect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f); // offset.xy, size.zw in texture coordinates
+	};
+
+	static TextureAtlas& Get();
+
+	// Uploads every group of the atlas, a missing file is not an error (nothing has been packed)
+	bool Load(const std::string& FilePath);
+
+	// Null if the texture was not packed
+	const Entry* Find(const std::string& TexturePath) const;
+
+	// Texture unit atlased textures of the material slot ("texture_diffuse", ...) are bound to
+	static unsigned int GetTextureUnit(const std::string& TextureType);
+
+	// Binds the array to the unit unless it is still bound there from an earlier draw
+	void Bind(unsigned int TextureID, unsigned int Unit);
+
+	size_t GetGpuBytes() const { return GpuBytes; }
+	size_t GetEntryCount() const { return Entries.size(); }
+
+	// Deletes the array textures while the GL context is current
+	void Shutdown();
+
+private:
+	std::vector<unsigned int> Textures;
+	std::unordered_map<std::string, Entry> Entries; // by Paths::ToArchivePath
+	size_t GpuBytes = 0;
+};
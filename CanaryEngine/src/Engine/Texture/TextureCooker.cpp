@@ -0,0 +1,132 @@
+#include "TextureCooker.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include <stb/stb_image.h>
+
+#include "BlockCompression.h"
+#include "Engine/Core/ThreadPool.h"
+
+ETextureFormat TextureCooker::ChooseFormat(const CookOptions& Options, bool bHasAlpha)
+{
+	if (Options.TextureType == "texture_normal")
+	{
+		return ETextureFormat::BC5;
+	}
+	if (Options.bHighQuality)
+	{
+		return ETextureFormat::BC7;
+	}
+	return bHasAlpha ? ETextureFormat::BC3 : ETextureFormat::BC1;
+}
+
+void TextureCooker::DownsampleMip(const std::vector<uint8_t>& Source, uint32_t Width, uint32_t Height, std::vector<uint8_t>& OutMip)
+{
+	const uint32_t MipWidth = std::max<uint32_t>(1, Width / 2);
+	const uint32_t MipHeight = std::max<uint32_t>(1, Height / 2);
+	OutMip.resize(size_t(MipWidth) * MipHeight * 4);
+
+	for (uint32_t Y = 0; Y < MipHeight; Y++)
+	{
+		const uint32_t Y0 = std::min(Y * 2, Height - 1);
+		const uint32_t Y1 = std::min(Y * 2 + 1, Height - 1);
+		for (uint32_t X = 0; X < MipWidth; X++)
+		{
+			const uint32_t X0 = std::min(X * 2, Width - 1);
+			const uint32_t X1 = std::min(X * 2 + 1, Width - 1);
+			for (uint32_t Channel = 0; Channel < 4; Channel++)
+			{
+				const uint32_t Sum = Source[(size_t(Y0) * Width + X0) * 4 + Channel] + Source[(size_t(Y0) * Width + X1) * 4 + Channel]
+					+ Source[(size_t(Y1) * Width + X0) * 4 + Channel] + Source[(size_t(Y1) * Width + X1) * 4 + Channel];
+				OutMip[(size_t(Y) * MipWidth + X) * 4 + Channel] = static_cast<uint8_t>((Sum + 2) / 4);
+			}
+		}
+	}
+}
+
+void TextureCooker::CompressLevel(const std::vector<uint8_t>& Pixels, uint32_t Width, uint32_t Height, ETextureFormat Format, std::vector<uint8_t>& OutBlocks)
+{
+	const uint32_t BlocksX = std::max<uint32_t>(1, (Width + 3) / 4);
+	const uint32_t BlocksY = std::max<uint32_t>(1, (Height + 3) / 4);
+	const uint32_t BlockSize = CookedTexture::GetBlockSize(Format);
+	OutBlocks.resize(size_t(BlocksX) * BlocksY * BlockSize);
+
+	ThreadPool::Get().ParallelFor(BlocksY, [&](size_t BlockY)
+	{
+		uint8_t Block[64];
+		for (uint32_t BlockX = 0; BlockX < BlocksX; BlockX++)
+		{
+			// edge blocks repeat the last row/column so partial blocks compress like their visible part
+			for (uint32_t Row = 0; Row < 4; Row++)
+			{
+				const uint32_t Y = std::min(uint32_t(BlockY) * 4 + Row, Height - 1);
+				for (uint32_t Column = 0; Column < 4; Column++)
+				{
+					const uint32_t X = std::min(BlockX * 4 + Column, Width - 1);
+					const uint8_t* Pixel = &Pixels[(size_t(Y) * Width + X) * 4];
+					std::copy(Pixel, Pixel + 4, &Block[(Row * 4 + Column) * 4]);
+				}
+			}
+
+			uint8_t* Out = &OutBlocks[(BlockY * BlocksX + BlockX) * BlockSize];
+			switch (Format)
+			{
+			case ETextureFormat::BC1: BlockCompression::EncodeBC1(Block, Out); break;
+			case ETextureFormat::BC3: BlockCompression::EncodeBC3(Block, Out); break;
+			case ETextureFormat::BC5: BlockCompression::EncodeBC5(Block, Out); break;
+			case ETextureFormat::BC7: BlockCompression::EncodeBC7(Block, Out); break;
+			}
+		}
+	});
+}
+
+bool TextureCooker::Cook(const std::string& SourcePath, const std::string& CookedPath, const CookOptions& Options)
+{
+	// the engine loads images flipped (see Application::Run), cooked data has to match
+	stbi_set_flip_vertically_on_load(true);
+
+	int Width, Height, Components;
+	unsigned char* Data = stbi_load(SourcePath.c_str(), &Width, &Height, &Components, 4);
+	if (!Data)
+	{
+		std::cout << "ERROR::TEXTURECOOKER::Failed to load " << SourcePath << std::endl;
+		return false;
+	}
+
+	std::vector<uint8_t> Level(Data, Data + size_t(Width) * Height * 4);
+	stbi_image_free(Data);
+
+	bool bHasAlpha = false;
+	if (Components == 2 || Components == 4)
+	{
+		for (size_t i = 3; i < Level.size() && !bHasAlpha; i += 4)
+		{
+			bHasAlpha = Level[i] != 255;
+		}
+	}
+
+	const ETextureFormat Format = ChooseFormat(Options, bHasAlpha);
+
+	std::vector<std::vector<uint8_t>> Mips;
+	uint32_t LevelWidth = static_cast<uint32_t>(Width);
+	uint32_t LevelHeight = static_cast<uint32_t>(Height);
+	std::vector<uint8_t> NextLevel;
+	while (true)
+	{
+		Mips.emplace_back();
+		CompressLevel(Level, LevelWidth, LevelHeight, Format, Mips.back());
+
+		if (LevelWidth == 1 && LevelHeight == 1)
+		{
+			break;
+		}
+
+		DownsampleMip(Level, LevelWidth, LevelHeight, NextLevel);
+		Level.swap(NextLevel);
+		LevelWidth = std::max<uint32_t>(1, LevelWidth / 2);
+		LevelHeight = std::max<uint32_t>(1, LevelHeight / 2);
+	}
+
+	return CookedTexture::Write(CookedPath, Format, static_cast<uint32_t>(Width), static_cast<uint32_t>(Height), Mips);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "CookedTexture.h"
+
+// Offline half of the texture pipeline, used by CanaryCooker: decodes a source image, builds the full mip chain and
+// block compresses every level into a .ctex next to the source.
+namespace TextureCooker
+{
+	struct CookOptions
+	{
+		// Material texture type ("texture_diffuse", "texture_normal", ...) used to pick a format
+		std::string TextureType = "texture_diffuse";
+
+		// Use BC7 instead of BC1/BC3 for colour textures (better quality, slower to cook)
+		bool bHighQuality = false;
+	};
+
+	// BC5 for normal maps, BC3 (or BC7) when the image has alpha, BC1 (or BC7) otherwise
+	ETextureFormat ChooseFormat(const CookOptions& Options, bool bHasAlpha);
+
+	// Box filters an RGBA8 image down by one level
+	void DownsampleMip(const std::vector<uint8_t>& Source, uint32_t Width, uint32_t Height, std::vector<uint8_t>& OutMip);
+
+	// Block compresses one RGBA8 level, rows of blocks are encoded on the thread pool
+	void CompressLevel(const std::vector<uint8_t>& Pixels, uint32_t Width, uint32_t Height, ETextureFormat Format, std::vector<uint8_t>& OutBlocks);
+
+	bool Cook(const std::string& SourcePath, const std::string& CookedPath, const CookOptions& Options);
+}
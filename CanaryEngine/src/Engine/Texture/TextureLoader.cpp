@@ -0,0 +1,87 @@
+#include "TextureLoader.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "Engine/Renderer/GLStateCache.h"
+
+// Extension formats are not part of the 3.3 core headers
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+unsigned int TextureLoader::GetInternalFormat(ETextureFormat Format)
+{
+	switch (Format)
+	{
+	case ETextureFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case ETextureFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case ETextureFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+	case ETextureFormat::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+	}
+	return 0;
+}
+
+bool TextureLoader::IsFormatSupported(ETextureFormat Format)
+{
+	// queried once, the list does not change for the lifetime of the context
+	static std::vector<GLint> SupportedFormats;
+	if (SupportedFormats.empty())
+	{
+		GLint Count = 0;
+		glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &Count);
+		SupportedFormats.resize(Count > 0 ? Count : 1, 0);
+		if (Count > 0)
+		{
+			glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, SupportedFormats.data());
+		}
+	}
+
+	// RGTC is core since 3.0 but drivers are not required to list it
+	const GLint InternalFormat = static_cast<GLint>(GetInternalFormat(Format));
+	return Format == ETextureFormat::BC5
+		|| std::find(SupportedFormats.begin(), SupportedFormats.end(), InternalFormat) != SupportedFormats.end();
+}
+
+bool TextureLoader::UploadCooked(const std::string& CookedPath, unsigned int TextureID)
+{
+	CookedTextureFile File;
+	if (!File.Open(CookedPath))
+	{
+		return false;
+	}
+
+	if (!IsFormatSupported(File.GetFormat()))
+	{
+		std::cout << "ERROR::TEXTURELOADER::Compressed format not supported by the driver: " << CookedPath << std::endl;
+		return false;
+	}
+
+	const GLenum InternalFormat = GetInternalFormat(File.GetFormat());
+
+	GLStateCache::Get().BindTexture(GL_TEXTURE_2D, TextureID);
+	for (uint32_t Level = 0; Level < File.GetMipCount(); Level++)
+	{
+		const CookedTexture::MipRecord& Mip = File.GetMip(Level);
+		glCompressedTexImage2D(GL_TEXTURE_2D, Level, InternalFormat, Mip.Width, Mip.Height, 0, static_cast<GLsizei>(Mip.Size), File.GetMipData(Level));
+	}
+
+	// the chain is complete, so no glGenerateMipmap
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, File.GetMipCount() - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	return true;
+}
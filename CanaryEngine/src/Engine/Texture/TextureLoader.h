@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+
+#include "CookedTexture.h"
+
+// Runtime half of the texture pipeline: uploads cooked textures straight from their memory mapping. Needs a current
+// GL context.
+namespace TextureLoader
+{
+	// GL internal format used for a cooked format
+	unsigned int GetInternalFormat(ETextureFormat Format);
+
+	// True if the driver accepts the format through glCompressedTexImage2D (BC7 needs ARB_texture_compression_bptc
+	// on a 3.3 context, BC1/BC3 need EXT_texture_compression_s3tc)
+	bool IsFormatSupported(ETextureFormat Format);
+
+	// Uploads every mip level of a .ctex into the given texture object. Returns false without touching the texture
+	// if the file cannot be used, so the caller can fall back to the source image.
+	bool UploadCooked(const std::string& CookedPath, unsigned int TextureID);
+}
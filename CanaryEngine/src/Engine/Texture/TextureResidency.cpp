@@ -0,0 +1,181 @@
+#include "TextureResidency.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+#include "TextureStreamer.h"
+#include "Engine/Renderer/RenderStats.h"
+
+namespace
+{
+	// Finest level whose texels are no smaller than a pixel
+	uint32_t GetWantedLevel(const TextureStreamer::TextureInfo& Info, float TexCoordsPerPixel)
+	{
+		const float TexelsPerPixel = float(std::max(Info.Width, Info.Height)) * TexCoordsPerPixel;
+		if (TexelsPerPixel <= 1.0f)
+		{
+			return 0;
+		}
+		return std::min(static_cast<uint32_t>(std::log2(TexelsPerPixel)), Info.LevelCount - 1);
+	}
+
+	uint32_t GetIdleLevel(const TextureStreamer::TextureInfo& Info)
+	{
+		uint32_t Level = 0;
+		while (Level + 1 < Info.LevelCount && (std::max(Info.Width, Info.Height) >> Level) > TextureResidency::IdleSize)
+		{
+			Level++;
+		}
+		return Level;
+	}
+}
+
+TextureResidency& TextureResidency::Get()
+{
+	static TextureResidency Residency;
+	return Residency;
+}
+
+void TextureResidency::MarkUsed(unsigned int TextureID, float TexCoordsPerPixel)
+{
+	Usage& Texture = Textures[TextureID];
+	Texture.LastUsedFrame = Frame;
+
+	TexCoordsPerPixel = std::max(TexCoordsPerPixel, 0.0f);
+	if (Texture.WantedTexCoordsPerPixel < 0.0f || TexCoordsPerPixel < Texture.WantedTexCoordsPerPixel)
+	{
+		Texture.WantedTexCoordsPerPixel = TexCoordsPerPixel;
+	}
+}
+
+void TextureResidency::Update()
+{
+	TextureStreamer& Streamer = TextureStreamer::Get();
+
+	Plans.clear();
+	size_t Bytes = 0;
+	Streamer.ForEachTexture([&](unsigned int TextureID, const TextureStreamer::TextureInfo& Info)
+	{
+		Usage& Texture = Textures[TextureID];
+		if (Texture.Serial != Info.Serial)
+		{
+			// a new texture, or a reused GL name, counts as just drawn so it is not dropped before it gets the chance.
+			// Its draws from last frame may already be in WantedTexCoordsPerPixel.
+			const float Wanted = Texture.WantedTexCoordsPerPixel;
+			Texture = Usage();
+			Texture.Serial = Info.Serial;
+			Texture.LastUsedFrame = Frame;
+			Texture.HeldFrame = Frame;
+			Texture.WantedTexCoordsPerPixel = Wanted;
+		}
+		Texture.SeenFrame = Frame;
+
+		if (Info.LevelCount == 0)
+		{
+			// still decoding, the size of the chain is not known yet
+			Bytes += Info.ResidentBytes;
+			return;
+		}
+
+		if (Texture.WantedTexCoordsPerPixel >= 0.0f)
+		{
+			// finer levels are kept straight away, coarser ones only once the finer one has not been needed for a while
+			const uint32_t Wanted = GetWantedLevel(Info, Texture.WantedTexCoordsPerPixel);
+			if (Wanted <= Texture.HeldLevel || Frame - Texture.HeldFrame > DropDelayFrames)
+			{
+				Texture.HeldLevel = Wanted;
+				Texture.HeldFrame = Frame;
+			}
+			Texture.WantedTexCoordsPerPixel = -1.0f;
+		}
+
+		Plan NewPlan;
+		NewPlan.TextureID = TextureID;
+		NewPlan.Level = std::min(Texture.HeldLevel, Info.LevelCount - 1);
+		if (Frame - Texture.LastUsedFrame > IdleFrames)
+		{
+			NewPlan.Level = std::max(NewPlan.Level, GetIdleLevel(Info));
+		}
+		NewPlan.WantedLevel = NewPlan.Level;
+		NewPlan.CurrentTarget = Info.TargetLevel;
+		NewPlan.LastUsedFrame = Texture.LastUsedFrame;
+		NewPlan.LevelBytes = &Info.LevelBytes;
+		Plans.push_back(NewPlan);
+
+		for (uint32_t Level = NewPlan.Level; Level < Info.LevelCount; Level++)
+		{
+			Bytes += Info.LevelBytes[Level];
+		}
+	});
+
+	// textures the streamer no longer has were released
+	for (auto It = Textures.begin(); It != Textures.end();)
+	{
+		It = It->second.SeenFrame == Frame ? std::next(It) : Textures.erase(It);
+	}
+
+	FitBudget(Plans, Bytes);
+
+	unsigned int Degraded = 0;
+	for (const Plan& TexturePlan : Plans)
+	{
+		if (TexturePlan.Level != TexturePlan.CurrentTarget)
+		{
+			Streamer.SetTargetLevel(TexturePlan.TextureID, TexturePlan.Level);
+		}
+		if (TexturePlan.Level > TexturePlan.WantedLevel)
+		{
+			Degraded++;
+		}
+	}
+
+	RenderStats& Stats = RenderStats::Get();
+	Stats.TextureTargetBytes = Bytes;
+	Stats.TexturesDegraded = Degraded;
+
+	Frame++;
+}
+
+void TextureResidency::FitBudget(std::vector<Plan>& InOutPlans, size_t& InOutBytes) const
+{
+	if (InOutBytes <= Budget)
+	{
+		return;
+	}
+
+	// the top of the queue loses a level next: least recently used first, then whichever frees the most
+	auto IsMoreImportant = [&InOutPlans](size_t A, size_t B)
+	{
+		const Plan& PlanA = InOutPlans[A];
+		const Plan& PlanB = InOutPlans[B];
+		if (PlanA.LastUsedFrame != PlanB.LastUsedFrame)
+		{
+			return PlanA.LastUsedFrame > PlanB.LastUsedFrame;
+		}
+		return (*PlanA.LevelBytes)[PlanA.Level] < (*PlanB.LevelBytes)[PlanB.Level];
+	};
+	std::priority_queue<size_t, std::vector<size_t>, decltype(IsMoreImportant)> Candidates(IsMoreImportant);
+	for (size_t i = 0; i < InOutPlans.size(); i++)
+	{
+		if (InOutPlans[i].Level + 1 < InOutPlans[i].LevelBytes->size())
+		{
+			Candidates.push(i);
+		}
+	}
+
+	// the coarsest level of every texture always stays, past that the budget simply cannot be met
+	while (InOutBytes > Budget && !Candidates.empty())
+	{
+		const size_t Index = Candidates.top();
+		Candidates.pop();
+
+		Plan& TexturePlan = InOutPlans[Index];
+		InOutBytes -= (*TexturePlan.LevelBytes)[TexturePlan.Level];
+		TexturePlan.Level++;
+		if (TexturePlan.Level + 1 < TexturePlan.LevelBytes->size())
+		{
+			Candidates.push(Index);
+		}
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Keeps streamed textures inside a video memory budget. Draw code reports every texture it binds together with how
+// many texture coordinate units one pixel covers, which gives the finest mip level the texture needs on screen.
+// Once per frame Update() picks a target level for each texture: the finest level it needed recently, or a small one
+// for textures that have not been drawn for a while. When the targets do not fit the budget, levels are dropped from
+// the least recently used textures first, then from the largest, so memory pressure costs sharpness on things that
+// are not being looked at rather than failing allocations. TextureStreamer frees or streams back the levels.
+// GL thread only.
+class TextureResidency
+{
+public:
+	static const size_t DefaultBudget = 256 * 1024 * 1024;
+
+	// A level no longer needed is only dropped after this many frames, so textures near a mip boundary do not
+	// stream in and out as the camera moves
+	static const uint32_t DropDelayFrames = 120;
+
+	// Textures that have not been drawn for this many frames keep at most IdleSize texels along their longer side
+	static const uint32_t IdleFrames = 600;
+	static const uint32_t IdleSize = 64;
+
+	static TextureResidency& Get();
+
+	// Records that the texture is drawn this frame. TexCoordsPerPixel is the change in texture coordinates across one
+	// pixel, 0 asks for full resolution.
+	void MarkUsed(unsigned int TextureID, float TexCoordsPerPixel);
+
+	// Retargets every texture, call once per frame before TextureStreamer::Update
+	void Update();
+
+	void SetBudget(size_t InBytes) { Budget = InBytes; }
+	size_t GetBudget() const { return Budget; }
+
+private:
+	struct Usage
+	{
+		uint32_t Serial = 0;            // TextureStreamer::TextureInfo::Serial the usage belongs to
+		uint64_t LastUsedFrame = 0;
+		uint64_t SeenFrame = 0;
+		float WantedTexCoordsPerPixel = -1.0f; // smallest reported since the last Update, negative if none
+		uint32_t HeldLevel = 0;                // finest level asked for recently
+		uint64_t HeldFrame = 0;
+	};
+
+	struct Plan
+	{
+		unsigned int TextureID = 0;
+		uint32_t Level = 0;
+		uint32_t WantedLevel = 0;
+		uint32_t CurrentTarget = 0;
+		uint64_t LastUsedFrame = 0;
+		const std::vector<size_t>* LevelBytes = nullptr;
+	};
+
+	// Coarsens the least important targets until their total fits the budget
+	void FitBudget(std::vector<Plan>& InOutPlans, size_t& InOutBytes) const;
+
+	std::unordered_map<unsigned int, Usage> Textures;
+	std::vector<Plan> Plans;
+	uint64_t Frame = 1;
+	size_t Budget = DefaultBudget;
+};
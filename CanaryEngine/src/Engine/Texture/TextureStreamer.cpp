@@ -0,0 +1,536 @@
+#include "TextureStreamer.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include <stb/stb_image.h>
+
+#include "TextureCooker.h"
+#include "TextureLoader.h"
+#include "Engine/Core/CookedFile.h"
+#include "Engine/Core/ThreadPool.h"
+#include "Engine/Core/VirtualFileSystem.h"
+#include "Engine/Renderer/GLStateCache.h"
+#include "Engine/Renderer/RenderStats.h"
+
+namespace
+{
+	// Bytes per row and number of rows of a level, block rows for compressed formats
+	void GetRowLayout(bool bCompressed, ETextureFormat Format, uint32_t Width, uint32_t Height, size_t& OutRowBytes, uint32_t& OutRowCount)
+	{
+		if (bCompressed)
+		{
+			OutRowBytes = size_t(std::max<uint32_t>(1, (Width + 3) / 4)) * CookedTexture::GetBlockSize(Format);
+			OutRowCount = std::max<uint32_t>(1, (Height + 3) / 4);
+		}
+		else
+		{
+			OutRowBytes = size_t(Width) * 4;
+			OutRowCount = Height;
+		}
+	}
+}
+
+// passed to std::min by reference, so it needs storage
+const size_t TextureStreamer::RingSlotSize;
+
+TextureStreamer& TextureStreamer::Get()
+{
+	static TextureStreamer Streamer;
+	return Streamer;
+}
+
+unsigned int TextureStreamer::Request(const std::string& FilePath, const std::string& TextureType, bool bGamma)
+{
+	// flat normal so lighting stays sensible until the real map arrives
+	const uint8_t Placeholder[4] = { 255, 255, 255, 255 };
+	const uint8_t FlatNormal[4] = { 128, 128, 255, 255 };
+
+	unsigned int TextureID;
+	glGenTextures(1, &TextureID);
+	GLStateCache::Get().BindTexture(GL_TEXTURE_2D, TextureID);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, TextureType == "texture_normal" ? FlatNormal : Placeholder);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	StreamedTexture& Texture = Textures[TextureID];
+	Texture = StreamedTexture();
+	Texture.FilePath = FilePath;
+	Texture.bGamma = bGamma;
+	Texture.Info.Serial = NextSerial++;
+	QueueDecode(TextureID, Texture);
+
+	return TextureID;
+}
+
+void TextureStreamer::QueueDecode(unsigned int TextureID, const StreamedTexture& Texture)
+{
+	std::shared_ptr<StreamRequest> Request = std::make_shared<StreamRequest>();
+	Request->TextureID = TextureID;
+	Request->FilePath = Texture.FilePath;
+	Request->bGamma = Texture.bGamma;
+	Request->bAllowCooked = Texture.bAllowCooked;
+	Pending[TextureID] = Request;
+
+	std::shared_ptr<DecodedQueue> Queue = Decoded;
+	ThreadPool::Get().Submit([Queue, Request]()
+	{
+		Decode(*Request);
+
+		std::lock_guard<std::mutex> Lock(Queue->Mutex);
+		Queue->Requests.push_back(Request);
+	});
+}
+
+void TextureStreamer::Decode(StreamRequest& Request)
+{
+	// cooked textures only need mapping, the GL thread checks the driver supports the format
+	const std::string CookedPath = CookedTexture::GetCookedPath(Request.FilePath);
+	if (Request.bAllowCooked && CookedFile::IsUpToDate(CookedPath, Request.FilePath))
+	{
+		std::unique_ptr<CookedTextureFile> Cooked(new CookedTextureFile());
+		if (Cooked->Open(CookedPath))
+		{
+			Request.bCompressed = true;
+			Request.Format = Cooked->GetFormat();
+			for (uint32_t Level = 0; Level < Cooked->GetMipCount(); Level++)
+			{
+				const CookedTexture::MipRecord& Mip = Cooked->GetMip(Level);
+				Request.Levels.push_back({ Mip.Width, Mip.Height, Cooked->GetMipData(Level), static_cast<size_t>(Mip.Size) });
+			}
+			Request.Cooked = std::move(Cooked);
+			return;
+		}
+	}
+
+	VirtualFile Source;
+	if (!Source.Open(Request.FilePath))
+	{
+		Request.bFailed = true;
+		return;
+	}
+
+	int Width, Height, Components;
+	unsigned char* Data = stbi_load_from_memory(Source.GetData(), static_cast<int>(Source.GetSize()), &Width, &Height, &Components, 4);
+	Source.Close();
+	if (!Data)
+	{
+		Request.bFailed = true;
+		return;
+	}
+
+	// the mip chain is built here rather than with glGenerateMipmap so the GL thread only copies
+	Request.Pixels.emplace_back(Data, Data + size_t(Width) * Height * 4);
+	stbi_image_free(Data);
+
+	uint32_t LevelWidth = static_cast<uint32_t>(Width);
+	uint32_t LevelHeight = static_cast<uint32_t>(Height);
+	while (LevelWidth > 1 || LevelHeight > 1)
+	{
+		std::vector<uint8_t> NextLevel;
+		TextureCooker::DownsampleMip(Request.Pixels.back(), LevelWidth, LevelHeight, NextLevel);
+		Request.Pixels.push_back(std::move(NextLevel));
+		LevelWidth = std::max<uint32_t>(1, LevelWidth / 2);
+		LevelHeight = std::max<uint32_t>(1, LevelHeight / 2);
+	}
+
+	for (size_t Level = 0; Level < Request.Pixels.size(); Level++)
+	{
+		const uint32_t MipWidth = std::max<uint32_t>(1, uint32_t(Width) >> Level);
+		const uint32_t MipHeight = std::max<uint32_t>(1, uint32_t(Height) >> Level);
+		Request.Levels.push_back({ MipWidth, MipHeight, Request.Pixels[Level].data(), Request.Pixels[Level].size() });
+	}
+}
+
+void TextureStreamer::Update()
+{
+	{
+		std::lock_guard<std::mutex> Lock(Decoded->Mutex);
+		while (!Decoded->Requests.empty())
+		{
+			std::shared_ptr<StreamRequest> Request = Decoded->Requests.front();
+			Decoded->Requests.pop_front();
+
+			if (Request->bCancelled)
+			{
+				continue;
+			}
+
+			StreamedTexture& Texture = Textures[Request->TextureID];
+			if (Request->bFailed)
+			{
+				std::cout << "Texture failed to load at path: " << Request->FilePath << std::endl;
+				Pending.erase(Request->TextureID);
+			}
+			else if (Request->bCompressed && !TextureLoader::IsFormatSupported(Request->Format))
+			{
+				std::cout << "ERROR::TEXTURESTREAMER::Compressed format not supported by the driver, decoding " << Request->FilePath << " instead" << std::endl;
+				Texture.bAllowCooked = false;
+				QueueDecode(Request->TextureID, Texture);
+			}
+			else
+			{
+				if (Texture.Info.LevelCount == 0)
+				{
+					InitialiseLevels(*Request, Texture);
+				}
+
+				// the source may have been cooked again since the resident levels were streamed, they would not match
+				const bool bSameChain = Request->bCompressed == Texture.bCompressed && Request->Format == Texture.Format
+					&& Request->Levels.size() == Texture.Info.LevelCount && Request->Levels[0].Width == Texture.Info.Width
+					&& Request->Levels[0].Height == Texture.Info.Height;
+				if (!bSameChain)
+				{
+					std::cout << "ERROR::TEXTURESTREAMER::" << Request->FilePath << " changed since it was loaded, keeping the resident levels" << std::endl;
+				}
+
+				if (!bSameChain || Texture.Info.ResidentLevel <= Texture.Info.TargetLevel)
+				{
+					// the target was lowered again before the levels could be streamed
+					Pending.erase(Request->TextureID);
+				}
+				else
+				{
+					Request->NextLevel = Texture.Info.ResidentLevel - 1;
+					Request->NextRow = 0;
+					Uploads.push_back(Request);
+				}
+			}
+		}
+	}
+
+	size_t BytesUsed = 0;
+	if (!Uploads.empty())
+	{
+		if (Ring.empty())
+		{
+			CreateRing();
+		}
+
+		while (!Uploads.empty())
+		{
+			StreamRequest& Request = *Uploads.front();
+			if (!Request.bCancelled)
+			{
+				if (!UploadRows(Request, BytesUsed))
+				{
+					break;
+				}
+				Pending.erase(Request.TextureID);
+			}
+			Uploads.pop_front();
+		}
+
+		GLStateCache::Get().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	RenderStats::Get().TextureBytesUploaded = static_cast<unsigned int>(BytesUsed);
+	RenderStats::Get().TexturesStreaming = GetPendingCount();
+}
+
+void TextureStreamer::Shutdown()
+{
+	for (RingSlot& Slot : Ring)
+	{
+		if (Slot.Fence)
+		{
+			glDeleteSync(static_cast<GLsync>(Slot.Fence));
+		}
+		GLStateCache::Get().DeleteBuffers(1, &Slot.Buffer);
+	}
+	Ring.clear();
+	Uploads.clear();
+	Pending.clear();
+	Textures.clear();
+
+	// jobs still running push into the old queue, which they keep alive themselves
+	Decoded = std::make_shared<DecodedQueue>();
+}
+
+void TextureStreamer::Release(unsigned int TextureID)
+{
+	auto Found = Pending.find(TextureID);
+	if (Found != Pending.end())
+	{
+		// the GL name may be reused straight away, so the old request must never touch it again
+		Found->second->bCancelled = true;
+		Pending.erase(Found);
+	}
+
+	Textures.erase(TextureID);
+	GLStateCache::Get().DeleteTextures(1, &TextureID);
+}
+
+size_t TextureStreamer::GetResidentBytes(unsigned int TextureID) const
+{
+	auto Found = Textures.find(TextureID);
+	return Found != Textures.end() ? Found->second.Info.ResidentBytes : 0;
+}
+
+const TextureStreamer::TextureInfo* TextureStreamer::GetTextureInfo(unsigned int TextureID) const
+{
+	auto Found = Textures.find(TextureID);
+	return Found != Textures.end() ? &Found->second.Info : nullptr;
+}
+
+void TextureStreamer::ForEachTexture(const std::function<void(unsigned int TextureID, const TextureInfo& Info)>& Visit) const
+{
+	for (const auto& Texture : Textures)
+	{
+		Visit(Texture.first, Texture.second.Info);
+	}
+}
+
+void TextureStreamer::SetTargetLevel(unsigned int TextureID, uint32_t Level)
+{
+	auto Found = Textures.find(TextureID);
+	if (Found == Textures.end())
+	{
+		return;
+	}
+
+	StreamedTexture& Texture = Found->second;
+	TextureInfo& Info = Texture.Info;
+	if (Info.LevelCount > 0)
+	{
+		Level = std::min(Level, Info.LevelCount - 1);
+	}
+	Info.TargetLevel = Level;
+
+	if (Info.LevelCount == 0 || Info.ResidentLevel == Info.LevelCount)
+	{
+		// still on the placeholder, the request in flight reads the target as it uploads
+		return;
+	}
+
+	if (Level < Info.ResidentLevel)
+	{
+		// a request already in flight carries on to the new target, otherwise the image is needed again
+		if (!Pending.count(TextureID))
+		{
+			QueueDecode(TextureID, Texture);
+		}
+		return;
+	}
+
+	// everything from Level down is resident, the levels above it can go straight away. A level that was being
+	// uploaded goes with them, its request notices the new target before uploading anything else.
+	if (Texture.DefinedLevel < Level)
+	{
+		GLStateCache::Get().BindTexture(GL_TEXTURE_2D, TextureID);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, Level);
+		for (uint32_t FreedLevel = Texture.DefinedLevel; FreedLevel < Level; FreedLevel++)
+		{
+			FreeLevel(FreedLevel);
+		}
+		Texture.DefinedLevel = Level;
+		Info.ResidentLevel = Level;
+		UpdateResidentBytes(Texture);
+	}
+}
+
+unsigned int TextureStreamer::GetPendingCount() const
+{
+	return static_cast<unsigned int>(Pending.size());
+}
+
+void TextureStreamer::CreateRing()
+{
+	Ring.resize(RingSlotCount);
+	for (RingSlot& Slot : Ring)
+	{
+		glGenBuffers(1, &Slot.Buffer);
+		GLStateCache::Get().BindBuffer(GL_PIXEL_UNPACK_BUFFER, Slot.Buffer);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, RingSlotSize, nullptr, GL_STREAM_DRAW);
+	}
+	GLStateCache::Get().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+bool TextureStreamer::IsSlotFree(RingSlot& Slot)
+{
+	if (Slot.Fence)
+	{
+		if (glClientWaitSync(static_cast<GLsync>(Slot.Fence), 0, 0) == GL_TIMEOUT_EXPIRED)
+		{
+			return false;
+		}
+		glDeleteSync(static_cast<GLsync>(Slot.Fence));
+		Slot.Fence = nullptr;
+	}
+	return true;
+}
+
+void TextureStreamer::InitialiseLevels(const StreamRequest& Request, StreamedTexture& Texture)
+{
+	Texture.bCompressed = Request.bCompressed;
+	Texture.Format = Request.Format;
+
+	TextureInfo& Info = Texture.Info;
+	Info.Width = Request.Levels[0].Width;
+	Info.Height = Request.Levels[0].Height;
+	Info.LevelCount = static_cast<uint32_t>(Request.Levels.size());
+	Info.ResidentLevel = Info.LevelCount;
+	Info.TargetLevel = std::min(Info.TargetLevel, Info.LevelCount - 1);
+	Info.LevelBytes.clear();
+	for (const StreamLevel& Mip : Request.Levels)
+	{
+		Info.LevelBytes.push_back(Request.bCompressed ? Mip.Size : size_t(Mip.Width) * Mip.Height * 4);
+	}
+
+	// level 0 still holds the placeholder until a real level replaces it
+	Texture.DefinedLevel = Info.LevelCount;
+}
+
+void TextureStreamer::DefineLevel(const StreamRequest& Request, StreamedTexture& Texture, uint32_t Level)
+{
+	const StreamLevel& Mip = Request.Levels[Level];
+	if (Request.bCompressed)
+	{
+		glCompressedTexImage2D(GL_TEXTURE_2D, GLint(Level), TextureLoader::GetInternalFormat(Request.Format), Mip.Width, Mip.Height, 0,
+			static_cast<GLsizei>(Mip.Size), nullptr);
+	}
+	else
+	{
+		glTexImage2D(GL_TEXTURE_2D, GLint(Level), Request.bGamma ? GL_SRGB8_ALPHA8 : GL_RGBA8, Mip.Width, Mip.Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	}
+
+	Texture.DefinedLevel = Level;
+	UpdateResidentBytes(Texture);
+}
+
+void TextureStreamer::FreeLevel(uint32_t Level)
+{
+	// levels outside BASE_LEVEL..MAX_LEVEL do not count towards completeness, so an empty image is allowed there
+	glTexImage2D(GL_TEXTURE_2D, GLint(Level), GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+}
+
+void TextureStreamer::UpdateResidentBytes(StreamedTexture& Texture)
+{
+	TextureInfo& Info = Texture.Info;
+	if (Texture.DefinedLevel >= Info.LevelCount)
+	{
+		Info.ResidentBytes = 4;
+		return;
+	}
+
+	Info.ResidentBytes = 0;
+	for (uint32_t Level = Texture.DefinedLevel; Level < Info.LevelCount; Level++)
+	{
+		Info.ResidentBytes += Info.LevelBytes[Level];
+	}
+}
+
+bool TextureStreamer::UploadRows(StreamRequest& Request, size_t& InOutBytesUsed)
+{
+	StreamedTexture& Texture = Textures[Request.TextureID];
+	TextureInfo& Info = Texture.Info;
+
+	GLStateCache::Get().BindTexture(GL_TEXTURE_2D, Request.TextureID);
+
+	for (;;)
+	{
+		// the residency manager may have lowered the target since the request was queued
+		if (Request.NextLevel < Info.TargetLevel)
+		{
+			Request.Pixels.clear();
+			Request.Levels.clear();
+			Request.Cooked.reset();
+			return true;
+		}
+
+		const StreamLevel& Mip = Request.Levels[Request.NextLevel];
+
+		size_t RowBytes;
+		uint32_t RowCount;
+		GetRowLayout(Request.bCompressed, Request.Format, Mip.Width, Mip.Height, RowBytes, RowCount);
+		if (RowBytes > RingSlotSize)
+		{
+			std::cout << "ERROR::TEXTURESTREAMER::Texture rows are larger than a pixel buffer: " << Request.FilePath << std::endl;
+			return true;
+		}
+
+		// at least one row per frame so a texture wider than the budget still makes progress
+		const size_t BudgetLeft = InOutBytesUsed < UploadBudget ? UploadBudget - InOutBytesUsed : 0;
+		uint32_t Rows = std::min<uint32_t>(RowCount - Request.NextRow, uint32_t(std::min(BudgetLeft, RingSlotSize) / RowBytes));
+		if (Rows == 0)
+		{
+			if (InOutBytesUsed > 0)
+			{
+				return false;
+			}
+			Rows = 1;
+		}
+
+		// never wait on the GPU, a busy slot just ends the frame's uploads
+		RingSlot& Slot = Ring[NextSlot];
+		if (!IsSlotFree(Slot))
+		{
+			return false;
+		}
+
+		// storage arrives one level at a time, the level below BASE_LEVEL is not sampled while it fills
+		if (Texture.DefinedLevel > Request.NextLevel)
+		{
+			GLStateCache::Get().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			DefineLevel(Request, Texture, Request.NextLevel);
+		}
+
+		const size_t Bytes = size_t(Rows) * RowBytes;
+		GLStateCache::Get().BindBuffer(GL_PIXEL_UNPACK_BUFFER, Slot.Buffer);
+		void* Mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, Bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		if (!Mapped)
+		{
+			return false;
+		}
+		std::memcpy(Mapped, Mip.Data + size_t(Request.NextRow) * RowBytes, Bytes);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+		if (Request.bCompressed)
+		{
+			const GLint Y = GLint(Request.NextRow) * 4;
+			const GLsizei Height = std::min<GLsizei>(GLsizei(Rows) * 4, GLsizei(Mip.Height) - Y);
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, Request.NextLevel, 0, Y, Mip.Width, Height,
+				TextureLoader::GetInternalFormat(Request.Format), static_cast<GLsizei>(Bytes), nullptr);
+		}
+		else
+		{
+			glTexSubImage2D(GL_TEXTURE_2D, Request.NextLevel, 0, Request.NextRow, Mip.Width, Rows, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		}
+
+		Slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		NextSlot = (NextSlot + 1) % RingSlotCount;
+		InOutBytesUsed += Bytes;
+
+		Request.NextRow += Rows;
+		if (Request.NextRow < RowCount)
+		{
+			continue;
+		}
+
+		// level finished, let sampling use it. The first real level replaces the placeholder.
+		if (Info.ResidentLevel == Info.LevelCount)
+		{
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, Info.LevelCount - 1);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, Request.NextLevel);
+		Info.ResidentLevel = Request.NextLevel;
+
+		if (Request.NextLevel == 0)
+		{
+			Request.Pixels.clear();
+			Request.Levels.clear();
+			Request.Cooked.reset();
+			return true;
+		}
+
+		Request.NextLevel--;
+		Request.NextRow = 0;
+	}
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "CookedTexture.h"
+
+// Loads textures without blocking the render thread. Request() hands back a texture that already holds a 1x1
+// placeholder, the image is decoded (or its .ctex mapped) on the thread pool and Update() then copies it to the GPU
+// through a ring of pixel buffer objects, spending at most the upload budget per frame. Levels are uploaded from the
+// smallest up and GL_TEXTURE_BASE_LEVEL follows them, so a texture sharpens progressively instead of popping in.
+// Each texture streams down to a target level set by TextureResidency. Levels are defined one at a time, so the ones
+// above the target take no memory, and raising the target frees the top levels again without touching the rest of
+// the chain. Levels keep their indices, GL only looks at BASE_LEVEL and below.
+// Everything except the decode runs on the GL thread.
+class TextureStreamer
+{
+public:
+	static const size_t DefaultUploadBudget = 4 * 1024 * 1024;
+	static const size_t RingSlotSize = 2 * 1024 * 1024;
+	static const unsigned int RingSlotCount = 4;
+
+	// Mip chain of a texture as far as TextureResidency needs to know it
+	struct TextureInfo
+	{
+		uint32_t Serial = 0;        // differs whenever a GL name is reused for another texture
+		uint32_t Width = 0;         // of level 0, 0 until the image has been decoded
+		uint32_t Height = 0;
+		uint32_t LevelCount = 0;
+		uint32_t ResidentLevel = 0; // finest level that can be sampled, LevelCount while only the placeholder can
+		uint32_t TargetLevel = 0;   // finest level to stream
+		std::vector<size_t> LevelBytes;
+		size_t ResidentBytes = 4;   // every defined level, the placeholder counts as 4 bytes
+	};
+
+	TextureStreamer() = default;
+	~TextureStreamer() = default;
+
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	static TextureStreamer& Get();
+
+	// Creates the texture with a placeholder matching the material slot (flat normal for "texture_normal", white
+	// otherwise) and queues the file for decoding. The returned ID stays valid once the real image arrives.
+	unsigned int Request(const std::string& FilePath, const std::string& TextureType, bool bGamma = false);
+
+	// Deletes the texture, a request still decoding or uploading into it is dropped
+	void Release(unsigned int TextureID);
+
+	// Video memory allocated for the texture's mip chain (the placeholder counts as 4 bytes)
+	size_t GetResidentBytes(unsigned int TextureID) const;
+
+	// Null for a texture the streamer does not own
+	const TextureInfo* GetTextureInfo(unsigned int TextureID) const;
+	void ForEachTexture(const std::function<void(unsigned int TextureID, const TextureInfo& Info)>& Visit) const;
+
+	// Finest level the texture should have. A coarser target frees the levels above it straight away, a finer one
+	// decodes the image again and streams in the missing levels. Clamped to the chain once its size is known.
+	void SetTargetLevel(unsigned int TextureID, uint32_t Level);
+
+	// Uploads decoded textures, call once per frame on the GL thread
+	void Update();
+
+	// Frees the pixel buffers, in-flight requests are dropped. Needs the GL context to still be current.
+	void Shutdown();
+
+	void SetUploadBudget(size_t InBytesPerFrame) { UploadBudget = InBytesPerFrame; }
+	size_t GetUploadBudget() const { return UploadBudget; }
+
+	// Requests that are still being decoded or uploaded
+	unsigned int GetPendingCount() const;
+
+private:
+	struct StreamLevel
+	{
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		const uint8_t* Data = nullptr;
+		size_t Size = 0;
+	};
+
+	struct StreamRequest
+	{
+		unsigned int TextureID = 0;
+		std::string FilePath;
+		bool bGamma = false;
+		bool bCancelled = false; // released or no longer needed before it finished, only touched on the GL thread
+
+		// filled in by the decode job
+		bool bAllowCooked = true;
+		bool bFailed = false;
+		bool bCompressed = false;
+		ETextureFormat Format = ETextureFormat::BC1;
+		std::unique_ptr<CookedTextureFile> Cooked;
+		std::vector<std::vector<uint8_t>> Pixels; // RGBA8 mip chain when decoded from the source image
+		std::vector<StreamLevel> Levels;
+
+		// upload progress, levels go from the coarsest missing one down to the texture's target
+		uint32_t NextLevel = 0;
+		uint32_t NextRow = 0; // pixel rows, or block rows for compressed levels
+	};
+
+	struct StreamedTexture
+	{
+		std::string FilePath;
+		bool bGamma = false;
+		bool bAllowCooked = true;
+		bool bCompressed = false;
+		ETextureFormat Format = ETextureFormat::BC1;
+		uint32_t DefinedLevel = 0; // finest level with storage, one above ResidentLevel while a level is uploading
+		TextureInfo Info;
+	};
+
+	// Finished decodes, shared with the jobs so they never outlive it
+	struct DecodedQueue
+	{
+		std::mutex Mutex;
+		std::deque<std::shared_ptr<StreamRequest>> Requests;
+	};
+
+	struct RingSlot
+	{
+		unsigned int Buffer = 0;
+		void* Fence = nullptr; // GLsync of the last copy out of this slot
+	};
+
+	static void Decode(StreamRequest& Request);
+	void QueueDecode(unsigned int TextureID, const StreamedTexture& Texture);
+
+	// Takes the mip chain's layout from the first decode of the texture
+	void InitialiseLevels(const StreamRequest& Request, StreamedTexture& Texture);
+
+	// Gives the level storage, or takes it away with a 0x0 image
+	void DefineLevel(const StreamRequest& Request, StreamedTexture& Texture, uint32_t Level);
+	static void FreeLevel(uint32_t Level);
+	static void UpdateResidentBytes(StreamedTexture& Texture);
+
+	// Uploads rows of the request until it completes, the budget runs out or no ring slot is free. Returns false
+	// when nothing more can be uploaded this frame.
+	bool UploadRows(StreamRequest& Request, size_t& InOutBytesUsed);
+
+	void CreateRing();
+
+	// Polls the slot's fence without blocking
+	static bool IsSlotFree(RingSlot& Slot);
+
+	std::shared_ptr<DecodedQueue> Decoded = std::make_shared<DecodedQueue>();
+	std::deque<std::shared_ptr<StreamRequest>> Uploads;
+
+	// Unfinished request of every texture, so Release can cancel it
+	std::unordered_map<unsigned int, std::shared_ptr<StreamRequest>> Pending;
+	std::unordered_map<unsigned int, StreamedTexture> Textures;
+	uint32_t NextSerial = 1;
+
+	std::vector<RingSlot> Ring;
+	unsigned int NextSlot = 0;
+
+	size_t UploadBudget = DefaultUploadBudget;
+};
@@ -0,0 +1,142 @@
+#include "VirtualTextureCooker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <stb/stb_image.h>
+
+#include "CookedVirtualTexture.h"
+#include "TextureCooker.h"
+#include "Engine/Core/ThreadPool.h"
+
+namespace
+{
+	uint32_t RoundUpToPowerOfTwo(uint32_t Value)
+	{
+		uint32_t Result = 1;
+		while (Result < Value)
+		{
+			Result *= 2;
+		}
+		return Result;
+	}
+
+	// Bilinear resample to a Size x Size square. Texels wrap around the edges so tiling materials stay seamless.
+	void ResampleSquare(const uint8_t* Source, uint32_t Width, uint32_t Height, uint32_t Size, std::vector<uint8_t>& OutPixels)
+	{
+		OutPixels.resize(size_t(Size) * Size * 4);
+
+		const float ScaleX = float(Width) / float(Size);
+		const float ScaleY = float(Height) / float(Size);
+		ThreadPool::Get().ParallelFor(Size, [&](size_t Y)
+		{
+			const float SourceY = (float(Y) + 0.5f) * ScaleY - 0.5f;
+			const float FloorY = std::floor(SourceY);
+			const float FracY = SourceY - FloorY;
+			const uint32_t Y0 = static_cast<uint32_t>(int64_t(FloorY) + Height) % Height;
+			const uint32_t Y1 = (Y0 + 1) % Height;
+
+			for (uint32_t X = 0; X < Size; X++)
+			{
+				const float SourceX = (float(X) + 0.5f) * ScaleX - 0.5f;
+				const float FloorX = std::floor(SourceX);
+				const float FracX = SourceX - FloorX;
+				const uint32_t X0 = static_cast<uint32_t>(int64_t(FloorX) + Width) % Width;
+				const uint32_t X1 = (X0 + 1) % Width;
+
+				for (uint32_t Channel = 0; Channel < 4; Channel++)
+				{
+					const float Top = Source[(size_t(Y0) * Width + X0) * 4 + Channel] * (1.0f - FracX) + Source[(size_t(Y0) * Width + X1) * 4 + Channel] * FracX;
+					const float Bottom = Source[(size_t(Y1) * Width + X0) * 4 + Channel] * (1.0f - FracX) + Source[(size_t(Y1) * Width + X1) * 4 + Channel] * FracX;
+					OutPixels[(Y * Size + X) * 4 + Channel] = static_cast<uint8_t>(Top * (1.0f - FracY) + Bottom * FracY + 0.5f);
+				}
+			}
+		});
+	}
+
+	// Copies one page plus its border out of a square level, wrapping at the edges
+	void ExtractPage(const std::vector<uint8_t>& Level, uint32_t LevelSize, uint32_t PageX, uint32_t PageY, std::vector<uint8_t>& OutPixels)
+	{
+		const uint32_t Total = CookedVirtualTexture::PageTotalSize;
+		OutPixels.resize(size_t(Total) * Total * 4);
+
+		const int64_t OriginX = int64_t(PageX) * CookedVirtualTexture::PageSize - CookedVirtualTexture::BorderSize;
+		const int64_t OriginY = int64_t(PageY) * CookedVirtualTexture::PageSize - CookedVirtualTexture::BorderSize;
+		for (uint32_t Y = 0; Y < Total; Y++)
+		{
+			const uint32_t SourceY = static_cast<uint32_t>((OriginY + Y + LevelSize) % LevelSize);
+			for (uint32_t X = 0; X < Total; X++)
+			{
+				const uint32_t SourceX = static_cast<uint32_t>((OriginX + X + LevelSize) % LevelSize);
+				const uint8_t* Pixel = &Level[(size_t(SourceY) * LevelSize + SourceX) * 4];
+				std::copy(Pixel, Pixel + 4, &OutPixels[(size_t(Y) * Total + X) * 4]);
+			}
+		}
+	}
+}
+
+bool VirtualTextureCooker::IsCandidate(const std::string& SourcePath)
+{
+	int Width, Height, Components;
+	if (!stbi_info(SourcePath.c_str(), &Width, &Height, &Components))
+	{
+		return false;
+	}
+	return uint32_t(std::max(Width, Height)) >= MinSize;
+}
+
+bool VirtualTextureCooker::Cook(const std::string& SourcePath, const std::string& CookedPath)
+{
+	// the engine loads images flipped (see Application::Run), cooked data has to match
+	stbi_set_flip_vertically_on_load(true);
+
+	int Width, Height, Components;
+	unsigned char* Data = stbi_load(SourcePath.c_str(), &Width, &Height, &Components, 4);
+	if (!Data)
+	{
+		std::cout << "ERROR::VIRTUALTEXTURECOOKER::Failed to load " << SourcePath << std::endl;
+		return false;
+	}
+
+	const uint32_t Size = std::max(CookedVirtualTexture::PageSize, std::min(MaxSize, RoundUpToPowerOfTwo(uint32_t(std::max(Width, Height)))));
+
+	std::vector<uint8_t> Level;
+	if (uint32_t(Width) == Size && uint32_t(Height) == Size)
+	{
+		Level.assign(Data, Data + size_t(Size) * Size * 4);
+	}
+	else
+	{
+		ResampleSquare(Data, static_cast<uint32_t>(Width), static_cast<uint32_t>(Height), Size, Level);
+	}
+	stbi_image_free(Data);
+
+	const uint32_t LevelCount = CookedVirtualTexture::GetLevelCount(Size);
+	const uint32_t PageCount = CookedVirtualTexture::GetPageIndex(Size, LevelCount - 1, 0, 0) + 1;
+	std::vector<std::vector<uint8_t>> Pages(PageCount);
+
+	uint32_t LevelSize = Size;
+	std::vector<uint8_t> NextLevel;
+	for (uint32_t LevelIndex = 0; LevelIndex < LevelCount; LevelIndex++)
+	{
+		const uint32_t PagesPerSide = CookedVirtualTexture::GetPagesPerSide(Size, LevelIndex);
+		const uint32_t FirstPage = CookedVirtualTexture::GetPageIndex(Size, LevelIndex, 0, 0);
+		ThreadPool::Get().ParallelFor(size_t(PagesPerSide) * PagesPerSide, [&](size_t Page)
+		{
+			std::vector<uint8_t> Pixels;
+			ExtractPage(Level, LevelSize, uint32_t(Page % PagesPerSide), uint32_t(Page / PagesPerSide), Pixels);
+			TextureCooker::CompressLevel(Pixels, CookedVirtualTexture::PageTotalSize, CookedVirtualTexture::PageTotalSize, ETextureFormat::BC3, Pages[FirstPage + Page]);
+		});
+
+		if (LevelIndex + 1 < LevelCount)
+		{
+			TextureCooker::DownsampleMip(Level, LevelSize, LevelSize, NextLevel);
+			Level.swap(NextLevel);
+			LevelSize /= 2;
+		}
+	}
+
+	return CookedVirtualTexture::Write(CookedPath, ETextureFormat::BC3, Size, Pages);
+}
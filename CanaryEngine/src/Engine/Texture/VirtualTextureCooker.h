@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Offline half of virtual texturing, used by CanaryCooker: turns a large source image into a .cvt page file (see
+// CookedVirtualTexture.h) that VirtualTextureSystem streams page by page.
+namespace VirtualTextureCooker
+{
+	// Images smaller than this along their longer side are cheap enough to keep resident as ordinary textures
+	const uint32_t MinSize = 2048;
+
+	// Level 0 is clamped to this size, larger sources are downsampled
+	const uint32_t MaxSize = 16384;
+
+	// Reads only the image header
+	bool IsCandidate(const std::string& SourcePath);
+
+	// Every page is BC3 so pages of any virtual texture can share the one physical cache texture
+	bool Cook(const std::string& SourcePath, const std::string& CookedPath);
+}
@@ -0,0 +1,663 @@
+#include "VirtualTextureSystem.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <iostream>
+
+#include "TextureLoader.h"
+#include "Engine/Core/CookedFile.h"
+#include "Engine/Core/Paths.h"
+#include "Engine/Renderer/GLStateCache.h"
+#include "Engine/Renderer/RenderStats.h"
+#include "Engine/Shader/ShaderProgram.h"
+
+namespace
+{
+	const uint32_t PhysicalSize = VirtualTextureSystem::PhysicalPagesPerSide * CookedVirtualTexture::PageTotalSize;
+
+	// Indirection texels are RGBA8: cache slot x and y, level of the page and 255 once the texel points at a page
+	uint32_t PackIndirection(int Slot, uint32_t Level)
+	{
+		const uint32_t SlotX = uint32_t(Slot) % VirtualTextureSystem::PhysicalPagesPerSide;
+		const uint32_t SlotY = uint32_t(Slot) / VirtualTextureSystem::PhysicalPagesPerSide;
+		return SlotX | (SlotY << 8) | (Level << 16) | (255u << 24);
+	}
+}
+
+VirtualTextureSystem& VirtualTextureSystem::Get()
+{
+	static VirtualTextureSystem System;
+	return System;
+}
+
+uint64_t VirtualTextureSystem::MakeKey(uint32_t TextureIndex, uint32_t Level, uint32_t PageX, uint32_t PageY)
+{
+	return (uint64_t(TextureIndex) << 48) | (uint64_t(Level) << 40) | (uint64_t(PageY) << 20) | uint64_t(PageX);
+}
+
+void VirtualTextureSystem::SplitKey(uint64_t Key, uint32_t& OutTextureIndex, uint32_t& OutLevel, uint32_t& OutPageX, uint32_t& OutPageY)
+{
+	OutTextureIndex = uint32_t(Key >> 48);
+	OutLevel = uint32_t(Key >> 40) & 0xFF;
+	OutPageY = uint32_t(Key >> 20) & 0xFFFFF;
+	OutPageX = uint32_t(Key) & 0xFFFFF;
+}
+
+int VirtualTextureSystem::Find(const std::string& TexturePath, const std::string& TextureType)
+{
+	if (!IsVirtualSlot(TextureType))
+	{
+		return -1;
+	}
+
+	const std::string Key = Paths::ToArchivePath(TexturePath);
+	auto Found = TexturesByPath.find(Key);
+	if (Found != TexturesByPath.end())
+	{
+		return Found->second;
+	}
+
+	const std::string CookedPath = CookedVirtualTexture::GetCookedPath(TexturePath);
+	if (!VirtualFileSystem::Get().Exists(CookedPath) || !CookedFile::IsUpToDate(CookedPath, TexturePath))
+	{
+		return -1;
+	}
+
+	// every texture pins its coarsest page, half the cache is left for streaming
+	if (Textures.size() >= GetPhysicalPageCount() / 2)
+	{
+		std::cout << "ERROR::VIRTUALTEXTURESYSTEM::Too many virtual textures, loading " << TexturePath << " as a regular texture" << std::endl;
+		return -1;
+	}
+
+	std::unique_ptr<CookedVirtualTextureFile> File(new CookedVirtualTextureFile());
+	if (!File->Open(CookedPath))
+	{
+		return -1;
+	}
+	if (File->GetFormat() != ETextureFormat::BC3)
+	{
+		std::cout << "ERROR::VIRTUALTEXTURESYSTEM::Pages of " << CookedPath << " are not BC3, re-cook it" << std::endl;
+		return -1;
+	}
+
+	if (PhysicalTexture == 0 && !CreateCache())
+	{
+		return -1;
+	}
+
+	// the coarsest page is what the shader falls back to, it has to be there before the first draw. With every page
+	// in use and wanted this frame there is no slot for it.
+	const int CoarsestSlot = FindFreeSlot();
+	if (CoarsestSlot < 0)
+	{
+		std::cout << "ERROR::VIRTUALTEXTURESYSTEM::Page cache is full, loading " << TexturePath << " as a regular texture" << std::endl;
+		return -1;
+	}
+
+	const uint32_t Size = File->GetSize();
+	const uint32_t LevelCount = File->GetLevelCount();
+
+	VirtualTexture NewTexture;
+	NewTexture.Path = TexturePath;
+	NewTexture.IndirectionLevels.resize(LevelCount);
+
+	glGenTextures(1, &NewTexture.Indirection);
+	GLStateCache::Get().BindTexture(IndirectionTextureUnit, GL_TEXTURE_2D, NewTexture.Indirection);
+	for (uint32_t Level = 0; Level < LevelCount; Level++)
+	{
+		const uint32_t Pages = CookedVirtualTexture::GetPagesPerSide(Size, Level);
+		NewTexture.IndirectionLevels[Level].assign(size_t(Pages) * Pages, 0);
+		glTexImage2D(GL_TEXTURE_2D, Level, GL_RGBA8, Pages, Pages, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	}
+	// read with texelFetch, the filtering state only has to make the texture complete
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, LevelCount - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	const uint32_t TextureIndex = static_cast<uint32_t>(Textures.size());
+	NewTexture.File = std::move(File);
+	Textures.push_back(std::move(NewTexture));
+	TexturesByPath[Key] = static_cast<int>(TextureIndex);
+
+	VirtualTexture& Texture = Textures.back();
+	const uint32_t CoarsestPage = CookedVirtualTexture::GetPageIndex(Size, LevelCount - 1, 0, 0);
+	UploadPage(CoarsestSlot, MakeKey(TextureIndex, LevelCount - 1, 0, 0), Texture.File->GetPageData(CoarsestPage),
+		static_cast<size_t>(Texture.File->GetPage(CoarsestPage).Size), true);
+	UpdateIndirection(TextureIndex, Texture);
+
+	if (!StreamingThread.joinable())
+	{
+		StreamingThread = std::thread(&VirtualTextureSystem::StreamingLoop, this);
+	}
+
+	return static_cast<int>(TextureIndex);
+}
+
+void VirtualTextureSystem::Bind(int VirtualTextureIndex, ShaderProgram& Shader)
+{
+	const VirtualTexture& Texture = Textures[VirtualTextureIndex];
+
+	// the physical cache stays on its unit for every virtual texture, only the indirection changes between them
+	GLStateCache& StateCache = GLStateCache::Get();
+	RenderStats::Get().TextureBinds += StateCache.BindTexture(PhysicalTextureUnit, GL_TEXTURE_2D, PhysicalTexture) ? 1 : 0;
+	RenderStats::Get().TextureBinds += StateCache.BindTexture(IndirectionTextureUnit, GL_TEXTURE_2D, Texture.Indirection) ? 1 : 0;
+
+	Shader.SetInt("vt_physical", PhysicalTextureUnit);
+	Shader.SetVec4("vt_physical_info", float(CookedVirtualTexture::PageSize), float(CookedVirtualTexture::BorderSize),
+		float(CookedVirtualTexture::PageTotalSize), float(PhysicalSize));
+	Shader.SetInt("texture_diffuse_vt_indirection", IndirectionTextureUnit);
+	Shader.SetVec4("texture_diffuse_vt_info", float(CookedVirtualTexture::GetPagesPerSide(Texture.File->GetSize(), 0)),
+		float(Texture.File->GetLevelCount()), float(VirtualTextureIndex + 1), 0.0f);
+}
+
+void VirtualTextureSystem::BindNone(ShaderProgram& Shader)
+{
+	Shader.SetInt("vt_physical", PhysicalTextureUnit);
+	Shader.SetInt("texture_diffuse_vt_indirection", IndirectionTextureUnit);
+	Shader.SetVec4("texture_diffuse_vt_info", 0.0f, 0.0f, 0.0f, 0.0f);
+}
+
+bool VirtualTextureSystem::CreateCache()
+{
+	if (!TextureLoader::IsFormatSupported(ETextureFormat::BC3))
+	{
+		std::cout << "ERROR::VIRTUALTEXTURESYSTEM::BC3 is not supported by the driver, virtual texturing is disabled" << std::endl;
+		return false;
+	}
+
+	glGenTextures(1, &PhysicalTexture);
+	GLStateCache::Get().BindTexture(PhysicalTextureUnit, GL_TEXTURE_2D, PhysicalTexture);
+	glCompressedTexImage2D(GL_TEXTURE_2D, 0, TextureLoader::GetInternalFormat(ETextureFormat::BC3), PhysicalSize, PhysicalSize, 0,
+		static_cast<GLsizei>(CookedTexture::GetLevelSize(ETextureFormat::BC3, PhysicalSize, PhysicalSize)), nullptr);
+	// pages carry their own border, so plain bilinear filtering of level 0 never bleeds into a neighbouring page
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	PhysicalPages.assign(GetPhysicalPageCount(), PhysicalPage());
+
+	FeedbackBuffers.resize(FeedbackBufferCount);
+	for (FeedbackBuffer& Buffer : FeedbackBuffers)
+	{
+		glGenBuffers(1, &Buffer.Buffer);
+	}
+
+	return true;
+}
+
+void VirtualTextureSystem::CreateFeedbackTarget(uint32_t Width, uint32_t Height)
+{
+	if (FeedbackFramebuffer == 0)
+	{
+		glGenFramebuffers(1, &FeedbackFramebuffer);
+		glGenRenderbuffers(1, &FeedbackColor);
+		glGenRenderbuffers(1, &FeedbackDepth);
+	}
+
+	glBindRenderbuffer(GL_RENDERBUFFER, FeedbackColor);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA16UI, Width, Height);
+	glBindRenderbuffer(GL_RENDERBUFFER, FeedbackDepth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, Width, Height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, FeedbackFramebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, FeedbackColor);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, FeedbackDepth);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "ERROR::VIRTUALTEXTURESYSTEM::Feedback framebuffer is not complete" << std::endl;
+	}
+
+	FeedbackWidth = Width;
+	FeedbackHeight = Height;
+}
+
+bool VirtualTextureSystem::BeginFeedback()
+{
+	if (Textures.empty() || FeedbackBuffers[NextFeedbackBuffer].bPending)
+	{
+		return false;
+	}
+
+	glGetIntegerv(GL_VIEWPORT, SavedViewport);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &SavedFramebuffer);
+
+	const uint32_t Width = std::max<uint32_t>(1, uint32_t(SavedViewport[2]) / FeedbackDivisor);
+	const uint32_t Height = std::max<uint32_t>(1, uint32_t(SavedViewport[3]) / FeedbackDivisor);
+	if (Width != FeedbackWidth || Height != FeedbackHeight)
+	{
+		CreateFeedbackTarget(Width, Height);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, FeedbackFramebuffer);
+	glViewport(0, 0, Width, Height);
+
+	// texture id 0 marks pixels that want nothing
+	const GLuint NoPage[4] = { 0, 0, 0, 0 };
+	glClearBufferuiv(GL_COLOR, 0, NoPage);
+	glClear(GL_DEPTH_BUFFER_BIT);
+	return true;
+}
+
+void VirtualTextureSystem::EndFeedback()
+{
+	FeedbackBuffer& Buffer = FeedbackBuffers[NextFeedbackBuffer];
+	Buffer.Width = FeedbackWidth;
+	Buffer.Height = FeedbackHeight;
+
+	// the copy lands in the pixel buffer asynchronously, ReadFeedback maps it once the fence has signalled
+	GLStateCache::Get().BindBuffer(GL_PIXEL_PACK_BUFFER, Buffer.Buffer);
+	glBufferData(GL_PIXEL_PACK_BUFFER, size_t(Buffer.Width) * Buffer.Height * 4 * sizeof(uint16_t), nullptr, GL_STREAM_READ);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glReadPixels(0, 0, Buffer.Width, Buffer.Height, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, nullptr);
+	GLStateCache::Get().BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	Buffer.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	Buffer.bPending = true;
+	NextFeedbackBuffer = (NextFeedbackBuffer + 1) % FeedbackBufferCount;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, SavedFramebuffer);
+	glViewport(SavedViewport[0], SavedViewport[1], SavedViewport[2], SavedViewport[3]);
+}
+
+void VirtualTextureSystem::ReadFeedback()
+{
+	// buffers complete in the order they were filled, the newest finished one is all that matters
+	for (uint32_t i = 0; i < FeedbackBufferCount; i++)
+	{
+		FeedbackBuffer& Buffer = FeedbackBuffers[(NextFeedbackBuffer + i) % FeedbackBufferCount];
+		if (!Buffer.bPending || glClientWaitSync(static_cast<GLsync>(Buffer.Fence), 0, 0) == GL_TIMEOUT_EXPIRED)
+		{
+			continue;
+		}
+		glDeleteSync(static_cast<GLsync>(Buffer.Fence));
+		Buffer.Fence = nullptr;
+		Buffer.bPending = false;
+
+		FeedbackJob Job;
+		Job.Pixels.resize(size_t(Buffer.Width) * Buffer.Height * 4);
+		Job.LevelCounts.reserve(Textures.size());
+		for (const VirtualTexture& Texture : Textures)
+		{
+			Job.LevelCounts.push_back(Texture.File->GetLevelCount());
+		}
+
+		GLStateCache::Get().BindBuffer(GL_PIXEL_PACK_BUFFER, Buffer.Buffer);
+		const void* Mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, Job.Pixels.size() * sizeof(uint16_t), GL_MAP_READ_BIT);
+		if (Mapped)
+		{
+			std::copy_n(static_cast<const uint16_t*>(Mapped), Job.Pixels.size(), Job.Pixels.data());
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		GLStateCache::Get().BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		if (Mapped)
+		{
+			std::lock_guard<std::mutex> Lock(Mutex);
+			FeedbackJobs.clear();
+			FeedbackJobs.push_back(std::move(Job));
+			WorkAvailable.notify_one();
+		}
+	}
+}
+
+void VirtualTextureSystem::AnalyseFeedback(const FeedbackJob& Job, std::vector<WantedPage>& OutPages) const
+{
+	std::unordered_map<uint64_t, uint32_t> Counts;
+	for (size_t Pixel = 0; Pixel + 3 < Job.Pixels.size(); Pixel += 4)
+	{
+		const uint32_t Id = Job.Pixels[Pixel + 3];
+		if (Id == 0 || Id > Job.LevelCounts.size())
+		{
+			continue;
+		}
+
+		// every coarser page covering the wanted one is needed too, so the chain has no holes to fall back through
+		const uint32_t LevelCount = Job.LevelCounts[Id - 1];
+		uint32_t PageX = Job.Pixels[Pixel];
+		uint32_t PageY = Job.Pixels[Pixel + 1];
+		for (uint32_t Level = Job.Pixels[Pixel + 2]; Level < LevelCount; Level++)
+		{
+			Counts[MakeKey(Id - 1, Level, PageX, PageY)]++;
+			PageX /= 2;
+			PageY /= 2;
+		}
+	}
+
+	OutPages.clear();
+	OutPages.reserve(Counts.size());
+	for (const auto& Entry : Counts)
+	{
+		WantedPage Page;
+		Page.Key = Entry.first;
+		Page.Count = Entry.second;
+		OutPages.push_back(Page);
+	}
+
+	// coarse levels first, then the pages covering the most pixels
+	std::sort(OutPages.begin(), OutPages.end(), [](const WantedPage& A, const WantedPage& B)
+	{
+		const uint32_t LevelA = uint32_t(A.Key >> 40) & 0xFF;
+		const uint32_t LevelB = uint32_t(B.Key >> 40) & 0xFF;
+		if (LevelA != LevelB)
+		{
+			return LevelA > LevelB;
+		}
+		return A.Count != B.Count ? A.Count > B.Count : A.Key < B.Key;
+	});
+}
+
+void VirtualTextureSystem::ApplyWantedPages(const std::vector<WantedPage>& Pages)
+{
+	// loads that have not started yet were wanted by older feedback, the new list replaces them
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		for (const PageLoad& Stale : LoadJobs)
+		{
+			InFlight.erase(Stale.Key);
+		}
+		LoadJobs.clear();
+	}
+
+	std::vector<PageLoad> Loads;
+	for (const WantedPage& Page : Pages)
+	{
+		auto Resident = ResidentPages.find(Page.Key);
+		if (Resident != ResidentPages.end())
+		{
+			PhysicalPages[Resident->second].LastWantedFrame = Frame;
+			continue;
+		}
+		if (Loads.size() >= MaxPageRequestsPerFrame || InFlight.count(Page.Key) > 0)
+		{
+			continue;
+		}
+
+		uint32_t TextureIndex, Level, PageX, PageY;
+		SplitKey(Page.Key, TextureIndex, Level, PageX, PageY);
+		if (TextureIndex >= Textures.size())
+		{
+			continue;
+		}
+		const CookedVirtualTextureFile& File = *Textures[TextureIndex].File;
+		const uint32_t PagesPerSide = CookedVirtualTexture::GetPagesPerSide(File.GetSize(), Level);
+		if (Level >= File.GetLevelCount() || PageX >= PagesPerSide || PageY >= PagesPerSide)
+		{
+			continue;
+		}
+
+		const uint32_t PageIndex = CookedVirtualTexture::GetPageIndex(File.GetSize(), Level, PageX, PageY);
+		PageLoad Load;
+		Load.Key = Page.Key;
+		Load.Source = File.GetPageData(PageIndex);
+		Load.Size = static_cast<size_t>(File.GetPage(PageIndex).Size);
+		Loads.push_back(std::move(Load));
+		InFlight.insert(Page.Key);
+	}
+
+	std::lock_guard<std::mutex> Lock(Mutex);
+	for (PageLoad& Load : Loads)
+	{
+		LoadJobs.push_back(std::move(Load));
+	}
+	if (!LoadJobs.empty())
+	{
+		WorkAvailable.notify_one();
+	}
+}
+
+void VirtualTextureSystem::StreamingLoop()
+{
+	std::unique_lock<std::mutex> Lock(Mutex);
+	while (true)
+	{
+		WorkAvailable.wait(Lock, [this]()
+		{
+			return bStopping || !FeedbackJobs.empty() || !LoadJobs.empty();
+		});
+		if (bStopping)
+		{
+			return;
+		}
+
+		if (!FeedbackJobs.empty())
+		{
+			FeedbackJob Job = std::move(FeedbackJobs.front());
+			FeedbackJobs.pop_front();
+			Lock.unlock();
+
+			std::vector<WantedPage> Pages;
+			AnalyseFeedback(Job, Pages);
+
+			Lock.lock();
+			AnalysedPages.swap(Pages);
+			bAnalysisReady = true;
+			continue;
+		}
+
+		// reading the page out of the mapping is what faults it in from disk
+		PageLoad Load = std::move(LoadJobs.front());
+		LoadJobs.pop_front();
+		Lock.unlock();
+
+		Load.Data.assign(Load.Source, Load.Source + Load.Size);
+
+		Lock.lock();
+		LoadedPages.push_back(std::move(Load));
+	}
+}
+
+int VirtualTextureSystem::FindFreeSlot()
+{
+	int Oldest = -1;
+	for (size_t Slot = 0; Slot < PhysicalPages.size(); Slot++)
+	{
+		const PhysicalPage& Page = PhysicalPages[Slot];
+		if (!Page.bUsed)
+		{
+			return static_cast<int>(Slot);
+		}
+		if (!Page.bPinned && Page.LastWantedFrame < Frame && (Oldest < 0 || Page.LastWantedFrame < PhysicalPages[Oldest].LastWantedFrame))
+		{
+			Oldest = static_cast<int>(Slot);
+		}
+	}
+
+	if (Oldest >= 0)
+	{
+		PhysicalPage& Evicted = PhysicalPages[Oldest];
+		uint32_t TextureIndex, Level, PageX, PageY;
+		SplitKey(Evicted.Key, TextureIndex, Level, PageX, PageY);
+		Textures[TextureIndex].bDirty = true;
+		ResidentPages.erase(Evicted.Key);
+		ResidentPageCount--;
+		Evicted = PhysicalPage();
+	}
+	return Oldest;
+}
+
+void VirtualTextureSystem::UploadPage(int Slot, uint64_t Key, const uint8_t* Data, size_t Size, bool bPinned)
+{
+	const uint32_t SlotX = uint32_t(Slot) % PhysicalPagesPerSide;
+	const uint32_t SlotY = uint32_t(Slot) / PhysicalPagesPerSide;
+
+	// the texture streamer may have left its ring buffer bound
+	GLStateCache::Get().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	GLStateCache::Get().BindTexture(PhysicalTextureUnit, GL_TEXTURE_2D, PhysicalTexture);
+	glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, SlotX * CookedVirtualTexture::PageTotalSize, SlotY * CookedVirtualTexture::PageTotalSize,
+		CookedVirtualTexture::PageTotalSize, CookedVirtualTexture::PageTotalSize, TextureLoader::GetInternalFormat(ETextureFormat::BC3),
+		static_cast<GLsizei>(Size), Data);
+
+	PhysicalPage& Page = PhysicalPages[Slot];
+	Page.Key = Key;
+	Page.LastWantedFrame = Frame;
+	Page.bUsed = true;
+	Page.bPinned = bPinned;
+	ResidentPages[Key] = Slot;
+	ResidentPageCount++;
+
+	uint32_t TextureIndex, Level, PageX, PageY;
+	SplitKey(Key, TextureIndex, Level, PageX, PageY);
+	Textures[TextureIndex].bDirty = true;
+}
+
+void VirtualTextureSystem::UpdateIndirection(uint32_t TextureIndex, VirtualTexture& Texture)
+{
+	const uint32_t Size = Texture.File->GetSize();
+	const uint32_t LevelCount = Texture.File->GetLevelCount();
+
+	GLStateCache::Get().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	GLStateCache::Get().BindTexture(IndirectionTextureUnit, GL_TEXTURE_2D, Texture.Indirection);
+
+	// top down, a page that is not resident inherits whatever its parent points at
+	for (uint32_t Level = LevelCount; Level-- > 0;)
+	{
+		const uint32_t Pages = CookedVirtualTexture::GetPagesPerSide(Size, Level);
+		const uint32_t ParentPages = CookedVirtualTexture::GetPagesPerSide(Size, Level + 1);
+		std::vector<uint32_t>& Entries = Texture.IndirectionLevels[Level];
+		for (uint32_t PageY = 0; PageY < Pages; PageY++)
+		{
+			for (uint32_t PageX = 0; PageX < Pages; PageX++)
+			{
+				auto Resident = ResidentPages.find(MakeKey(TextureIndex, Level, PageX, PageY));
+				if (Resident != ResidentPages.end())
+				{
+					Entries[PageY * Pages + PageX] = PackIndirection(Resident->second, Level);
+				}
+				else
+				{
+					Entries[PageY * Pages + PageX] = Level + 1 < LevelCount ? Texture.IndirectionLevels[Level + 1][(PageY / 2) * ParentPages + PageX / 2] : 0;
+				}
+			}
+		}
+		glTexSubImage2D(GL_TEXTURE_2D, Level, 0, 0, Pages, Pages, GL_RGBA, GL_UNSIGNED_BYTE, Entries.data());
+	}
+
+	Texture.bDirty = false;
+}
+
+void VirtualTextureSystem::Update()
+{
+	if (Textures.empty())
+	{
+		return;
+	}
+
+	Frame++;
+	ReadFeedback();
+
+	std::vector<WantedPage> Wanted;
+	std::vector<PageLoad> Loaded;
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		if (bAnalysisReady)
+		{
+			Wanted.swap(AnalysedPages);
+			bAnalysisReady = false;
+		}
+		while (!LoadedPages.empty() && Loaded.size() < MaxPageUploadsPerFrame)
+		{
+			Loaded.push_back(std::move(LoadedPages.front()));
+			LoadedPages.pop_front();
+		}
+	}
+
+	// touching what is wanted first keeps those pages from being evicted by this frame's uploads
+	if (!Wanted.empty())
+	{
+		ApplyWantedPages(Wanted);
+	}
+
+	RenderStats& Stats = RenderStats::Get();
+	for (const PageLoad& Load : Loaded)
+	{
+		InFlight.erase(Load.Key);
+		if (ResidentPages.count(Load.Key) > 0)
+		{
+			continue;
+		}
+
+		// with the whole cache wanted this frame the page waits for the next feedback to ask for it again
+		const int Slot = FindFreeSlot();
+		if (Slot < 0)
+		{
+			continue;
+		}
+		UploadPage(Slot, Load.Key, Load.Data.data(), Load.Data.size(), false);
+		Stats.VirtualPagesUploaded++;
+	}
+
+	for (uint32_t TextureIndex = 0; TextureIndex < Textures.size(); TextureIndex++)
+	{
+		if (Textures[TextureIndex].bDirty)
+		{
+			UpdateIndirection(TextureIndex, Textures[TextureIndex]);
+		}
+	}
+
+	Stats.VirtualPagesResident = ResidentPageCount;
+	Stats.VirtualPagesPending = static_cast<unsigned int>(InFlight.size());
+}
+
+void VirtualTextureSystem::Shutdown()
+{
+	if (StreamingThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> Lock(Mutex);
+			bStopping = true;
+		}
+		WorkAvailable.notify_one();
+		StreamingThread.join();
+	}
+
+	for (VirtualTexture& Texture : Textures)
+	{
+		GLStateCache::Get().DeleteTextures(1, &Texture.Indirection);
+	}
+	for (FeedbackBuffer& Buffer : FeedbackBuffers)
+	{
+		if (Buffer.Fence)
+		{
+			glDeleteSync(static_cast<GLsync>(Buffer.Fence));
+		}
+		GLStateCache::Get().DeleteBuffers(1, &Buffer.Buffer);
+	}
+	if (PhysicalTexture != 0)
+	{
+		GLStateCache::Get().DeleteTextures(1, &PhysicalTexture);
+	}
+	if (FeedbackFramebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &FeedbackFramebuffer);
+		glDeleteRenderbuffers(1, &FeedbackColor);
+		glDeleteRenderbuffers(1, &FeedbackDepth);
+	}
+
+	Textures.clear();
+	TexturesByPath.clear();
+	PhysicalTexture = 0;
+	PhysicalPages.clear();
+	ResidentPages.clear();
+	ResidentPageCount = 0;
+	FeedbackFramebuffer = FeedbackColor = FeedbackDepth = 0;
+	FeedbackWidth = FeedbackHeight = 0;
+	FeedbackBuffers.clear();
+	NextFeedbackBuffer = 0;
+
+	FeedbackJobs.clear();
+	LoadJobs.clear();
+	AnalysedPages.clear();
+	bAnalysisReady = false;
+	LoadedPages.clear();
+	InFlight.clear();
+	bStopping = false;
+}
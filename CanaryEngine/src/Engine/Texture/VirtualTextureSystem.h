@@ -0,0 +1,182 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "CookedVirtualTexture.h"
+
+class ShaderProgram;
+
+// Runtime side of virtual texturing for material textures too large to keep resident (see CookedVirtualTexture.h).
+// Pages of every virtual texture share one physical page cache texture. Each virtual texture has an indirection
+// texture with one texel per page and a mip level per page level; a texel holds the cache slot of the finest resident
+// page covering it, so the shader always finds something to sample and pages sharpen as they arrive.
+// Which pages are needed comes from the GPU: a feedback pass draws the scene at a fraction of the resolution
+// writing the page each pixel wants, the result is read back through pixel buffers a few frames later and a
+// streaming thread turns it into a prioritised list of pages (coarse levels first, then by how many pixels want
+// them). Pages are read on that thread and uploaded by Update() within a per-frame limit, evicting the least recently
+// wanted pages. The coarsest page of each texture is loaded up front and never evicted.
+// Everything except the feedback analysis and page reads runs on the GL thread.
+class VirtualTextureSystem
+{
+public:
+	// The physical cache is PhysicalPagesPerSide^2 pages of CookedVirtualTexture::PageTotalSize texels
+	static const uint32_t PhysicalPagesPerSide = 32;
+
+	// The feedback pass runs at 1/FeedbackDivisor of the screen resolution along each axis
+	static const uint32_t FeedbackDivisor = 8;
+	static const uint32_t FeedbackBufferCount = 3;
+
+	static const uint32_t MaxPageRequestsPerFrame = 32;
+	static const uint32_t MaxPageUploadsPerFrame = 16;
+
+	// Atlas arrays use units 8 to 10 (see TextureAtlas.h)
+	static const unsigned int PhysicalTextureUnit = 11;
+	static const unsigned int IndirectionTextureUnit = 12;
+
+	VirtualTextureSystem() = default;
+	~VirtualTextureSystem() = default;
+
+	VirtualTextureSystem(const VirtualTextureSystem&) = delete;
+	VirtualTextureSystem& operator=(const VirtualTextureSystem&) = delete;
+
+	static VirtualTextureSystem& Get();
+
+	// True for material slots that can be virtual. ObjectFragmentShader.frag only samples the diffuse slot, a
+	// virtual texture anywhere else would stream pages nothing reads.
+	static bool IsVirtualSlot(const std::string& TextureType) { return TextureType == "texture_diffuse"; }
+
+	// Index of the virtual texture cooked for the image, -1 if it has no up to date .cvt or the slot cannot be
+	// virtual. Creates the cache on first use.
+	int Find(const std::string& TexturePath, const std::string& TextureType);
+
+	// Binds the cache and the texture's indirection and sets the texture_diffuse_vt uniforms
+	void Bind(int VirtualTextureIndex, ShaderProgram& Shader);
+
+	// Points the samplers at their units and marks the diffuse slot as not virtual
+	static void BindNone(ShaderProgram& Shader);
+
+	// Renders into the feedback target, returns false when there is nothing virtual or no readback buffer is free.
+	// Draw the scene with the feedback shader in between, EndFeedback restores the framebuffer and viewport.
+	bool BeginFeedback();
+	void EndFeedback();
+
+	// Applies finished feedback and uploads streamed pages, call once per frame on the GL thread
+	void Update();
+
+	// Stops the streaming thread and frees every GL object while the GL context is current
+	void Shutdown();
+
+	size_t GetVirtualTextureCount() const { return Textures.size(); }
+	uint32_t GetResidentPageCount() const { return ResidentPageCount; }
+	uint32_t GetPhysicalPageCount() const { return PhysicalPagesPerSide * PhysicalPagesPerSide; }
+
+private:
+	struct VirtualTexture
+	{
+		std::string Path;
+		std::unique_ptr<CookedVirtualTextureFile> File;
+		unsigned int Indirection = 0;
+		std::vector<std::vector<uint32_t>> IndirectionLevels; // CPU copy, RGBA8 per page
+		bool bDirty = true;
+	};
+
+	struct PhysicalPage
+	{
+		uint64_t Key = 0;
+		uint64_t LastWantedFrame = 0;
+		bool bUsed = false;
+		bool bPinned = false;
+	};
+
+	// Feedback read back from the GPU, analysed on the streaming thread
+	struct FeedbackJob
+	{
+		std::vector<uint16_t> Pixels;      // RGBA16UI: page x, page y, level, texture index + 1
+		std::vector<uint32_t> LevelCounts; // of every texture, the thread never looks at Textures
+	};
+
+	struct WantedPage
+	{
+		uint64_t Key = 0;
+		uint32_t Count = 0;
+	};
+
+	struct PageLoad
+	{
+		uint64_t Key = 0;
+		const uint8_t* Source = nullptr; // inside the texture's mapping, which stays open until Shutdown
+		size_t Size = 0;
+		std::vector<uint8_t> Data;
+	};
+
+	struct FeedbackBuffer
+	{
+		unsigned int Buffer = 0;
+		void* Fence = nullptr; // GLsync of the glReadPixels into the buffer
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		bool bPending = false;
+	};
+
+	static uint64_t MakeKey(uint32_t TextureIndex, uint32_t Level, uint32_t PageX, uint32_t PageY);
+	static void SplitKey(uint64_t Key, uint32_t& OutTextureIndex, uint32_t& OutLevel, uint32_t& OutPageX, uint32_t& OutPageY);
+
+	bool CreateCache();
+	void CreateFeedbackTarget(uint32_t Width, uint32_t Height);
+
+	// Slot to load a page into, -1 when every page is pinned or wanted this frame
+	int FindFreeSlot();
+	void UploadPage(int Slot, uint64_t Key, const uint8_t* Data, size_t Size, bool bPinned);
+
+	// Rebuilds the indirection of a texture whose resident pages changed
+	void UpdateIndirection(uint32_t TextureIndex, VirtualTexture& Texture);
+
+	void ReadFeedback();
+	void ApplyWantedPages(const std::vector<WantedPage>& Pages);
+
+	void StreamingLoop();
+	void AnalyseFeedback(const FeedbackJob& Job, std::vector<WantedPage>& OutPages) const;
+
+	std::vector<VirtualTexture> Textures;
+	std::unordered_map<std::string, int> TexturesByPath;
+
+	unsigned int PhysicalTexture = 0;
+	std::vector<PhysicalPage> PhysicalPages;
+	std::unordered_map<uint64_t, int> ResidentPages; // page key to slot
+	uint32_t ResidentPageCount = 0;
+
+	unsigned int FeedbackFramebuffer = 0;
+	unsigned int FeedbackColor = 0;
+	unsigned int FeedbackDepth = 0;
+	uint32_t FeedbackWidth = 0;
+	uint32_t FeedbackHeight = 0;
+	std::vector<FeedbackBuffer> FeedbackBuffers;
+	uint32_t NextFeedbackBuffer = 0;
+	int SavedViewport[4] = {};
+	int SavedFramebuffer = 0;
+
+	uint64_t Frame = 1;
+
+	// streaming thread, the queues are guarded by Mutex
+	std::thread StreamingThread;
+	std::mutex Mutex;
+	std::condition_variable WorkAvailable;
+	bool bStopping = false;
+	std::deque<FeedbackJob> FeedbackJobs;
+	std::deque<PageLoad> LoadJobs;
+	std::vector<WantedPage> AnalysedPages; // latest analysis only, older ones are stale
+	bool bAnalysisReady = false;
+	std::deque<PageLoad> LoadedPages;
+
+	// pages queued for loading or waiting to be uploaded, GL thread only
+	std::unordered_set<uint64_t> InFlight;
+};
@@ -6,6 +6,12 @@
 #include <Imgui/imgui_impl_glfw.h>
 #include <Imgui/imgui_impl_opengl3.h>
 
+#include "Engine/Asset/AssetRegistry.h"
+#include "Engine/Renderer/RenderStats.h"
+#include "Engine/Texture/TextureAtlas.h"
+#include "Engine/Texture/TextureResidency.h"
+#include "Engine/Texture/VirtualTextureSystem.h"
+
 void UIManager::Intialise(GLFWwindow* Window)
 {
     IMGUI_CHECKVERSION();
@@ -69,5 +75,79 @@ void UIManager::AddDebugWindow()
         // Add application exit here
     }
 
+    const RenderStats& Stats = RenderStats::GetLastFrame();
+    ImGui::Text("Draw calls: %u (+%u feedback)", Stats.DrawCalls, Stats.FeedbackDrawCalls);
+    ImGui::Text("Triangles: %u (+%u feedback)", Stats.TrianglesDrawn, Stats.FeedbackTrianglesDrawn);
+    ImGui::Text("Objects culled: %u", Stats.ObjectsCulled);
+    ImGui::Text("Triangles saved by LOD: %u", Stats.TrianglesSavedByLod);
+    ImGui::Text("Clusters drawn: %u, culled: %u", Stats.ClustersDrawn, Stats.ClustersCulled);
+    ImGui::Text("Textures streaming: %u (%.1f KB uploaded)", Stats.TexturesStreaming, Stats.TextureBytesUploaded / 1024.0f);
+    ImGui::Text("Texture binds: %u", Stats.TextureBinds);
+
+    // budget in MB, textures drop their top levels on the next frame when it shrinks
+    TextureResidency& Residency = TextureResidency::Get();
+    int BudgetMB = static_cast<int>(Residency.GetBudget() / (1024 * 1024));
+    ImGui::Text("Texture memory: %.1f MB, %u textures below wanted detail", Stats.TextureTargetBytes / (1024.0f * 1024.0f), Stats.TexturesDegraded);
+    if (ImGui::SliderInt("Texture budget (MB)", &BudgetMB, 16, 2048))
+    {
+        Residency.SetBudget(size_t(BudgetMB) * 1024 * 1024);
+    }
+    ImGui::Text("Atlas: %zu textures (%.1f KB)", TextureAtlas::Get().GetEntryCount(), TextureAtlas::Get().GetGpuBytes() / 1024.0f);
+
+    const VirtualTextureSystem& VirtualTextures = VirtualTextureSystem::Get();
+    ImGui::Text("Virtual textures: %zu, pages %u/%u resident (%u uploaded, %u pending)", VirtualTextures.GetVirtualTextureCount(),
+        Stats.VirtualPagesResident, VirtualTextures.GetPhysicalPageCount(), Stats.VirtualPagesUploaded, Stats.VirtualPagesPending);
+    ImGui::Text("Skinning: %u palette bones, crowd instances %u drawn, %u culled", Stats.SkinningBonesUploaded, Stats.CrowdInstancesDrawn, Stats.CrowdInstancesCulled);
+    ImGui::Text("Sectors: %u resident, %u loading, %.1f MB (%.1f KB uploaded)", Stats.SectorsResident, Stats.SectorsLoading,
+        Stats.SectorBytes / (1024.0f * 1024.0f), Stats.SectorBytesUploaded / 1024.0f);
+    ImGui::Text("Static batches: %u chunks drawn, %u culled, %u objects merged", Stats.BatchChunksDrawn, Stats.BatchChunksCulled,
+        Stats.ObjectsBatched);
+    ImGui::Text("GL state: %u changes, %u redundant skipped", Stats.StateChanges, Stats.StateChangesSkipped);
+
+    AddResidentAssetsView();
+
     ImGui::End();
-}
\ No newline at end of file
+}
+
+void UIManager::AddResidentAssetsView()
+{
+    AssetRegistry::Get().GatherResidentAssets(ResidentAssets);
+
+    size_t TotalGpuBytes = 0;
+    size_t TotalCpuBytes = 0;
+    for (const AssetMemoryInfo& Asset : ResidentAssets)
+    {
+        TotalGpuBytes += Asset.GpuBytes;
+        TotalCpuBytes += Asset.CpuBytes;
+    }
+
+    const float MB = 1024.0f * 1024.0f;
+    if (!ImGui::CollapsingHeader("Resident assets"))
+    {
+        return;
+    }
+
+    ImGui::Text("%u assets, %.2f MB video memory, %.2f MB system memory", static_cast<unsigned int>(ResidentAssets.size()), TotalGpuBytes / MB, TotalCpuBytes / MB);
+
+    // largest first, see AssetRegistry::GatherResidentAssets
+    if (ImGui::BeginTable("ResidentAssets", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY, ImVec2(0.0f, 200.0f)))
+    {
+        ImGui::TableSetupColumn("Asset");
+        ImGui::TableSetupColumn("Kind");
+        ImGui::TableSetupColumn("Refs");
+        ImGui::TableSetupColumn("GPU MB");
+        ImGui::TableSetupColumn("CPU MB");
+        ImGui::TableHeadersRow();
+
+        for (const AssetMemoryInfo& Asset : ResidentAssets)
+        {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(Asset.Path.c_str());
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(Asset.Kind);
+            ImGui::TableNextColumn(); ImGui::Text("%u", Asset.RefCount);
+            ImGui::TableNextColumn(); ImGui::Text("%.2f", Asset.GpuBytes / MB);
+            ImGui::TableNextColumn(); ImGui::Text("%.2f", Asset.CpuBytes / MB);
+        }
+        ImGui::EndTable();
+    }
+}
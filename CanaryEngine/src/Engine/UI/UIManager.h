@@ -1,5 +1,9 @@
 #pragma once
 
+#include <vector>
+
+#include "Engine/Asset/AssetRegistry.h"
+
 struct GLFWwindow;
 
 class UIManager
@@ -14,4 +18,10 @@ public:
 	void Shutdown();
 
 	void AddDebugWindow();
+
+private:
+	// Memory held by every texture and mesh in the asset registry, refreshed each frame
+	void AddResidentAssetsView();
+
+	std::vector<AssetMemoryInfo> ResidentAssets;
 };
\ No newline at end of file